@@ -0,0 +1,668 @@
+/*
+ * Controller benchmark with emulated OpenFlow 1.3 switches ( cbench style ).
+ *
+ * Copyright (C) 2012 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "trema.h"
+
+
+#define DEFAULT_CONTROLLER "localhost"
+#define DEFAULT_SWITCHES 16
+#define DEFAULT_LOOPS 16
+#define DEFAULT_MS_PER_TEST 1000
+#define DEFAULT_MAC_ADDRESSES 100000
+#define DEFAULT_WINDOW 256
+#define FRAME_LENGTH 60
+#define RECV_BUFFER_SIZE ( 256 * 1024 )
+#define SEND_BUFFER_SIZE ( 256 * 1024 )
+#define HANDSHAKE_TIMEOUT 10 // seconds
+
+
+typedef struct {
+  int fd;
+  uint64_t datapath_id;
+  bool ready;
+  uint8_t recv_buffer[ RECV_BUFFER_SIZE ];
+  size_t recv_length;
+  uint8_t send_buffer[ SEND_BUFFER_SIZE ];
+  size_t send_length;
+  buffer *packet_in;          // template, patched in place for every packet-in
+  size_t buffer_id_offset;
+  size_t macsa_offset;
+  uint32_t next_buffer_id;
+  uint32_t outstanding;
+  uint64_t *sent_at;          // send time of each outstanding packet-in, by buffer_id % window
+  uint64_t n_responses;
+} fake_switch;
+
+
+typedef struct {
+  uint64_t *samples;
+  size_t n_samples;
+  size_t size;
+} latency_samples;
+
+
+static fake_switch *switches = NULL;
+static unsigned int n_switches = DEFAULT_SWITCHES;
+static unsigned int n_macs = DEFAULT_MAC_ADDRESSES;
+static uint32_t window = 1;
+static latency_samples latencies = { NULL, 0, 0 };
+static uint64_t n_errors = 0;
+
+
+static struct option long_options[] = {
+  { "controller", 1, NULL, 'c' },
+  { "port", 1, NULL, 'p' },
+  { "switches", 1, NULL, 's' },
+  { "loops", 1, NULL, 'l' },
+  { "ms-per-test", 1, NULL, 'm' },
+  { "delay", 1, NULL, 'D' },
+  { "mac-addresses", 1, NULL, 'M' },
+  { "throughput", 0, NULL, 't' },
+  { "window", 1, NULL, 'w' },
+  { "help", 0, NULL, 'h' },
+  { NULL, 0, NULL, 0  },
+};
+
+static char short_options[] = "c:p:s:l:m:D:M:tw:h";
+
+
+static void
+print_usage( const char *program_name ) {
+  printf(
+    "Controller benchmark with emulated OpenFlow 1.3 switches.\n"
+    "Usage: %s [OPTION]...\n"
+    "\n"
+    "  -c, --controller=HOST       controller host ( default: %s )\n"
+    "  -p, --port=PORT             controller port ( default: %d )\n"
+    "  -s, --switches=N            number of emulated switches ( default: %d )\n"
+    "  -l, --loops=N               number of tests ( default: %d )\n"
+    "  -m, --ms-per-test=N         test length in milliseconds ( default: %d )\n"
+    "  -D, --delay=N               delay in milliseconds before starting tests ( default: 0 )\n"
+    "  -M, --mac-addresses=N       unique source MAC addresses per switch ( default: %d )\n"
+    "  -t, --throughput            throughput mode ( default: latency mode )\n"
+    "  -w, --window=N              outstanding packet-ins per switch in throughput mode ( default: %d )\n"
+    "  -h, --help                  display this help and exit\n",
+    program_name, DEFAULT_CONTROLLER, OFP_TCP_PORT, DEFAULT_SWITCHES, DEFAULT_LOOPS,
+    DEFAULT_MS_PER_TEST, DEFAULT_MAC_ADDRESSES, DEFAULT_WINDOW
+  );
+}
+
+
+static uint64_t
+now_ns( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( uint64_t ) ts.tv_sec * 1000000000ULL + ( uint64_t ) ts.tv_nsec;
+}
+
+
+static void
+add_latency_sample( uint64_t latency ) {
+  if ( latencies.n_samples == latencies.size ) {
+    latencies.size = latencies.size > 0 ? latencies.size * 2 : 65536;
+    latencies.samples = xrealloc( latencies.samples, sizeof( uint64_t ) * latencies.size );
+  }
+  latencies.samples[ latencies.n_samples++ ] = latency;
+}
+
+
+static int
+compare_latency( const void *x, const void *y ) {
+  uint64_t a = *( const uint64_t * ) x;
+  uint64_t b = *( const uint64_t * ) y;
+  return a < b ? -1 : ( a > b ? 1 : 0 );
+}
+
+
+static double
+latency_percentile( double percentile ) {
+  if ( latencies.n_samples == 0 ) {
+    return 0.0;
+  }
+  size_t index = ( size_t ) ( percentile / 100.0 * ( double ) ( latencies.n_samples - 1 ) );
+  return ( double ) latencies.samples[ index ] / 1000.0;
+}
+
+
+static double
+latency_mean( void ) {
+  if ( latencies.n_samples == 0 ) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for ( size_t i = 0; i < latencies.n_samples; i++ ) {
+    sum += ( double ) latencies.samples[ i ];
+  }
+  return sum / ( double ) latencies.n_samples / 1000.0;
+}
+
+
+static bool
+queue_message( fake_switch *sw, const void *data, size_t length ) {
+  if ( sw->send_length + length > SEND_BUFFER_SIZE ) {
+    error( "Send buffer overflow ( datapath_id = %#" PRIx64 ", length = %zu ).", sw->datapath_id, length );
+    return false;
+  }
+  memcpy( sw->send_buffer + sw->send_length, data, length );
+  sw->send_length += length;
+
+  return true;
+}
+
+
+static void
+queue_buffer( fake_switch *sw, buffer *message ) {
+  queue_message( sw, message->data, message->length );
+  free_buffer( message );
+}
+
+
+static bool
+flush_messages( fake_switch *sw ) {
+  size_t offset = 0;
+  while ( offset < sw->send_length ) {
+    ssize_t ret = send( sw->fd, sw->send_buffer + offset, sw->send_length - offset, MSG_NOSIGNAL );
+    if ( ret < 0 ) {
+      if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) {
+        break;
+      }
+      error( "Failed to send ( datapath_id = %#" PRIx64 ", errno = %s [%d] ).", sw->datapath_id, strerror( errno ), errno );
+      return false;
+    }
+    offset += ( size_t ) ret;
+  }
+  if ( offset > 0 ) {
+    memmove( sw->send_buffer, sw->send_buffer + offset, sw->send_length - offset );
+    sw->send_length -= offset;
+  }
+
+  return true;
+}
+
+
+static buffer *
+create_frame( const fake_switch *sw ) {
+  buffer *frame = alloc_buffer_with_length( FRAME_LENGTH );
+  uint8_t *data = append_back_buffer( frame, FRAME_LENGTH );
+  memset( data, 0, FRAME_LENGTH );
+
+  ether_header_t *ether = ( ether_header_t * ) data;
+  uint8_t macda[ ETH_ADDRLEN ] = { 0x80, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  memcpy( ether->macda, macda, ETH_ADDRLEN );
+  ether->macsa[ 0 ] = 0x00;
+  ether->macsa[ 1 ] = ( uint8_t ) sw->datapath_id;
+  ether->type = htons( ETH_ETHTYPE_IPV4 );
+
+  ipv4_header_t *ipv4 = ( ipv4_header_t * ) ( ether + 1 );
+  ipv4->version = 4;
+  ipv4->ihl = sizeof( ipv4_header_t ) / 4;
+  ipv4->tot_len = htons( ( uint16_t ) ( FRAME_LENGTH - sizeof( ether_header_t ) ) );
+  ipv4->ttl = 64;
+  ipv4->protocol = IPPROTO_UDP;
+  ipv4->saddr = htonl( 0xc0a80001 );
+  ipv4->daddr = htonl( 0xc0a80002 );
+  ipv4->csum = get_checksum( ( uint16_t * ) ipv4, sizeof( ipv4_header_t ) );
+
+  udp_header_t *udp = ( udp_header_t * ) ( ipv4 + 1 );
+  udp->src_port = htons( 1024 );
+  udp->dst_port = htons( 1024 );
+  udp->len = htons( ( uint16_t ) ( FRAME_LENGTH - sizeof( ether_header_t ) - sizeof( ipv4_header_t ) ) );
+
+  return frame;
+}
+
+
+// Builds a packet-in once per switch. Buffer id and the low bytes of the
+// source MAC address are rewritten in place for every packet-in sent.
+static void
+create_packet_in_template( fake_switch *sw ) {
+  buffer *frame = create_frame( sw );
+  oxm_matches *match = create_oxm_matches();
+  append_oxm_match_in_port( match, 1 );
+
+  sw->packet_in = create_packet_in( 0, 0, FRAME_LENGTH, OFPR_NO_MATCH, 0, 0, match, frame );
+  sw->buffer_id_offset = offsetof( struct ofp_packet_in, buffer_id );
+  sw->macsa_offset = sw->packet_in->length - FRAME_LENGTH + offsetof( ether_header_t, macsa );
+
+  delete_oxm_matches( match );
+  free_buffer( frame );
+}
+
+
+static void
+send_packet_in( fake_switch *sw ) {
+  uint32_t buffer_id = sw->next_buffer_id;
+  sw->next_buffer_id = ( sw->next_buffer_id + 1 ) & 0x7fffffff;
+
+  uint8_t *data = sw->packet_in->data;
+  struct ofp_header *header = ( struct ofp_header * ) data;
+  header->xid = htonl( buffer_id );
+  uint32_t id = htonl( buffer_id );
+  memcpy( data + sw->buffer_id_offset, &id, sizeof( id ) );
+  uint32_t mac = buffer_id % n_macs;
+  data[ sw->macsa_offset + 2 ] = ( uint8_t ) ( mac >> 24 );
+  data[ sw->macsa_offset + 3 ] = ( uint8_t ) ( mac >> 16 );
+  data[ sw->macsa_offset + 4 ] = ( uint8_t ) ( mac >> 8 );
+  data[ sw->macsa_offset + 5 ] = ( uint8_t ) mac;
+
+  if ( queue_message( sw, data, sw->packet_in->length ) ) {
+    sw->sent_at[ buffer_id % window ] = now_ns();
+    sw->outstanding++;
+  }
+}
+
+
+static void
+fill_window( fake_switch *sw ) {
+  while ( sw->outstanding < window ) {
+    send_packet_in( sw );
+  }
+}
+
+
+static void
+handle_response( fake_switch *sw, uint32_t buffer_id, bool running ) {
+  if ( buffer_id != OFP_NO_BUFFER ) {
+    uint64_t *sent_at = &sw->sent_at[ buffer_id % window ];
+    if ( *sent_at == 0 ) {
+      return;
+    }
+    if ( running ) {
+      add_latency_sample( now_ns() - *sent_at );
+    }
+    *sent_at = 0;
+  }
+  if ( sw->outstanding > 0 ) {
+    sw->outstanding--;
+  }
+  if ( running ) {
+    sw->n_responses++;
+    fill_window( sw );
+  }
+}
+
+
+static void
+handle_message( fake_switch *sw, const uint8_t *data, size_t length, bool running ) {
+  const struct ofp_header *header = ( const struct ofp_header * ) data;
+  uint32_t xid = ntohl( header->xid );
+
+  switch ( header->type ) {
+    case OFPT_HELLO:
+    break;
+
+    case OFPT_ECHO_REQUEST:
+    {
+      buffer *body = NULL;
+      if ( length > sizeof( struct ofp_header ) ) {
+        body = alloc_buffer_with_length( length - sizeof( struct ofp_header ) );
+        memcpy( append_back_buffer( body, length - sizeof( struct ofp_header ) ),
+                data + sizeof( struct ofp_header ), length - sizeof( struct ofp_header ) );
+      }
+      queue_buffer( sw, create_echo_reply( xid, body ) );
+      if ( body != NULL ) {
+        free_buffer( body );
+      }
+    }
+    break;
+
+    case OFPT_FEATURES_REQUEST:
+    {
+      queue_buffer( sw, create_features_reply( xid, sw->datapath_id, 256, 1, 0, 0 ) );
+      sw->ready = true;
+    }
+    break;
+
+    case OFPT_GET_CONFIG_REQUEST:
+    {
+      queue_buffer( sw, create_get_config_reply( xid, OFPC_FRAG_NORMAL, OFPCML_NO_BUFFER ) );
+    }
+    break;
+
+    case OFPT_BARRIER_REQUEST:
+    {
+      queue_buffer( sw, create_barrier_reply( xid ) );
+    }
+    break;
+
+    case OFPT_FLOW_MOD:
+    {
+      if ( length < sizeof( struct ofp_flow_mod ) ) {
+        break;
+      }
+      const struct ofp_flow_mod *flow_mod = ( const struct ofp_flow_mod * ) data;
+      if ( flow_mod->command == OFPFC_ADD ) {
+        handle_response( sw, ntohl( flow_mod->buffer_id ), running );
+      }
+    }
+    break;
+
+    case OFPT_PACKET_OUT:
+    {
+      if ( length < sizeof( struct ofp_packet_out ) ) {
+        break;
+      }
+      const struct ofp_packet_out *packet_out = ( const struct ofp_packet_out * ) data;
+      handle_response( sw, ntohl( packet_out->buffer_id ), running );
+    }
+    break;
+
+    case OFPT_ERROR:
+    {
+      n_errors++;
+    }
+    break;
+
+    default:
+    break;
+  }
+}
+
+
+static bool
+receive_messages( fake_switch *sw, bool running ) {
+  ssize_t ret = recv( sw->fd, sw->recv_buffer + sw->recv_length, RECV_BUFFER_SIZE - sw->recv_length, 0 );
+  if ( ret < 0 ) {
+    if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) {
+      return true;
+    }
+    error( "Failed to receive ( datapath_id = %#" PRIx64 ", errno = %s [%d] ).", sw->datapath_id, strerror( errno ), errno );
+    return false;
+  }
+  if ( ret == 0 ) {
+    error( "Connection closed by controller ( datapath_id = %#" PRIx64 " ).", sw->datapath_id );
+    return false;
+  }
+  sw->recv_length += ( size_t ) ret;
+
+  size_t offset = 0;
+  while ( sw->recv_length - offset >= sizeof( struct ofp_header ) ) {
+    const struct ofp_header *header = ( const struct ofp_header * ) ( sw->recv_buffer + offset );
+    size_t length = ntohs( header->length );
+    if ( length < sizeof( struct ofp_header ) ) {
+      error( "Invalid message length ( datapath_id = %#" PRIx64 ", length = %zu ).", sw->datapath_id, length );
+      return false;
+    }
+    if ( sw->recv_length - offset < length ) {
+      break;
+    }
+    handle_message( sw, sw->recv_buffer + offset, length, running );
+    offset += length;
+  }
+  if ( offset > 0 ) {
+    memmove( sw->recv_buffer, sw->recv_buffer + offset, sw->recv_length - offset );
+    sw->recv_length -= offset;
+  }
+
+  return true;
+}
+
+
+static bool
+connect_switch( fake_switch *sw, const char *host, uint16_t port ) {
+  struct addrinfo hints, *result = NULL;
+  memset( &hints, 0, sizeof( hints ) );
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[ 8 ];
+  snprintf( service, sizeof( service ), "%u", port );
+  int ret = getaddrinfo( host, service, &hints, &result );
+  if ( ret != 0 ) {
+    error( "Failed to resolve %s ( %s ).", host, gai_strerror( ret ) );
+    return false;
+  }
+
+  sw->fd = socket( AF_INET, SOCK_STREAM, 0 );
+  if ( sw->fd < 0 || connect( sw->fd, result->ai_addr, result->ai_addrlen ) < 0 ) {
+    error( "Failed to connect to %s:%u ( errno = %s [%d] ).", host, port, strerror( errno ), errno );
+    freeaddrinfo( result );
+    return false;
+  }
+  freeaddrinfo( result );
+
+  int flag = 1;
+  setsockopt( sw->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof( flag ) );
+  fcntl( sw->fd, F_SETFL, fcntl( sw->fd, F_GETFL ) | O_NONBLOCK );
+
+  queue_buffer( sw, create_hello( 0, NULL ) );
+
+  return true;
+}
+
+
+// Runs the event loop until the deadline. Returns false on connection errors.
+static bool
+run_until( uint64_t deadline, bool running, bool wait_for_ready ) {
+  struct pollfd *fds = xmalloc( sizeof( struct pollfd ) * n_switches );
+
+  while ( now_ns() < deadline ) {
+    if ( wait_for_ready ) {
+      unsigned int n_ready = 0;
+      for ( unsigned int i = 0; i < n_switches; i++ ) {
+        n_ready += switches[ i ].ready ? 1 : 0;
+      }
+      if ( n_ready == n_switches ) {
+        break;
+      }
+    }
+
+    for ( unsigned int i = 0; i < n_switches; i++ ) {
+      fds[ i ].fd = switches[ i ].fd;
+      fds[ i ].events = ( short ) ( POLLIN | ( switches[ i ].send_length > 0 ? POLLOUT : 0 ) );
+      fds[ i ].revents = 0;
+    }
+    uint64_t remaining = ( deadline - now_ns() ) / 1000000;
+    int ret = poll( fds, n_switches, remaining > 10 ? 10 : ( int ) remaining );
+    if ( ret < 0 && errno != EINTR ) {
+      error( "Failed to poll ( errno = %s [%d] ).", strerror( errno ), errno );
+      xfree( fds );
+      return false;
+    }
+
+    for ( unsigned int i = 0; i < n_switches; i++ ) {
+      fake_switch *sw = &switches[ i ];
+      if ( ( fds[ i ].revents & ( POLLIN | POLLERR | POLLHUP ) ) != 0 ) {
+        if ( !receive_messages( sw, running ) ) {
+          xfree( fds );
+          return false;
+        }
+      }
+      if ( sw->send_length > 0 && !flush_messages( sw ) ) {
+        xfree( fds );
+        return false;
+      }
+    }
+  }
+
+  xfree( fds );
+  return true;
+}
+
+
+static void
+print_result( const char *mode, unsigned int n_loops, const double *results ) {
+  double min = 0.0, max = 0.0, sum = 0.0, sum_squares = 0.0;
+  for ( unsigned int i = 0; i < n_loops; i++ ) {
+    min = ( i == 0 || results[ i ] < min ) ? results[ i ] : min;
+    max = ( i == 0 || results[ i ] > max ) ? results[ i ] : max;
+    sum += results[ i ];
+    sum_squares += results[ i ] * results[ i ];
+  }
+  double avg = n_loops > 0 ? sum / n_loops : 0.0;
+  double variance = n_loops > 0 ? sum_squares / n_loops - avg * avg : 0.0;
+  printf( "RESULT: %u switches %u tests ( %s mode ) min/max/avg/stdev = %.2f/%.2f/%.2f/%.2f responses/s\n",
+          n_switches, n_loops, mode, min, max, avg, variance > 0.0 ? sqrt( variance ) : 0.0 );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  const char *host = DEFAULT_CONTROLLER;
+  uint16_t port = OFP_TCP_PORT;
+  unsigned int n_loops = DEFAULT_LOOPS;
+  unsigned int ms_per_test = DEFAULT_MS_PER_TEST;
+  unsigned int delay = 0;
+  bool throughput = false;
+  uint32_t throughput_window = DEFAULT_WINDOW;
+
+  int c;
+  while ( ( c = getopt_long( argc, argv, short_options, long_options, NULL ) ) != -1 ) {
+    switch ( c ) {
+      case 'c':
+        host = optarg;
+        break;
+      case 'p':
+        port = ( uint16_t ) strtoul( optarg, NULL, 0 );
+        break;
+      case 's':
+        n_switches = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'l':
+        n_loops = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'm':
+        ms_per_test = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'D':
+        delay = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'M':
+        n_macs = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 't':
+        throughput = true;
+        break;
+      case 'w':
+        throughput_window = ( uint32_t ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'h':
+        print_usage( argv[ 0 ] );
+        return EXIT_SUCCESS;
+      default:
+        print_usage( argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+  }
+  if ( n_switches == 0 || n_loops == 0 || ms_per_test == 0 || n_macs == 0 || throughput_window == 0 ) {
+    print_usage( argv[ 0 ] );
+    return EXIT_FAILURE;
+  }
+  window = throughput ? throughput_window : 1;
+
+  init_log( "cbench_benchmark", "/tmp", LOGGING_TYPE_STDOUT );
+  set_logging_level( "error" );
+
+  const char *mode = throughput ? "throughput" : "latency";
+  printf( "cbench: controller at %s:%u, %u switches, %u tests of %u ms, %u unique source MACs per switch, %s mode\n",
+          host, port, n_switches, n_loops, ms_per_test, n_macs, mode );
+
+  switches = xcalloc( n_switches, sizeof( fake_switch ) );
+  for ( unsigned int i = 0; i < n_switches; i++ ) {
+    fake_switch *sw = &switches[ i ];
+    sw->fd = -1;
+    sw->datapath_id = i + 1;
+    sw->sent_at = xcalloc( window, sizeof( uint64_t ) );
+    create_packet_in_template( sw );
+    if ( !connect_switch( sw, host, port ) ) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  uint64_t deadline = now_ns() + ( uint64_t ) HANDSHAKE_TIMEOUT * 1000000000ULL;
+  if ( !run_until( deadline, false, true ) ) {
+    return EXIT_FAILURE;
+  }
+  for ( unsigned int i = 0; i < n_switches; i++ ) {
+    if ( !switches[ i ].ready ) {
+      error( "Handshake timed out ( datapath_id = %#" PRIx64 " ).", switches[ i ].datapath_id );
+      return EXIT_FAILURE;
+    }
+  }
+  if ( !run_until( now_ns() + ( uint64_t ) delay * 1000000ULL, false, false ) ) {
+    return EXIT_FAILURE;
+  }
+
+  double *results = xcalloc( n_loops, sizeof( double ) );
+  for ( unsigned int loop = 0; loop < n_loops; loop++ ) {
+    latencies.n_samples = 0;
+    for ( unsigned int i = 0; i < n_switches; i++ ) {
+      switches[ i ].n_responses = 0;
+      fill_window( &switches[ i ] );
+    }
+
+    uint64_t start = now_ns();
+    if ( !run_until( start + ( uint64_t ) ms_per_test * 1000000ULL, true, false ) ) {
+      return EXIT_FAILURE;
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    uint64_t n_responses = 0;
+    for ( unsigned int i = 0; i < n_switches; i++ ) {
+      n_responses += switches[ i ].n_responses;
+    }
+    qsort( latencies.samples, latencies.n_samples, sizeof( uint64_t ), compare_latency );
+    results[ loop ] = ( double ) n_responses * 1e9 / ( double ) elapsed;
+    printf( "%u switches: %" PRIu64 " responses, %.2f responses/s, latency mean %.1f, p50 %.1f, p99 %.1f, max %.1f us\n",
+            n_switches, n_responses, results[ loop ], latency_mean(),
+            latency_percentile( 50.0 ), latency_percentile( 99.0 ), latency_percentile( 100.0 ) );
+  }
+  print_result( mode, n_loops, results );
+  if ( n_errors > 0 ) {
+    printf( "%" PRIu64 " error messages received from controller\n", n_errors );
+  }
+
+  for ( unsigned int i = 0; i < n_switches; i++ ) {
+    close( switches[ i ].fd );
+    free_buffer( switches[ i ].packet_in );
+    xfree( switches[ i ].sent_at );
+  }
+  xfree( switches );
+  xfree( results );
+  if ( latencies.samples != NULL ) {
+    xfree( latencies.samples );
+  }
+  finalize_log();
+
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
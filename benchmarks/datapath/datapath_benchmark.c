@@ -0,0 +1,718 @@
+/*
+ * Benchmark for the datapath pipeline with synthetic or pcap frames.
+ *
+ * Copyright (C) 2012 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "action_executor.h"
+#include "ether_device.h"
+#include "flow_table.h"
+#include "ofdp.h"
+#include "pipeline.h"
+#include "port_manager.h"
+#include "switch_port.h"
+#include "table_manager.h"
+#include "trema.h"
+
+
+#define DEFAULT_PACKETS 20000
+#define DEFAULT_ENTRIES 1000
+#define DEFAULT_FRAME_LENGTH 64
+#define MAX_FRAMES 4096
+#define MAX_TABLES_PER_PACKET 8
+#define IN_PORT 1
+#define OUT_PORT 2
+#define N_UDP_PORTS 16
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_LINKTYPE_ETHERNET 1
+
+
+enum {
+  SHAPE_EXACT,
+  SHAPE_WILDCARD,
+  SHAPE_MULTI_TABLE,
+  N_SHAPES,
+};
+
+static const char *shape_names[ N_SHAPES ] = { "exact", "wildcard", "multitable" };
+
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version_major;
+  uint16_t version_minor;
+  int32_t thiszone;
+  uint32_t sigfigs;
+  uint32_t snaplen;
+  uint32_t linktype;
+} pcap_file_header;
+
+
+typedef struct {
+  uint32_t sec;
+  uint32_t usec;
+  uint32_t caplen;
+  uint32_t len;
+} pcap_record_header;
+
+
+static struct {
+  uint64_t packets;
+  uint64_t bytes;
+} sink;
+
+static buffer *frames[ MAX_FRAMES ];
+static unsigned int n_frames = 0;
+
+
+static struct option long_options[] = {
+  { "shape", 1, NULL, 't' },
+  { "entries", 1, NULL, 'n' },
+  { "packets", 1, NULL, 'p' },
+  { "length", 1, NULL, 'l' },
+  { "pcap", 1, NULL, 'r' },
+  { "seed", 1, NULL, 's' },
+  { "help", 0, NULL, 'h' },
+  { NULL, 0, NULL, 0  },
+};
+
+static char short_options[] = "t:n:p:l:r:s:h";
+
+
+static void
+print_usage( const char *program_name ) {
+  printf(
+    "Datapath benchmark.\n"
+    "Usage: %s [OPTION]...\n"
+    "\n"
+    "  -t, --shape=SHAPE           flow table shape: exact, wildcard or multitable ( default: all )\n"
+    "  -n, --entries=N             number of flow entries ( default: %d )\n"
+    "  -p, --packets=N             number of frames to process per run ( default: %d )\n"
+    "  -l, --length=N              length of synthetic frames ( default: %d )\n"
+    "  -r, --pcap=FILE             replay frames read from a pcap file\n"
+    "  -s, --seed=N                random seed\n"
+    "  -h, --help                  display this help and exit\n",
+    program_name, DEFAULT_ENTRIES, DEFAULT_PACKETS, DEFAULT_FRAME_LENGTH
+  );
+}
+
+
+static uint64_t
+now_ns( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( uint64_t ) ts.tv_sec * 1000000000ULL + ( uint64_t ) ts.tv_nsec;
+}
+
+
+// The benchmark links the datapath library directly. Defining the whole
+// ether_device API here keeps ether_device.o out of the link, so switch
+// ports are backed by fake devices and frames output by the pipeline end
+// up in the sink instead of a packet socket.
+ether_device *
+create_ether_device( const char *name, const size_t max_send_queue, const size_t max_recv_queue ) {
+  UNUSED( max_send_queue );
+  UNUSED( max_recv_queue );
+
+  ether_device *device = xmalloc( sizeof( ether_device ) );
+  memset( device, 0, sizeof( ether_device ) );
+  strncpy( device->name, name, IFNAMSIZ - 1 );
+  device->fd = -1;
+  device->mtu = ETH_MTU;
+  device->status.up = true;
+  device->status.curr_speed = 10000000;
+  device->status.max_speed = 10000000;
+  time_now( &device->created_at );
+
+  return device;
+}
+
+
+void
+delete_ether_device( ether_device *device ) {
+  xfree( device );
+}
+
+
+bool
+up_ether_device( ether_device *device ) {
+  device->status.up = true;
+  return true;
+}
+
+
+bool
+down_ether_device( ether_device *device ) {
+  device->status.up = false;
+  return true;
+}
+
+
+bool
+send_frame( ether_device *device, buffer *frame ) {
+  device->stats.tx_packets++;
+  device->stats.tx_bytes += frame->length;
+  sink.packets++;
+  sink.bytes += frame->length;
+  return true;
+}
+
+
+bool
+set_frame_received_handler( ether_device *device, frame_received_handler callback, void *user_data ) {
+  device->received_callback = callback;
+  device->received_user_data = user_data;
+  return true;
+}
+
+
+bool
+update_device_status( ether_device *device ) {
+  UNUSED( device );
+  return false;
+}
+
+
+bool
+update_device_stats( ether_device *device ) {
+  UNUSED( device );
+  return true;
+}
+
+
+short int
+get_device_flags( const char *name ) {
+  UNUSED( name );
+  return 0;
+}
+
+
+bool
+set_device_flags( const char *name, short int flags ) {
+  UNUSED( name );
+  UNUSED( flags );
+  return true;
+}
+
+
+struct timespec
+get_device_uptime( ether_device *device ) {
+  struct timespec now, diff;
+  time_now( &now );
+  timespec_diff( device->created_at, now, &diff );
+  return diff;
+}
+
+
+static uint32_t
+host_address( unsigned int index ) {
+  return 0x0a000000 | ( index & 0x00ffffff );
+}
+
+
+static buffer *
+create_synthetic_frame( unsigned int flow, size_t length ) {
+  size_t header_length = sizeof( ether_header_t ) + sizeof( ipv4_header_t ) + sizeof( udp_header_t );
+  if ( length < header_length ) {
+    length = header_length;
+  }
+
+  buffer *frame = alloc_buffer_with_length( length );
+  uint8_t *data = append_back_buffer( frame, length );
+  memset( data, 0, length );
+
+  ether_header_t *ether = ( ether_header_t * ) data;
+  uint8_t macda[ ETH_ADDRLEN ] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 };
+  uint8_t macsa[ ETH_ADDRLEN ] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  memcpy( ether->macda, macda, ETH_ADDRLEN );
+  memcpy( ether->macsa, macsa, ETH_ADDRLEN );
+  ether->type = htons( ETH_ETHTYPE_IPV4 );
+
+  ipv4_header_t *ipv4 = ( ipv4_header_t * ) ( ether + 1 );
+  ipv4->version = IPVERSION;
+  ipv4->ihl = sizeof( ipv4_header_t ) / 4;
+  ipv4->tot_len = htons( ( uint16_t ) ( length - sizeof( ether_header_t ) ) );
+  ipv4->ttl = IPDEFTTL;
+  ipv4->protocol = IPPROTO_UDP;
+  ipv4->saddr = htonl( host_address( 0x00ffffff ) );
+  ipv4->daddr = htonl( host_address( flow ) );
+  ipv4->csum = get_checksum( ( uint16_t * ) ipv4, sizeof( ipv4_header_t ) );
+
+  udp_header_t *udp = ( udp_header_t * ) ( ipv4 + 1 );
+  udp->src_port = htons( ( uint16_t ) ( 32768 + flow % 1000 ) );
+  udp->dst_port = htons( ( uint16_t ) ( 1024 + flow % N_UDP_PORTS ) );
+  udp->len = htons( ( uint16_t ) ( length - sizeof( ether_header_t ) - sizeof( ipv4_header_t ) ) );
+
+  return frame;
+}
+
+
+static bool
+read_pcap_frames( const char *file ) {
+  FILE *fp = fopen( file, "r" );
+  if ( fp == NULL ) {
+    error( "Failed to open %s.", file );
+    return false;
+  }
+
+  pcap_file_header header;
+  if ( fread( &header, sizeof( header ), 1, fp ) != 1 ) {
+    error( "Failed to read a pcap file header from %s.", file );
+    fclose( fp );
+    return false;
+  }
+  bool swapped = false;
+  if ( header.magic != PCAP_MAGIC && header.magic != PCAP_MAGIC_NSEC ) {
+    swapped = true;
+    header.magic = __builtin_bswap32( header.magic );
+    header.linktype = __builtin_bswap32( header.linktype );
+  }
+  if ( header.magic != PCAP_MAGIC && header.magic != PCAP_MAGIC_NSEC ) {
+    error( "%s is not a pcap file.", file );
+    fclose( fp );
+    return false;
+  }
+  if ( header.linktype != PCAP_LINKTYPE_ETHERNET ) {
+    error( "Unsupported link type ( file = %s, linktype = %u ).", file, header.linktype );
+    fclose( fp );
+    return false;
+  }
+
+  pcap_record_header record;
+  while ( n_frames < MAX_FRAMES && fread( &record, sizeof( record ), 1, fp ) == 1 ) {
+    uint32_t caplen = swapped ? __builtin_bswap32( record.caplen ) : record.caplen;
+    if ( caplen == 0 || caplen > UINT16_MAX ) {
+      error( "Invalid pcap record found in %s ( caplen = %u ).", file, caplen );
+      break;
+    }
+    buffer *frame = alloc_buffer_with_length( caplen );
+    void *data = append_back_buffer( frame, caplen );
+    if ( fread( data, caplen, 1, fp ) != 1 ) {
+      free_buffer( frame );
+      break;
+    }
+    if ( !parse_packet( frame ) ) {
+      free_buffer( frame );
+      continue;
+    }
+    free_packet_info( frame );
+    frames[ n_frames++ ] = frame;
+  }
+  fclose( fp );
+
+  if ( n_frames == 0 ) {
+    error( "No Ethernet frames found in %s.", file );
+    return false;
+  }
+
+  return true;
+}
+
+
+// Drops the parse result of the previous run so that the frame is parsed again.
+static void
+unparse_frame( buffer *frame ) {
+  if ( frame->user_data != NULL ) {
+    free_packet_info( frame );
+  }
+}
+
+
+static void
+create_synthetic_frames( unsigned int n_entries, size_t length ) {
+  for ( n_frames = 0; n_frames < MAX_FRAMES; n_frames++ ) {
+    frames[ n_frames ] = create_synthetic_frame( ( unsigned int ) rand() % n_entries, length );
+  }
+}
+
+
+// Returns the parsed header fields that flow entry #index is keyed on.
+// Synthetic runs key entries on synthetic flows, and pcap runs on the
+// replayed frames so that the same tables apply to both.
+static packet_info
+get_key_packet_info( unsigned int index, const char *pcap_file, size_t length ) {
+  buffer *frame = pcap_file != NULL ? duplicate_buffer( frames[ index % n_frames ] ) : create_synthetic_frame( index, length );
+  parse_packet( frame );
+  packet_info info = get_packet_info( frame );
+  info.eth_in_port = IN_PORT;
+  info.eth_in_phy_port = IN_PORT;
+  free_buffer( frame );
+
+  return info;
+}
+
+
+static void
+set_match16( match16 *field, uint16_t value, uint16_t mask ) {
+  field->value = value;
+  field->mask = mask;
+  field->valid = true;
+}
+
+
+static void
+set_match32( match32 *field, uint32_t value, uint32_t mask ) {
+  field->value = value;
+  field->mask = mask;
+  field->valid = true;
+}
+
+
+static void
+set_match64( match64 *field, uint64_t value, uint64_t mask ) {
+  field->value = value;
+  field->mask = mask;
+  field->valid = true;
+}
+
+
+static instruction_set *
+create_output_instructions( bool write ) {
+  action_list *actions = create_action_list();
+  append_action( actions, create_action_output( OUT_PORT, 0 ) );
+  instruction_set *instructions = create_instruction_set();
+  if ( write ) {
+    add_instruction( instructions, alloc_instruction_write_actions( actions ) );
+  }
+  else {
+    add_instruction( instructions, alloc_instruction_apply_actions( actions ) );
+  }
+
+  return instructions;
+}
+
+
+static void
+add_entry( flow_entry_addition *addition, uint8_t table_id, match *match, instruction_set *instructions, uint16_t priority ) {
+  addition->table_id = table_id;
+  addition->flags = 0;
+  addition->entry = alloc_flow_entry( match, instructions, priority, 0, 0, 0, 0 );
+  addition->result = OFDPE_SUCCESS;
+}
+
+
+// exact:      table 0 holds one fully specified entry per flow.
+// wildcard:   table 0 holds one entry per destination address with the
+//             rest of the header wildcarded, and a low priority default.
+// multitable: table 0 writes metadata and goes to table 1, which matches
+//             destination addresses, rewrites eth_dst and goes to
+//             table 2, where a single entry writes the output action.
+static unsigned int
+install_flow_entries( int shape, unsigned int n_entries, const char *pcap_file, size_t length ) {
+  flow_entry_addition *additions = xmalloc( sizeof( flow_entry_addition ) * ( n_entries + 2 ) );
+  unsigned int n_additions = 0;
+
+  for ( unsigned int i = 0; i < n_entries; i++ ) {
+    packet_info info = get_key_packet_info( i, pcap_file, length );
+    // distinct priorities keep the insertion cost of large tables linear.
+    uint16_t priority = ( uint16_t ) ( 0x8000 + i % 0x7fff );
+    match *key = create_match();
+    if ( shape == SHAPE_EXACT ) {
+      build_match_from_packet_info( key, &info );
+      add_entry( &additions[ n_additions++ ], 0, key, create_output_instructions( false ), priority );
+      continue;
+    }
+    if ( info.eth_type != ETH_ETHTYPE_IPV4 ) {
+      delete_match( key );
+      continue;
+    }
+    set_match16( &key->eth_type, ETH_ETHTYPE_IPV4, UINT16_MAX );
+    set_match32( &key->ipv4_dst, info.ipv4_daddr, UINT32_MAX );
+    if ( shape == SHAPE_WILDCARD ) {
+      add_entry( &additions[ n_additions++ ], 0, key, create_output_instructions( false ), priority );
+      continue;
+    }
+    set_match64( &key->metadata, 1, UINT64_MAX );
+    match *eth_dst = create_match();
+    for ( int j = 0; j < ETH_ADDRLEN; j++ ) {
+      eth_dst->eth_dst[ j ].value = info.eth_macda[ j ];
+      eth_dst->eth_dst[ j ].mask = UINT8_MAX;
+      eth_dst->eth_dst[ j ].valid = true;
+    }
+    action_list *actions = create_action_list();
+    append_action( actions, create_action_set_field( eth_dst ) );
+    instruction_set *instructions = create_instruction_set();
+    add_instruction( instructions, alloc_instruction_apply_actions( actions ) );
+    add_instruction( instructions, alloc_instruction_goto_table( 2 ) );
+    add_entry( &additions[ n_additions++ ], 1, key, instructions, priority );
+  }
+
+  if ( shape == SHAPE_WILDCARD ) {
+    match *key = create_match();
+    set_match16( &key->eth_type, ETH_ETHTYPE_IPV4, UINT16_MAX );
+    set_match16( &key->udp_dst, 1024, 0xfff0 );
+    add_entry( &additions[ n_additions++ ], 0, key, create_output_instructions( false ), 1 );
+  }
+  else if ( shape == SHAPE_MULTI_TABLE ) {
+    match *key = create_match();
+    set_match32( &key->in_port, IN_PORT, UINT32_MAX );
+    instruction_set *instructions = create_instruction_set();
+    add_instruction( instructions, alloc_instruction_write_metadata( 1, UINT64_MAX ) );
+    add_instruction( instructions, alloc_instruction_goto_table( 1 ) );
+    add_entry( &additions[ n_additions++ ], 0, key, instructions, 1 );
+
+    key = create_match();
+    add_entry( &additions[ n_additions++ ], 2, key, create_output_instructions( true ), 1 );
+  }
+
+  OFDPE ret = add_flow_entries( additions, n_additions );
+  if ( ret != OFDPE_SUCCESS ) {
+    die( "Failed to add flow entries ( ret = %d ).", ret );
+  }
+  xfree( additions );
+
+  return n_additions;
+}
+
+
+static void
+reset_flow_tables( unsigned int n_entries ) {
+  finalize_table_manager();
+  init_table_manager( n_entries + 2 );
+}
+
+
+typedef struct {
+  uint8_t n_tables;
+  flow_entry *entries[ MAX_TABLES_PER_PACKET ];
+} lookup_result;
+
+
+static void
+lookup( buffer *frame, lookup_result *result ) {
+  packet_info *info = frame->user_data;
+  info->eth_in_port = IN_PORT;
+  info->eth_in_phy_port = IN_PORT;
+
+  match key;
+  uint8_t table_id = 0;
+  result->n_tables = 0;
+  while ( result->n_tables < MAX_TABLES_PER_PACKET ) {
+    build_match_from_packet_info( &key, info );
+    flow_entry *entry = lookup_flow_entry( table_id, &key );
+    if ( entry == NULL ) {
+      result->n_tables = 0;
+      return;
+    }
+    result->entries[ result->n_tables++ ] = entry;
+    instruction_set *instructions = entry->instructions;
+    if ( instructions == NULL || instructions->goto_table == NULL ) {
+      return;
+    }
+    if ( instructions->write_metadata != NULL ) {
+      info->metadata = instructions->write_metadata->metadata & instructions->write_metadata->metadata_mask;
+    }
+    table_id = instructions->goto_table->table_id;
+  }
+}
+
+
+static void
+execute_actions( buffer *frame, const lookup_result *result ) {
+  action_set set;
+  clear_action_set( &set );
+  for ( uint8_t i = 0; i < result->n_tables; i++ ) {
+    instruction_set *instructions = result->entries[ i ]->instructions;
+    if ( instructions->apply_actions != NULL ) {
+      execute_action_list( instructions->apply_actions->actions, frame );
+    }
+    if ( instructions->clear_actions != NULL ) {
+      clear_action_set( &set );
+    }
+    if ( instructions->write_actions != NULL ) {
+      write_action_set( instructions->write_actions->actions, &set );
+    }
+  }
+  if ( result->n_tables > 0 ) {
+    execute_action_set( &set, frame );
+  }
+}
+
+
+static void
+run_benchmark( int shape, unsigned int n_entries, unsigned int n_packets, const char *pcap_file, size_t length ) {
+  uint64_t start = now_ns();
+  unsigned int n_installed = install_flow_entries( shape, n_entries, pcap_file, length );
+  uint64_t install_ns = now_ns() - start;
+
+  switch_port *port = lookup_switch_port( IN_PORT );
+  assert( port != NULL );
+
+  // end-to-end, the same path handle_frame_received_on_switch_port() takes.
+  sink.packets = 0;
+  start = now_ns();
+  for ( unsigned int i = 0; i < n_packets; i++ ) {
+    buffer *frame = frames[ i % n_frames ];
+    unparse_frame( frame );
+    handle_received_frame( port, frame );
+  }
+  uint64_t total_ns = now_ns() - start;
+  uint64_t n_output = sink.packets;
+
+  // per-stage breakdown. stages are timed in separate passes over the
+  // same frames so that timestamps are not taken per packet.
+  start = now_ns();
+  for ( unsigned int i = 0; i < n_packets; i++ ) {
+    buffer *frame = frames[ i % n_frames ];
+    unparse_frame( frame );
+    parse_packet( frame );
+  }
+  uint64_t parse_ns = now_ns() - start;
+
+  lookup_result *results = xmalloc( sizeof( lookup_result ) * n_frames );
+  start = now_ns();
+  for ( unsigned int i = 0; i < n_packets; i++ ) {
+    lookup( frames[ i % n_frames ], &results[ i % n_frames ] );
+  }
+  uint64_t lookup_ns = now_ns() - start;
+
+  start = now_ns();
+  for ( unsigned int i = 0; i < n_packets; i++ ) {
+    execute_actions( frames[ i % n_frames ], &results[ i % n_frames ] );
+  }
+  uint64_t actions_ns = now_ns() - start;
+
+  start = now_ns();
+  for ( unsigned int i = 0; i < n_packets; i++ ) {
+    if ( results[ i % n_frames ].n_tables > 0 ) {
+      send_frame_from_switch_port( OUT_PORT, frames[ i % n_frames ] );
+    }
+  }
+  uint64_t output_ns = now_ns() - start;
+  actions_ns = actions_ns > output_ns ? actions_ns - output_ns : 0;
+  xfree( results );
+
+  reset_flow_tables( n_entries );
+
+  double n = n_packets > 0 ? ( double ) n_packets : 1.0;
+  printf( "%-10s entries %7u: install %8.1f ns/entry, %10.0f packets/sec, %8.1f ns/packet "
+          "( parse %6.1f, lookup %8.1f, actions %6.1f, output %6.1f ns ), output %5.1f%%\n",
+          shape_names[ shape ], n_installed,
+          n_installed > 0 ? ( double ) install_ns / n_installed : 0.0,
+          total_ns > 0 ? n * 1e9 / ( double ) total_ns : 0.0,
+          ( double ) total_ns / n,
+          ( double ) parse_ns / n, ( double ) lookup_ns / n,
+          ( double ) actions_ns / n, ( double ) output_ns / n,
+          100.0 * ( double ) n_output / n );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  int shape = -1;
+  unsigned int n_entries = DEFAULT_ENTRIES;
+  unsigned int n_packets = DEFAULT_PACKETS;
+  size_t length = DEFAULT_FRAME_LENGTH;
+  const char *pcap_file = NULL;
+  unsigned int seed = 1;
+
+  int c;
+  while ( ( c = getopt_long( argc, argv, short_options, long_options, NULL ) ) != -1 ) {
+    switch ( c ) {
+      case 't':
+        for ( shape = 0; shape < N_SHAPES; shape++ ) {
+          if ( strcmp( optarg, shape_names[ shape ] ) == 0 ) {
+            break;
+          }
+        }
+        if ( shape == N_SHAPES ) {
+          print_usage( argv[ 0 ] );
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'n':
+        n_entries = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'p':
+        n_packets = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'l':
+        length = ( size_t ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'r':
+        pcap_file = optarg;
+        break;
+      case 's':
+        seed = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'h':
+        print_usage( argv[ 0 ] );
+        return EXIT_SUCCESS;
+      default:
+        print_usage( argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+  }
+  if ( n_entries == 0 || length > ETH_MAXIMUM_LENGTH ) {
+    print_usage( argv[ 0 ] );
+    return EXIT_FAILURE;
+  }
+
+  init_log( "datapath_benchmark", "/tmp", LOGGING_TYPE_STDOUT );
+  set_logging_level( "error" );
+
+  srand( seed );
+  if ( pcap_file != NULL ) {
+    if ( !read_pcap_frames( pcap_file ) ) {
+      return EXIT_FAILURE;
+    }
+  }
+  else {
+    create_synthetic_frames( n_entries, length );
+  }
+
+  OFDPE ret = init_datapath( 1, 1, 1, 1, n_entries + 2 );
+  if ( ret != OFDPE_SUCCESS ) {
+    die( "Failed to initialize datapath ( ret = %d ).", ret );
+  }
+  add_port( IN_PORT, "bench-in" );
+  add_port( OUT_PORT, "bench-out" );
+
+  if ( shape >= 0 ) {
+    run_benchmark( shape, n_entries, n_packets, pcap_file, length );
+  }
+  else {
+    for ( shape = 0; shape < N_SHAPES; shape++ ) {
+      run_benchmark( shape, n_entries, n_packets, pcap_file, length );
+    }
+  }
+
+  for ( unsigned int i = 0; i < n_frames; i++ ) {
+    free_buffer( frames[ i ] );
+  }
+  finalize_log();
+
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
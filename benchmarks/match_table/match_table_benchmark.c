@@ -0,0 +1,231 @@
+/*
+ * Benchmark for match table lookups with synthetic packet-in matches.
+ *
+ * Copyright (C) 2012 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ether.h"
+#include "log.h"
+#include "match_table.h"
+#include "oxm_match.h"
+#include "utility.h"
+#include "wrapper.h"
+
+
+#define DEFAULT_LOOKUPS 1000000
+#define DEFAULT_WILDCARDS_RATIO 10 // percent of filter entries that have wildcards
+#define N_PACKETS 4096
+#define N_TCP_PORTS 16
+
+
+static const unsigned int default_n_entries[] = { 1000, 10000, 100000 };
+
+
+static struct option long_options[] = {
+  { "entries", 1, NULL, 'n' },
+  { "lookups", 1, NULL, 'l' },
+  { "wildcards", 1, NULL, 'w' },
+  { "seed", 1, NULL, 's' },
+  { "help", 0, NULL, 'h' },
+  { NULL, 0, NULL, 0  },
+};
+
+static char short_options[] = "n:l:w:s:h";
+
+
+static void
+usage( const char *program_name ) {
+  printf(
+    "Match table benchmark.\n"
+    "Usage: %s [OPTION]...\n"
+    "\n"
+    "  -n, --entries=N             number of filter entries ( default: 1000, 10000 and 100000 )\n"
+    "  -l, --lookups=N             number of lookups per run ( default: %d )\n"
+    "  -w, --wildcards=PERCENT     percentage of wildcards entries ( default: %d )\n"
+    "  -s, --seed=N                random seed\n"
+    "  -h, --help                  display this help and exit\n",
+    program_name, DEFAULT_LOOKUPS, DEFAULT_WILDCARDS_RATIO
+  );
+}
+
+
+static uint64_t
+now_ns( void ) {
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ( uint64_t ) ts.tv_sec * 1000000000ULL + ( uint64_t ) ts.tv_nsec;
+}
+
+
+static uint32_t
+host_address( unsigned int index ) {
+  return 0x0a000000 | ( index & 0x00ffffff );
+}
+
+
+static oxm_matches *
+create_filter_match( unsigned int index, bool wildcards ) {
+  oxm_matches *match = create_oxm_matches();
+  append_oxm_match_eth_type( match, ETHERTYPE_IP );
+  if ( wildcards ) {
+    append_oxm_match_ipv4_src( match, host_address( index ) & 0xffffff00, 0xffffff00 );
+    append_oxm_match_ip_proto( match, IPPROTO_TCP );
+    return match;
+  }
+  append_oxm_match_ipv4_src( match, host_address( index ), 0 );
+  append_oxm_match_ipv4_dst( match, host_address( index + 1 ), 0 );
+  append_oxm_match_ip_proto( match, IPPROTO_TCP );
+  append_oxm_match_tcp_dst( match, ( uint16_t ) ( 1024 + index % N_TCP_PORTS ) );
+
+  return match;
+}
+
+
+// Builds a match in the same shape as set_match_from_packet() does for a TCP packet-in.
+static oxm_matches *
+create_packet_in_match( unsigned int index ) {
+  uint8_t src[ OFP_ETH_ALEN ] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  uint8_t dst[ OFP_ETH_ALEN ] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 };
+  uint8_t no_mask[ OFP_ETH_ALEN ] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+  oxm_matches *match = create_oxm_matches();
+  append_oxm_match_in_port( match, 1 + index % 48 );
+  append_oxm_match_eth_dst( match, dst, no_mask );
+  append_oxm_match_eth_src( match, src, no_mask );
+  append_oxm_match_eth_type( match, ETHERTYPE_IP );
+  append_oxm_match_ip_dscp( match, 0 );
+  append_oxm_match_ip_ecn( match, 0 );
+  append_oxm_match_ip_proto( match, IPPROTO_TCP );
+  append_oxm_match_ipv4_src( match, host_address( index ), 0 );
+  append_oxm_match_ipv4_dst( match, host_address( index + 1 ), 0 );
+  append_oxm_match_tcp_src( match, ( uint16_t ) ( 32768 + index % 1000 ) );
+  append_oxm_match_tcp_dst( match, ( uint16_t ) ( 1024 + index % N_TCP_PORTS ) );
+
+  return match;
+}
+
+
+static void
+run_benchmark( unsigned int n_entries, unsigned int n_lookups, unsigned int wildcards_ratio ) {
+  init_match_table();
+
+  uint64_t start = now_ns();
+  for ( unsigned int i = 0; i < n_entries; i++ ) {
+    bool wildcards = ( unsigned int ) ( rand() % 100 ) < wildcards_ratio;
+    oxm_matches *match = create_filter_match( i, wildcards );
+    uint16_t priority = ( uint16_t ) ( wildcards ? rand() % 0x8000 : 0x8000 + rand() % 0x8000 );
+    if ( !insert_match_entry( match, priority, ( void * ) ( uintptr_t ) ( i + 1 ) ) ) {
+      // same match and priority are generated. ignore.
+    }
+    delete_oxm_matches( match );
+  }
+  uint64_t insert_ns = now_ns() - start;
+
+  oxm_matches *packets[ N_PACKETS ];
+  for ( unsigned int i = 0; i < N_PACKETS; i++ ) {
+    // three quarters of packets hit a filter entry.
+    unsigned int index = ( unsigned int ) rand() % ( n_entries + n_entries / 3 + 1 );
+    packets[ i ] = create_packet_in_match( index );
+  }
+
+  unsigned int hits = 0;
+  start = now_ns();
+  for ( unsigned int i = 0; i < n_lookups; i++ ) {
+    if ( lookup_match_entry( packets[ i % N_PACKETS ] ) != NULL ) {
+      hits++;
+    }
+  }
+  uint64_t lookup_ns = now_ns() - start;
+
+  for ( unsigned int i = 0; i < N_PACKETS; i++ ) {
+    delete_oxm_matches( packets[ i ] );
+  }
+  finalize_match_table();
+
+  printf( "entries %7u: insert %10.1f ns/entry, lookup %8.1f ns/packet ( %10.0f packets/sec, hit %5.1f%% )\n",
+          n_entries,
+          n_entries > 0 ? ( double ) insert_ns / n_entries : 0.0,
+          n_lookups > 0 ? ( double ) lookup_ns / n_lookups : 0.0,
+          lookup_ns > 0 ? ( double ) n_lookups * 1e9 / ( double ) lookup_ns : 0.0,
+          n_lookups > 0 ? 100.0 * hits / n_lookups : 0.0 );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  unsigned int n_entries = 0;
+  unsigned int n_lookups = DEFAULT_LOOKUPS;
+  unsigned int wildcards_ratio = DEFAULT_WILDCARDS_RATIO;
+  unsigned int seed = 1;
+
+  int c;
+  while ( ( c = getopt_long( argc, argv, short_options, long_options, NULL ) ) != -1 ) {
+    switch ( c ) {
+      case 'n':
+        n_entries = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'l':
+        n_lookups = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'w':
+        wildcards_ratio = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 's':
+        seed = ( unsigned int ) strtoul( optarg, NULL, 0 );
+        break;
+      case 'h':
+        usage( argv[ 0 ] );
+        return EXIT_SUCCESS;
+      default:
+        usage( argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+  }
+
+  init_log( "match_table_benchmark", "/tmp", LOGGING_TYPE_STDOUT );
+  set_logging_level( "error" );
+
+  srand( seed );
+  if ( n_entries > 0 ) {
+    run_benchmark( n_entries, n_lookups, wildcards_ratio );
+  }
+  else {
+    for ( size_t i = 0; i < sizeof( default_n_entries ) / sizeof( default_n_entries[ 0 ] ); i++ ) {
+      run_benchmark( default_n_entries[ i ], n_lookups, wildcards_ratio );
+    }
+  }
+
+  finalize_log();
+
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
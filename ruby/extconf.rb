@@ -70,5 +70,8 @@ Please try the following command:
 EOF
 end
 
+# Lets the event loop wait for events without holding the GVL.
+have_func "rb_thread_call_without_gvl", "ruby/thread.h"
+
 
 create_makefile "trema", "trema"
@@ -59,6 +59,39 @@ end
 
 
 module Trema
+  class LatencyStats
+    attr_reader :ip_src
+    attr_reader :ip_dst
+    attr_reader :stream
+    attr_reader :n_pkts
+    attr_reader :n_lost
+    attr_reader :n_reordered
+    # latencies below are in nanoseconds.
+    attr_reader :min
+    attr_reader :mean
+    attr_reader :p50
+    attr_reader :p99
+    attr_reader :p999
+    attr_reader :max
+
+
+    def initialize ip_src, ip_dst, stream, n_pkts, n_lost, n_reordered, min, mean, p50, p99, p999, max
+      @ip_src = ip_src
+      @ip_dst = ip_dst
+      @stream = stream.to_i
+      @n_pkts = n_pkts.to_i
+      @n_lost = n_lost.to_i
+      @n_reordered = n_reordered.to_i
+      @min = min.to_i
+      @mean = mean.to_i
+      @p50 = p50.to_i
+      @p99 = p99.to_i
+      @p999 = p999.to_i
+      @max = max.to_i
+    end
+  end
+
+
   class Cli
     def initialize host
       @host = host
@@ -84,6 +117,16 @@ module Trema
     def show_rx_stats
       puts stats( :rx )
     end
+
+
+    def show_rate_stats
+      puts stats( :rate )
+    end
+
+
+    def show_latency_stats
+      puts stats( :latency )
+    end
     
 
     def tx_stats
@@ -106,6 +149,13 @@ module Trema
     end
 
 
+    def latency_stats
+      stats( :latency ).split( "\n" )[ 1..-1 ].to_a.collect do | each |
+        Trema::LatencyStats.new *each.split( "," )
+      end
+    end
+
+
     def reset_stats
       sh "sudo #{ Executables.cli } -i #{ @host.interface } reset_stats --tx"
       sh "sudo #{ Executables.cli } -i #{ @host.interface } reset_stats --rx"
@@ -136,7 +186,7 @@ module Trema
       [
        tp_src( options[ :tp_src ] || default_tp_src ),
        tp_dst( options[ :tp_dst ] || default_tp_dst ),
-       pps( options[ :pps ] || default_pps ),
+       pps( options[ :pps ] || ( options[ :high_rate ] ? 0 : default_pps ) ),
        options[ :n_pkts ] ? nil : duration( options[ :duration ] || default_duration ),
        length( options[ :length ] || default_length ),
        n_pkts( options[ :n_pkts ] ),
@@ -145,6 +195,10 @@ module Trema
        inc_tp_src( options[ :inc_tp_src ] ),
        inc_tp_dst( options[ :inc_tp_dst ] ),
        inc_payload( options[ :inc_payload ] ),
+       high_rate( options[ :high_rate ] ),
+       imix( options[ :imix ] ),
+       n_flows( options[ :n_flows ] ),
+       latency( options[ :latency ] ),
       ].compact.join( " " )
     end
 
@@ -255,6 +309,27 @@ module Trema
     end
 
 
+    def high_rate value
+      value ? "--high_rate" : nil
+    end
+
+
+    def imix value
+      value ? "--imix" : nil
+    end
+
+
+    def n_flows value
+      return nil if value.nil?
+      "--n_flows=#{ value }"
+    end
+
+
+    def latency value
+      value ? "--latency" : nil
+    end
+
+
     def stats type
       `sudo #{ Executables.cli } -i #{ @host.interface } show_stats --#{ type }`
     end
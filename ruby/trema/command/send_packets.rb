@@ -104,6 +104,18 @@ module Trema
           cli_options[ :inc_payload ] = true
         end
       end
+      options.on( "--high_rate" ) do
+        cli_options[ :high_rate ] = true
+      end
+      options.on( "--imix" ) do
+        cli_options[ :imix ] = true
+      end
+      options.on( "--n_flows NUMBER" ) do | v |
+        cli_options[ :n_flows ] = v
+      end
+      options.on( "--latency" ) do
+        cli_options[ :latency ] = true
+      end
 
       options.separator ""
 
@@ -45,6 +45,12 @@ module Trema
       options.on( "-r", "--rx" ) do
         stats = :rx
       end
+      options.on( "--rate" ) do
+        stats = :rate
+      end
+      options.on( "--latency" ) do
+        stats = :latency
+      end
 
       options.separator ""
 
@@ -66,6 +72,10 @@ module Trema
         Trema::Cli.new( host ).show_tx_stats
       when :rx
         Trema::Cli.new( host ).show_rx_stats
+      when :rate
+        Trema::Cli.new( host ).show_rate_stats
+      when :latency
+        Trema::Cli.new( host ).show_latency_stats
       else
         puts "Sent packets:"
         Trema::Cli.new( host ).show_tx_stats
@@ -21,6 +21,7 @@
 #include "barrier-reply.h"
 #include "buffer.h"
 #include "controller.h"
+#include "event-loop.h"
 #include "features-reply.h"
 #include "flow-removed.h"
 #include "get-config-reply.h"
@@ -32,7 +33,6 @@
 #include "port-status.h"
 #include "queue-get-config-reply.h"
 #include "ruby.h"
-#include "rubysig.h"
 #include "stats-reply.h"
 #include "switch-disconnected.h"
 #include "trema.h"
@@ -42,11 +42,31 @@
 extern VALUE mTrema;
 VALUE cController;
 
+// Method IDs and option keys are looked up once in Init_controller(),
+// not on every message sent.
+static ID id_handle_timer_event;
+static ID id_append;
+static VALUE sym_actions;
+static VALUE sym_buffer_id;
+static VALUE sym_check_overlap;
+static VALUE sym_cookie;
+static VALUE sym_data;
+static VALUE sym_emerg;
+static VALUE sym_hard_timeout;
+static VALUE sym_idle_timeout;
+static VALUE sym_in_port;
+static VALUE sym_match;
+static VALUE sym_out_port;
+static VALUE sym_packet_in;
+static VALUE sym_priority;
+static VALUE sym_send_flow_rem;
+static VALUE sym_strict;
+
 
 static void
 handle_timer_event( void *self ) {
-  if ( rb_respond_to( ( VALUE ) self, rb_intern( "handle_timer_event" ) ) == Qtrue ) {
-    rb_funcall( ( VALUE ) self, rb_intern( "handle_timer_event" ), 0 );
+  if ( rb_respond_to( ( VALUE ) self, id_handle_timer_event ) == Qtrue ) {
+    rb_funcall( ( VALUE ) self, id_handle_timer_event, 0 );
   }
 }
 
@@ -93,11 +113,11 @@ form_actions( VALUE raction, openflow_actions *actions ) {
 
         for ( i = 0; i < RARRAY_LEN( raction ); i++ ) {
           VALUE value = data_ptr[i];
-          rb_funcall( value, rb_intern( "append" ), 1, Data_Wrap_Struct( cController, NULL, NULL, actions ) );
+          rb_funcall( value, id_append, 1, Data_Wrap_Struct( cController, NULL, NULL, actions ) );
         }
         break;
       case T_OBJECT:
-        rb_funcall( raction, rb_intern( "append" ), 1, Data_Wrap_Struct( cController, NULL, NULL, actions ) );
+        rb_funcall( raction, id_append, 1, Data_Wrap_Struct( cController, NULL, NULL, actions ) );
         break;
       default:
         rb_raise( rb_eTypeError, "actions argument must be an Array or an Action object" );
@@ -114,7 +134,7 @@ get_strict( int argc, VALUE *argv ) {
 
   rb_scan_args( argc, argv, "11", &datapath_id, &options );
   if ( options != Qnil ) {
-    strict = rb_hash_aref( options, ID2SYM( rb_intern( "strict" ) ) );
+    strict = rb_hash_aref( options, sym_strict );
   }
   return strict;
 }
@@ -142,57 +162,57 @@ controller_send_flow_mod( uint16_t command, int argc, VALUE *argv, VALUE self )
 
   // Options
   if ( options != Qnil ) {
-    VALUE opt_match = rb_hash_aref( options, ID2SYM( rb_intern( "match" ) ) );
+    VALUE opt_match = rb_hash_aref( options, sym_match );
     if ( opt_match != Qnil ) {
       Data_Get_Struct( opt_match, struct ofp_match, match );
     }
 
-    VALUE opt_cookie = rb_hash_aref( options, ID2SYM( rb_intern( "cookie" ) ) );
+    VALUE opt_cookie = rb_hash_aref( options, sym_cookie );
     if ( opt_cookie != Qnil ) {
       cookie = NUM2ULL( opt_cookie );
     }
 
-    VALUE opt_idle_timeout = rb_hash_aref( options, ID2SYM( rb_intern( "idle_timeout" ) ) );
+    VALUE opt_idle_timeout = rb_hash_aref( options, sym_idle_timeout );
     if ( opt_idle_timeout != Qnil ) {
       idle_timeout = ( uint16_t )NUM2UINT( opt_idle_timeout );
     }
 
-    VALUE opt_hard_timeout = rb_hash_aref( options, ID2SYM( rb_intern( "hard_timeout" ) ) );
+    VALUE opt_hard_timeout = rb_hash_aref( options, sym_hard_timeout );
     if ( opt_hard_timeout != Qnil ) {
       hard_timeout = ( uint16_t )NUM2UINT( opt_hard_timeout );
     }
 
-    VALUE opt_priority = rb_hash_aref( options, ID2SYM( rb_intern( "priority" ) ) );
+    VALUE opt_priority = rb_hash_aref( options, sym_priority );
     if ( opt_priority != Qnil ) {
       priority = ( uint16_t )NUM2UINT( opt_priority );
     }
 
-    VALUE opt_buffer_id = rb_hash_aref( options, ID2SYM( rb_intern( "buffer_id" ) ) );
+    VALUE opt_buffer_id = rb_hash_aref( options, sym_buffer_id );
     if ( opt_buffer_id != Qnil ) {
       buffer_id = ( uint32_t ) NUM2ULONG( opt_buffer_id );
     }
 
-    VALUE opt_out_port = rb_hash_aref( options, ID2SYM( rb_intern( "out_port" ) ) );
+    VALUE opt_out_port = rb_hash_aref( options, sym_out_port );
     if ( opt_out_port != Qnil ) {
       out_port = ( uint16_t )NUM2UINT( opt_out_port );
     }
 
-    VALUE opt_send_flow_rem = rb_hash_aref( options, ID2SYM( rb_intern( "send_flow_rem" ) ) );
+    VALUE opt_send_flow_rem = rb_hash_aref( options, sym_send_flow_rem );
     if ( opt_send_flow_rem == Qfalse ) {
       flags &= ( uint16_t ) ~OFPFF_SEND_FLOW_REM;
     }
 
-    VALUE opt_check_overlap = rb_hash_aref( options, ID2SYM( rb_intern( "check_overlap" ) ) );
+    VALUE opt_check_overlap = rb_hash_aref( options, sym_check_overlap );
     if ( opt_check_overlap != Qnil ) {
       flags |= OFPFF_CHECK_OVERLAP;
     }
 
-    VALUE opt_emerg = rb_hash_aref( options, ID2SYM( rb_intern( "emerg" ) ) );
+    VALUE opt_emerg = rb_hash_aref( options, sym_emerg );
     if ( opt_emerg != Qnil ) {
       flags |= OFPFF_EMERG;
     }
 
-    VALUE opt_actions = rb_hash_aref( options, ID2SYM( rb_intern( "actions" ) ) );
+    VALUE opt_actions = rb_hash_aref( options, sym_actions );
     if ( opt_actions != Qnil ) {
       form_actions( opt_actions, actions );
     }
@@ -389,7 +409,7 @@ controller_send_packet_out( int argc, VALUE *argv, VALUE self ) {
   buffer *allocated_data = NULL;
 
   if ( options != Qnil ) {
-    VALUE opt_message = rb_hash_aref( options, ID2SYM( rb_intern( "packet_in" ) ) );
+    VALUE opt_message = rb_hash_aref( options, sym_packet_in );
     if ( opt_message != Qnil ) {
       packet_in *message;
       Data_Get_Struct( opt_message, packet_in, message );
@@ -401,22 +421,22 @@ controller_send_packet_out( int argc, VALUE *argv, VALUE self ) {
       data = ( buffer_id == OFP_NO_BUFFER ? message->data : NULL );
     }
 
-    VALUE opt_buffer_id = rb_hash_aref( options, ID2SYM( rb_intern( "buffer_id" ) ) );
+    VALUE opt_buffer_id = rb_hash_aref( options, sym_buffer_id );
     if ( opt_buffer_id != Qnil ) {
       buffer_id = ( uint32_t ) NUM2ULONG( opt_buffer_id );
     }
 
-    VALUE opt_in_port = rb_hash_aref( options, ID2SYM( rb_intern( "in_port" ) ) );
+    VALUE opt_in_port = rb_hash_aref( options, sym_in_port );
     if ( opt_in_port != Qnil ) {
       in_port = ( uint16_t ) NUM2UINT( opt_in_port );
     }
 
-    VALUE opt_action = rb_hash_aref( options, ID2SYM( rb_intern( "actions" ) ) );
+    VALUE opt_action = rb_hash_aref( options, sym_actions );
     if ( opt_action != Qnil ) {
       form_actions( opt_action, actions );
     }
 
-    VALUE opt_data = rb_hash_aref( options, ID2SYM( rb_intern( "data" ) ) );
+    VALUE opt_data = rb_hash_aref( options, sym_data );
     if ( opt_data != Qnil ) {
       Check_Type( opt_data, T_STRING );
       uint16_t length = ( u_int16_t ) RSTRING_LEN( opt_data );
@@ -507,26 +527,12 @@ controller_shutdown( VALUE self ) {
 }
 
 
-static void
-thread_pass( void *user_data ) {
-  UNUSED( user_data );
-  CHECK_INTS;
-  rb_funcall( rb_cThread, rb_intern( "pass" ), 0 );
-}
-
-
 /*
  * In the context of trema framework invokes the scheduler to start its applications.
  */
 static VALUE
 controller_start_trema( VALUE self ) {
-  struct itimerspec interval;
-  interval.it_interval.tv_sec = 0;
-  interval.it_interval.tv_nsec = 1000000;
-  interval.it_value.tv_sec = 0;
-  interval.it_value.tv_nsec = 0;
-  add_timer_event_callback( &interval, thread_pass, NULL );
-
+  prepare_event_loop();
   start_trema();
 
   return self;
@@ -543,6 +549,24 @@ Init_controller() {
   VALUE cApp = rb_eval_string( "Trema::App" );
   cController = rb_define_class_under( mTrema, "Controller", cApp );
 
+  id_handle_timer_event = rb_intern( "handle_timer_event" );
+  id_append = rb_intern( "append" );
+  sym_actions = ID2SYM( rb_intern( "actions" ) );
+  sym_buffer_id = ID2SYM( rb_intern( "buffer_id" ) );
+  sym_check_overlap = ID2SYM( rb_intern( "check_overlap" ) );
+  sym_cookie = ID2SYM( rb_intern( "cookie" ) );
+  sym_data = ID2SYM( rb_intern( "data" ) );
+  sym_emerg = ID2SYM( rb_intern( "emerg" ) );
+  sym_hard_timeout = ID2SYM( rb_intern( "hard_timeout" ) );
+  sym_idle_timeout = ID2SYM( rb_intern( "idle_timeout" ) );
+  sym_in_port = ID2SYM( rb_intern( "in_port" ) );
+  sym_match = ID2SYM( rb_intern( "match" ) );
+  sym_out_port = ID2SYM( rb_intern( "out_port" ) );
+  sym_packet_in = ID2SYM( rb_intern( "packet_in" ) );
+  sym_priority = ID2SYM( rb_intern( "priority" ) );
+  sym_send_flow_rem = ID2SYM( rb_intern( "send_flow_rem" ) );
+  sym_strict = ID2SYM( rb_intern( "strict" ) );
+
   rb_define_const( cController, "OFPP_MAX", INT2NUM( OFPP_MAX ) );
   rb_define_const( cController, "OFPP_IN_PORT", INT2NUM( OFPP_IN_PORT ) );
   rb_define_const( cController, "OFPP_TABLE", INT2NUM( OFPP_TABLE ) );
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "checks.h"
+#include "event_handler.h"
+#include "event-loop.h"
+#include "log.h"
+#include "ruby.h"
+#include "timer.h"
+
+
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+
+/*
+ * select() runs without the GVL, so Ruby threads run freely while the
+ * loop is idle. Ruby interrupts and changes to the fd sets or stop
+ * requests made from other Ruby threads poke an eventfd that is always in
+ * the read set, which makes the blocked select() return at once.
+ */
+
+#include <sys/eventfd.h>
+#include "ruby/thread.h"
+
+
+static int wakeup_fd = -1;
+static bool waiting = false;
+
+static void ( *original_set_fd_handler )( int fd, event_fd_callback read_callback, void *read_data, event_fd_callback write_callback, void *write_data );
+static void ( *original_delete_fd_handler )( int fd );
+static void ( *original_set_readable )( int fd, bool state );
+static void ( *original_set_writable )( int fd, bool state );
+static void ( *original_stop_event_handler )();
+
+
+typedef struct {
+  int nfds;
+  fd_set *read_set;
+  fd_set *write_set;
+  struct timeval *timeout;
+  int ret;
+  int error;
+} select_args;
+
+
+static void
+wakeup_event_loop( void *data ) {
+  UNUSED( data );
+
+  uint64_t count = 1;
+  ssize_t ret = write( wakeup_fd, &count, sizeof( count ) );
+  UNUSED( ret );
+}
+
+
+static void
+wakeup_waiting_event_loop() {
+  if ( waiting ) {
+    wakeup_event_loop( NULL );
+  }
+}
+
+
+static void *
+select_without_gvl( void *data ) {
+  select_args *args = data;
+
+  FD_SET( wakeup_fd, args->read_set );
+  int nfds = args->nfds > wakeup_fd ? args->nfds : wakeup_fd + 1;
+  args->ret = select( nfds, args->read_set, args->write_set, NULL, args->timeout );
+  args->error = errno;
+
+  return NULL;
+}
+
+
+static int
+select_event_fds_without_gvl( int nfds, fd_set *read_set, fd_set *write_set, struct timeval *timeout ) {
+  // Stays a timeout if Ruby has a pending interrupt and skips select().
+  select_args args = { nfds, read_set, write_set, timeout, 0, 0 };
+
+  waiting = true;
+  rb_thread_call_without_gvl( select_without_gvl, &args, wakeup_event_loop, NULL );
+  waiting = false;
+
+  if ( args.ret > 0 && FD_ISSET( wakeup_fd, read_set ) ) {
+    uint64_t count;
+    ssize_t ret = read( wakeup_fd, &count, sizeof( count ) );
+    UNUSED( ret );
+    FD_CLR( wakeup_fd, read_set );
+    args.ret--;
+  }
+
+  errno = args.error;
+  return args.ret;
+}
+
+
+static void
+set_fd_handler_and_wakeup( int fd, event_fd_callback read_callback, void *read_data, event_fd_callback write_callback, void *write_data ) {
+  original_set_fd_handler( fd, read_callback, read_data, write_callback, write_data );
+  wakeup_waiting_event_loop();
+}
+
+
+static void
+delete_fd_handler_and_wakeup( int fd ) {
+  original_delete_fd_handler( fd );
+  wakeup_waiting_event_loop();
+}
+
+
+static void
+set_readable_and_wakeup( int fd, bool state ) {
+  original_set_readable( fd, state );
+  wakeup_waiting_event_loop();
+}
+
+
+static void
+set_writable_and_wakeup( int fd, bool state ) {
+  original_set_writable( fd, state );
+  wakeup_waiting_event_loop();
+}
+
+
+static void
+stop_event_handler_and_wakeup() {
+  original_stop_event_handler();
+  wakeup_waiting_event_loop();
+}
+
+
+void
+prepare_event_loop() {
+  if ( wakeup_fd >= 0 ) {
+    return;
+  }
+
+  wakeup_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+  if ( wakeup_fd < 0 ) {
+    rb_raise( rb_eRuntimeError, "Failed to create an eventfd ( errno = %s [%d] ).", strerror( errno ), errno );
+  }
+
+  original_set_fd_handler = set_fd_handler;
+  original_delete_fd_handler = delete_fd_handler;
+  original_set_readable = set_readable;
+  original_set_writable = set_writable;
+  original_stop_event_handler = stop_event_handler;
+
+  set_fd_handler = set_fd_handler_and_wakeup;
+  delete_fd_handler = delete_fd_handler_and_wakeup;
+  set_readable = set_readable_and_wakeup;
+  set_writable = set_writable_and_wakeup;
+  stop_event_handler = stop_event_handler_and_wakeup;
+  select_event_fds = select_event_fds_without_gvl;
+}
+
+#else // HAVE_RB_THREAD_CALL_WITHOUT_GVL
+
+/*
+ * Interpreters without rb_thread_call_without_gvl() fall back to yielding
+ * to other Ruby threads from a 1 ms timer.
+ */
+
+#include "rubysig.h"
+
+
+static void
+thread_pass( void *user_data ) {
+  UNUSED( user_data );
+  CHECK_INTS;
+  rb_funcall( rb_cThread, rb_intern( "pass" ), 0 );
+}
+
+
+void
+prepare_event_loop() {
+  struct itimerspec interval;
+  interval.it_interval.tv_sec = 0;
+  interval.it_interval.tv_nsec = 1000000;
+  interval.it_value.tv_sec = 0;
+  interval.it_value.tv_nsec = 0;
+  add_timer_event_callback( &interval, thread_pass, NULL );
+}
+
+#endif // HAVE_RB_THREAD_CALL_WITHOUT_GVL
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
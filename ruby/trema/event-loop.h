@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+
+/*
+ * Lets other Ruby threads run while the trema event loop is waiting for
+ * events. Call before start_trema() / start_chibach().
+ */
+void prepare_event_loop( void );
+
+
+#endif // EVENT_LOOP_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -212,6 +212,8 @@ module Trema
         @cli.tx_stats
       when :rx
         @cli.rx_stats
+      when :latency
+        @cli.latency_stats
       else
         raise
       end
@@ -246,6 +248,22 @@ module Trema
     def rx_stats
       @cli.rx_stats
     end
+
+
+    #
+    # Returns one-way latency stats of the probes received from
+    # the hosts that ran send_packets with :latency => true
+    #
+    # @example
+    #   host.latency_stats
+    #
+    # @return [Array<LatencyStats>]
+    #
+    # @api public
+    #
+    def latency_stats
+      @cli.latency_stats
+    end
   end
 end
 
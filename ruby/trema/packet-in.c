@@ -25,17 +25,54 @@
 extern VALUE mTrema;
 VALUE cPacketIn;
 
-
-#define PACKET_IN_RETURN_MAC( packet_member )                                          \
-  {                                                                                    \
-    VALUE ret = ULL2NUM( mac_to_uint64( get_packet_in_info( self )->packet_member ) ); \
-    return rb_funcall( rb_eval_string( "Trema::Mac" ), rb_intern( "new" ), 1, ret );   \
+static VALUE cMac;
+static VALUE cIP;
+static ID id_new;
+static ID id_packet_in;
+
+
+// Trema::Mac and Trema::IP objects built on first access, so that
+// repeated reads of a field return the same object.
+typedef struct {
+  VALUE eth_macsa;
+  VALUE eth_macda;
+  VALUE arp_sha;
+  VALUE arp_spa;
+  VALUE arp_tha;
+  VALUE arp_tpa;
+  VALUE ipv4_saddr;
+  VALUE ipv4_daddr;
+  VALUE icmpv4_gateway;
+  VALUE igmp_group;
+} packet_in_cache;
+
+
+// The packet_in message must stay the first member, since other
+// wrappers ( e.g. send_packet_out ) read a PacketIn as a packet_in.
+typedef struct {
+  packet_in message;
+  packet_in_cache cache;
+} packet_in_object;
+
+
+#define PACKET_IN_RETURN_MAC( packet_member )                                            \
+  {                                                                                      \
+    VALUE *cached = &get_packet_in_cache( self )->packet_member;                         \
+    if ( NIL_P( *cached ) ) {                                                            \
+      VALUE ret = ULL2NUM( mac_to_uint64( get_packet_in_info( self )->packet_member ) ); \
+      *cached = rb_funcall( cMac, id_new, 1, ret );                                      \
+    }                                                                                    \
+    return *cached;                                                                      \
   }
 
-#define PACKET_IN_RETURN_IP( packet_member )                                        \
-  {                                                                                 \
-    VALUE ret = ULONG2NUM( get_packet_in_info( self )->packet_member );             \
-    return rb_funcall( rb_eval_string( "Trema::IP" ), rb_intern( "new" ), 1, ret ); \
+#define PACKET_IN_RETURN_IP( packet_member )                              \
+  {                                                                       \
+    VALUE *cached = &get_packet_in_cache( self )->packet_member;          \
+    if ( NIL_P( *cached ) ) {                                             \
+      VALUE ret = ULONG2NUM( get_packet_in_info( self )->packet_member ); \
+      *cached = rb_funcall( cIP, id_new, 1, ret );                        \
+    }                                                                     \
+    return *cached;                                                       \
   }
 
 #define PACKET_IN_RETURN_NUM( flag, func, packet_member )               \
@@ -48,26 +85,58 @@ VALUE cPacketIn;
   }
 
 
+static void
+packet_in_mark( packet_in_object *object ) {
+  rb_gc_mark( object->cache.eth_macsa );
+  rb_gc_mark( object->cache.eth_macda );
+  rb_gc_mark( object->cache.arp_sha );
+  rb_gc_mark( object->cache.arp_spa );
+  rb_gc_mark( object->cache.arp_tha );
+  rb_gc_mark( object->cache.arp_tpa );
+  rb_gc_mark( object->cache.ipv4_saddr );
+  rb_gc_mark( object->cache.ipv4_daddr );
+  rb_gc_mark( object->cache.icmpv4_gateway );
+  rb_gc_mark( object->cache.igmp_group );
+}
+
+
 static VALUE
 packet_in_alloc( VALUE klass ) {
-  packet_in *_packet_in = xmalloc( sizeof( packet_in ) );
-  return Data_Wrap_Struct( klass, 0, xfree, _packet_in );
+  packet_in_object *object = xmalloc( sizeof( packet_in_object ) );
+  memset( &object->message, 0, sizeof( packet_in ) );
+  object->cache.eth_macsa = Qnil;
+  object->cache.eth_macda = Qnil;
+  object->cache.arp_sha = Qnil;
+  object->cache.arp_spa = Qnil;
+  object->cache.arp_tha = Qnil;
+  object->cache.arp_tpa = Qnil;
+  object->cache.ipv4_saddr = Qnil;
+  object->cache.ipv4_daddr = Qnil;
+  object->cache.icmpv4_gateway = Qnil;
+  object->cache.igmp_group = Qnil;
+  return Data_Wrap_Struct( klass, packet_in_mark, xfree, object );
 }
 
 
 static packet_in *
 get_packet_in( VALUE self ) {
-  packet_in *cpacket;
-  Data_Get_Struct( self, packet_in, cpacket );
-  return cpacket;
+  packet_in_object *object;
+  Data_Get_Struct( self, packet_in_object, object );
+  return &object->message;
+}
+
+
+static packet_in_cache *
+get_packet_in_cache( VALUE self ) {
+  packet_in_object *object;
+  Data_Get_Struct( self, packet_in_object, object );
+  return &object->cache;
 }
 
 
 static packet_info *
 get_packet_in_info( VALUE self ) {
-  packet_in *cpacket;
-  Data_Get_Struct( self, packet_in, cpacket );
-  return ( packet_info * ) cpacket->data->user_data;
+  return get_parsed_packet_info( get_packet_in( self )->data );
 }
 
 
@@ -1016,10 +1085,110 @@ packet_in_udp_checksum( VALUE self ) {
 }
 
 
+typedef struct {
+  const char *name;
+  VALUE ( *get )( VALUE self );
+  uint32_t format;
+} packet_in_field;
+
+
+static packet_in_field packet_in_fields[] = {
+  { "datapath_id", packet_in_datapath_id, 0 },
+  { "transaction_id", packet_in_transaction_id, 0 },
+  { "buffer_id", packet_in_buffer_id, 0 },
+  { "in_port", packet_in_in_port, 0 },
+  { "total_len", packet_in_total_len, 0 },
+  { "reason", packet_in_reason, 0 },
+  { "data", packet_in_data, 0 },
+  { "macsa", packet_in_macsa, 0 },
+  { "macda", packet_in_macda, 0 },
+  { "eth_type", packet_in_eth_type, 0 },
+  { "vlan_tpid", packet_in_vlan_tpid, ETH_8021Q },
+  { "vlan_tci", packet_in_vlan_tci, ETH_8021Q },
+  { "vlan_prio", packet_in_vlan_prio, ETH_8021Q },
+  { "vlan_cfi", packet_in_vlan_cfi, ETH_8021Q },
+  { "vlan_vid", packet_in_vlan_vid, ETH_8021Q },
+  { "arp_oper", packet_in_arp_oper, NW_ARP },
+  { "arp_sha", packet_in_arp_sha, NW_ARP },
+  { "arp_spa", packet_in_arp_spa, NW_ARP },
+  { "arp_tha", packet_in_arp_tha, NW_ARP },
+  { "arp_tpa", packet_in_arp_tpa, NW_ARP },
+  { "ipv4_version", packet_in_ipv4_version, NW_IPV4 },
+  { "ipv4_ihl", packet_in_ipv4_ihl, NW_IPV4 },
+  { "ipv4_tos", packet_in_ipv4_tos, NW_IPV4 },
+  { "ipv4_tot_len", packet_in_ipv4_tot_len, NW_IPV4 },
+  { "ipv4_id", packet_in_ipv4_id, NW_IPV4 },
+  { "ipv4_frag_off", packet_in_ipv4_frag_off, NW_IPV4 },
+  { "ipv4_ttl", packet_in_ipv4_ttl, NW_IPV4 },
+  { "ipv4_protocol", packet_in_ipv4_protocol, NW_IPV4 },
+  { "ipv4_checksum", packet_in_ipv4_checksum, NW_IPV4 },
+  { "ipv4_saddr", packet_in_ipv4_saddr, NW_IPV4 },
+  { "ipv4_daddr", packet_in_ipv4_daddr, NW_IPV4 },
+  { "icmpv4_type", packet_in_icmpv4_type, NW_ICMPV4 },
+  { "icmpv4_code", packet_in_icmpv4_code, NW_ICMPV4 },
+  { "icmpv4_checksum", packet_in_icmpv4_checksum, NW_ICMPV4 },
+  { "icmpv4_id", packet_in_icmpv4_id, NW_ICMPV4 },
+  { "icmpv4_seq", packet_in_icmpv4_seq, NW_ICMPV4 },
+  { "icmpv4_gateway", packet_in_icmpv4_gateway, NW_ICMPV4 },
+  { "igmp_type", packet_in_igmp_type, NW_IGMP },
+  { "igmp_group", packet_in_igmp_group, NW_IGMP },
+  { "igmp_checksum", packet_in_igmp_checksum, NW_IGMP },
+  { "tcp_src_port", packet_in_tcp_src_port, TP_TCP },
+  { "tcp_dst_port", packet_in_tcp_dst_port, TP_TCP },
+  { "tcp_seq_no", packet_in_tcp_seq_no, TP_TCP },
+  { "tcp_ack_no", packet_in_tcp_ack_no, TP_TCP },
+  { "tcp_offset", packet_in_tcp_offset, TP_TCP },
+  { "tcp_flags", packet_in_tcp_flags, TP_TCP },
+  { "tcp_window", packet_in_tcp_window, TP_TCP },
+  { "tcp_checksum", packet_in_tcp_checksum, TP_TCP },
+  { "tcp_urgent", packet_in_tcp_urgent, TP_TCP },
+  { "udp_payload", packet_in_udp_payload, TP_UDP },
+  { "udp_src_port", packet_in_udp_src_port, TP_UDP },
+  { "udp_dst_port", packet_in_udp_dst_port, TP_UDP },
+  { "udp_len", packet_in_udp_len, TP_UDP },
+  { "udp_checksum", packet_in_udp_checksum, TP_UDP },
+};
+
+#define N_PACKET_IN_FIELDS ( sizeof( packet_in_fields ) / sizeof( packet_in_fields[ 0 ] ) )
+
+static VALUE packet_in_field_keys[ N_PACKET_IN_FIELDS ];
+
+
+/*
+ * All the fields of this packet_in in one Hash, keyed by accessor
+ * name. Fields of protocols the frame does not carry are omitted, so
+ * this is much cheaper than calling each accessor from Ruby.
+ *
+ * @example
+ *   message.to_h[ :ipv4_saddr ] #=> #<Trema::IP ...>
+ *
+ * @return [Hash] the fields of this packet_in.
+ */
+static VALUE
+packet_in_to_h( VALUE self ) {
+  uint32_t format = get_packet_in_info( self )->format;
+  VALUE hash = rb_hash_new();
+  for ( size_t i = 0; i < N_PACKET_IN_FIELDS; i++ ) {
+    if ( ( format & packet_in_fields[ i ].format ) == packet_in_fields[ i ].format ) {
+      rb_hash_aset( hash, packet_in_field_keys[ i ], packet_in_fields[ i ].get( self ) );
+    }
+  }
+  return hash;
+}
+
+
 void
 Init_packet_in() {
   rb_require( "trema/ip" );
   rb_require( "trema/mac" );
+  cMac = rb_const_get( mTrema, rb_intern( "Mac" ) );
+  cIP = rb_const_get( mTrema, rb_intern( "IP" ) );
+  id_new = rb_intern( "new" );
+  id_packet_in = rb_intern( "packet_in" );
+  for ( size_t i = 0; i < N_PACKET_IN_FIELDS; i++ ) {
+    packet_in_field_keys[ i ] = ID2SYM( rb_intern( packet_in_fields[ i ].name ) );
+  }
+
   cPacketIn = rb_define_class_under( mTrema, "PacketIn", rb_cObject );
   rb_define_alloc_func( cPacketIn, packet_in_alloc );
 
@@ -1105,6 +1274,8 @@ Init_packet_in() {
   rb_define_method( cPacketIn, "udp_dst_port", packet_in_udp_dst_port, 0 );
   rb_define_method( cPacketIn, "udp_checksum", packet_in_udp_checksum, 0 );
   rb_define_method( cPacketIn, "udp_len", packet_in_udp_len, 0 );
+
+  rb_define_method( cPacketIn, "to_h", packet_in_to_h, 0 );
 }
 
 
@@ -1114,16 +1285,14 @@ Init_packet_in() {
 void
 handle_packet_in( uint64_t datapath_id, packet_in message ) {
   VALUE controller = ( VALUE ) message.user_data;
-  if ( rb_respond_to( controller, rb_intern( "packet_in" ) ) == Qfalse ) {
+  if ( rb_respond_to( controller, id_packet_in ) == Qfalse ) {
     return;
   }
 
-  VALUE r_message = rb_funcall( cPacketIn, rb_intern( "new" ), 0 );
-  packet_in *tmp = NULL;
-  Data_Get_Struct( r_message, packet_in, tmp );
-  memcpy( tmp, &message, sizeof( packet_in ) );
+  VALUE r_message = rb_funcall( cPacketIn, id_new, 0 );
+  memcpy( get_packet_in( r_message ), &message, sizeof( packet_in ) );
 
-  rb_funcall( controller, rb_intern( "packet_in" ), 2, ULL2NUM( datapath_id ), r_message );
+  rb_funcall( controller, id_packet_in, 2, ULL2NUM( datapath_id ), r_message );
 }
 
 
@@ -33,6 +33,8 @@ module Trema
 
       if option.to_s == "tx"
         Cli.new( Host[ host_name ] ).show_tx_stats
+      elsif option.to_s == "latency"
+        Cli.new( Host[ host_name ] ).show_latency_stats
       else
         Cli.new( Host[ host_name ] ).show_rx_stats
       end
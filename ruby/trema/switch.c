@@ -17,10 +17,10 @@
 
 
 #include "chibach.h"
+#include "event-loop.h"
 #include "flow-mod.h"
 #include "logger.h"
 #include "ruby.h"
-#include "rubysig.h"
 #include "switch.h"
 
 
@@ -141,23 +141,9 @@ switch_run( VALUE self ) {
 }
 
 
-static void
-thread_pass( void *user_data ) {
-  UNUSED( user_data );
-  CHECK_INTS;
-  rb_funcall( rb_cThread, rb_intern( "pass" ), 0 );
-}
-
-
 static VALUE
 switch_start_chibach( VALUE self ) {
-  struct itimerspec interval;
-  interval.it_interval.tv_sec = 0;
-  interval.it_interval.tv_nsec = 1000000;
-  interval.it_value.tv_sec = 0;
-  interval.it_value.tv_nsec = 0;
-  add_timer_event_callback( &interval, thread_pass, NULL );
-
+  prepare_event_loop();
   start_chibach();
 
   return self;
@@ -523,6 +523,68 @@ describe Trema::PacketIn do
       }
     end
 
+    it "should return the same fields from to_h" do
+      network {
+        vswitch( "packet-in" ) { datapath_id 0xabc }
+        vhost "host1"
+        vhost ( "host2" ) {
+          ip "192.168.0.2"
+          netmask "255.255.0.0"
+          mac "00:00:00:00:00:02"
+        }
+        link "host1", "packet-in"
+        link "host2", "packet-in"
+      }.run( PacketInSendController ) {
+        data = [
+          0x00, 0x00, 0x00, 0x00, 0x00, 0x02, # dst
+          0x00, 0x00, 0x00, 0x00, 0x00, 0x01, # src
+          0x08, 0x00, # ether type
+          # ipv4
+          0x45, 0x00, # version
+          0x00, 0x32, # length
+          0x00, 0x00,
+          0x00, 0x00,
+          0x40,       # ttl
+          0x11,       # protocol
+          0xf9, 0x68, # checksum
+          0xc0, 0xa8, 0x00, 0x01, # src
+          0xc0, 0xa8, 0x00, 0x02, # dst
+          # udp
+          0x00, 0x01, # src port
+          0x00, 0x02, # dst port
+          0x00, 0x1e, # length
+          0x00, 0x00, # checksum
+          0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+          0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+          0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+        ].pack( "C*" )
+        controller( "PacketInSendController" ).should_receive( :packet_in ) do | datapath_id, message |
+          fields = message.to_h
+          fields[ :datapath_id ].should == 0xabc
+          fields[ :in_port ].should == message.in_port
+          fields[ :macsa ].to_s.should == "00:00:00:00:00:01"
+          fields[ :macda ].to_s.should == "00:00:00:00:00:02"
+          fields[ :ipv4_saddr ].to_s.should == "192.168.0.1"
+          fields[ :ipv4_daddr ].to_s.should == "192.168.0.2"
+          fields[ :udp_src_port ].should == 1
+          fields[ :udp_dst_port ].should == 2
+          fields.should_not have_key( :vlan_vid )
+          fields.should_not have_key( :arp_oper )
+          fields.should_not have_key( :tcp_src_port )
+
+          message.macsa.should equal( message.macsa )
+          message.ipv4_saddr.should equal( fields[ :ipv4_saddr ] )
+        end
+
+        controller( "PacketInSendController" ).send_packet_out(
+          0xabc,
+          :data => data,
+          :actions => Trema::ActionOutput.new( :port => Controller::OFPP_CONTROLLER )
+        )
+        sleep 2
+      }
+    end
+
   end
 
 end
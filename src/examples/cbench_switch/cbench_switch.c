@@ -25,28 +25,44 @@
 
 static void
 handle_packet_in( uint64_t datapath_id, packet_in message ) {
+  if ( message.data == NULL ) {
+    return;
+  }
+  uint32_t in_port = get_in_port_from_oxm_matches( message.match );
+  if ( in_port == 0 ) {
+    return;
+  }
+
   openflow_actions *actions = create_actions();
-  append_action_output( actions, ( uint16_t ) ( message.in_port + 1 ), OFPCML_NO_BUFFER );
+  append_action_output( actions, in_port + 1, OFPCML_NO_BUFFER );
+
+  openflow_instructions *insts = create_instructions();
+  append_instructions_apply_actions( insts, actions );
 
-  struct ofp_match match;
-  set_match_from_packet( &match, message.in_port, 0, message.data );
+  oxm_matches *match = create_oxm_matches();
+  set_match_from_packet( match, in_port, NULL, message.data );
 
   buffer *flow_mod = create_flow_mod(
     get_transaction_id(),
-    match,
     get_cookie(),
+    0,
+    0,
     OFPFC_ADD,
     0,
     0,
     OFP_HIGH_PRIORITY,
     message.buffer_id,
-    OFPP_NONE,
     0,
-    actions
+    0,
+    0,
+    match,
+    insts
   );
   send_openflow_message( datapath_id, flow_mod );
 
   free_buffer( flow_mod );
+  delete_oxm_matches( match );
+  delete_instructions( insts );
   delete_actions( actions );
 }
 
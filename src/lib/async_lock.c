@@ -17,136 +17,96 @@
 
 
 #include <assert.h>
-#include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>
-#include <string.h>
-#include <time.h>
-#include "array_util.h"
 #include "async_lock.h"
-#include "async_util.h"
 #include "log.h"
 #include "trema_wrapper.h"
-#include "wrapper.h"
 
 
-static struct thread_info_list thread_list;
-static struct lock_group lck_grp[ MAX_SECTIONS ] = { 
+static struct lock_group lck_grp[ MAX_SECTIONS ] = {
   LCK_GRP_INIT,
   LCK_GRP_INIT
 };
-static pthread_mutex_t global_mutex;
-LOCK_OBJ( global )
-UNLOCK_OBJ( global )
-GET_OBJ_INFO( thread )
-
-
-static inline int
-compare_and_swap( const uint32_t old, const uint32_t new, uint32_t *address, pthread_mutex_t *mutex  ) {
-  assert( address != NULL );
-  assert( mutex != NULL );
-
-  int ret = 0;
-  pthread_mutex_lock( mutex );
-  if ( *address == old ) {
-    *address = new;
-    ret = 1;
-  }
-  pthread_mutex_unlock( mutex );
 
-  return ret;
-}
+
+/*
+ * Per-thread lock state. A thread may nest read sections, and does so
+ * even while a writer is waiting, since the writer cannot proceed until
+ * the outermost section ends anyway.
+ */
+static __thread uint32_t read_depth[ MAX_SECTIONS ];
+static __thread bool writing[ MAX_SECTIONS ];
+static __thread bool thread_added;
 
 
 static void
 lock_read_begin( enum lock_section section ) {
-  uint32_t new_value;
-  uint32_t old_value;
+  struct lock_group *grp = &lck_grp[ section ];
 
-  struct thread_info *thread = get_thread_info();
-  assert( thread != NULL );
-
-  if ( thread->attr( incremented_read, section ) == lck_grp[ section ].writer_waiting ) {
+  if ( writing[ section ] ) {
     trema_abort();
   }
 
-  struct timespec ts = { 0, 0 };
-  int ret = -1;
-  do {
-again:
-    pthread_mutex_lock( &lck_grp[ section ].mutex );
-    old_value = lck_grp[ section ].read_count;
-    pthread_mutex_unlock( &lck_grp[ section ].mutex );
-
-    if ( ( old_value & lck_grp[ section ].writer_waiting ) != 0 && thread->attr( incremented_read, section ) == 0 ) {
-      pthread_mutex_lock( &lck_grp[ section ].rw_mutex );
-      {
-        clock_gettime( CLOCK_REALTIME, &ts );
-        ts.tv_sec += 1;
-        ret = pthread_cond_timedwait( &lck_grp[ section ].read_cond, &lck_grp[ section ].rw_mutex, &ts );
-      }
-      pthread_mutex_unlock( &lck_grp[ section ].rw_mutex );
-      if ( ret == ETIMEDOUT ) {
-        goto again;
+  if ( read_depth[ section ]++ > 0 ) {
+    __atomic_add_fetch( &grp->state, 1, __ATOMIC_ACQUIRE );
+    return;
+  }
+
+  uint32_t state = __atomic_load_n( &grp->state, __ATOMIC_RELAXED );
+  for ( ;; ) {
+    if ( ( state & LOCK_WRITER ) == 0 ) {
+      if ( __atomic_compare_exchange_n( &grp->state, &state, state + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) {
+        return;
       }
+      continue;
     }
-    new_value = old_value + 1;
-  } while ( !compare_and_swap( old_value, new_value, &lck_grp[ section ].read_count, &lck_grp[ section ].mutex ) );
 
-  thread->attr( incremented_read, section )++;
+    pthread_mutex_lock( &grp->wait_mutex );
+    __atomic_add_fetch( &grp->waiting_readers, 1, __ATOMIC_SEQ_CST );
+    while ( ( __atomic_load_n( &grp->state, __ATOMIC_SEQ_CST ) & LOCK_WRITER ) != 0 ) {
+      pthread_cond_wait( &grp->read_cond, &grp->wait_mutex );
+    }
+    __atomic_sub_fetch( &grp->waiting_readers, 1, __ATOMIC_RELAXED );
+    pthread_mutex_unlock( &grp->wait_mutex );
+    state = __atomic_load_n( &grp->state, __ATOMIC_RELAXED );
+  }
 }
 
 
 static void
 lock_read_end( enum lock_section section ) {
-  struct thread_info *thread = get_thread_info();
-  assert( thread != NULL );
-
-  pthread_mutex_lock( &lck_grp[ section ].mutex );
-  lck_grp[ section ].read_count--;
-  pthread_mutex_unlock( &lck_grp[ section ].mutex );
-  thread->attr( incremented_read, section )--;
-  if ( lck_grp[ section ].read_count == lck_grp[ section ].writer_waiting ) {
-    pthread_mutex_lock( &lck_grp[ section ].rw_mutex );
-    {
-      pthread_cond_signal( &lck_grp[ section ].write_cond );
-    }
-    pthread_mutex_unlock( &lck_grp[ section ].rw_mutex );
+  struct lock_group *grp = &lck_grp[ section ];
+
+  assert( read_depth[ section ] > 0 );
+  read_depth[ section ]--;
+
+  if ( __atomic_sub_fetch( &grp->state, 1, __ATOMIC_SEQ_CST ) == LOCK_WRITER ) {
+    // the last reader wakes up the waiting writer
+    pthread_mutex_lock( &grp->wait_mutex );
+    pthread_cond_signal( &grp->write_cond );
+    pthread_mutex_unlock( &grp->wait_mutex );
   }
 }
 
 
 static int
 lock_write_begin( enum lock_section section ) {
-  struct thread_info *thread = get_thread_info();
-  assert( thread != NULL );
+  struct lock_group *grp = &lck_grp[ section ];
 
-  if ( thread->attr( incremented_read, section ) != 0 ) {
+  if ( read_depth[ section ] != 0 || writing[ section ] ) {
     return -1;
   }
-  pthread_mutex_lock( &lck_grp[ section ].mutex );
-  lck_grp[ section ].read_count |= lck_grp[ section ].writer_waiting;
 
-  struct timespec ts = { 0, 0 };
-  int ret = -1;
-
-again:
-  if ( lck_grp[ section ].read_count == lck_grp[ section ].writer_waiting ) {
-    thread->attr( incremented_read, section ) = lck_grp[ section ].writer_waiting;
-    return 0;
-  }
-  else {
-    pthread_mutex_lock( &lck_grp[ section ].rw_mutex );
-    {
-      clock_gettime( CLOCK_REALTIME, &ts );
-      ts.tv_sec += 1;
-      ret = pthread_cond_timedwait( &lck_grp[ section ].write_cond, &lck_grp[ section ].rw_mutex, &ts );
-    }
-    pthread_mutex_unlock( &lck_grp[ section ].rw_mutex );
-    if ( ret == ETIMEDOUT ) {
-      goto again;
+  pthread_mutex_lock( &grp->write_mutex );
+  if ( __atomic_or_fetch( &grp->state, LOCK_WRITER, __ATOMIC_SEQ_CST ) != LOCK_WRITER ) {
+    pthread_mutex_lock( &grp->wait_mutex );
+    while ( __atomic_load_n( &grp->state, __ATOMIC_SEQ_CST ) != LOCK_WRITER ) {
+      pthread_cond_wait( &grp->write_cond, &grp->wait_mutex );
     }
+    pthread_mutex_unlock( &grp->wait_mutex );
   }
+  writing[ section ] = true;
 
   return 0;
 }
@@ -154,38 +114,30 @@ again:
 
 static void
 lock_write_end( enum lock_section section ) {
-  struct thread_info *thread = get_thread_info();
-  assert( thread != NULL );
+  struct lock_group *grp = &lck_grp[ section ];
 
-  if ( thread->attr( incremented_read, section ) != lck_grp[ section ].writer_waiting ) {
+  if ( !writing[ section ] ) {
     trema_abort();
   }
-  lck_grp[ section ].read_count &= ~( lck_grp[ section ].writer_waiting );
-  pthread_mutex_unlock( &lck_grp[ section ].mutex );
-  thread->attr( incremented_read, section ) = 0;
-  pthread_mutex_lock( &lck_grp[ section ].rw_mutex ) ;
-  {
-    pthread_cond_signal( &lck_grp [ section ].read_cond );
+  writing[ section ] = false;
+
+  __atomic_and_fetch( &grp->state, ~LOCK_WRITER, __ATOMIC_SEQ_CST );
+  pthread_mutex_unlock( &grp->write_mutex );
+  if ( __atomic_load_n( &grp->waiting_readers, __ATOMIC_SEQ_CST ) > 0 ) {
+    pthread_mutex_lock( &grp->wait_mutex );
+    pthread_cond_broadcast( &grp->read_cond );
+    pthread_mutex_unlock( &grp->wait_mutex );
   }
-  pthread_mutex_unlock( &lck_grp[ section ].rw_mutex ) ;
 }
 
 
 void 
 add_thread( void ) {
-  struct thread_info *thread = get_thread_info();
-
-  if ( thread != NULL ) {
-    error( "add_thread has been called twice for thread id %ld", thread->thread_id );
+  if ( thread_added ) {
+    error( "add_thread has been called twice for thread id %lu", ( unsigned long ) pthread_self() );
     return;
   }
-  thread = ( struct thread_info * ) xmalloc( sizeof( *thread ) );
-  thread->thread_id = current_thread();
-  memset( &thread->sections, 0, sizeof( struct section ) * MAX_SECTIONS );
-  global_lock();
-  ALLOC_GROW( thread_list.threads, thread_list.threads_nr + 1, thread_list.threads_alloc );
-  thread_list.threads[ thread_list.threads_nr++ ] = thread;
-  global_unlock();
+  thread_added = true;
 }
 
 
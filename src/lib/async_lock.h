@@ -36,39 +36,31 @@ enum lock_section {
 };
 
 
+/*
+ * A writer-preferring reader/writer lock. state holds the number of
+ * readers and LOCK_WRITER while a writer is waiting for or holding the
+ * lock. Readers and writers only fall back to sleeping on the condition
+ * variables when the lock is contended.
+ */
 struct lock_group {
-  pthread_mutex_t mutex;
-  pthread_mutex_t rw_mutex;
+  uint32_t state;
+  uint32_t waiting_readers;
+  pthread_mutex_t write_mutex;
+  pthread_mutex_t wait_mutex;
   pthread_cond_t read_cond;
   pthread_cond_t write_cond;
-  uint32_t read_count;
-  uint32_t writer_waiting;
-};
-
-
-#define LCK_GRP_INIT { .mutex = PTHREAD_MUTEX_INITIALIZER, .read_count = 0, .writer_waiting = 0x80000000 }
-
-
-struct section {
-  uint32_t incremented_read;
 };
 
 
-struct thread_info {
-  pthread_t thread_id;
-  struct section sections[ MAX_SECTIONS ];
-};
-
-
-#define attr( attr, idx ) \
-  sections[ ( idx ) ].attr
-
-
-struct thread_info_list {
-  struct thread_info **threads;
-  uint32_t threads_nr;
-  uint32_t threads_alloc;
-};
+#define LOCK_WRITER 0x80000000U
+#define LCK_GRP_INIT {                        \
+  .state = 0,                                \
+  .waiting_readers = 0,                      \
+  .write_mutex = PTHREAD_MUTEX_INITIALIZER,  \
+  .wait_mutex = PTHREAD_MUTEX_INITIALIZER,   \
+  .read_cond = PTHREAD_COND_INITIALIZER,     \
+  .write_cond = PTHREAD_COND_INITIALIZER     \
+}
 
 
 void event_read_begin( void );
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "bool.h"
 #include "buffer.h"
 #include "checks.h"
 #include "utility.h"
@@ -34,6 +35,7 @@ typedef struct {
   size_t real_length;
   void *top;
   pthread_mutex_t *mutex;
+  bool external_data; // data is not owned by the buffer
 } private_buffer;
 
 
@@ -96,7 +98,10 @@ append_front( private_buffer *pbuf, size_t length ) {
   size_t new_length = front_length_of( pbuf ) + pbuf->public.length + length;
   void *new_data = xmalloc( new_length );
   memcpy( ( char * ) new_data + front_length_of( pbuf ) + length, pbuf->public.data, pbuf->public.length );
-  xfree( pbuf->top );
+  if ( !pbuf->external_data ) {
+    xfree( pbuf->top );
+  }
+  pbuf->external_data = false;
 
   pbuf->public.data = ( char * ) new_data + front_length_of( pbuf );
   pbuf->real_length = new_length;
@@ -113,7 +118,10 @@ append_back( private_buffer *pbuf, size_t length ) {
   size_t new_length = front_length_of( pbuf ) + pbuf->public.length + length;
   void *new_data = xmalloc( new_length );
   memcpy( ( char * ) new_data + front_length_of( pbuf ), pbuf->public.data, pbuf->public.length );
-  xfree( pbuf->top );
+  if ( !pbuf->external_data ) {
+    xfree( pbuf->top );
+  }
+  pbuf->external_data = false;
 
   pbuf->public.data = ( char * ) new_data + front_length_of( pbuf );
   pbuf->real_length = new_length;
@@ -151,6 +159,45 @@ alloc_buffer_with_length( size_t length ) {
 }
 
 
+/*
+ * Allocates a buffer that refers to the given memory instead of copying it.
+ * The memory is not freed by free_buffer() and must outlive the buffer.
+ * Growing the buffer copies the data into memory owned by the buffer.
+ */
+buffer *
+alloc_buffer_with_data( void *data, size_t length ) {
+  assert( data != NULL );
+  assert( length != 0 );
+
+  private_buffer *new_buf = alloc_private_buffer();
+  new_buf->public.data = data;
+  new_buf->public.length = length;
+  new_buf->top = data;
+  new_buf->real_length = length;
+  new_buf->external_data = true;
+
+  return ( buffer * ) new_buf;
+}
+
+
+/*
+ * Allocates a buffer with room for length bytes of data that is preceded by
+ * headroom bytes, so that append_front_buffer() of up to headroom bytes
+ * neither reallocates nor moves the data.
+ */
+buffer *
+alloc_buffer_with_headroom( size_t headroom, size_t length ) {
+  assert( headroom + length != 0 );
+
+  private_buffer *new_buf = alloc_private_buffer();
+  new_buf->top = xmalloc( headroom + length );
+  new_buf->public.data = ( char * ) new_buf->top + headroom;
+  new_buf->real_length = headroom + length;
+
+  return ( buffer * ) new_buf;
+}
+
+
 void
 free_buffer( buffer *buf ) {
   assert( buf != NULL );
@@ -162,7 +209,7 @@ free_buffer( buffer *buf ) {
   }
   pthread_mutex_lock( ( ( private_buffer * ) buf )->mutex );
   private_buffer *delete_me = ( private_buffer * ) buf;
-  if ( delete_me->top != NULL ) {
+  if ( delete_me->top != NULL && !delete_me->external_data ) {
     xfree( delete_me->top );
   }
   pthread_mutex_unlock( delete_me->mutex );
@@ -188,7 +235,11 @@ append_front_buffer( buffer *buf, size_t length ) {
   }
 
   buffer *b = &( pbuf->public );
-  if ( already_allocated( pbuf, length ) ) {
+  if ( !pbuf->external_data && front_length_of( pbuf ) >= length ) {
+    b->data = ( char * ) b->data - length;
+    memset( b->data, 0, length );
+  }
+  else if ( already_allocated( pbuf, length ) ) {
     memmove( ( char * ) b->data + length, b->data, b->length );
     memset( b->data, 0, length );
   } else {
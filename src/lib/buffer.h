@@ -37,6 +37,8 @@ typedef struct buffer {
 
 buffer *alloc_buffer( void );
 buffer *alloc_buffer_with_length( size_t length );
+buffer *alloc_buffer_with_data( void *data, size_t length );
+buffer *alloc_buffer_with_headroom( size_t headroom, size_t length );
 void free_buffer( buffer *buf );
 void *append_front_buffer( buffer *buf, size_t length );
 void *remove_front_buffer( buffer *buf, size_t length );
@@ -99,6 +99,13 @@ static int fd_set_size = 0;
 static external_callback_t external_callback = ( external_callback_t ) NULL;
 
 
+static int
+_select_event_fds( int nfds, fd_set *read_set, fd_set *write_set, struct timeval *timeout ) {
+  return select( nfds, read_set, write_set, NULL, timeout );
+}
+int ( *select_event_fds )( int nfds, fd_set *read_set, fd_set *write_set, struct timeval *timeout ) = _select_event_fds;
+
+
 static void
 _init_event_handler() {
   event_last = event_list;
@@ -141,7 +148,7 @@ _run_event_handler_once( int timeout_usec ) {
   struct timeval timeout;
   timeout.tv_sec = timeout_usec / 1000000;
   timeout.tv_usec = timeout_usec % 1000000;
-  int set_count = select( fd_set_size, &current_read_set, &current_write_set, NULL, &timeout );
+  int set_count = select_event_fds( fd_set_size, &current_read_set, &current_write_set, &timeout );
 
   if ( set_count == -1 ) {
     if ( errno == EINTR ) {
@@ -24,6 +24,7 @@
 #define EVENT_HANDLER_H
 
 
+#include <sys/select.h>
 #include <sys/types.h>
 #include "bool.h"
 
@@ -39,6 +40,10 @@ extern void ( *stop_event_handler )();
 
 extern bool ( *run_event_handler_once )( int timeout_usec );
 
+// Blocks until a descriptor in the sets is ready. Language bindings may
+// replace it to wait without holding their interpreter lock.
+extern int ( *select_event_fds )( int nfds, fd_set *read_set, fd_set *write_set, struct timeval *timeout );
+
 extern void ( *set_fd_handler )( int fd, event_fd_callback read_callback, void *read_data, event_fd_callback write_callback, void *write_data );
 extern void ( *delete_fd_handler )( int fd );
 
@@ -20,30 +20,75 @@
 
 #include <assert.h>
 #include <pthread.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <openflow.h>
 #include "checks.h"
+#include "hash_table.h"
 #include "match_table.h"
 #include "log.h"
+#include "utility.h"
 #include "wrapper.h"
 
 
 #define VLAN_VID_MASK 0x0fff // 12 bits
 #define VLAN_PCP_MASK 0x07 // 3 bits
 
+#define MATCH_NUM ( OFPXMT_OFB_IPV6_EXTHDR + 1 ) // MATCH_NUM = 40
+#define MAX_OXM_FIELD_LENGTH 16 // IPv6 address is the widest field
+#define MATCH_KEY_LENGTH 256
+#define N_PRIORITIES ( UINT16_MAX + 1 )
+#define N_PRIORITY_WORDS ( N_PRIORITIES / 64 )
+
 
 typedef struct {
   oxm_matches *match; // match data. host byte order
   uint16_t priority;
   void *data;
+  uint32_t serial; // insertion order. the older entry wins among the same priority entries
+  struct match_tuple *tuple; // NULL if the entry cannot be indexed
 } match_entry;
 
 
 typedef struct {
+  uint16_t length;
+  uint8_t value[ MATCH_KEY_LENGTH ];
+} match_key;
+
+
+typedef struct {
+  match_key *key;
+  list_element *entries; // sorted by priority and serial
+} match_bucket;
+
+
+/*
+ * A tuple holds all entries that specify the same set of fields with
+ * the same masks. Entries are hashed by their masked values, so that
+ * a lookup costs one hash probe per tuple. Exact match entries simply
+ * form tuples whose masks are all ones.
+ */
+typedef struct match_tuple {
+  uint64_t fields; // bitmask of oxm fields
+  uint8_t widths[ MATCH_NUM ];
+  uint16_t key_length;
+  uint8_t mask[ MATCH_KEY_LENGTH ];
+  uint16_t max_priority;
+  unsigned int n_entries;
+  hash_table *buckets;
+} match_tuple;
+
+
+struct match_table {
   list_element *wildcards_table;
   pthread_mutex_t *mutex;
-} match_table;
+  list_element **priority_tails; // last element of each priority in wildcards_table
+  uint64_t *priorities; // bitmap of priorities in wildcards_table
+  list_element *tuples; // sorted by max_priority
+  list_element *unindexed_entries; // sorted by priority
+  uint32_t serial;
+};
 
 
 typedef struct {
@@ -54,6 +99,7 @@ typedef struct {
 
 
 match_table *_match_table_head = NULL; // non-static variable for use in unit testing
+static match_table *default_match_table = NULL;
 
 
 static match_entry *
@@ -62,6 +108,8 @@ allocate_match_entry( oxm_matches *match, uint16_t priority, void *data ) {
   new_entry->match = duplicate_oxm_matches( match );
   new_entry->priority = priority;
   new_entry->data = data;
+  new_entry->serial = 0;
+  new_entry->tuple = NULL;
 
   return new_entry;
 }
@@ -84,79 +132,456 @@ compare_filter_match( oxm_matches *x, oxm_matches *y ) {
 }
 
 
-static void
-init_wildcards_match_table( list_element **wildcards_table ) {
-  assert( wildcards_table != NULL);
+static bool
+compare_match_key( const void *x, const void *y ) {
+  const match_key *key_x = x;
+  const match_key *key_y = y;
 
-  create_list( wildcards_table );
+  if ( key_x->length != key_y->length ) {
+    return false;
+  }
+  return memcmp( key_x->value, key_y->value, key_x->length ) == 0 ? true : false;
 }
 
 
-static void
-finalize_wildcards_match_table( list_element *wildcards_table ) {
-  list_element *element;
-  for ( element = wildcards_table; element != NULL; element = element->next ) {
-    free_match_entry( element->data );
-    element->data = NULL;
+static unsigned int
+hash_match_key( const void *key ) {
+  const match_key *match_key = key;
+
+  return hash_core( match_key->value, match_key->length );
+}
+
+
+static uint64_t
+get_oxm_fields( oxm_matches *match, oxm_match_header **oxms, bool *masked ) {
+  assert( match != NULL );
+  assert( oxms != NULL );
+
+  uint64_t fields = 0;
+  if ( masked != NULL ) {
+    *masked = false;
   }
-  delete_list( wildcards_table );
+  for ( list_element *element = match->list; element != NULL; element = element->next ) {
+    oxm_match_header *header = element->data;
+    if ( OXM_CLASS( *header ) != OFPXMC_OPENFLOW_BASIC ) {
+      continue;
+    }
+    uint32_t type = ( uint32_t ) OXM_FIELD( *header );
+    if ( type >= MATCH_NUM ) {
+      continue;
+    }
+    fields |= ( ( uint64_t ) 1 ) << type;
+    oxms[ type ] = header;
+    if ( masked != NULL && OXM_HASMASK( *header ) ) {
+      *masked = true;
+    }
+  }
+
+  return fields;
+}
+
+
+static uint8_t
+get_oxm_field_width( oxm_match_header *header ) {
+  uint8_t width = ( uint8_t ) OXM_LENGTH( *header );
+  if ( OXM_HASMASK( *header ) ) {
+    width = ( uint8_t ) ( width / 2 );
+  }
+
+  return width;
 }
 
 
 static bool
-insert_wildcards_match_entry( list_element **wildcards_table, oxm_matches *match, uint16_t priority, void *data ) {
+has_higher_precedence( match_entry *x, match_entry *y ) {
+  if ( x->priority != y->priority ) {
+    return x->priority > y->priority;
+  }
+
+  return x->serial < y->serial;
+}
+
+
+static bool
+set_match_tuple_signature( match_tuple *tuple, oxm_matches *match ) {
+  assert( tuple != NULL );
   assert( match != NULL );
 
+  oxm_match_header *oxms[ MATCH_NUM ] = {};
+
+  memset( tuple, 0, sizeof( match_tuple ) );
+  tuple->fields = get_oxm_fields( match, oxms, NULL );
+  for ( int i = 0; i < MATCH_NUM; i++ ) {
+    if ( oxms[ i ] == NULL ) {
+      continue;
+    }
+    uint8_t width = get_oxm_field_width( oxms[ i ] );
+    if ( width == 0 || width > MAX_OXM_FIELD_LENGTH ) {
+      return false;
+    }
+    tuple->widths[ i ] = width;
+    uint8_t *mask = tuple->mask + tuple->key_length;
+    if ( OXM_HASMASK( *oxms[ i ] ) ) {
+      memcpy( mask, ( uint8_t * ) oxms[ i ] + sizeof( oxm_match_header ) + width, width );
+    }
+    else {
+      memset( mask, 0xff, width );
+    }
+    tuple->key_length = ( uint16_t ) ( tuple->key_length + width );
+  }
+
+  return true;
+}
+
+
+static bool
+compare_match_tuple_signature( match_tuple *x, match_tuple *y ) {
+  if ( x->fields != y->fields || x->key_length != y->key_length ) {
+    return false;
+  }
+  if ( memcmp( x->widths, y->widths, sizeof( x->widths ) ) != 0 ) {
+    return false;
+  }
+
+  return memcmp( x->mask, y->mask, x->key_length ) == 0 ? true : false;
+}
+
+
+static bool
+set_match_key( match_key *key, match_tuple *tuple, oxm_match_header **oxms ) {
+  assert( key != NULL );
+  assert( tuple != NULL );
+  assert( oxms != NULL );
+
+  key->length = 0;
+  for ( int i = 0; i < MATCH_NUM; i++ ) {
+    if ( ( tuple->fields & ( ( ( uint64_t ) 1 ) << i ) ) == 0 ) {
+      continue;
+    }
+    uint8_t width = tuple->widths[ i ];
+    if ( oxms[ i ] == NULL || get_oxm_field_width( oxms[ i ] ) != width ) {
+      return false;
+    }
+    const uint8_t *value = ( const uint8_t * ) oxms[ i ] + sizeof( oxm_match_header );
+    const uint8_t *mask = tuple->mask + key->length;
+    for ( int j = 0; j < width; j++ ) {
+      key->value[ key->length + j ] = value[ j ] & mask[ j ];
+    }
+    key->length = ( uint16_t ) ( key->length + width );
+  }
+
+  return true;
+}
+
+
+static void
+sort_match_tuple( list_element **tuples, match_tuple *tuple ) {
+  delete_element( tuples, tuple );
+
   list_element *element;
-  for ( element = *wildcards_table; element != NULL; element = element->next ) {
-    match_entry *entry = element->data;
-    if ( entry->priority < priority ) {
+  for ( element = *tuples; element != NULL; element = element->next ) {
+    match_tuple *sibling = element->data;
+    if ( sibling->max_priority < tuple->max_priority ) {
       break;
     }
-    assert( entry != NULL );
-    if ( entry->priority == priority && compare_oxm_match_strict( entry->match, match ) ) {
-      char match_string[ MATCH_STRING_LENGTH ];
-      match_to_string( match, match_string, sizeof( match_string ) );
-      warn( "wildcards match entry already exists ( match = [%s], priority = %u )",
-            match_string, priority );
-      return false;
+  }
+  if ( element == NULL ) {
+    append_to_tail( tuples, tuple );
+  }
+  else if ( element == *tuples ) {
+    insert_in_front( tuples, tuple );
+  }
+  else {
+    insert_before( tuples, element->data, tuple );
+  }
+}
+
+
+static void
+update_match_tuple_max_priority( match_tuple *tuple ) {
+  tuple->max_priority = 0;
+
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( tuple->buckets, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    match_bucket *bucket = e->value;
+    match_entry *head = bucket->entries->data;
+    if ( head->priority > tuple->max_priority ) {
+      tuple->max_priority = head->priority;
+    }
+  }
+}
+
+
+static void
+insert_entry_into_sorted_list( list_element **list, match_entry *new_entry ) {
+  list_element *element;
+  for ( element = *list; element != NULL; element = element->next ) {
+    if ( has_higher_precedence( new_entry, element->data ) ) {
+      break;
     }
   }
-  match_entry *new_entry = allocate_match_entry( match, priority, data );
   if ( element == NULL ) {
-    // tail
-    append_to_tail( wildcards_table, new_entry );
+    append_to_tail( list, new_entry );
   }
-  else if ( element == *wildcards_table ) {
-    // head
-    insert_in_front( wildcards_table, new_entry );
+  else if ( element == *list ) {
+    insert_in_front( list, new_entry );
   }
   else {
-    // insert before
-    insert_before( wildcards_table, element->data, new_entry );
+    insert_before( list, element->data, new_entry );
+  }
+}
+
+
+static void
+insert_match_index( match_table *table, match_entry *entry ) {
+  assert( table != NULL );
+  assert( entry != NULL );
+
+  match_tuple signature;
+  if ( !set_match_tuple_signature( &signature, entry->match ) ) {
+    entry->tuple = NULL;
+    insert_entry_into_sorted_list( &table->unindexed_entries, entry );
+    return;
+  }
+
+  match_tuple *tuple = NULL;
+  for ( list_element *element = table->tuples; element != NULL; element = element->next ) {
+    if ( compare_match_tuple_signature( element->data, &signature ) ) {
+      tuple = element->data;
+      break;
+    }
+  }
+  if ( tuple == NULL ) {
+    tuple = xmalloc( sizeof( match_tuple ) );
+    memcpy( tuple, &signature, sizeof( match_tuple ) );
+    tuple->buckets = create_hash( compare_match_key, hash_match_key );
+    append_to_tail( &table->tuples, tuple );
+  }
+
+  oxm_match_header *oxms[ MATCH_NUM ] = {};
+  get_oxm_fields( entry->match, oxms, NULL );
+  match_key key;
+  bool ret = set_match_key( &key, tuple, oxms );
+  assert( ret == true );
+  UNUSED( ret );
+
+  match_bucket *bucket = lookup_hash_entry( tuple->buckets, &key );
+  if ( bucket == NULL ) {
+    bucket = xmalloc( sizeof( match_bucket ) );
+    size_t key_size = offsetof( match_key, value ) + key.length;
+    bucket->key = xmalloc( key_size );
+    memcpy( bucket->key, &key, key_size );
+    create_list( &bucket->entries );
+    insert_hash_entry( tuple->buckets, bucket->key, bucket );
+  }
+  insert_entry_into_sorted_list( &bucket->entries, entry );
+  entry->tuple = tuple;
+  tuple->n_entries++;
+
+  if ( tuple->n_entries == 1 || entry->priority > tuple->max_priority ) {
+    tuple->max_priority = entry->priority;
+    sort_match_tuple( &table->tuples, tuple );
+  }
+}
+
+
+static void
+free_match_bucket( match_bucket *bucket ) {
+  delete_list( bucket->entries );
+  xfree( bucket->key );
+  xfree( bucket );
+}
+
+
+static void
+free_match_tuple( match_tuple *tuple ) {
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( tuple->buckets, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    free_match_bucket( e->value );
+  }
+  delete_hash( tuple->buckets );
+  xfree( tuple );
+}
+
+
+static void
+delete_match_index( match_table *table, match_entry *entry ) {
+  assert( table != NULL );
+  assert( entry != NULL );
+
+  match_tuple *tuple = entry->tuple;
+  if ( tuple == NULL ) {
+    delete_element( &table->unindexed_entries, entry );
+    return;
+  }
+
+  oxm_match_header *oxms[ MATCH_NUM ] = {};
+  get_oxm_fields( entry->match, oxms, NULL );
+  match_key key;
+  bool ret = set_match_key( &key, tuple, oxms );
+  assert( ret == true );
+  UNUSED( ret );
+
+  match_bucket *bucket = lookup_hash_entry( tuple->buckets, &key );
+  assert( bucket != NULL );
+  delete_element( &bucket->entries, entry );
+  if ( bucket->entries == NULL ) {
+    delete_hash_entry( tuple->buckets, &key );
+    free_match_bucket( bucket );
+  }
+  entry->tuple = NULL;
+  tuple->n_entries--;
+
+  if ( tuple->n_entries == 0 ) {
+    delete_element( &table->tuples, tuple );
+    free_match_tuple( tuple );
+  }
+  else if ( entry->priority == tuple->max_priority ) {
+    update_match_tuple_max_priority( tuple );
+    sort_match_tuple( &table->tuples, tuple );
   }
-  return true;
 }
 
 
 static match_entry *
-lookup_wildcards_match_strict_entry( list_element *wildcards_table, oxm_matches *match, uint16_t priority ) {
+lookup_indexed_match_strict_entry( match_table *table, oxm_matches *match, uint16_t priority ) {
+  assert( table != NULL );
   assert( match != NULL );
 
-  list_element *element;
-  for ( element = wildcards_table; element != NULL; element = element->next ) {
-    match_entry *entry = element->data;
-    if ( entry->priority < priority ) {
+  match_tuple signature;
+  if ( !set_match_tuple_signature( &signature, match ) ) {
+    for ( list_element *element = table->unindexed_entries; element != NULL; element = element->next ) {
+      match_entry *entry = element->data;
+      if ( entry->priority < priority ) {
+        break;
+      }
+      if ( entry->priority == priority && compare_oxm_match_strict( entry->match, match ) ) {
+        return entry;
+      }
+    }
+    return NULL;
+  }
+
+  match_tuple *tuple = NULL;
+  for ( list_element *element = table->tuples; element != NULL; element = element->next ) {
+    if ( compare_match_tuple_signature( element->data, &signature ) ) {
+      tuple = element->data;
       break;
     }
-    if ( entry->priority == priority && compare_oxm_match_strict( entry->match, match ) ) {
+  }
+  if ( tuple == NULL ) {
+    return NULL;
+  }
+
+  oxm_match_header *oxms[ MATCH_NUM ] = {};
+  get_oxm_fields( match, oxms, NULL );
+  match_key key;
+  if ( !set_match_key( &key, tuple, oxms ) ) {
+    return NULL;
+  }
+  match_bucket *bucket = lookup_hash_entry( tuple->buckets, &key );
+  if ( bucket == NULL ) {
+    return NULL;
+  }
+  for ( list_element *element = bucket->entries; element != NULL; element = element->next ) {
+    match_entry *entry = element->data;
+    if ( entry->priority == priority ) {
       return entry;
     }
   }
+
   return NULL;
 }
 
 
+static void
+finalize_match_index( match_table *table ) {
+  for ( list_element *element = table->tuples; element != NULL; element = element->next ) {
+    free_match_tuple( element->data );
+    element->data = NULL;
+  }
+  delete_list( table->tuples );
+  table->tuples = NULL;
+  delete_list( table->unindexed_entries );
+  table->unindexed_entries = NULL;
+}
+
+
+static void
+init_wildcards_match_table( list_element **wildcards_table ) {
+  assert( wildcards_table != NULL);
+
+  create_list( wildcards_table );
+}
+
+
+static void
+finalize_wildcards_match_table( list_element *wildcards_table ) {
+  list_element *element;
+  for ( element = wildcards_table; element != NULL; element = element->next ) {
+    free_match_entry( element->data );
+    element->data = NULL;
+  }
+  delete_list( wildcards_table );
+}
+
+
+static list_element *
+find_priority_tail( match_table *table, uint16_t priority ) {
+  // returns the last element of the lowest priority which is not lower than the given one
+  unsigned int word = priority / 64;
+  uint64_t bits = table->priorities[ word ] & ( ~( ( uint64_t ) 0 ) << ( priority % 64 ) );
+  while ( bits == 0 ) {
+    if ( ++word >= N_PRIORITY_WORDS ) {
+      return NULL;
+    }
+    bits = table->priorities[ word ];
+  }
+
+  return table->priority_tails[ word * 64 + ( unsigned int ) __builtin_ctzll( bits ) ];
+}
+
+
+static match_entry *
+insert_wildcards_match_entry( match_table *table, oxm_matches *match, uint16_t priority, void *data ) {
+  assert( table != NULL );
+  assert( match != NULL );
+
+  if ( lookup_indexed_match_strict_entry( table, match, priority ) != NULL ) {
+    char match_string[ MATCH_STRING_LENGTH ];
+    match_to_string( match, match_string, sizeof( match_string ) );
+    warn( "wildcards match entry already exists ( match = [%s], priority = %u )",
+          match_string, priority );
+    return NULL;
+  }
+  match_entry *new_entry = allocate_match_entry( match, priority, data );
+  new_entry->serial = table->serial++;
+
+  // insert after the entries that have the same or higher priority
+  list_element *new_element = xmalloc( sizeof( list_element ) );
+  new_element->data = new_entry;
+  list_element *prev = find_priority_tail( table, priority );
+  if ( prev == NULL ) {
+    new_element->next = table->wildcards_table;
+    table->wildcards_table = new_element;
+  }
+  else {
+    new_element->next = prev->next;
+    prev->next = new_element;
+  }
+  table->priority_tails[ priority ] = new_element;
+  table->priorities[ priority / 64 ] |= ( ( uint64_t ) 1 ) << ( priority % 64 );
+
+  insert_match_index( table, new_entry );
+
+  return new_entry;
+}
+
+
 static match_entry *
 lookup_wildcards_match_entry( list_element *wildcards_table, oxm_matches *match ) {
   assert( match != NULL );
@@ -173,10 +598,11 @@ lookup_wildcards_match_entry( list_element *wildcards_table, oxm_matches *match
 
 
 static bool
-update_wildcards_match_entry( list_element *wildcards_table, oxm_matches *match, uint16_t priority, void *data ) {
+update_wildcards_match_entry( match_table *table, oxm_matches *match, uint16_t priority, void *data ) {
+  assert( table != NULL );
   assert( match != NULL );
 
-  match_entry *entry = lookup_wildcards_match_strict_entry( wildcards_table, match, priority );
+  match_entry *entry = lookup_indexed_match_strict_entry( table, match, priority );
   if ( entry == NULL ) {
     char match_string[ MATCH_STRING_LENGTH ];
     match_to_string( match, match_string, sizeof( match_string ) );
@@ -190,10 +616,11 @@ update_wildcards_match_entry( list_element *wildcards_table, oxm_matches *match,
 
 
 static void *
-delete_wildcards_match_strict_entry( list_element **wildcards_table, oxm_matches *match, uint16_t priority ) {
+delete_wildcards_match_strict_entry( match_table *table, oxm_matches *match, uint16_t priority ) {
+  assert( table != NULL );
   assert( match != NULL );
 
-  match_entry *entry = lookup_wildcards_match_strict_entry( *wildcards_table, match, priority );
+  match_entry *entry = lookup_indexed_match_strict_entry( table, match, priority );
   if ( entry == NULL ) {
     char match_string[ MATCH_STRING_LENGTH ];
     match_to_string( match, match_string, sizeof( match_string ) );
@@ -201,8 +628,33 @@ delete_wildcards_match_strict_entry( list_element **wildcards_table, oxm_matches
           match_string, priority );
     return NULL;
   }
+  delete_match_index( table, entry );
+
+  list_element *prev = NULL;
+  list_element *element = table->wildcards_table;
+  while ( element != NULL && element->data != entry ) {
+    prev = element;
+    element = element->next;
+  }
+  assert( element != NULL );
+  if ( prev == NULL ) {
+    table->wildcards_table = element->next;
+  }
+  else {
+    prev->next = element->next;
+  }
+  if ( table->priority_tails[ priority ] == element ) {
+    if ( prev != NULL && ( ( match_entry * ) prev->data )->priority == priority ) {
+      table->priority_tails[ priority ] = prev;
+    }
+    else {
+      table->priority_tails[ priority ] = NULL;
+      table->priorities[ priority / 64 ] &= ~( ( ( uint64_t ) 1 ) << ( priority % 64 ) );
+    }
+  }
+  xfree( element );
+
   void *data = entry->data;
-  delete_element( wildcards_table, entry );
   free_match_entry( entry );
   return data;
 }
@@ -226,21 +678,97 @@ map_wildcards_match_table( list_element *wildcards_table, oxm_matches *match, vo
 }
 
 
-void
-init_match_table( void ) {
-  if ( _match_table_head != NULL ) {
-    die( "match table is already initialized." );
+static match_entry *
+lookup_indexed_match_entry( match_table *table, oxm_matches *match ) {
+  assert( table != NULL );
+  assert( match != NULL );
+
+  oxm_match_header *oxms[ MATCH_NUM ] = {};
+  bool masked = false;
+  uint64_t fields = get_oxm_fields( match, oxms, &masked );
+  if ( masked ) {
+    // masked fields cannot be hashed. fall back to linear search.
+    return lookup_wildcards_match_entry( table->wildcards_table, match );
+  }
+
+  match_entry *found = NULL;
+  for ( list_element *element = table->unindexed_entries; element != NULL; element = element->next ) {
+    match_entry *entry = element->data;
+    if ( compare_oxm_match( entry->match, match ) ) {
+      found = entry;
+      break;
+    }
   }
 
+  match_key key;
+  for ( list_element *element = table->tuples; element != NULL; element = element->next ) {
+    match_tuple *tuple = element->data;
+    if ( found != NULL && tuple->max_priority < found->priority ) {
+      break;
+    }
+    if ( ( tuple->fields & fields ) != tuple->fields ) {
+      continue;
+    }
+    if ( !set_match_key( &key, tuple, oxms ) ) {
+      continue;
+    }
+    match_bucket *bucket = lookup_hash_entry( tuple->buckets, &key );
+    if ( bucket == NULL ) {
+      continue;
+    }
+    match_entry *entry = bucket->entries->data;
+    if ( found == NULL || has_higher_precedence( entry, found ) ) {
+      found = entry;
+    }
+  }
+
+  return found;
+}
+
+
+static match_table *
+allocate_match_table( void ) {
   match_table *table = xmalloc( sizeof( match_table ) );
   init_wildcards_match_table( &table->wildcards_table );
+  table->priority_tails = xcalloc( N_PRIORITIES, sizeof( list_element * ) );
+  table->priorities = xcalloc( N_PRIORITY_WORDS, sizeof( uint64_t ) );
+  create_list( &table->tuples );
+  create_list( &table->unindexed_entries );
+  table->serial = 0;
   pthread_mutexattr_t attr;
   pthread_mutexattr_init( &attr );
   pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE_NP );
   table->mutex = xmalloc( sizeof( pthread_mutex_t ) );
   pthread_mutex_init( table->mutex, &attr );
 
-  _match_table_head = table;
+  return table;
+}
+
+
+static void
+free_match_table( match_table *table ) {
+  pthread_mutex_t *mutex = table->mutex;
+
+  pthread_mutex_lock( mutex );
+  finalize_match_index( table );
+  finalize_wildcards_match_table( table->wildcards_table );
+  xfree( table->priority_tails );
+  xfree( table->priorities );
+  xfree( table );
+  pthread_mutex_unlock( mutex );
+  pthread_mutex_destroy( mutex );
+  xfree( mutex );
+}
+
+
+void
+init_match_table( void ) {
+  if ( _match_table_head != NULL ) {
+    die( "match table is already initialized." );
+  }
+
+  default_match_table = allocate_match_table();
+  _match_table_head = default_match_table;
 }
 
 
@@ -250,15 +778,47 @@ finalize_match_table( void ) {
     die( "match table is not initialized." );
   }
 
-  pthread_mutex_t *mutex = _match_table_head->mutex;
-
-  pthread_mutex_lock( mutex );
-  finalize_wildcards_match_table( _match_table_head->wildcards_table );
-  xfree( _match_table_head );
+  free_match_table( default_match_table );
+  default_match_table = NULL;
   _match_table_head = NULL;
-  pthread_mutex_unlock( mutex );
-  pthread_mutex_destroy( mutex );
-  xfree( mutex );
+}
+
+
+/*
+ * Creates another table, e.g. for each of the switches that a process
+ * handles. The functions below operate on the table selected with
+ * select_match_table(), or on the one created by init_match_table().
+ */
+match_table *
+create_match_table( void ) {
+  if ( default_match_table == NULL ) {
+    die( "match table is not initialized." );
+  }
+
+  return allocate_match_table();
+}
+
+
+void
+delete_match_table( match_table *table ) {
+  if ( table == NULL || table == default_match_table ) {
+    die( "table must be created by create_match_table()." );
+  }
+
+  if ( _match_table_head == table ) {
+    _match_table_head = default_match_table;
+  }
+  free_match_table( table );
+}
+
+
+void
+select_match_table( match_table *table ) {
+  if ( default_match_table == NULL ) {
+    die( "match table is not initialized." );
+  }
+
+  _match_table_head = table != NULL ? table : default_match_table;
 }
 
 
@@ -269,9 +829,9 @@ insert_match_entry( oxm_matches *match, uint16_t priority, void *data ) {
   }
 
   pthread_mutex_lock( _match_table_head->mutex );
-  bool result = insert_wildcards_match_entry( &_match_table_head->wildcards_table, match, priority, data );
+  match_entry *entry = insert_wildcards_match_entry( _match_table_head, match, priority, data );
   pthread_mutex_unlock( _match_table_head->mutex );
-  return result;
+  return entry != NULL ? true : false;
 }
 
 
@@ -282,7 +842,7 @@ lookup_match_strict_entry( oxm_matches *match, uint16_t priority ) {
   }
 
   pthread_mutex_lock( _match_table_head->mutex );
-  match_entry *entry = lookup_wildcards_match_strict_entry( _match_table_head->wildcards_table, match, priority );
+  match_entry *entry = lookup_indexed_match_strict_entry( _match_table_head, match, priority );
   void *data = ( entry != NULL ? entry->data : NULL );
   pthread_mutex_unlock( _match_table_head->mutex );
   return data;
@@ -296,7 +856,7 @@ lookup_match_entry( oxm_matches *match ) {
   }
 
   pthread_mutex_lock( _match_table_head->mutex );
-  match_entry *entry = lookup_wildcards_match_entry( _match_table_head->wildcards_table, match );
+  match_entry *entry = lookup_indexed_match_entry( _match_table_head, match );
   void *data = ( entry != NULL ? entry->data : NULL );
   pthread_mutex_unlock( _match_table_head->mutex );
   return data;
@@ -310,7 +870,7 @@ update_match_entry( oxm_matches *match, uint16_t priority, void *data ) {
   }
 
   pthread_mutex_lock( _match_table_head->mutex );
-  bool result = update_wildcards_match_entry( _match_table_head->wildcards_table, match, priority, data );
+  bool result = update_wildcards_match_entry( _match_table_head, match, priority, data );
   pthread_mutex_unlock( _match_table_head->mutex );
   return result;
 }
@@ -324,7 +884,7 @@ delete_match_strict_entry( oxm_matches *match, uint16_t priority ) {
 
   pthread_mutex_lock( _match_table_head->mutex );
   void *data = NULL;
-  data = delete_wildcards_match_strict_entry( &_match_table_head->wildcards_table, match, priority );
+  data = delete_wildcards_match_strict_entry( _match_table_head, match, priority );
   pthread_mutex_unlock( _match_table_head->mutex );
   return data;
 }
@@ -29,8 +29,14 @@
 #include "oxm_match.h"
 
 
+typedef struct match_table match_table;
+
+
 void init_match_table( void );
 void finalize_match_table( void );
+match_table *create_match_table( void );
+void delete_match_table( match_table *table );
+void select_match_table( match_table *table );
 bool insert_match_entry( oxm_matches *match, uint16_t priority, void *data );
 void *lookup_match_strict_entry( oxm_matches *match, uint16_t priority );
 void *lookup_match_entry( oxm_matches *match );
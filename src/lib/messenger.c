@@ -206,6 +206,7 @@ static hash_table *context_db = NULL;
 static char *_dump_service_name = NULL;
 static char *_dump_app_name = NULL;
 static uint32_t last_transaction_id = 0;
+static const char *requested_service_name = NULL;
 
 static void on_accept( int fd, void *data );
 static void on_recv( int fd, void *data );
@@ -1441,7 +1442,10 @@ call_message_callbacks( receive_queue *rq, const uint8_t message_type, const uin
         debug( "Calling a callback ( %p ) for MESSAGE_TYPE_REQUEST (%#x) ( handle = %p, tag = %#x, requested_data = %p, len = %u ).",
                cb->function, message_type, handle, tag, requested_data, len - header_len );
 
+        const char *outer_service_name = requested_service_name;
+        requested_service_name = rq->service_name;
         requested_callback( handle, tag, ( void * ) requested_data, len - header_len );
+        requested_service_name = outer_service_name;
       }
       break;
     case MESSAGE_TYPE_REPLY:
@@ -1737,6 +1741,17 @@ stop_messenger_dump( void ) {
 }
 
 
+/*
+ * Returns the service name that the request being handled was sent to, so
+ * that a callback added for several service names can tell them apart.
+ * NULL outside of message requested callbacks.
+ */
+const char *
+get_requested_service_name( void ) {
+  return requested_service_name;
+}
+
+
 bool
 messenger_dump_enabled( void ) {
   if ( _dump_service_name != NULL && _dump_app_name != NULL ) {
@@ -134,6 +134,8 @@ void start_messenger_dump( const char *dump_app_name, const char *dump_service_n
 void stop_messenger_dump( void );
 bool messenger_dump_enabled( void );
 
+const char *get_requested_service_name( void );
+
 
 #endif // MESSENGER_H
 
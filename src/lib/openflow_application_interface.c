@@ -101,12 +101,6 @@ bool mock_clear_send_queue( const char *service_name );
 #define getpid mock_getpid
 pid_t mock_getpid( void );
 
-#ifdef parse_packet
-#undef parse_packet
-#endif
-#define parse_packet mock_parse_packet
-bool mock_parse_packet( buffer *buf );
-
 #ifdef die
 #undef die
 #endif
@@ -151,6 +145,21 @@ static openflow_event_handlers_t event_handlers;
 static char service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
 
 
+/*
+ * Per-switch routing state for send_openflow_message(). The remote service
+ * name and the openflow_service_header_t (followed by our service name) are
+ * built once per datapath and copied in front of each outgoing message.
+ */
+typedef struct {
+  uint64_t datapath_id;
+  char remote_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+  uint16_t header_length;
+  char header[ sizeof( openflow_service_header_t ) + MESSENGER_SERVICE_NAME_LENGTH ];
+} switch_route;
+
+static hash_table *switch_routes = NULL;
+
+
 static void handle_message( uint16_t message_type, void *data, size_t length );
 static void handle_list_switches_reply( uint16_t message_type, void *dpid, size_t length, void *user_data );
 
@@ -161,6 +170,132 @@ enum {
 };
 
 
+/*
+ * Statistics keys indexed by message type, direction and result, e.g.
+ * "openflow_application_interface.hello_send_succeeded".
+ */
+#define STATS_KEY_PREFIX "openflow_application_interface."
+#define STATS_KEYS( name )                                                                \
+  { { STATS_KEY_PREFIX name "_send_failed", STATS_KEY_PREFIX name "_send_succeeded" },      \
+    { STATS_KEY_PREFIX name "_receive_failed", STATS_KEY_PREFIX name "_receive_succeeded" } }
+
+static const char *switch_event_stats_keys[][ 2 ][ 2 ] = {
+  [ MESSENGER_OPENFLOW_CONNECTED ] = STATS_KEYS( "switch_connected" ),
+  [ MESSENGER_OPENFLOW_READY ] = STATS_KEYS( "switch_ready" ),
+  [ MESSENGER_OPENFLOW_DISCONNECTED ] = STATS_KEYS( "switch_disconnected" ),
+  [ MESSENGER_OPENFLOW_FAILD_TO_CONNECT ] = STATS_KEYS( "switch_failed_to_connect" ),
+};
+static const char *undefined_switch_event_stats_keys[ 2 ][ 2 ] = STATS_KEYS( "undefined_switch_event" );
+
+static const char *openflow_stats_keys[][ 2 ][ 2 ] = {
+  [ OFPT_HELLO ] = STATS_KEYS( "hello" ),
+  [ OFPT_ERROR ] = STATS_KEYS( "error" ),
+  [ OFPT_ECHO_REQUEST ] = STATS_KEYS( "echo_request" ),
+  [ OFPT_ECHO_REPLY ] = STATS_KEYS( "echo_reply" ),
+  [ OFPT_EXPERIMENTER ] = STATS_KEYS( "experimenter" ),
+  [ OFPT_FEATURES_REQUEST ] = STATS_KEYS( "features_request" ),
+  [ OFPT_FEATURES_REPLY ] = STATS_KEYS( "features_reply" ),
+  [ OFPT_GET_CONFIG_REQUEST ] = STATS_KEYS( "get_config_request" ),
+  [ OFPT_GET_CONFIG_REPLY ] = STATS_KEYS( "get_config_reply" ),
+  [ OFPT_SET_CONFIG ] = STATS_KEYS( "set_config" ),
+  [ OFPT_PACKET_IN ] = STATS_KEYS( "packet_in" ),
+  [ OFPT_FLOW_REMOVED ] = STATS_KEYS( "flow_removed" ),
+  [ OFPT_PORT_STATUS ] = STATS_KEYS( "port_status" ),
+  [ OFPT_PACKET_OUT ] = STATS_KEYS( "packet_out" ),
+  [ OFPT_FLOW_MOD ] = STATS_KEYS( "flow_mod" ),
+  [ OFPT_GROUP_MOD ] = STATS_KEYS( "group_mod" ),
+  [ OFPT_PORT_MOD ] = STATS_KEYS( "port_mod" ),
+  [ OFPT_TABLE_MOD ] = STATS_KEYS( "table_mod" ),
+  [ OFPT_MULTIPART_REQUEST ] = STATS_KEYS( "multipart_request" ),
+  [ OFPT_MULTIPART_REPLY ] = STATS_KEYS( "multipart_reply" ),
+  [ OFPT_BARRIER_REQUEST ] = STATS_KEYS( "barrier_request" ),
+  [ OFPT_BARRIER_REPLY ] = STATS_KEYS( "barrier_reply" ),
+  [ OFPT_QUEUE_GET_CONFIG_REQUEST ] = STATS_KEYS( "queue_get_config_request" ),
+  [ OFPT_QUEUE_GET_CONFIG_REPLY ] = STATS_KEYS( "queue_get_config_reply" ),
+  [ OFPT_ROLE_REQUEST ] = STATS_KEYS( "role_request" ),
+  [ OFPT_ROLE_REPLY ] = STATS_KEYS( "role_reply" ),
+  [ OFPT_GET_ASYNC_REQUEST ] = STATS_KEYS( "get_async_request" ),
+  [ OFPT_GET_ASYNC_REPLY ] = STATS_KEYS( "get_async_reply" ),
+  [ OFPT_SET_ASYNC ] = STATS_KEYS( "set_async" ),
+  [ OFPT_METER_MOD ] = STATS_KEYS( "meter_mod" ),
+};
+static const char *undefined_openflow_stats_keys[ 2 ][ 2 ] = STATS_KEYS( "undefined_message_type" );
+
+
+static void
+build_switch_route( switch_route *route, uint64_t datapath_id ) {
+  memset( route, 0, sizeof( switch_route ) );
+  route->datapath_id = datapath_id;
+  snprintf( route->remote_service_name, sizeof( route->remote_service_name ),
+            "switch_daemon.%#" PRIx64, datapath_id );
+
+  size_t service_name_length = strlen( service_name ) + 1;
+  route->header_length = ( uint16_t ) ( sizeof( openflow_service_header_t ) + service_name_length );
+  openflow_service_header_t *header = ( openflow_service_header_t * ) route->header;
+  header->datapath_id = htonll( datapath_id );
+  header->service_name_length = htons( ( uint16_t ) service_name_length );
+  memcpy( route->header + sizeof( openflow_service_header_t ), service_name, service_name_length );
+}
+
+
+// Routes are cached only for switches that are known to be connected, so
+// that sending to arbitrary datapath ids does not grow the table.
+static void
+add_switch_route( uint64_t datapath_id ) {
+  if ( switch_routes == NULL ) {
+    switch_routes = create_hash( compare_datapath_id, hash_datapath_id );
+  }
+
+  if ( lookup_hash_entry( switch_routes, &datapath_id ) != NULL ) {
+    return;
+  }
+
+  switch_route *route = xmalloc( sizeof( switch_route ) );
+  build_switch_route( route, datapath_id );
+  insert_hash_entry( switch_routes, &route->datapath_id, route );
+}
+
+
+static switch_route *
+lookup_switch_route( uint64_t datapath_id ) {
+  if ( switch_routes == NULL ) {
+    return NULL;
+  }
+
+  return lookup_hash_entry( switch_routes, &datapath_id );
+}
+
+
+static void
+delete_switch_route( uint64_t datapath_id ) {
+  if ( switch_routes == NULL ) {
+    return;
+  }
+
+  switch_route *route = delete_hash_entry( switch_routes, &datapath_id );
+  if ( route != NULL ) {
+    xfree( route );
+  }
+}
+
+
+static void
+delete_switch_routes() {
+  if ( switch_routes == NULL ) {
+    return;
+  }
+
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( switch_routes, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    xfree( e->value );
+  }
+  delete_hash( switch_routes );
+  switch_routes = NULL;
+}
+
+
 bool
 openflow_application_interface_is_initialized() {
   return openflow_application_interface_initialized;
@@ -219,6 +354,8 @@ finalize_openflow_application_interface() {
   delete_message_received_callback( service_name, handle_message );
   delete_message_replied_callback( service_name, handle_list_switches_reply );
 
+  delete_switch_routes();
+
   memset( &event_handlers, 0, sizeof( openflow_event_handlers_t ) );
   memset( service_name, '\0', sizeof( service_name ) );
 
@@ -893,41 +1030,37 @@ handle_packet_in( const uint64_t datapath_id, buffer *data ) {
 
   uint16_t body_length = ( uint16_t ) ( ntohs( _packet_in->header.length ) - offsetof( struct ofp_packet_in, match ) - pad_len - match_len );
 
-  char match_string[ MATCH_STRING_LENGTH ];
-  match_to_string( match, match_string, sizeof( match_string ) );
+  if ( get_logging_level() >= LOG_DEBUG ) {
+    char match_string[ MATCH_STRING_LENGTH ];
+    match_to_string( match, match_string, sizeof( match_string ) );
 
-  debug(
-    "A packet_in message is received from %#" PRIx64
-    " (transaction_id = %#x, buffer_id = %#x, total_len = %#x, reason = %#x, table_id = %#x, "
-    "cookie = %#" PRIx64 ", match = [%s], body length = %u).",
-    datapath_id,
-    transaction_id,
-    buffer_id,
-    total_len,
-    reason,
-    table_id,
-    cookie,
-    match_string,
-    body_length
-  );
+    debug(
+      "A packet_in message is received from %#" PRIx64
+      " (transaction_id = %#x, buffer_id = %#x, total_len = %#x, reason = %#x, table_id = %#x, "
+      "cookie = %#" PRIx64 ", match = [%s], body length = %u).",
+      datapath_id,
+      transaction_id,
+      buffer_id,
+      total_len,
+      reason,
+      table_id,
+      cookie,
+      match_string,
+      body_length
+    );
+  }
 
   if ( event_handlers.packet_in_callback == NULL ) {
     debug( "Callback function for packet_in events is not set." );
     goto END;
   }
 
+  // The frame is handed over in place in the received message, and its
+  // headers are parsed only when the handler reads the packet_info.
   if ( body_length > 0 ) {
-    body = duplicate_buffer( data );
+    body = data;
     remove_front_buffer( body, offsetof( struct ofp_packet_in, match ) + pad_len + match_len );
-    bool parse_ok = parse_packet( body );
-    if ( !parse_ok ) {
-      error( "Failed to parse a packet." );
-      // ???: Is it OK to drop malformed packets?
-      goto END;
-    }
-  }
-  else {
-    body = NULL;
+    defer_parse_packet( body );
   }
 
   assert( event_handlers.packet_in_callback != NULL );
@@ -969,9 +1102,6 @@ END:
   if ( match != NULL ) {
     delete_oxm_matches( match );
   }
-  if ( body != NULL ) {
-    free_buffer( body );
-  }
 }
 
 
@@ -1120,7 +1250,6 @@ handle_multipart_reply( const uint64_t datapath_id, buffer *data ) {
   uint16_t type, flags, body_length;
   uint32_t transaction_id;
   buffer *body = NULL;
-  buffer *body_h = NULL;
   struct ofp_multipart_reply *multipart_reply;
 
   if ( ( data == NULL ) || ( ( data != NULL ) && ( data->length == 0 ) ) ) {
@@ -1146,277 +1275,175 @@ handle_multipart_reply( const uint64_t datapath_id, buffer *data ) {
     return;
   }
 
+  // The body is converted to host byte order record by record on the
+  // received message itself and handed to the callback without a copy.
   if ( body_length > 0 ) {
-    body = duplicate_buffer( data );
-    remove_front_buffer( body, offsetof( struct ofp_multipart_reply, body ) );
-  }
+    body = alloc_buffer_with_data( multipart_reply->body, body_length );
 
-  if ( body != NULL ) {
     switch ( type ) {
     case OFPMP_DESC:
-      {
-        body_h = body;
-        body = NULL;
-      }
       break;
     case OFPMP_FLOW:
       {
-        struct ofp_flow_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_flow_stats * ) body->data;
-        dst = ( struct ofp_flow_stats * ) body_h->data;
+        struct ofp_flow_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_flow_stats( dst, src );
+          ntoh_flow_stats( stats, stats );
 
-          body_length = ( uint16_t ) ( body_length - dst->length );
+          body_length = ( uint16_t ) ( body_length - stats->length );
 
-          src = ( struct ofp_flow_stats * ) ( ( char * ) src + dst->length );
-          dst = ( struct ofp_flow_stats * ) ( ( char * ) dst + dst->length );
+          stats = ( struct ofp_flow_stats * ) ( ( char * ) stats + stats->length );
         }
       }
       break;
     case OFPMP_AGGREGATE:
       {
-        struct ofp_aggregate_stats_reply *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
+        struct ofp_aggregate_stats_reply *stats = body->data;
 
-        src = ( struct ofp_aggregate_stats_reply * ) body->data;
-        dst = ( struct ofp_aggregate_stats_reply * ) body_h->data;
-
-        ntoh_aggregate_stats( dst, src );
+        ntoh_aggregate_stats( stats, stats );
       }
       break;
     case OFPMP_TABLE:
       {
-        struct ofp_table_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_table_stats * ) body->data;
-        dst = ( struct ofp_table_stats * ) body_h->data;
+        struct ofp_table_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_table_stats( dst, src );
+          ntoh_table_stats( stats, stats );
 
           body_length = ( uint16_t ) ( body_length - sizeof( struct ofp_table_stats ) );
 
-          src++;
-          dst++;
+          stats++;
         }
       }
       break;
     case OFPMP_PORT_STATS:
       {
-        struct ofp_port_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_port_stats * ) body->data;
-        dst = ( struct ofp_port_stats * ) body_h->data;
+        struct ofp_port_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_port_stats( dst, src );
+          ntoh_port_stats( stats, stats );
 
           body_length = ( uint16_t ) ( body_length - sizeof( struct ofp_port_stats ) );
 
-          src++;
-          dst++;
+          stats++;
         }
       }
       break;
     case OFPMP_QUEUE:
       {
-        struct ofp_queue_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_queue_stats * ) body->data;
-        dst = ( struct ofp_queue_stats * ) body_h->data;
+        struct ofp_queue_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_queue_stats( dst, src );
+          ntoh_queue_stats( stats, stats );
 
           body_length = ( uint16_t ) ( body_length - sizeof( struct ofp_queue_stats ) );
 
-          src++;
-          dst++;
+          stats++;
         }
       }
       break;
     case OFPMP_GROUP:
       {
-        struct ofp_group_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_group_stats * ) body->data;
-        dst = ( struct ofp_group_stats * ) body_h->data;
+        struct ofp_group_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_group_stats( dst, src );
+          ntoh_group_stats( stats, stats );
 
-          body_length = ( uint16_t ) ( body_length - dst->length );
+          body_length = ( uint16_t ) ( body_length - stats->length );
 
-          src = ( struct ofp_group_stats * ) ( ( char * ) src + dst->length );
-          dst = ( struct ofp_group_stats * ) ( ( char * ) dst + dst->length );
+          stats = ( struct ofp_group_stats * ) ( ( char * ) stats + stats->length );
         }
       }
       break;
     case OFPMP_GROUP_DESC:
       {
-        struct ofp_group_desc_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_group_desc_stats * ) body->data;
-        dst = ( struct ofp_group_desc_stats * ) body_h->data;
+        struct ofp_group_desc_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_group_desc_stats( dst, src );
+          ntoh_group_desc_stats( stats, stats );
 
-          body_length = ( uint16_t ) ( body_length - dst->length );
+          body_length = ( uint16_t ) ( body_length - stats->length );
 
-          src = ( struct ofp_group_desc_stats * ) ( ( char * ) src + dst->length );
-          dst = ( struct ofp_group_desc_stats * ) ( ( char * ) dst + dst->length );
+          stats = ( struct ofp_group_desc_stats * ) ( ( char * ) stats + stats->length );
         }
       }
       break;
     case OFPMP_GROUP_FEATURES:
       {
-        struct ofp_group_features *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_group_features * ) body->data;
-        dst = ( struct ofp_group_features * ) body_h->data;
+        struct ofp_group_features *features = body->data;
 
-        ntoh_group_features_stats( dst, src );
+        ntoh_group_features_stats( features, features );
       }
       break;
     case OFPMP_METER:
       {
-        struct ofp_meter_stats *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_meter_stats * ) body->data;
-        dst = ( struct ofp_meter_stats * ) body_h->data;
+        struct ofp_meter_stats *stats = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_meter_stats( dst, src );
+          ntoh_meter_stats( stats, stats );
 
-          body_length = ( uint16_t ) ( body_length - dst->len );
+          body_length = ( uint16_t ) ( body_length - stats->len );
 
-          src = ( struct ofp_meter_stats * ) ( ( char * ) src + dst->len );
-          dst = ( struct ofp_meter_stats * ) ( ( char * ) dst + dst->len );
+          stats = ( struct ofp_meter_stats * ) ( ( char * ) stats + stats->len );
         }
       }
       break;
     case OFPMP_METER_CONFIG:
       {
-        struct ofp_meter_config *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_meter_config * ) body->data;
-        dst = ( struct ofp_meter_config * ) body_h->data;
+        struct ofp_meter_config *config = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_meter_config( dst, src );
+          ntoh_meter_config( config, config );
 
-          body_length = ( uint16_t ) ( body_length - dst->length );
+          body_length = ( uint16_t ) ( body_length - config->length );
 
-          src = ( struct ofp_meter_config * ) ( ( char * ) src + dst->length );
-          dst = ( struct ofp_meter_config * ) ( ( char * ) dst + dst->length );
+          config = ( struct ofp_meter_config * ) ( ( char * ) config + config->length );
         }
       }
       break;
     case OFPMP_METER_FEATURES:
       {
-        struct ofp_meter_features *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_meter_features * ) body->data;
-        dst = ( struct ofp_meter_features * ) body_h->data;
+        struct ofp_meter_features *features = body->data;
 
-        ntoh_meter_features( dst, src );
+        ntoh_meter_features( features, features );
       }
       break;
     case OFPMP_TABLE_FEATURES:
       {
-        struct ofp_table_features *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_table_features * ) body->data;
-        dst = ( struct ofp_table_features * ) body_h->data;
+        struct ofp_table_features *features = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_table_features( dst, src );
+          ntoh_table_features( features, features );
 
-          body_length = ( uint16_t ) ( body_length - dst->length );
+          body_length = ( uint16_t ) ( body_length - features->length );
 
-          src = ( struct ofp_table_features * ) ( ( char * ) src + dst->length );
-          dst = ( struct ofp_table_features * ) ( ( char * ) dst + dst->length );
+          features = ( struct ofp_table_features * ) ( ( char * ) features + features->length );
         }
       }
       break;
     case OFPMP_PORT_DESC:
       {
-        struct ofp_port *src, *dst;
-
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
-
-        src = ( struct ofp_port * ) body->data;
-        dst = ( struct ofp_port * ) body_h->data;
+        struct ofp_port *port = body->data;
 
         while ( body_length > 0 ) {
-          ntoh_port( dst, src );
+          ntoh_port( port, port );
 
           body_length = ( uint16_t ) ( body_length - sizeof( struct ofp_port ) );
 
-          src++;
-          dst++;
+          port++;
         }
       }
       break;
     case OFPMP_EXPERIMENTER:
       {
-        struct ofp_experimenter_multipart_header *src, *dst;
-        body_h = alloc_buffer_with_length( body_length );
-        append_back_buffer( body_h, body_length );
+        struct ofp_experimenter_multipart_header *experimenter = body->data;
 
-        memcpy( body_h->data, body->data, body_length );
-
-        src = ( struct ofp_experimenter_multipart_header * ) body->data;
-        dst = ( struct ofp_experimenter_multipart_header * ) body_h->data;
-
-        dst->experimenter = ntohl( src->experimenter );
-        dst->exp_type = ntohl( src->exp_type );
+        experimenter->experimenter = ntohl( experimenter->experimenter );
+        experimenter->exp_type = ntohl( experimenter->exp_type );
       }
       break;
     default:
-      if ( body != NULL ) {
-        free_buffer( body );
-      }
+      free_buffer( body );
       critical( "Unhandled stats type ( type = %u ).", type );
       assert( 0 );
       break;
@@ -1430,15 +1457,12 @@ handle_multipart_reply( const uint64_t datapath_id, buffer *data ) {
                                            transaction_id,
                                            type,
                                            flags,
-                                           body_h,
+                                           body,
                                            event_handlers.multipart_reply_user_data );
 
   if ( body != NULL ) {
     free_buffer( body );
   }
-  if ( body_h != NULL ) {
-    free_buffer( body_h );
-  }
 }
 
 
@@ -1627,49 +1651,16 @@ static void handle_get_async_reply( const uint64_t datapath_id, buffer *data ) {
 
 static void
 update_switch_event_stats( uint16_t type, int send_receive, bool result ) {
-  char key[ STAT_KEY_LENGTH ];
-  char suffix[ 16 ];
-  char direction[ 16 ];
-  const char *prefix = "openflow_application_interface.";
-
-  memset( suffix, '\0', sizeof( suffix ) );
-
-  if ( result ) {
-    sprintf( suffix, "_succeeded" );
-  }
-  else {
-    sprintf( suffix, "_failed" );
-  }
-
-  memset( direction, '\0', sizeof( direction ) );
-
-  switch ( send_receive ) {
-  case OPENFLOW_MESSAGE_SEND:
-    sprintf( direction, "_send" );
-    break;
-  case OPENFLOW_MESSAGE_RECEIVE:
-    sprintf( direction, "_receive" );
-    break;
-  default:
+  if ( send_receive != OPENFLOW_MESSAGE_SEND && send_receive != OPENFLOW_MESSAGE_RECEIVE ) {
     return;
   }
 
-  switch ( type ) {
-  case MESSENGER_OPENFLOW_CONNECTED:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_connected", direction, suffix );
-    break;
-  case MESSENGER_OPENFLOW_READY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_ready", direction, suffix );
-    break;
-  case MESSENGER_OPENFLOW_DISCONNECTED:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_disconnected", direction, suffix );
-    break;
-  case MESSENGER_OPENFLOW_FAILD_TO_CONNECT:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_failed_to_connect", direction, suffix );
-    break;
-  default:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "undefined_switch_event", direction, suffix );
-    break;
+  const char *key = NULL;
+  if ( type < sizeof( switch_event_stats_keys ) / sizeof( switch_event_stats_keys[ 0 ] ) ) {
+    key = switch_event_stats_keys[ type ][ send_receive ][ result ];
+  }
+  if ( key == NULL ) {
+    key = undefined_switch_event_stats_keys[ send_receive ][ result ];
   }
 
   increment_stat( key );
@@ -1711,6 +1702,7 @@ handle_messenger_openflow_disconnected( uint64_t datapath_id ) {
     debug( "Callback function for switch disconnected events is not set." );
   }
   delete_openflow_messages( datapath_id );
+  delete_switch_route( datapath_id );
 }
 
 
@@ -1726,10 +1718,13 @@ handle_switch_events( uint16_t type, void *data, size_t length ) {
 
   switch ( type ) {
     case MESSENGER_OPENFLOW_CONNECTED:
+      add_switch_route( datapath_id );
+      break;
     case MESSENGER_OPENFLOW_FAILD_TO_CONNECT:
       // Do nothing.
       break;
     case MESSENGER_OPENFLOW_READY:
+      add_switch_route( datapath_id );
       handle_switch_ready( datapath_id );
       break;
     case MESSENGER_OPENFLOW_DISCONNECTED:
@@ -1746,127 +1741,16 @@ handle_switch_events( uint16_t type, void *data, size_t length ) {
 
 static void
 update_openflow_stats( uint8_t type, int send_receive, bool result ) {
-  char key[ STAT_KEY_LENGTH ];
-  char suffix[ 16 ];
-  char direction[ 16 ];
-  const char *prefix = "openflow_application_interface.";
-
-  memset( suffix, '\0', sizeof( suffix ) );
-
-  if ( result ) {
-    sprintf( suffix, "_succeeded" );
-  }
-  else {
-    sprintf( suffix, "_failed" );
-  }
-
-  memset( direction, '\0', sizeof( direction ) );
-
-  switch ( send_receive ) {
-  case OPENFLOW_MESSAGE_SEND:
-    sprintf( direction, "_send" );
-    break;
-  case OPENFLOW_MESSAGE_RECEIVE:
-    sprintf( direction, "_receive" );
-    break;
-  default:
+  if ( send_receive != OPENFLOW_MESSAGE_SEND && send_receive != OPENFLOW_MESSAGE_RECEIVE ) {
     return;
   }
 
-  switch ( type ) {
-  case OFPT_HELLO:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "hello", direction, suffix );
-    break;
-  case OFPT_ERROR:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "error", direction, suffix );
-    break;
-  case OFPT_ECHO_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "echo_request", direction, suffix );
-    break;
-  case OFPT_ECHO_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "echo_reply", direction, suffix );
-    break;
-  case OFPT_EXPERIMENTER:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "experimenter", direction, suffix );
-    break;
-  case OFPT_FEATURES_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "features_request", direction, suffix );
-    break;
-  case OFPT_FEATURES_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "features_reply", direction, suffix );
-    break;
-  case OFPT_GET_CONFIG_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "get_config_request", direction, suffix );
-    break;
-  case OFPT_GET_CONFIG_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "get_config_reply", direction, suffix );
-    break;
-  case OFPT_SET_CONFIG:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "set_config", direction, suffix );
-    break;
-  case OFPT_PACKET_IN:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "packet_in", direction, suffix );
-    break;
-  case OFPT_FLOW_REMOVED:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "flow_removed", direction, suffix );
-    break;
-  case OFPT_PORT_STATUS:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "port_status", direction, suffix );
-    break;
-  case OFPT_PACKET_OUT:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "packet_out", direction, suffix );
-    break;
-  case OFPT_FLOW_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "flow_mod", direction, suffix );
-    break;
-  case OFPT_GROUP_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "group_mod", direction, suffix );
-    break;
-  case OFPT_PORT_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "port_mod", direction, suffix );
-    break;
-  case OFPT_TABLE_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "table_mod", direction, suffix );
-    break;
-  case OFPT_MULTIPART_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "multipart_request", direction, suffix );
-    break;
-  case OFPT_MULTIPART_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "multipart_reply", direction, suffix );
-    break;
-  case OFPT_BARRIER_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "barrier_request", direction, suffix );
-    break;
-  case OFPT_BARRIER_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "barrier_reply", direction, suffix );
-    break;
-  case OFPT_QUEUE_GET_CONFIG_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "queue_get_config_request", direction, suffix );
-    break;
-  case OFPT_QUEUE_GET_CONFIG_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "queue_get_config_reply", direction, suffix );
-    break;
-  case OFPT_ROLE_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "role_request", direction, suffix );
-    break;
-  case OFPT_ROLE_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "role_reply", direction, suffix );
-    break;
-  case OFPT_GET_ASYNC_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "get_async_request", direction, suffix );
-    break;
-  case OFPT_GET_ASYNC_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "get_async_reply", direction, suffix );
-    break;
-  case OFPT_SET_ASYNC:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "set_async", direction, suffix );
-    break;
-  case OFPT_METER_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "meter_mod", direction, suffix );
-    break;
-  default:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "undefined_message_type", direction, suffix );
-    break;
+  const char *key = NULL;
+  if ( type < sizeof( openflow_stats_keys ) / sizeof( openflow_stats_keys[ 0 ] ) ) {
+    key = openflow_stats_keys[ type ][ send_receive ][ result ];
+  }
+  if ( key == NULL ) {
+    key = undefined_openflow_stats_keys[ send_receive ][ result ];
   }
 
   increment_stat( key );
@@ -1875,7 +1759,6 @@ update_openflow_stats( uint8_t type, int send_receive, bool result ) {
 
 static void
 handle_openflow_message( void *data, size_t length ) {
-  void *p;
   int ret;
   uint64_t datapath_id;
   buffer *buffer;
@@ -1891,12 +1774,12 @@ handle_openflow_message( void *data, size_t length ) {
 
   datapath_id = ntohll( message->datapath_id );
 
-  buffer = alloc_buffer_with_length( length );
+  // Handlers work on the messenger's receive buffer, which stays valid until
+  // this function returns.
+  buffer = alloc_buffer_with_data( data, length );
 
   assert( buffer != NULL );
 
-  p = append_back_buffer( buffer, length );
-  memcpy( p, data, length );
   remove_front_buffer( buffer, sizeof( openflow_service_header_t ) );
 
   ret = validate_openflow_message( buffer );
@@ -2018,6 +1901,10 @@ handle_list_switches_reply( uint16_t message_type, void *data, size_t length, vo
   debug( "A list switches reply message is received ( number of switches = %u ).",
          num_switch );
 
+  for ( size_t i = 0; i < num_switch; ++i ) {
+    add_switch_route( ntohll( dpid[ i ] ) );
+  }
+
   if ( event_handlers.list_switches_reply_callback == NULL ) {
     debug( "Callback function for list switches reply events is not set." );
     return;
@@ -2048,14 +1935,6 @@ handle_list_switches_reply( uint16_t message_type, void *data, size_t length, vo
 
 bool
 send_openflow_message( const uint64_t datapath_id, buffer *message ) {
-  bool ret;
-  void *data;
-  char remote_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
-  uint16_t header_length;
-  buffer *buffer;
-  struct ofp_header *ofp;
-  openflow_service_header_t header;
-
   maybe_init_openflow_application_interface();
   assert( openflow_application_interface_initialized );
 
@@ -2064,39 +1943,34 @@ send_openflow_message( const uint64_t datapath_id, buffer *message ) {
     assert( 0 );
   }
 
-  ofp = ( struct ofp_header * ) message->data;
-  buffer = duplicate_buffer( message );
-
-  assert( buffer != NULL );
-
-  header_length = ( uint16_t ) ( sizeof( openflow_service_header_t )
-                  + strlen( service_name ) + 1 );
-
-  header.datapath_id = htonll( datapath_id );
-  header.service_name_length = htons( ( uint16_t ) ( strlen( service_name ) + 1 ) );
-
-  data = append_front_buffer( buffer, header_length );
-  memset( data, '\0', header_length );
-  memcpy( data, &header, sizeof( openflow_service_header_t ) );
-  memcpy( ( char * ) data + sizeof( openflow_service_header_t ),
-          service_name, strlen( service_name ) );
+  switch_route unknown_route;
+  switch_route *route = lookup_switch_route( datapath_id );
+  if ( route == NULL ) {
+    // Not connected as far as we know; build the route without caching it.
+    build_switch_route( &unknown_route, datapath_id );
+    route = &unknown_route;
+  }
 
-  memset( remote_service_name, '\0', sizeof( remote_service_name ) );
-  snprintf( remote_service_name, sizeof( remote_service_name ),
-            "switch_daemon.%#" PRIx64, datapath_id );
+  struct ofp_header *ofp = ( struct ofp_header * ) message->data;
+  uint8_t type = ofp->type;
 
   debug( "Sending an OpenFlow message to %#" PRIx64
          " ( service_name = %s, remote_service_name = %s, "
          "ofp_header = [version = %#x, type = %#x, length = %u, transaction_id = %#x] ).",
-         datapath_id, service_name, remote_service_name,
+         datapath_id, service_name, route->remote_service_name,
          ofp->version, ofp->type, ntohs( ofp->length ), ntohl( ofp->xid ) );
 
-  ret =  send_message( remote_service_name, MESSENGER_OPENFLOW_MESSAGE,
-                       buffer->data, buffer->length );
+  // Messages from create_*() have headroom for the header, so the body
+  // stays where it is. The header is stripped again once it is queued.
+  void *header = append_front_buffer( message, route->header_length );
+  memcpy( header, route->header, route->header_length );
 
-  free_buffer( buffer );
+  bool ret = send_message( route->remote_service_name, MESSENGER_OPENFLOW_MESSAGE,
+                           message->data, message->length );
+
+  remove_front_buffer( message, route->header_length );
 
-  update_openflow_stats( ofp->type, OPENFLOW_MESSAGE_SEND, ret );
+  update_openflow_stats( type, OPENFLOW_MESSAGE_SEND, ret );
 
   return ret;
 }
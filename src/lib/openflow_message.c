@@ -27,7 +27,9 @@
 #include <sys/types.h>
 #include <syslog.h>
 #include <unistd.h>
+#include "messenger.h"
 #include "openflow_message.h"
+#include "openflow_service_interface.h"
 #include "packet_info.h"
 #include "wrapper.h"
 #include "log.h"
@@ -94,6 +96,10 @@ extern void mock_debug( const char *format, ... );
 #define FLOW_REMOVED_MASK ( ( 1 << OFPRR_IDLE_TIMEOUT ) | ( 1 << OFPRR_HARD_TIMEOUT ) \
                             | ( 1 << OFPRR_DELETE ) | ( 1 << OFPRR_GROUP_DELETE ) )
 
+// Room for an openflow_service_header_t and a service name, so that
+// send_openflow_message() can prepend them without moving the message.
+#define OPENFLOW_MESSAGE_HEADROOM ( sizeof( openflow_service_header_t ) + MESSENGER_SERVICE_NAME_LENGTH )
+
 static uint32_t transaction_id = 0;
 static pthread_mutex_t transaction_id_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 
@@ -129,7 +135,7 @@ create_header( const uint32_t transaction_id, const uint8_t type, const uint16_t
 
   assert( length >= sizeof( struct ofp_header ) );
 
-  buffer *buffer = alloc_buffer();
+  buffer *buffer = alloc_buffer_with_headroom( OPENFLOW_MESSAGE_HEADROOM, length );
   assert( buffer != NULL );
 
   struct ofp_header *header = append_back_buffer( buffer, length );
@@ -344,6 +350,53 @@ create_experimenter( const uint32_t transaction_id, const uint32_t experimenter,
 }
 
 
+buffer *
+create_bundle_control( const uint32_t transaction_id, const uint32_t bundle_id,
+                       const uint16_t type, const uint16_t flags ) {
+  debug( "Creating a bundle control ( xid = %#x, bundle_id = %#x, type = %#x, flags = %#x ).",
+         transaction_id, bundle_id, type, flags );
+
+  buffer *buffer = create_header( transaction_id, OFPT_EXPERIMENTER, sizeof( struct onf_bundle_ctrl_msg ) );
+  assert( buffer != NULL );
+
+  struct onf_bundle_ctrl_msg *bundle_ctrl = buffer->data;
+  bundle_ctrl->header.experimenter = htonl( ONF_EXPERIMENTER_ID );
+  bundle_ctrl->header.exp_type = htonl( ONFT_BUNDLE_CONTROL );
+  bundle_ctrl->bundle_id = htonl( bundle_id );
+  bundle_ctrl->type = htons( type );
+  bundle_ctrl->flags = htons( flags );
+
+  return buffer;
+}
+
+
+// The message is copied as is. Its transaction id must be the same as
+// the one of the bundle add message.
+buffer *
+create_bundle_add_message( const uint32_t transaction_id, const uint32_t bundle_id,
+                           const uint16_t flags, const buffer *message ) {
+  assert( message != NULL );
+  assert( message->length >= sizeof( struct ofp_header ) );
+
+  debug( "Creating a bundle add message ( xid = %#x, bundle_id = %#x, flags = %#x, message length = %u ).",
+         transaction_id, bundle_id, flags, message->length );
+
+  uint16_t length = ( uint16_t ) ( offsetof( struct onf_bundle_add_msg, message ) + message->length );
+  buffer *buffer = create_header( transaction_id, OFPT_EXPERIMENTER, length );
+  assert( buffer != NULL );
+
+  struct onf_bundle_add_msg *bundle_add = buffer->data;
+  bundle_add->header.experimenter = htonl( ONF_EXPERIMENTER_ID );
+  bundle_add->header.exp_type = htonl( ONFT_BUNDLE_ADD_MESSAGE );
+  bundle_add->bundle_id = htonl( bundle_id );
+  bundle_add->pad = 0;
+  bundle_add->flags = htons( flags );
+  memcpy( &bundle_add->message, message->data, message->length );
+
+  return buffer;
+}
+
+
 buffer *
 create_features_request( const uint32_t transaction_id ) {
   debug( "Creating a features request ( xid = %#x ).", transaction_id );
@@ -8050,6 +8103,7 @@ set_match_from_packet( oxm_matches *match, const uint32_t in_port,
   // Note that mask must be filled before calling this function.
 
   assert( packet != NULL );
+  get_parsed_packet_info( packet );
   assert( packet->user_data != NULL );
   assert( match != NULL );
 
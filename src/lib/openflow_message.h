@@ -73,6 +73,65 @@ typedef struct {
 } mask_fields;
 
 
+// Bundle extension for OpenFlow 1.3 ( ONF extension 230 )
+#define ONF_EXPERIMENTER_ID 0x4f4e4600
+
+enum onf_exp_type {
+  ONFT_BUNDLE_CONTROL = 2300,
+  ONFT_BUNDLE_ADD_MESSAGE = 2301,
+};
+
+enum onf_bundle_ctrl_type {
+  ONF_BCT_OPEN_REQUEST = 0,
+  ONF_BCT_OPEN_REPLY = 1,
+  ONF_BCT_CLOSE_REQUEST = 2,
+  ONF_BCT_CLOSE_REPLY = 3,
+  ONF_BCT_COMMIT_REQUEST = 4,
+  ONF_BCT_COMMIT_REPLY = 5,
+  ONF_BCT_DISCARD_REQUEST = 6,
+  ONF_BCT_DISCARD_REPLY = 7,
+};
+
+enum onf_bundle_flags {
+  ONF_BF_ATOMIC = 1 << 0,
+  ONF_BF_ORDERED = 1 << 1,
+};
+
+enum onf_bundle_error_type {
+  ONFERR_ET_UNKNOWN = 2300,
+  ONFERR_ET_EPERM = 2301,
+  ONFERR_ET_BAD_ID = 2302,
+  ONFERR_ET_BUNDLE_EXIST = 2303,
+  ONFERR_ET_BUNDLE_CLOSED = 2304,
+  ONFERR_ET_OUT_OF_BUNDLES = 2305,
+  ONFERR_ET_BAD_TYPE = 2306,
+  ONFERR_ET_BAD_FLAGS = 2307,
+  ONFERR_ET_MSG_BAD_LEN = 2308,
+  ONFERR_ET_MSG_BAD_XID = 2309,
+  ONFERR_ET_MSG_UNSUP = 2310,
+  ONFERR_ET_MSG_CONFLICT = 2311,
+  ONFERR_ET_MSG_TOO_MANY = 2312,
+  ONFERR_ET_MSG_FAILED = 2313,
+  ONFERR_ET_TIMEOUT = 2314,
+  ONFERR_ET_BUNDLE_IN_PROGRESS = 2315,
+};
+
+struct onf_bundle_ctrl_msg {
+  struct ofp_experimenter_header header; // exp_type = ONFT_BUNDLE_CONTROL
+  uint32_t bundle_id;
+  uint16_t type; // one of ONF_BCT_*
+  uint16_t flags; // bitmap of ONF_BF_*
+};
+
+struct onf_bundle_add_msg {
+  struct ofp_experimenter_header header; // exp_type = ONFT_BUNDLE_ADD_MESSAGE
+  uint32_t bundle_id;
+  uint16_t pad;
+  uint16_t flags; // bitmap of ONF_BF_*
+  struct ofp_header message; // message added to the bundle
+};
+
+
 // Initialization
 bool init_openflow_message( void );
 
@@ -88,6 +147,10 @@ buffer *create_echo_request( const uint32_t transaction_id, const buffer *body )
 buffer *create_echo_reply( const uint32_t transaction_id, const buffer *body );
 buffer *create_experimenter( const uint32_t transaction_id, const uint32_t experimenter,
                              const uint32_t exp_type, const buffer *data );
+buffer *create_bundle_control( const uint32_t transaction_id, const uint32_t bundle_id,
+                               const uint16_t type, const uint16_t flags );
+buffer *create_bundle_add_message( const uint32_t transaction_id, const uint32_t bundle_id,
+                                   const uint16_t flags, const buffer *message );
 buffer *create_features_request( const uint32_t transaction_id );
 buffer *create_features_reply( const uint32_t transaction_id, const uint64_t datapath_id,
                                const uint32_t n_buffers, const uint8_t n_tables,
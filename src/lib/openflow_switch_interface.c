@@ -583,6 +583,48 @@ set_meter_mod_handler( meter_mod_handler callback, void *user_data ) {
 }
 
 
+bool
+set_packet_out_message_handler( openflow_message_handler callback, void *user_data ) {
+  assert( callback != NULL );
+  assert( openflow_switch_interface_initialized );
+
+  debug( "Setting a packet out message handler ( callback = %p, user_data = %p ).", callback, user_data );
+
+  event_handlers.packet_out_message_callback = callback;
+  event_handlers.packet_out_message_user_data = user_data;
+
+  return true;
+}
+
+
+bool
+set_flow_mod_message_handler( openflow_message_handler callback, void *user_data ) {
+  assert( callback != NULL );
+  assert( openflow_switch_interface_initialized );
+
+  debug( "Setting a flow mod message handler ( callback = %p, user_data = %p ).", callback, user_data );
+
+  event_handlers.flow_mod_message_callback = callback;
+  event_handlers.flow_mod_message_user_data = user_data;
+
+  return true;
+}
+
+
+bool
+set_group_mod_message_handler( openflow_message_handler callback, void *user_data ) {
+  assert( callback != NULL );
+  assert( openflow_switch_interface_initialized );
+
+  debug( "Setting a group mod message handler ( callback = %p, user_data = %p ).", callback, user_data );
+
+  event_handlers.group_mod_message_callback = callback;
+  event_handlers.group_mod_message_user_data = user_data;
+
+  return true;
+}
+
+
 static bool
 empty( const buffer *data ) {
   if ( ( data == NULL ) || ( ( data != NULL ) && ( data->length == 0 ) ) ) {
@@ -904,6 +946,11 @@ static void
 handle_packet_out( buffer *data ) {
   assert( empty( data ) == false );
 
+  if ( event_handlers.packet_out_message_callback != NULL ) {
+    event_handlers.packet_out_message_callback( data, event_handlers.packet_out_message_user_data );
+    return;
+  }
+
   struct ofp_packet_out *packet_out = data->data;
 
   uint32_t transaction_id = ntohl( packet_out->header.xid );
@@ -967,6 +1014,11 @@ static void
 handle_flow_mod( buffer *data ) {
   assert( empty( data ) == false );
 
+  if ( event_handlers.flow_mod_message_callback != NULL ) {
+    event_handlers.flow_mod_message_callback( data, event_handlers.flow_mod_message_user_data );
+    return;
+  }
+
   struct ofp_flow_mod *flow_mod = data->data;
 
   uint32_t transaction_id = ntohl( flow_mod->header.xid );
@@ -1044,6 +1096,11 @@ static void
 handle_group_mod( buffer *data ) {
   assert( empty( data ) == false );
 
+  if ( event_handlers.group_mod_message_callback != NULL ) {
+    event_handlers.group_mod_message_callback( data, event_handlers.group_mod_message_user_data );
+    return;
+  }
+
   struct ofp_group_mod *group_mod = data->data;
 
   list_element *buckets_head = NULL;
@@ -162,6 +162,17 @@ typedef void ( *group_mod_handler )(
 );
 
 
+/*
+ * Takes a validated flow mod, group mod or packet out message as received
+ * ( i.e. in network byte order ), in place of the handler above that takes
+ * the message decoded into lists.
+ */
+typedef void ( *openflow_message_handler )(
+  const buffer *message,
+  void *user_data
+);
+
+
 typedef void ( *port_mod_handler )(
   uint32_t transaction_id,
   uint32_t port_no,
@@ -305,6 +316,15 @@ typedef struct {
   
   meter_mod_handler meter_mod_callback;
   void *meter_mod_user_data;
+
+  openflow_message_handler packet_out_message_callback;
+  void *packet_out_message_user_data;
+
+  openflow_message_handler flow_mod_message_callback;
+  void *flow_mod_message_user_data;
+
+  openflow_message_handler group_mod_message_callback;
+  void *group_mod_message_user_data;
 } openflow_event_handlers;
 
 
@@ -336,6 +356,9 @@ bool set_role_request_handler( role_request_handler callback, void *user_data );
 bool set_get_async_request_handler( get_async_request_handler callback, void *user_data );
 bool set_set_async_handler( set_async_handler callback, void *user_data );
 bool set_meter_mod_handler( meter_mod_handler callback, void *user_data );
+bool set_packet_out_message_handler( openflow_message_handler callback, void *user_data );
+bool set_flow_mod_message_handler( openflow_message_handler callback, void *user_data );
+bool set_group_mod_message_handler( openflow_message_handler callback, void *user_data );
 
 /********************************************************************************
  * Function for sending/receiving OpenFlow messages.
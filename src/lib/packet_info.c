@@ -17,7 +17,9 @@
 
 
 #include <assert.h>
+#include <stdint.h>
 #include "checks.h"
+#include "log.h"
 #include "packet_info.h"
 #include "wrapper.h"
 
@@ -47,14 +49,51 @@ calloc_packet_info( buffer *buf ) {
 }
 
 
+/*
+ * A deferred frame has no packet_info yet and carries this function as its
+ * user_data_free_function. free_buffer() only calls that function when
+ * user_data is set, so it serves purely as a marker.
+ */
+static void
+free_deferred_packet_info( buffer *buf ) {
+  buf->user_data_free_function = NULL;
+}
+
+
+void
+defer_parse_packet( buffer *frame ) {
+  die_if_NULL( frame );
+
+  frame->user_data = NULL;
+  frame->user_data_free_function = free_deferred_packet_info;
+}
+
+
+packet_info *
+get_parsed_packet_info( const buffer *frame ) {
+  die_if_NULL( frame );
+
+  if ( frame->user_data == NULL && frame->user_data_free_function == free_deferred_packet_info ) {
+    // Parsing only fills in user_data; the frame itself is left intact.
+    buffer *deferred = ( buffer * ) ( uintptr_t ) frame;
+    if ( !parse_packet( deferred ) ) {
+      error( "Failed to parse a packet." );
+    }
+  }
+
+  return frame->user_data;
+}
+
+
 packet_info
 get_packet_info( const buffer *frame ) {
   die_if_NULL( frame );
 
   packet_info info;
 
-  if ( frame->user_data != NULL ) {
-    info = *( packet_info * ) frame->user_data;
+  const packet_info *parsed = get_parsed_packet_info( frame );
+  if ( parsed != NULL ) {
+    info = *parsed;
   }
   else {
     memset( &info, 0, sizeof( info ) );
@@ -67,8 +106,8 @@ get_packet_info( const buffer *frame ) {
 static bool
 if_packet_type( const buffer *frame, const uint32_t type ) {
   die_if_NULL( frame );
-  packet_info packet_info = get_packet_info( frame );
-  return ( ( packet_info.format & type ) == type );
+  const packet_info *packet_info = get_parsed_packet_info( frame );
+  return ( packet_info != NULL && ( packet_info->format & type ) == type );
 }
 
 
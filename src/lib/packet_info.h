@@ -237,6 +237,10 @@ void calloc_packet_info( buffer *frame );
 void free_packet_info( buffer *frame );
 packet_info get_packet_info( const buffer *frame );
 
+// Marks a frame to be parsed when its packet_info is first read.
+void defer_parse_packet( buffer *frame );
+packet_info *get_parsed_packet_info( const buffer *frame );
+
 bool packet_type_eth_dix( const buffer *frame );
 bool packet_type_eth_vtag( const buffer *frame );
 bool packet_type_eth_raw( const buffer *frame );
@@ -42,6 +42,7 @@ typedef struct {
 
 static bool initialized = false;
 static char client_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+static char management_service_name[ MESSENGER_SERVICE_NAME_LENGTH ] = PACKETIN_FILTER_MANAGEMENT_SERVICE;
 
 
 static void
@@ -57,6 +58,23 @@ get_client_service_name( void ) {
 }
 
 
+bool
+set_packetin_filter_management_service( const char *service_name ) {
+  if ( service_name == NULL ) {
+    service_name = PACKETIN_FILTER_MANAGEMENT_SERVICE;
+  }
+  if ( strlen( service_name ) == 0 || strlen( service_name ) >= sizeof( management_service_name ) ) {
+    error( "Invalid packetin filter management service name ( %s ).", service_name );
+    return false;
+  }
+
+  strncpy( management_service_name, service_name, sizeof( management_service_name ) );
+  management_service_name[ sizeof( management_service_name ) - 1 ] = '\0';
+
+  return true;
+}
+
+
 static void
 maybe_init_packetin_filter_interface( void ) {
   if ( initialized ) {
@@ -136,7 +154,7 @@ add_packetin_filter( oxm_matches *match, uint16_t priority, char *service_name,
   }
   construct_ofp_match( &request->entry.match, match );
 
-  bool ret = send_request_message( PACKETIN_FILTER_MANAGEMENT_SERVICE,
+  bool ret = send_request_message( management_service_name,
                                    get_client_service_name(),
                                    MESSENGER_ADD_PACKETIN_FILTER_REQUEST,
                                    request, length, data );
@@ -176,7 +194,7 @@ delete_packetin_filter( oxm_matches *match, uint16_t priority, char *service_nam
   }
   construct_ofp_match( &request->criteria.match, match );
 
-  bool ret = send_request_message( PACKETIN_FILTER_MANAGEMENT_SERVICE,
+  bool ret = send_request_message( management_service_name,
                                    get_client_service_name(),
                                    MESSENGER_DELETE_PACKETIN_FILTER_REQUEST,
                                    request, length, data );
@@ -216,7 +234,7 @@ dump_packetin_filter( oxm_matches *match, uint16_t priority, char *service_name,
   }
   construct_ofp_match( &request->criteria.match, match );
 
-  bool ret = send_request_message( PACKETIN_FILTER_MANAGEMENT_SERVICE,
+  bool ret = send_request_message( management_service_name,
                                    get_client_service_name(),
                                    MESSENGER_DUMP_PACKETIN_FILTER_REQUEST,
                                    request, length, data );
@@ -123,6 +123,10 @@ bool delete_packetin_filter( oxm_matches *match, uint16_t priority, char *servic
                              delete_packetin_filter_handler callback, void *user_data );
 bool dump_packetin_filter( oxm_matches *match, uint16_t priority, char *service_name, bool strict,
                            dump_packetin_filter_handler callback, void *user_data );
+// Sends the requests above to service_name instead of the packetin_filter
+// process, e.g. to a switch daemon started with --packet_in-filter, which
+// accepts them on its own service name ( "switch_daemon.0x1" ).
+bool set_packetin_filter_management_service( const char *service_name );
 bool init_packetin_filter_interface( void );
 bool finalize_packetin_filter_interface( void );
 
@@ -0,0 +1,392 @@
+/*
+ * Packet-in filter rules kept in the match table.
+ *
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Each rule maps a match and a priority to a list of service names. The
+ * rules are shared by the packetin_filter process and by switch daemons
+ * that filter packet-ins themselves, and both serve the add, delete and
+ * dump requests of packetin_filter_interface.h with the handler below.
+ */
+
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include "linked_list.h"
+#include "log.h"
+#include "match_table.h"
+#include "packet_info.h"
+#include "packetin_filter_interface.h"
+#include "packetin_filter_table.h"
+#include "wrapper.h"
+
+
+static void
+free_services( oxm_matches *match, uint16_t priority, void *services, void *user_data ) {
+  UNUSED( match );
+  UNUSED( priority );
+  UNUSED( user_data );
+
+  list_element *element;
+  for ( element = services; element != NULL; element = element->next ) {
+    xfree( element->data );
+    element->data = NULL;
+  }
+  delete_list( services );
+}
+
+
+void
+init_packetin_filter_table( void ) {
+  init_match_table();
+}
+
+
+void
+finalize_packetin_filter_table( void ) {
+  foreach_match_table( free_services, NULL );
+  finalize_match_table();
+}
+
+
+/*
+ * Creates a separate set of rules, e.g. for one of the switches that a
+ * switch daemon handles. Rules are added to, looked up in and deleted from
+ * the set selected with select_packetin_filter_table().
+ */
+match_table *
+create_packetin_filter_table( void ) {
+  return create_match_table();
+}
+
+
+void
+delete_packetin_filter_table( match_table *table ) {
+  assert( table != NULL );
+
+  select_match_table( table );
+  foreach_match_table( free_services, NULL );
+  delete_match_table( table );
+}
+
+
+void
+select_packetin_filter_table( match_table *table ) {
+  select_match_table( table );
+}
+
+
+bool
+add_packetin_filter_entry( oxm_matches *match, uint16_t priority, const char *service_name ) {
+  assert( match != NULL );
+  assert( service_name != NULL );
+
+  bool ( *insert_or_update_match_entry ) ( oxm_matches *, uint16_t, void * ) = update_match_entry;
+  list_element *services = lookup_match_strict_entry( match, priority );
+  if ( services == NULL ) {
+    insert_or_update_match_entry = insert_match_entry;
+    create_list( &services );
+  }
+  else {
+    list_element *element;
+    for ( element = services; element != NULL; element = element->next ) {
+      if ( strcmp( element->data, service_name ) == 0 ) {
+        char match_string[ MATCH_STRING_LENGTH ];
+        match_to_string( match, match_string, sizeof( match_string ) );
+        warn( "match entry already exists ( match = [%s], service_name = [%s] )", match_string, service_name );
+        return false;
+      }
+    }
+  }
+  append_to_tail( &services, xstrdup( service_name ) );
+  insert_or_update_match_entry( match, priority, services );
+
+  return true;
+}
+
+
+int
+delete_packetin_filter_entry( oxm_matches *match, uint16_t priority, const char *service_name ) {
+  assert( match != NULL );
+  assert( service_name != NULL );
+
+  list_element *head = delete_match_strict_entry( match, priority );
+  if ( head == NULL ) {
+    return 0;
+  }
+
+  int n_deleted = 0;
+  int n_remaining_services = 0;
+  list_element *services = head;
+  while ( services != NULL ) {
+    char *service = services->data;
+    services = services->next;
+    if ( strcmp( service, service_name ) == 0 ) {
+      delete_element( &head, service );
+      xfree( service );
+      n_deleted++;
+    }
+    else {
+      n_remaining_services++;
+    }
+  }
+
+  if ( n_remaining_services == 0 ) {
+    if ( head != NULL ) {
+      delete_list( head );
+    }
+  }
+  else {
+    insert_match_entry( match, priority, head );
+  }
+
+  return n_deleted;
+}
+
+
+/*
+ * Returns the parsed inner frame of an EtherIP packet. The returned buffer
+ * refers to the data of the outer frame, which must outlive it.
+ */
+buffer *
+parse_etherip_frame( const buffer *frame ) {
+  assert( frame != NULL );
+
+  packet_info *packet_info = get_parsed_packet_info( frame );
+  if ( packet_info == NULL ) {
+    return NULL;
+  }
+  if ( packet_info->etherip_version != ETHERIP_VERSION ) {
+    error( "invalid etherip version 0x%04x.", packet_info->etherip_version );
+    return NULL;
+  }
+  if ( packet_info->etherip_offset == 0 || packet_info->etherip_offset >= frame->length ) {
+    debug( "too short etherip message" );
+    return NULL;
+  }
+
+  buffer *inner = alloc_buffer_with_data( ( char * ) frame->data + packet_info->etherip_offset,
+                                          frame->length - packet_info->etherip_offset );
+  if ( !parse_packet( inner ) ) {
+    error( "parse_packet failed." );
+    free_buffer( inner );
+    return NULL;
+  }
+
+  debug( "Receive EtherIP packet." );
+
+  return inner;
+}
+
+
+static void
+handle_add_filter_request( const messenger_context_handle *handle, add_packetin_filter_request *request ) {
+  assert( handle != NULL );
+  assert( request != NULL );
+
+  request->entry.service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
+  if ( strlen( request->entry.service_name ) == 0 ) {
+    error( "Service name must be specified." );
+    return;
+  }
+
+  oxm_matches *match = parse_ofp_match( &request->entry.match );
+  bool ret = add_packetin_filter_entry( match, ntohs( request->entry.priority ), request->entry.service_name );
+  delete_oxm_matches( match );
+
+  add_packetin_filter_reply reply;
+  memset( &reply, 0, sizeof( add_packetin_filter_reply ) );
+  reply.status = ( uint8_t ) ( ret ? PACKETIN_FILTER_OPERATION_SUCCEEDED : PACKETIN_FILTER_OPERATION_FAILED );
+  ret = send_reply_message( handle, MESSENGER_ADD_PACKETIN_FILTER_REPLY,
+                            &reply, sizeof( add_packetin_filter_reply ) );
+  if ( ret == false ) {
+    error( "Failed to send an add filter reply." );
+  }
+}
+
+
+static void
+delete_filter_walker( oxm_matches *match, uint16_t priority, void *data, void *user_data ) {
+  UNUSED( data );
+  delete_packetin_filter_reply *reply = user_data;
+  assert( reply != NULL );
+
+  list_element *head = delete_match_strict_entry( match, priority );
+  for ( list_element *services = head; services != NULL; services = services->next ) {
+    xfree( services->data );
+    reply->n_deleted++;
+  }
+  if ( head != NULL ) {
+    delete_list( head );
+  }
+}
+
+
+static void
+handle_delete_filter_request( const messenger_context_handle *handle, delete_packetin_filter_request *request ) {
+  assert( handle != NULL );
+  assert( request != NULL );
+
+  delete_packetin_filter_reply reply;
+  memset( &reply, 0, sizeof( delete_packetin_filter_reply ) );
+  reply.status = PACKETIN_FILTER_OPERATION_SUCCEEDED;
+
+  request->criteria.service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
+  oxm_matches *match = parse_ofp_match( &request->criteria.match );
+  uint16_t priority = ntohs( request->criteria.priority );
+  if ( request->flags & PACKETIN_FILTER_FLAG_MATCH_STRICT ) {
+    int n_deleted = delete_packetin_filter_entry( match, priority, request->criteria.service_name );
+    reply.n_deleted += ( uint32_t ) n_deleted;
+  }
+  else {
+    map_match_table( match, delete_filter_walker, &reply );
+  }
+  reply.n_deleted = htonl( reply.n_deleted );
+  delete_oxm_matches( match );
+
+  bool ret = send_reply_message( handle, MESSENGER_DELETE_PACKETIN_FILTER_REPLY, &reply, sizeof( reply ) );
+  if ( ret == false ) {
+    error( "Failed to send a delete filter reply." );
+  }
+}
+
+
+static void
+append_filter_entry( buffer *reply_buffer, oxm_matches *match, uint16_t priority, const char *service_name ) {
+  uint16_t match_len = ( uint16_t ) ( offsetof( struct ofp_match, oxm_fields ) + get_oxm_matches_length( match ) );
+  match_len = ( uint16_t ) ( match_len + PADLEN_TO_64( match_len ) );
+  uint16_t entry_len = ( uint16_t ) ( offsetof( packetin_filter_entry, match ) + match_len );
+
+  packetin_filter_entry *entry = append_back_buffer( reply_buffer, entry_len );
+  memset( entry, 0, entry_len );
+  entry->length = htons( entry_len );
+  entry->priority = htons( priority );
+  strncpy( entry->service_name, service_name, sizeof( entry->service_name ) );
+  entry->service_name[ sizeof( entry->service_name ) - 1 ] = '\0';
+  construct_ofp_match( &entry->match, match );
+
+  // append_back_buffer() may move the head of the buffer.
+  dump_packetin_filter_reply *reply = reply_buffer->data;
+  reply->n_entries++;
+}
+
+
+static void
+dump_filter_walker( oxm_matches *match, uint16_t priority, void *data, void *user_data ) {
+  buffer *reply_buffer = user_data;
+  assert( reply_buffer != NULL );
+
+  for ( list_element *services = data; services != NULL; services = services->next ) {
+    append_filter_entry( reply_buffer, match, priority, services->data );
+  }
+}
+
+
+static void
+handle_dump_filter_request( const messenger_context_handle *handle, dump_packetin_filter_request *request ) {
+  assert( handle != NULL );
+  assert( request != NULL );
+
+  buffer *buf = alloc_buffer_with_length( 2048 );
+  dump_packetin_filter_reply *reply = append_back_buffer( buf, offsetof( dump_packetin_filter_reply, entries ) );
+  memset( reply, 0, offsetof( dump_packetin_filter_reply, entries ) );
+  reply->status = PACKETIN_FILTER_OPERATION_SUCCEEDED;
+
+  request->criteria.service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
+  oxm_matches *match = parse_ofp_match( &request->criteria.match );
+  uint16_t priority = ntohs( request->criteria.priority );
+  if ( request->flags & PACKETIN_FILTER_FLAG_MATCH_STRICT ) {
+    for ( list_element *services = lookup_match_strict_entry( match, priority ); services != NULL; services = services->next ) {
+      if ( strcmp( services->data, request->criteria.service_name ) == 0 ) {
+        append_filter_entry( buf, match, priority, services->data );
+      }
+    }
+  }
+  else {
+    map_match_table( match, dump_filter_walker, buf );
+  }
+  delete_oxm_matches( match );
+
+  reply = buf->data;
+  reply->length = htons( ( uint16_t ) buf->length );
+  reply->n_entries = htonl( reply->n_entries );
+
+  bool ret = send_reply_message( handle, MESSENGER_DUMP_PACKETIN_FILTER_REPLY, buf->data, buf->length );
+  free_buffer( buf );
+  if ( ret == false ) {
+    error( "Failed to send a dump packetin filter reply." );
+  }
+}
+
+
+void
+handle_packetin_filter_request( const messenger_context_handle *handle, uint16_t tag, void *data, size_t length ) {
+  assert( handle != NULL );
+
+  debug( "Handling a packetin filter request ( handle = %p, tag = %#x, data = %p, length = %u ).",
+         handle, tag, data, length );
+
+  switch ( tag ) {
+    case MESSENGER_ADD_PACKETIN_FILTER_REQUEST:
+    {
+      if ( length < sizeof( add_packetin_filter_request ) ) {
+        error( "Invalid add packetin filter request ( length = %u ).", length );
+        return;
+      }
+
+      handle_add_filter_request( handle, data );
+    }
+    break;
+    case MESSENGER_DELETE_PACKETIN_FILTER_REQUEST:
+    {
+      if ( length < sizeof( delete_packetin_filter_request ) ) {
+        error( "Invalid delete packetin filter request ( length = %u ).", length );
+        return;
+      }
+
+      handle_delete_filter_request( handle, data );
+    }
+    break;
+    case MESSENGER_DUMP_PACKETIN_FILTER_REQUEST:
+    {
+      if ( length < sizeof( dump_packetin_filter_request ) ) {
+        error( "Invalid dump packetin filter request ( length = %u ).", length );
+        return;
+      }
+
+      handle_dump_filter_request( handle, data );
+    }
+    break;
+    default:
+    {
+      warn( "Undefined request tag ( tag = %#x ).", tag );
+    }
+    break;
+  }
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,51 @@
+/*
+ * Packet-in filter rules kept in the match table.
+ *
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef PACKETIN_FILTER_TABLE_H
+#define PACKETIN_FILTER_TABLE_H
+
+
+#include "bool.h"
+#include "buffer.h"
+#include "match_table.h"
+#include "messenger.h"
+#include "oxm_match.h"
+
+
+void init_packetin_filter_table( void );
+void finalize_packetin_filter_table( void );
+match_table *create_packetin_filter_table( void );
+void delete_packetin_filter_table( match_table *table );
+void select_packetin_filter_table( match_table *table );
+bool add_packetin_filter_entry( oxm_matches *match, uint16_t priority, const char *service_name );
+int delete_packetin_filter_entry( oxm_matches *match, uint16_t priority, const char *service_name );
+buffer *parse_etherip_frame( const buffer *frame );
+void handle_packetin_filter_request( const messenger_context_handle *handle, uint16_t tag, void *data, size_t length );
+
+
+#endif // PACKETIN_FILTER_TABLE_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
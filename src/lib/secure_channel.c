@@ -22,6 +22,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdio.h>
@@ -29,6 +30,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "buffer.h"
 #include "checks.h"
@@ -66,11 +68,18 @@ static secure_channel_connection connection = { 0, 0, -1, INIT, NULL, NULL };
 static bool secure_channel_initialized = false;
 
 static message_queue *send_queue = NULL;
-static message_queue *recv_queue = NULL;
 
-static const size_t RECEIVE_BUFFER_SIZE = UINT16_MAX + sizeof( struct ofp_packet_in ) - 2;
+// large enough to receive a burst of messages with a read() call
+static const size_t RECEIVE_BUFFER_SIZE = ( UINT16_MAX + 1 ) * 4;
 static buffer *fragment_buf = NULL;
 
+#ifdef IOV_MAX
+#define SEND_IOVCNT_MAX IOV_MAX
+#else
+#define SEND_IOVCNT_MAX 1024
+#endif
+static struct iovec send_iov[ SEND_IOVCNT_MAX ];
+
 
 static void
 transit_state( int state ) {
@@ -140,6 +149,11 @@ clear_connection() {
 
   connection.fd = -1;
   connection.state = INIT;
+
+  // discard a partial message from the previous connection
+  if ( fragment_buf != NULL ) {
+    reset_buffer( fragment_buf );
+  }
 }
 
 
@@ -158,19 +172,39 @@ disconnected() {
 }
 
 
-static bool
-recv_message_from_secure_channel() {
-  assert( recv_queue != NULL );
-
-  if ( recv_queue->length == 0 ) {
-    return false;
+/*
+ * Dispatches complete messages in the receive buffer in place. Each message
+ * is handed over as a buffer that refers to the receive buffer, so handlers
+ * must duplicate it if they keep it after returning.
+ */
+static size_t
+handle_messages_in_place( void ) {
+  char *data = fragment_buf->data;
+  size_t remaining = fragment_buf->length;
+  size_t handled = 0;
+
+  while ( remaining >= sizeof( struct ofp_header ) ) {
+    struct ofp_header *header = ( struct ofp_header * ) ( data + handled );
+    uint16_t message_length = ntohs( header->length );
+    if ( message_length < sizeof( struct ofp_header ) ) {
+      error( "Invalid message length ( length = %u ).", message_length );
+      return SIZE_MAX;
+    }
+    if ( message_length > remaining ) {
+      break;
+    }
+    buffer *message = alloc_buffer_with_data( header, message_length );
+    handle_secure_channel_message( message ); // FIXME: handle error properly
+    free_buffer( message );
+    handled += message_length;
+    remaining -= message_length;
+    if ( fragment_buf == NULL ) {
+      // disconnected while handling messages
+      return 0;
+    }
   }
 
-  buffer *message = dequeue_message( recv_queue );
-  handle_secure_channel_message( message ); // FIXME: handle error properly
-  free_buffer( message );
-
-  return true;
+  return handled;
 }
 
 
@@ -179,55 +213,52 @@ recv_from_secure_channel( int fd, void *user_data ) {
   UNUSED( fd );
   UNUSED( user_data );
 
-  // all queued messages should be processed before receiving new messages from remote
-  if ( recv_queue->length > 0 ) {
-    return;
-  }
-
   if ( fragment_buf == NULL ) {
     fragment_buf = alloc_buffer_with_length( RECEIVE_BUFFER_SIZE );
   }
 
-  size_t remaining_length = RECEIVE_BUFFER_SIZE - fragment_buf->length;
-  char *recv_buf = ( char * ) fragment_buf->data + fragment_buf->length;
-  ssize_t recv_length = read( connection.fd, recv_buf, remaining_length );
-  if ( recv_length < 0 ) {
-    if ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) {
+  for ( ;; ) {
+    size_t remaining_length = RECEIVE_BUFFER_SIZE - fragment_buf->length;
+    char *recv_buf = ( char * ) fragment_buf->data + fragment_buf->length;
+    ssize_t recv_length = read( connection.fd, recv_buf, remaining_length );
+    if ( recv_length < 0 ) {
+      if ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) {
+        return;
+      }
+      error( "Receive error ( errno = %s [%d] ).", strerror( errno ), errno );
       return;
     }
-    error( "Receive error ( errno = %s [%d] ).", strerror( errno ), errno );
-    return;
-  }
-  if ( recv_length == 0 ) {
-    debug( "Connection closed by peer." );
-    disconnected();
-    reconnect( NULL );
-    return;
-  }
-  fragment_buf->length += ( size_t ) recv_length;
+    if ( recv_length == 0 ) {
+      debug( "Connection closed by peer." );
+      disconnected();
+      reconnect( NULL );
+      return;
+    }
+    fragment_buf->length += ( size_t ) recv_length;
 
-  size_t read_total = 0;
-  while ( fragment_buf->length >= sizeof( struct ofp_header ) ) {
-    struct ofp_header *header = fragment_buf->data;
-    uint16_t message_length = ntohs( header->length );
-    if ( message_length > fragment_buf->length ) {
-      break;
+    size_t handled = handle_messages_in_place();
+    if ( handled == SIZE_MAX ) {
+      disconnected();
+      reconnect( NULL );
+      return;
+    }
+    if ( fragment_buf == NULL ) {
+      return;
     }
-    buffer *message = alloc_buffer_with_length( message_length );
-    char *p = append_back_buffer( message, message_length );
-    memcpy( p, fragment_buf->data, message_length );
-    remove_front_buffer( fragment_buf, message_length );
-    enqueue_message( recv_queue, message );
-    read_total += message_length;
-  }
 
-  // remove headroom manually for next call
-  if ( read_total > 0 ) {
-    memmove( ( char * ) fragment_buf->data - read_total, fragment_buf->data, fragment_buf->length );
-    fragment_buf->data = ( char * ) fragment_buf->data - read_total;
-  }
+    // move a partial message to the head for next read
+    if ( handled > 0 ) {
+      fragment_buf->length -= handled;
+      if ( fragment_buf->length > 0 ) {
+        memmove( fragment_buf->data, ( char * ) fragment_buf->data + handled, fragment_buf->length );
+      }
+    }
 
-  while ( recv_message_from_secure_channel() == true );
+    // more data may be pending if the buffer got full.
+    if ( ( size_t ) recv_length < remaining_length ) {
+      return;
+    }
+  }
 }
 
 
@@ -243,9 +274,18 @@ flush_send_queue( int fd, void *user_data ) {
 
   set_writable_safe( connection.fd, false );
 
-  buffer *buf = NULL;
-  while ( ( buf = peek_message( send_queue ) ) != NULL ) {
-    ssize_t write_length = write( connection.fd, buf->data, buf->length );
+  while ( send_queue->length > 0 ) {
+    int iovcnt = 0;
+    size_t total_length = 0;
+    for ( message_queue_element *element = send_queue->divider->next;
+          element != NULL && iovcnt < SEND_IOVCNT_MAX; element = element->next ) {
+      send_iov[ iovcnt ].iov_base = element->data->data;
+      send_iov[ iovcnt ].iov_len = element->data->length;
+      total_length += element->data->length;
+      iovcnt++;
+    }
+
+    ssize_t write_length = writev( connection.fd, send_iov, iovcnt );
     if ( write_length < 0 ) {
       if ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) {
         set_writable_safe( connection.fd, true );
@@ -255,14 +295,22 @@ flush_send_queue( int fd, void *user_data ) {
              strerror( errno ), errno );
       return;
     }
-    if ( ( size_t ) write_length < buf->length ) {
-      remove_front_buffer( buf, ( size_t ) write_length );
+
+    size_t written = ( size_t ) write_length;
+    buffer *buf;
+    while ( written > 0 && ( buf = peek_message( send_queue ) ) != NULL ) {
+      if ( written < buf->length ) {
+        remove_front_buffer( buf, written );
+        break;
+      }
+      written -= buf->length;
+      buf = dequeue_message( send_queue );
+      free_buffer( buf );
+    }
+    if ( ( size_t ) write_length < total_length ) {
       set_writable_safe( connection.fd, true );
       return;
     }
-
-    buf = dequeue_message( send_queue );
-    free_buffer( buf );
   }
 }
 
@@ -439,7 +487,6 @@ init_secure_channel( uint32_t ip, uint16_t port, connected_handler connected_cal
   }
 
   send_queue = create_message_queue();
-  recv_queue = create_message_queue();
 
   secure_channel_initialized = true;
 
@@ -457,9 +504,9 @@ finalize_secure_channel() {
     delete_message_queue( send_queue );
     send_queue = NULL;
   }
-  if ( recv_queue != NULL ) {
-    delete_message_queue( recv_queue );
-    recv_queue = NULL;
+  if ( fragment_buf != NULL ) {
+    free_buffer( fragment_buf );
+    fragment_buf = NULL;
   }
 
   secure_channel_initialized = false;
@@ -710,6 +710,25 @@ get_trema_process_from_name( const char *name ) {
 }
 
 
+/**
+ * Makes get_trema_process_from_name() find the calling process also by
+ * the given name. This is useful for a process that serves several
+ * services, such as a switch daemon handling many switches.
+ */
+void
+add_trema_process_alias( const char *name ) {
+  assert( name != NULL );
+  write_pid( get_trema_pid(), name );
+}
+
+
+void
+delete_trema_process_alias( const char *name ) {
+  assert( name != NULL );
+  unlink_pid( get_trema_pid(), name );
+}
+
+
 bool
 terminate_trema_process( pid_t pid ) {
   assert( pid > 0 );
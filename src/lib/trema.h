@@ -48,6 +48,7 @@
 #include "oxm_byteorder.h"
 #include "packet_info.h"
 #include "packetin_filter_interface.h"
+#include "packetin_filter_table.h"
 #include "persistent_storage.h"
 #include "safe_event_handler.h"
 #include "safe_timer.h"
@@ -71,6 +72,8 @@ void set_trema_name( const char *name );
 const char *get_trema_name( void );
 const char *get_executable_name( void );
 pid_t get_trema_process_from_name( const char *name );
+void add_trema_process_alias( const char *name );
+void delete_trema_process_alias( const char *name );
 bool terminate_trema_process( pid_t pid );
 __attribute__( ( weak ) ) void usage( void );
 
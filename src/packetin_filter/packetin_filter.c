@@ -63,13 +63,6 @@ buffer *mock_create_packet_in( const uint32_t transaction_id, const uint32_t buf
                                const uint8_t table_id, const uint64_t cookie,
                                const oxm_matches *match, const buffer *data );
 
-#ifdef insert_match_entry
-#undef insert_match_entry
-#endif
-#define insert_match_entry mock_insert_match_entry
-void mock_insert_match_entry( oxm_matches *ofp_match, uint16_t priority,
-                              const char *service_name );
-
 #ifdef lookup_match_entry
 #undef lookup_match_entry
 #endif
@@ -134,38 +127,6 @@ usage() {
 }
 
 
-static buffer *
-parse_etherip( const buffer *data ) {
-  packet_info *packet_info = data->user_data;
-  if ( packet_info->etherip_version != ETHERIP_VERSION ) {
-    error( "invalid etherip version 0x%04x.", packet_info->etherip_version );
-    return NULL;
-  }
-  if ( packet_info->etherip_offset == 0 ) {
-    debug( "too short etherip message" );
-    return NULL;
-  }
-
-  buffer *copy = duplicate_buffer( data );
-  if ( copy == NULL ) {
-    error( "duplicate_buffer failed." );
-    return NULL;
-  }
-  copy->user_data = NULL;
-  remove_front_buffer( copy, packet_info->etherip_offset );
-
-  if ( !parse_packet( copy ) ) {
-    error( "parse_packet failed." );
-    free_buffer( copy );
-    return NULL;
-  }
-
-  debug( "Receive EtherIP packet." );
-
-  return copy;
-}
-
-
 static void
 handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
                   uint32_t buffer_id, uint16_t total_len,
@@ -183,10 +144,10 @@ handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
   }
 
   buffer *copy = NULL;
-  packet_info *packet_info = data->user_data;
+  packet_info *packet_info = get_parsed_packet_info( data );
   debug( "Receive packet. ethertype=0x%04x, ipproto=0x%x", packet_info->eth_type, packet_info->ipv4_protocol );
   if ( packet_type_ipv4_etherip( data ) ) {
-    copy = parse_etherip( data );
+    copy = parse_etherip_frame( data );
   }
   set_match_from_packet( matches, in_port, NULL, copy != NULL ? copy : data );
   if ( copy != NULL ) {
@@ -227,102 +188,12 @@ handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
 }
 
 
-static void
-init_packetin_match_table( void ) {
-  init_match_table();
-}
-
-
-static void
-free_user_data_entry( oxm_matches *match, uint16_t priority, void *services, void *user_data ) {
-  UNUSED( match );
-  UNUSED( priority );
-  UNUSED( user_data );
-
-  list_element *element;
-  for ( element = services; element != NULL; element = element->next ) {
-    xfree( element->data );
-    element->data = NULL;
-  }
-  delete_list( services );
-}
-
-
-static void
-finalize_packetin_match_table( void ) {
-  foreach_match_table( free_user_data_entry, NULL );
-  finalize_match_table();
-}
-
-
-static bool
-add_packetin_match_entry( oxm_matches *match, uint16_t priority, const char *service_name ) {
-  bool ( *insert_or_update_match_entry ) ( oxm_matches *, uint16_t, void * ) = update_match_entry;
-  list_element *services = lookup_match_strict_entry( match, priority );
-  if ( services == NULL ) {
-    insert_or_update_match_entry = insert_match_entry;
-    create_list( &services );
-  }
-  else {
-    list_element *element;
-    for ( element = services; element != NULL; element = element->next ) {
-      if ( strcmp( element->data, service_name ) == 0 ) {
-        char match_string[ MATCH_STRING_LENGTH ];
-        match_to_string( match, match_string, sizeof( match_string ) );
-        warn( "match entry already exists ( match = [%s], service_name = [%s] )", match_string, service_name );
-        return false;
-      }
-    }
-  }
-  append_to_tail( &services, xstrdup( service_name ) );
-  insert_or_update_match_entry( match, priority, services );
-
-  return true;
-}
-
-
-static int
-delete_packetin_match_entry( oxm_matches *match, uint16_t priority, const char *service_name ) {
-  list_element *head = delete_match_strict_entry( match, priority );
-  if ( head == NULL ) {
-    return 0;
-  }
-
-  int n_deleted = 0;
-  int n_remaining_services = 0;
-  list_element *services = head;
-  while ( services != NULL ) {
-    char *service = services->data;
-    services = services->next;
-    if ( strcmp( service, service_name ) == 0 ) {
-      delete_element( &head, service );
-      xfree( service );
-      n_deleted++;
-    }
-    else {
-      n_remaining_services++;
-    }
-  }
-
-  if ( n_remaining_services == 0 ) {
-    if ( head != NULL ) {
-      delete_list( head );
-    }
-  }
-  else {
-    insert_match_entry( match, priority, head );
-  }
-
-  return n_deleted;
-}
-
-
 static void
 register_dl_type_filter( uint16_t dl_type, uint16_t priority, const char *service_name ) {
   oxm_matches *match = create_oxm_matches();
   append_oxm_match_eth_type( match, dl_type );
 
-  add_packetin_match_entry( match, priority, service_name );
+  add_packetin_filter_entry( match, priority, service_name );
   delete_oxm_matches( match );
 }
 
@@ -331,7 +202,7 @@ static void
 register_any_filter( uint16_t priority, const char *service_name ) {
   oxm_matches *match = create_oxm_matches();
 
-  add_packetin_match_entry( match, priority, service_name );
+  add_packetin_filter_entry( match, priority, service_name );
   delete_oxm_matches( match );
 }
 
@@ -371,214 +242,25 @@ set_match_type( int argc, char *argv[] ) {
 }
 
 
-static void
-handle_add_filter_request( const messenger_context_handle *handle, add_packetin_filter_request *request ) {
-  assert( handle != NULL );
-  assert( request != NULL ) ;
-
-  request->entry.service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
-  if ( strlen( request->entry.service_name ) == 0 ) {
-    error( "Service name must be specified." );
-    return;
-  }
-
-  oxm_matches *match = parse_ofp_match( &request->entry.match );
-  bool ret = add_packetin_match_entry( match, ntohs( request->entry.priority ), request->entry.service_name );
-  delete_oxm_matches( match );
-
-  add_packetin_filter_reply reply;
-  memset( &reply, 0, sizeof( add_packetin_filter_reply ) );
-  reply.status = ( uint8_t ) ( ret ? PACKETIN_FILTER_OPERATION_SUCCEEDED : PACKETIN_FILTER_OPERATION_FAILED );
-  ret = send_reply_message( handle, MESSENGER_ADD_PACKETIN_FILTER_REPLY,
-                            &reply, sizeof( add_packetin_filter_reply ) );
-  if ( ret == false ) {
-    error( "Failed to send an add filter reply." );
-  }
-}
-
-
-static void
-delete_filter_walker( oxm_matches *match, uint16_t priority, void *data, void *user_data ) {
-  UNUSED( data );
-  buffer *reply_buffer = user_data; 
-  assert( reply_buffer != NULL );
-
-  delete_packetin_filter_reply *reply = reply_buffer->data;
-  list_element *head = delete_match_strict_entry( match, priority );
-  for ( list_element *services = head; services != NULL; services = services->next ) {
-    xfree( services->data );
-    reply->n_deleted++;
-  }
-  if ( head != NULL ) {
-    delete_list( head );
-  }
-}
-
-
-static void
-handle_delete_filter_request( const messenger_context_handle *handle, delete_packetin_filter_request *request ) {
-  assert( handle != NULL );
-  assert( request != NULL ) ;
-
-  buffer *buf = alloc_buffer_with_length( sizeof( delete_packetin_filter_reply ) );
-  delete_packetin_filter_reply *reply = append_back_buffer( buf, sizeof( delete_packetin_filter_reply ) );
-  reply->status = PACKETIN_FILTER_OPERATION_SUCCEEDED;
-  reply->n_deleted = 0;
-
-  oxm_matches *match = parse_ofp_match( &request->criteria.match );
-  uint16_t priority = ntohs( request->criteria.priority );
-  if ( request->flags & PACKETIN_FILTER_FLAG_MATCH_STRICT ) {
-    int n_deleted = delete_packetin_match_entry( match, priority, request->criteria.service_name );
-    reply->n_deleted += ( uint32_t ) n_deleted;
-  }
-  else {
-    map_match_table( match, delete_filter_walker, buf );
-  }
-  reply->n_deleted = htonl( reply->n_deleted );
-  delete_oxm_matches( match );
-
-  bool ret = send_reply_message( handle, MESSENGER_DELETE_PACKETIN_FILTER_REPLY, buf->data, buf->length );
-  free_buffer( buf );
-  if ( ret == false ) {
-    error( "Failed to send a dump filter reply." );
-  }
-}
-
-
-static void
-dump_filter_walker( oxm_matches *match, uint16_t priority, void *data, void *user_data ) {
-  buffer *reply_buffer = user_data;
-  assert( reply_buffer != NULL );
-
-  uint16_t match_len = ( uint16_t ) ( offsetof( struct ofp_match, oxm_fields ) + get_oxm_matches_length( match ) );
-  match_len = ( uint16_t ) ( match_len + PADLEN_TO_64( match_len ) );
-
-  dump_packetin_filter_reply *reply = reply_buffer->data;
-  list_element *services = data;
-  while ( services != NULL ) {
-    reply->n_entries++;
-    packetin_filter_entry *entry = append_back_buffer( reply_buffer, offsetof( packetin_filter_entry, match ) + match_len );
-    entry->length = htons( ( uint16_t ) ( offsetof( packetin_filter_entry, match ) + match_len ) );
-    entry->priority = htons( priority );
-    strncpy( entry->service_name, services->data, sizeof( entry->service_name ) );
-    entry->service_name[ sizeof( entry->service_name ) - 1 ] = '\0';
-    construct_ofp_match( &entry->match, match );
-    services = services->next;
-  }
-}
-
-
-static void
-handle_dump_filter_request( const messenger_context_handle *handle, dump_packetin_filter_request *request ) {
-  assert( handle != NULL );
-  assert( request != NULL ) ;
-
-  buffer *buf = alloc_buffer_with_length( 2048 );
-  dump_packetin_filter_reply *reply = append_back_buffer( buf, offsetof( dump_packetin_filter_reply, entries ) );
-  reply->status = PACKETIN_FILTER_OPERATION_SUCCEEDED;
-  reply->n_entries = 0;
-
-  oxm_matches *match = parse_ofp_match( &request->criteria.match );
-  uint16_t match_len = ( uint16_t ) ( offsetof( struct ofp_match, oxm_fields ) + get_oxm_matches_length( match ) );
-  match_len = ( uint16_t ) ( match_len + PADLEN_TO_64( match_len ) );
-
-  uint16_t priority = ntohs( request->criteria.priority );
-  if ( request->flags & PACKETIN_FILTER_FLAG_MATCH_STRICT ) {
-    list_element *services = lookup_match_strict_entry( match, priority );
-    while ( services != NULL ) {
-      if ( strcmp( services->data, request->criteria.service_name ) == 0 ) {
-        packetin_filter_entry *entry = append_back_buffer( buf, offsetof( packetin_filter_entry, match ) + match_len );
-        reply->n_entries++;
-        entry->length = htons( ( uint16_t ) ( offsetof( packetin_filter_entry, match ) + match_len ) );
-        entry->priority = request->criteria.priority;
-        strncpy( entry->service_name, services->data, sizeof( entry->service_name ) );
-        entry->service_name[ sizeof( entry->service_name ) - 1 ] = '\0';
-        construct_ofp_match( &entry->match, match );
-      }
-      services = services->next;
-    }
-  }
-  else {
-    map_match_table( match, dump_filter_walker, buf );
-  }
-  reply->length = htons( ( uint16_t ) buf->length );
-  reply->n_entries = htonl( reply->n_entries );
-  delete_oxm_matches( match );
-
-  bool ret = send_reply_message( handle, MESSENGER_DUMP_PACKETIN_FILTER_REPLY, buf->data, buf->length );
-  free_buffer( buf );
-  if ( ret == false ) {
-    error( "Failed to send a dump packetin filter reply." );
-  }
-}
-
-
-static void
-handle_request( const messenger_context_handle *handle, uint16_t tag, void *data, size_t length ) {
-  assert( handle != NULL );
-
-  debug( "Handling a request ( handle = %p, tag = %#x, data = %p, length = %u ).",
-         handle, tag, data, length );
-
-  switch ( tag ) {
-    case MESSENGER_ADD_PACKETIN_FILTER_REQUEST:
-    {
-      if ( length < sizeof( add_packetin_filter_request ) ) {
-        error( "Invalid add packetin filter request ( length = %u ).", length );
-        return;
-      }
-
-      handle_add_filter_request( handle, data );
-    }
-    break;
-    case MESSENGER_DELETE_PACKETIN_FILTER_REQUEST:
-    {
-      if ( length < sizeof( delete_packetin_filter_request ) ) {
-        error( "Invalid delete packetin filter request ( length = %u ).", length );
-        return;
-      }
-
-      handle_delete_filter_request( handle, data );
-    }
-    break;
-    case MESSENGER_DUMP_PACKETIN_FILTER_REQUEST:
-    {
-      if ( length < sizeof( dump_packetin_filter_request ) ) {
-        error( "Invalid dump packetin filter request ( length = %u ).", length );
-        return;
-      }
-
-      handle_dump_filter_request( handle, data );
-    }
-    break;
-    default:
-    {
-      warn( "Undefined request tag ( tag = %#x ).", tag );
-    }
-    break;
-  }
-}
-
-
 int
 main( int argc, char *argv[] ) {
   init_trema( &argc, &argv );
 
-  init_packetin_match_table();
+  init_packetin_filter_table();
 
   // built-in packetin-filter-rule
   if ( !set_match_type( argc, argv ) ) {
     usage();
-    finalize_packetin_match_table();
+    finalize_packetin_filter_table();
     exit( EXIT_FAILURE );
   }
 
   set_packet_in_handler( handle_packet_in, NULL );
-  add_message_requested_callback( PACKETIN_FILTER_MANAGEMENT_SERVICE, handle_request );
+  add_message_requested_callback( PACKETIN_FILTER_MANAGEMENT_SERVICE, handle_packetin_filter_request );
 
   start_trema();
 
-  finalize_packetin_match_table();
+  finalize_packetin_filter_table();
 
   return 0;
 }
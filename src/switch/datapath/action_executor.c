@@ -1217,7 +1217,7 @@ execute_action_dec_mpls_ttl( buffer *frame, action *dec_mpls_ttl ) {
   assert( info->l2_mpls_header != NULL );
   uint8_t *ttl = ( uint8_t * ) info->l2_mpls_header + 3;
 
-  if ( !decrement_ttl( ttl ) ) {
+  if ( !decrement_ttl( ttl ) && packet_in_enabled( OFPR_INVALID_TTL ) ) {
     match *match = duplicate_match( dec_mpls_ttl->entry->match );
     packet_info *info = ( packet_info * ) frame->user_data;
     match->in_port.value = info->eth_in_port;
@@ -1260,7 +1260,7 @@ execute_action_dec_nw_ttl( buffer *frame, action *dec_nw_ttl ) {
     return true;
   }
 
-  if ( ttl_exceeded ) {
+  if ( ttl_exceeded && packet_in_enabled( OFPR_INVALID_TTL ) ) {
     match *match = duplicate_match( dec_nw_ttl->entry->match );
     packet_info *info = ( packet_info * ) frame->user_data;
     match->in_port.value = info->eth_in_port;
@@ -1723,7 +1723,8 @@ execute_action_output( buffer *frame, action *output ) {
     switch_port *port = lookup_switch_port( in_port );
     assert( port != NULL );
 
-    if ( ( port->config & OFPPC_NO_PACKET_IN ) == 0 ) {
+    uint8_t reason = table_miss_flow_entry( output->entry ) ? OFPR_NO_MATCH : OFPR_ACTION;
+    if ( ( port->config & OFPPC_NO_PACKET_IN ) == 0 && packet_in_enabled( reason ) ) {
       match *match = duplicate_match( output->entry->match );
       match->in_port.value = info->eth_in_port;
       match->in_port.valid = true;
@@ -1731,7 +1732,7 @@ execute_action_output( buffer *frame, action *output ) {
         match->in_phy_port.value = info->eth_in_phy_port;
         match->in_phy_port.valid = true;
       }
-      if ( table_miss_flow_entry( output->entry ) ) {
+      if ( reason == OFPR_NO_MATCH ) {
         notify_packet_in( OFPR_NO_MATCH, output->entry->table_id, output->entry->cookie, match, frame, MISS_SEND_LEN );
       }
       else {
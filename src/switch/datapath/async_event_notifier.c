@@ -36,12 +36,67 @@ typedef struct {
   struct timespec saved_at;
 } packet_in_buffer;
 
+typedef struct {
+  uint32_t port_no;
+  double tokens;
+  struct timespec updated_at;
+} token_bucket;
+
+typedef struct {
+  uint32_t in_port;
+  uint16_t eth_type;
+  uint16_t vlan_vid;
+  uint8_t eth_dst[ ETH_ADDRLEN ];
+  uint8_t eth_src[ ETH_ADDRLEN ];
+  uint8_t ip_proto;
+  uint8_t icmp_type;
+  uint8_t icmp_code;
+  uint16_t arp_op;
+  uint16_t tp_src;
+  uint16_t tp_dst;
+  uint32_t nw_src;
+  uint32_t nw_dst;
+  uint8_t ipv6_src[ IPV6_ADDRLEN ];
+  uint8_t ipv6_dst[ IPV6_ADDRLEN ];
+} microflow_key;
+
+typedef struct {
+  microflow_key key;
+  struct timespec window_started_at;
+  uint32_t count;
+  uint32_t suppressed;
+} microflow_entry;
+
+
+#define N_MICROFLOW_ENTRIES 4096
+
 
 static event_handlers callbacks = { NULL, NULL, NULL, NULL, NULL, NULL };
+static async_config async_masks;
 static packet_in_buffer *packet_in_buffers = NULL;
 static unsigned int n_buffers = 0;
 static unsigned int next_buffer_id = 0;
 static pthread_mutex_t buffer_mutex;
+static packet_in_limits limits;
+static hash_table *port_buckets = NULL;
+static token_bucket reason_buckets[ OFPR_INVALID_TTL + 1 ];
+static microflow_entry *microflows = NULL;
+static uint64_t n_rate_limited = 0;
+static uint64_t n_coalesced = 0;
+static pthread_mutex_t limit_mutex;
+
+
+static void
+build_default_async_config( async_config *config ) {
+  // Masters and equals get every event; slaves get port status only.
+  config->packet_in_mask[ 0 ] = ( 1U << OFPR_NO_MATCH ) | ( 1U << OFPR_ACTION ) | ( 1U << OFPR_INVALID_TTL );
+  config->packet_in_mask[ 1 ] = 0;
+  config->port_status_mask[ 0 ] = ( 1U << OFPPR_ADD ) | ( 1U << OFPPR_DELETE ) | ( 1U << OFPPR_MODIFY );
+  config->port_status_mask[ 1 ] = config->port_status_mask[ 0 ];
+  config->flow_removed_mask[ 0 ] = ( 1U << OFPRR_IDLE_TIMEOUT ) | ( 1U << OFPRR_HARD_TIMEOUT ) |
+                                   ( 1U << OFPRR_DELETE ) | ( 1U << OFPRR_GROUP_DELETE );
+  config->flow_removed_mask[ 1 ] = 0;
+}
 
 
 OFDPE
@@ -49,6 +104,8 @@ init_async_event_notifier( const unsigned int n_packet_buffers ) {
   assert( packet_in_buffers == NULL );
   assert( next_buffer_id == 0 );
 
+  build_default_async_config( &async_masks );
+
   n_buffers = n_packet_buffers;
 
   if ( n_buffers > 0 ) {
@@ -58,10 +115,34 @@ init_async_event_notifier( const unsigned int n_packet_buffers ) {
 
   init_mutex( &buffer_mutex );
 
+  memset( &limits, 0, sizeof( limits ) );
+  n_rate_limited = 0;
+  n_coalesced = 0;
+  init_mutex( &limit_mutex );
+
   return OFDPE_SUCCESS;
 }
 
 
+static void
+delete_packet_in_limiters() {
+  if ( port_buckets != NULL ) {
+    hash_iterator iter;
+    init_hash_iterator( port_buckets, &iter );
+    hash_entry *entry;
+    while ( ( entry = iterate_hash_next( &iter ) ) != NULL ) {
+      xfree( entry->value );
+    }
+    delete_hash( port_buckets );
+    port_buckets = NULL;
+  }
+  if ( microflows != NULL ) {
+    xfree( microflows );
+    microflows = NULL;
+  }
+}
+
+
 OFDPE
 finalize_async_event_notifier() {
   next_buffer_id = 0;
@@ -71,6 +152,7 @@ finalize_async_event_notifier() {
   callbacks.flow_removed_user_data = NULL;
   callbacks.port_status = NULL;
   callbacks.port_status_user_data = NULL;
+  build_default_async_config( &async_masks );
 
   if ( packet_in_buffers != NULL ) {
     if ( !lock_mutex( &buffer_mutex ) ) {
@@ -94,16 +176,43 @@ finalize_async_event_notifier() {
 
   finalize_mutex( &buffer_mutex );
 
+  delete_packet_in_limiters();
+  memset( &limits, 0, sizeof( limits ) );
+  finalize_mutex( &limit_mutex );
+
   return OFDPE_SUCCESS;
 }
 
 
+/*
+ * The switch does not handle role requests and always acts as an equal,
+ * so only the master/equal masks apply. The masks are written by the
+ * protocol thread and read here by the datapath thread.
+ */
+static bool
+async_event_enabled( const uint32_t *mask, const uint8_t reason ) {
+  return ( __atomic_load_n( mask, __ATOMIC_RELAXED ) & ( 1U << reason ) ) != 0;
+}
+
+
+bool
+packet_in_enabled( const uint8_t reason ) {
+  return callbacks.packet_in != NULL && async_event_enabled( &async_masks.packet_in_mask[ 0 ], reason );
+}
+
+
+bool
+flow_removed_enabled( const uint8_t reason ) {
+  return callbacks.flow_removed != NULL && async_event_enabled( &async_masks.flow_removed_mask[ 0 ], reason );
+}
+
+
 void
 notify_port_status( const switch_port *port, const uint8_t reason ) {
   assert( port != NULL );
   assert( reason <= OFPPR_MODIFY );
 
-  if ( callbacks.port_status == NULL ) {
+  if ( callbacks.port_status == NULL || !async_event_enabled( &async_masks.port_status_mask[ 0 ], reason ) ) {
     return;
   }
 
@@ -176,6 +285,158 @@ save_packet( const buffer *packet ) {
 }
 
 
+static double
+elapsed_sec( const struct timespec *since, const struct timespec *now ) {
+  struct timespec diff = { 0, 0 };
+  timespec_diff( *since, *now, &diff );
+  return ( double ) diff.tv_sec + ( double ) diff.tv_nsec / 1000000000.0;
+}
+
+
+static void
+refill_bucket( token_bucket *bucket, const uint32_t rate, const uint32_t burst, const struct timespec *now ) {
+  bucket->tokens += elapsed_sec( &bucket->updated_at, now ) * rate;
+  if ( bucket->tokens > burst ) {
+    bucket->tokens = burst;
+  }
+  bucket->updated_at = *now;
+}
+
+
+static token_bucket *
+lookup_port_bucket( const uint32_t port_no, const struct timespec *now ) {
+  token_bucket *bucket = lookup_hash_entry( port_buckets, &port_no );
+  if ( bucket == NULL ) {
+    bucket = xmalloc( sizeof( token_bucket ) );
+    bucket->port_no = port_no;
+    bucket->tokens = limits.port_burst;
+    bucket->updated_at = *now;
+    insert_hash_entry( port_buckets, &bucket->port_no, bucket );
+  }
+
+  return bucket;
+}
+
+
+static void
+build_microflow_key( microflow_key *key, const match *match ) {
+  memset( key, 0, sizeof( microflow_key ) );
+
+#define COPY_FIELD( dst, src ) if ( match->src.valid ) key->dst = match->src.value
+  COPY_FIELD( in_port, in_port );
+  COPY_FIELD( eth_type, eth_type );
+  COPY_FIELD( vlan_vid, vlan_vid );
+  COPY_FIELD( ip_proto, ip_proto );
+  COPY_FIELD( icmp_type, icmpv4_type );
+  COPY_FIELD( icmp_code, icmpv4_code );
+  COPY_FIELD( icmp_type, icmpv6_type );
+  COPY_FIELD( icmp_code, icmpv6_code );
+  COPY_FIELD( arp_op, arp_op );
+  COPY_FIELD( tp_src, tcp_src );
+  COPY_FIELD( tp_dst, tcp_dst );
+  COPY_FIELD( tp_src, udp_src );
+  COPY_FIELD( tp_dst, udp_dst );
+  COPY_FIELD( tp_src, sctp_src );
+  COPY_FIELD( tp_dst, sctp_dst );
+  COPY_FIELD( nw_src, ipv4_src );
+  COPY_FIELD( nw_dst, ipv4_dst );
+  COPY_FIELD( nw_src, arp_spa );
+  COPY_FIELD( nw_dst, arp_tpa );
+  for ( int i = 0; i < ETH_ADDRLEN; i++ ) {
+    COPY_FIELD( eth_dst[ i ], eth_dst[ i ] );
+    COPY_FIELD( eth_src[ i ], eth_src[ i ] );
+  }
+  for ( int i = 0; i < IPV6_ADDRLEN; i++ ) {
+    COPY_FIELD( ipv6_src[ i ], ipv6_src[ i ] );
+    COPY_FIELD( ipv6_dst[ i ], ipv6_dst[ i ] );
+  }
+#undef COPY_FIELD
+}
+
+
+static microflow_entry *
+lookup_microflow( const match *match, const struct timespec *now ) {
+  microflow_key key;
+  build_microflow_key( &key, match );
+
+  // Direct-mapped: a colliding flow simply takes over the slot.
+  microflow_entry *entry = &microflows[ hash_core( &key, sizeof( key ) ) % N_MICROFLOW_ENTRIES ];
+  bool same_flow = memcmp( &entry->key, &key, sizeof( key ) ) == 0;
+  if ( same_flow && elapsed_sec( &entry->window_started_at, now ) * 1000 < limits.coalesce_window_msec ) {
+    return entry;
+  }
+
+  if ( same_flow && entry->suppressed > 0 ) {
+    debug( "%u packet-ins coalesced ( in_port = %u, eth_type = %#x, ip_proto = %u ).",
+           entry->suppressed, key.in_port, key.eth_type, key.ip_proto );
+  }
+  entry->key = key;
+  entry->window_started_at = *now;
+  entry->count = 0;
+  entry->suppressed = 0;
+
+  return entry;
+}
+
+
+static bool
+admit_packet_in( const uint8_t reason, const match *match ) {
+  if ( limits.port_rate == 0 && limits.reason_rate == 0 && limits.coalesce_count == 0 ) {
+    return true;
+  }
+
+  if ( !lock_mutex( &limit_mutex ) ) {
+    return true;
+  }
+
+  struct timespec now = { 0, 0 };
+  time_now( &now );
+
+  microflow_entry *flow = NULL;
+  if ( limits.coalesce_count > 0 ) {
+    flow = lookup_microflow( match, &now );
+    if ( flow->count >= limits.coalesce_count ) {
+      flow->suppressed++;
+      n_coalesced++;
+      unlock_mutex( &limit_mutex );
+      return false;
+    }
+  }
+
+  token_bucket *port_bucket = NULL;
+  if ( limits.port_rate > 0 && match->in_port.valid ) {
+    port_bucket = lookup_port_bucket( match->in_port.value, &now );
+    refill_bucket( port_bucket, limits.port_rate, limits.port_burst, &now );
+  }
+  token_bucket *reason_bucket = NULL;
+  if ( limits.reason_rate > 0 ) {
+    reason_bucket = &reason_buckets[ reason ];
+    refill_bucket( reason_bucket, limits.reason_rate, limits.reason_burst, &now );
+  }
+
+  // Take tokens only when every bucket has one, so a packet-in dropped by
+  // one limit does not use up the budget of the other.
+  if ( ( port_bucket != NULL && port_bucket->tokens < 1 ) || ( reason_bucket != NULL && reason_bucket->tokens < 1 ) ) {
+    n_rate_limited++;
+    unlock_mutex( &limit_mutex );
+    return false;
+  }
+  if ( port_bucket != NULL ) {
+    port_bucket->tokens -= 1;
+  }
+  if ( reason_bucket != NULL ) {
+    reason_bucket->tokens -= 1;
+  }
+  if ( flow != NULL ) {
+    flow->count++;
+  }
+
+  unlock_mutex( &limit_mutex );
+
+  return true;
+}
+
+
 void
 notify_packet_in( const uint8_t reason, const uint8_t table_id, const uint64_t cookie, const match *match,
                   buffer *packet, const uint16_t max_len ) {
@@ -184,7 +445,11 @@ notify_packet_in( const uint8_t reason, const uint8_t table_id, const uint64_t c
   assert( match != NULL );
   assert( packet != NULL );
 
-  if ( callbacks.packet_in == NULL ) {
+  if ( !packet_in_enabled( reason ) ) {
+    return;
+  }
+
+  if ( !admit_packet_in( reason, match ) ) {
     return;
   }
 
@@ -211,7 +476,7 @@ notify_flow_removed( const uint8_t reason, const flow_entry *entry ) {
   assert( entry != NULL );
   assert( entry->match != NULL );
 
-  if ( callbacks.flow_removed == NULL ) {
+  if ( !flow_removed_enabled( reason ) ) {
     return;
   }
 
@@ -273,6 +538,44 @@ set_async_event_handler( async_event_type type, async_event_handler handler, voi
 }
 
 
+OFDPE
+get_async_config( async_config *config ) {
+  assert( config != NULL );
+
+  for ( int i = 0; i < 2; i++ ) {
+    config->packet_in_mask[ i ] = __atomic_load_n( &async_masks.packet_in_mask[ i ], __ATOMIC_RELAXED );
+    config->port_status_mask[ i ] = __atomic_load_n( &async_masks.port_status_mask[ i ], __ATOMIC_RELAXED );
+    config->flow_removed_mask[ i ] = __atomic_load_n( &async_masks.flow_removed_mask[ i ], __ATOMIC_RELAXED );
+  }
+
+  return OFDPE_SUCCESS;
+}
+
+
+OFDPE
+set_async_config( const async_config *config ) {
+  assert( config != NULL );
+
+  for ( int i = 0; i < 2; i++ ) {
+    __atomic_store_n( &async_masks.packet_in_mask[ i ], config->packet_in_mask[ i ], __ATOMIC_RELAXED );
+    __atomic_store_n( &async_masks.port_status_mask[ i ], config->port_status_mask[ i ], __ATOMIC_RELAXED );
+    __atomic_store_n( &async_masks.flow_removed_mask[ i ], config->flow_removed_mask[ i ], __ATOMIC_RELAXED );
+  }
+
+  return OFDPE_SUCCESS;
+}
+
+
+// Masks set by a controller do not apply to the next connection.
+OFDPE
+reset_async_config( void ) {
+  async_config config;
+  build_default_async_config( &config );
+
+  return set_async_config( &config );
+}
+
+
 buffer *
 get_packet_from_packet_in_buffer( const uint32_t buffer_id ) {
   if ( buffer_id == UINT32_MAX || buffer_id >= n_buffers ) {
@@ -288,6 +591,61 @@ get_packet_from_packet_in_buffer( const uint32_t buffer_id ) {
 }
 
 
+OFDPE
+set_packet_in_limits( const packet_in_limits *new_limits ) {
+  assert( new_limits != NULL );
+
+  if ( !lock_mutex( &limit_mutex ) ) {
+    return ERROR_LOCK;
+  }
+
+  delete_packet_in_limiters();
+
+  limits = *new_limits;
+  if ( limits.port_burst == 0 ) {
+    limits.port_burst = limits.port_rate;
+  }
+  if ( limits.reason_burst == 0 ) {
+    limits.reason_burst = limits.reason_rate;
+  }
+  if ( limits.coalesce_window_msec == 0 ) {
+    limits.coalesce_window_msec = 1000;
+  }
+
+  struct timespec now = { 0, 0 };
+  time_now( &now );
+  if ( limits.port_rate > 0 ) {
+    port_buckets = create_hash( compare_uint32, hash_uint32 );
+  }
+  for ( int i = 0; i <= OFPR_INVALID_TTL; i++ ) {
+    reason_buckets[ i ].tokens = limits.reason_burst;
+    reason_buckets[ i ].updated_at = now;
+  }
+  if ( limits.coalesce_count > 0 ) {
+    microflows = xmalloc( sizeof( microflow_entry ) * N_MICROFLOW_ENTRIES );
+    memset( microflows, 0, sizeof( microflow_entry ) * N_MICROFLOW_ENTRIES );
+  }
+
+  if ( !unlock_mutex( &limit_mutex ) ) {
+    return ERROR_UNLOCK;
+  }
+
+  return OFDPE_SUCCESS;
+}
+
+
+void
+get_suppressed_packet_in_counts( uint64_t *rate_limited, uint64_t *coalesced ) {
+  assert( rate_limited != NULL );
+  assert( coalesced != NULL );
+
+  lock_mutex( &limit_mutex );
+  *rate_limited = n_rate_limited;
+  *coalesced = n_coalesced;
+  unlock_mutex( &limit_mutex );
+}
+
+
 /*
  * Local variables:
  * c-basic-offset: 2
@@ -66,6 +66,31 @@ typedef struct {
 
 typedef void ( *async_event_handler )( void *data, void *user_data );
 
+/*
+ * Bitmaps of the event reasons to send, indexed by controller role:
+ * [ 0 ] for master or equal and [ 1 ] for slave.
+ */
+typedef struct {
+  uint32_t packet_in_mask[ 2 ];
+  uint32_t port_status_mask[ 2 ];
+  uint32_t flow_removed_mask[ 2 ];
+} async_config;
+
+/*
+ * Packet-in throttling. Rates are packet-ins per second and zero disables
+ * the limit; a zero burst defaults to the rate. When coalesce_count is
+ * non-zero, only the first coalesce_count packet-ins of each microflow are
+ * sent within a coalesce_window_msec window.
+ */
+typedef struct {
+  uint32_t port_rate;
+  uint32_t port_burst;
+  uint32_t reason_rate;
+  uint32_t reason_burst;
+  uint32_t coalesce_count;
+  uint32_t coalesce_window_msec;
+} packet_in_limits;
+
 
 OFDPE init_async_event_notifier( const unsigned int n_packet_buffers );
 OFDPE finalize_async_event_notifier( void );
@@ -74,7 +99,14 @@ void notify_packet_in( const uint8_t reason, const uint8_t table_id, const uint6
                        buffer *packet, const uint16_t max_len );
 void notify_flow_removed( const uint8_t reason, const flow_entry *entry );
 OFDPE set_async_event_handler( async_event_type type, async_event_handler handler, void *user_data );
+OFDPE get_async_config( async_config *config );
+OFDPE set_async_config( const async_config *config );
+OFDPE reset_async_config( void );
+bool packet_in_enabled( const uint8_t reason );
+bool flow_removed_enabled( const uint8_t reason );
 buffer *get_packet_from_packet_in_buffer( const uint32_t buffer_id );
+OFDPE set_packet_in_limits( const packet_in_limits *limits );
+void get_suppressed_packet_in_counts( uint64_t *rate_limited, uint64_t *coalesced );
 
 
 #endif // ASYNC_EVENT_NOTIFIER_H
@@ -40,6 +40,7 @@ typedef struct _flow_entry {
   instruction_set *instructions;
   struct timespec created_at;
   struct timespec last_seen;
+  time_t expires_at; // the timing wheel slot deadline. zero if not scheduled
 } flow_entry;
 
 
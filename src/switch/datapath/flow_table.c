@@ -20,27 +20,53 @@
 #include "async_event_notifier.h"
 #include "flow_table.h"
 #include "group_entry.h"
+#include "group_table.h"
 #include "table_manager.h"
 
 
-typedef void ( *flow_entry_handler )( flow_entry *entry, void *user_data );
+enum {
+  N_EXPIRY_SLOTS = 1024,
+};
+
+
+typedef struct {
+  uint64_t key; // cookie, output port number or output group id
+  list_element *entries;
+} flow_index_bucket;
 
 
 static flow_table flow_tables[ N_FLOW_TABLES ];
+static list_element *flow_stats_cursors = NULL;
+// A hashed timing wheel of flow entries with timeouts, keyed by deadline in seconds.
+static list_element *expiry_slots[ N_EXPIRY_SLOTS ];
+static time_t expiry_clock = 0; // the last second processed by expire_flow_entries()
 static const time_t AGING_INTERVAL = 1;
+static const uint32_t FLOW_STATS_SCAN_MAX = 1024; // flow entries examined per pipeline lock
+
+
+static void expire_flow_entries( void *user_data );
 
 
 void
 init_flow_tables( const uint32_t max_flow_entries ) {
   memset( &flow_tables, 0, sizeof( flow_table ) * N_FLOW_TABLES );
+  memset( expiry_slots, 0, sizeof( expiry_slots ) );
+  struct timespec now = { 0, 0 };
+  time_now( &now );
+  expiry_clock = now.tv_sec;
+
   for ( uint8_t i = 0; i <= FLOW_TABLE_ID_MAX; i++ ) {
     init_flow_table( i, max_flow_entries );
   }
+
+  add_periodic_event_callback_safe( AGING_INTERVAL, expire_flow_entries, NULL );
 }
 
 
 void
 finalize_flow_tables() {
+  delete_timer_event_safe( expire_flow_entries, NULL );
+
   for ( uint8_t i = 0; i <= FLOW_TABLE_ID_MAX; i++ ) {
     finalize_flow_table( i );
   }
@@ -202,25 +228,283 @@ get_matched_count( const uint8_t table_id ) {
 }
 
 
+static void
+update_flow_entry_duration( flow_entry *entry, const struct timespec *now ) {
+  assert( entry != NULL );
+  assert( now != NULL );
+
+  struct timespec diff = { 0, 0 };
+  timespec_diff( entry->created_at, *now, &diff );
+  entry->duration_sec = ( uint32_t ) diff.tv_sec;
+  entry->duration_nsec = ( uint32_t ) diff.tv_nsec;
+}
+
+
 static void
 flow_deleted( flow_entry *entry, uint8_t reason ) {
   assert( entry != NULL );
 
-  if ( ( entry->flags & OFPFF_SEND_FLOW_REM ) == 0 ) {
+  if ( ( entry->flags & OFPFF_SEND_FLOW_REM ) == 0 || !flow_removed_enabled( reason ) ) {
     return;
   }
 
+  struct timespec now = { 0, 0 };
+  time_now( &now );
+  update_flow_entry_duration( entry, &now );
+
   notify_flow_removed( reason, entry );
 }
 
 
+/*
+ * Returns the earliest second at which a flow entry may expire, or zero if
+ * it never expires. An idle deadline is only a lower bound since last_seen
+ * may move forward before the deadline is reached.
+ */
+static time_t
+flow_entry_deadline( const flow_entry *entry ) {
+  assert( entry != NULL );
+
+  time_t deadline = 0;
+  if ( entry->hard_timeout > 0 ) {
+    deadline = entry->created_at.tv_sec + entry->hard_timeout;
+  }
+  if ( entry->idle_timeout > 0 ) {
+    time_t idle_deadline = entry->last_seen.tv_sec + entry->idle_timeout;
+    if ( deadline == 0 || idle_deadline < deadline ) {
+      deadline = idle_deadline;
+    }
+  }
+
+  return deadline;
+}
+
+
+static void
+schedule_flow_entry_expiry( flow_entry *entry ) {
+  assert( entry != NULL );
+  assert( entry->expires_at == 0 );
+
+  time_t deadline = flow_entry_deadline( entry );
+  if ( deadline == 0 ) {
+    return;
+  }
+  if ( deadline <= expiry_clock ) {
+    deadline = expiry_clock + 1;
+  }
+
+  entry->expires_at = deadline;
+  insert_in_front( &expiry_slots[ deadline % N_EXPIRY_SLOTS ], entry );
+}
+
+
+static void
+cancel_flow_entry_expiry( flow_entry *entry ) {
+  assert( entry != NULL );
+
+  if ( entry->expires_at == 0 ) {
+    return;
+  }
+
+  list_element **slot = &expiry_slots[ entry->expires_at % N_EXPIRY_SLOTS ];
+  if ( *slot != NULL ) {
+    delete_element( slot, entry );
+  }
+  entry->expires_at = 0;
+}
+
+
+static void
+seek_flow_stats_cursor( flow_stats_cursor *cursor, list_element *element ) {
+  assert( cursor != NULL );
+
+  while ( element == NULL ) {
+    if ( cursor->table_id != FLOW_TABLE_ALL || cursor->current_table_id >= FLOW_TABLE_ID_MAX ) {
+      cursor->next = NULL;
+      cursor->done = true;
+      return;
+    }
+    cursor->current_table_id++;
+    if ( flow_tables[ cursor->current_table_id ].initialized ) {
+      element = flow_tables[ cursor->current_table_id ].entries;
+    }
+  }
+
+  cursor->next = element;
+}
+
+
+static void
+move_flow_stats_cursors( const flow_entry *entry ) {
+  for ( list_element *e = flow_stats_cursors; e != NULL; e = e->next ) {
+    flow_stats_cursor *cursor = e->data;
+    // A cursor must never refer to a list element that is about to be freed.
+    if ( cursor->next != NULL && cursor->next->data == entry ) {
+      seek_flow_stats_cursor( cursor, cursor->next->next );
+    }
+  }
+}
+
+
+static void
+skip_flow_stats_cursors( const uint8_t table_id ) {
+  for ( list_element *e = flow_stats_cursors; e != NULL; e = e->next ) {
+    flow_stats_cursor *cursor = e->data;
+    if ( !cursor->done && cursor->current_table_id == table_id ) {
+      seek_flow_stats_cursor( cursor, NULL );
+    }
+  }
+}
+
+
+static void
+add_to_flow_index( hash_table *index, const uint64_t key, flow_entry *entry ) {
+  assert( index != NULL );
+  assert( entry != NULL );
+
+  flow_index_bucket *bucket = lookup_hash_entry( index, &key );
+  if ( bucket == NULL ) {
+    bucket = xmalloc( sizeof( flow_index_bucket ) );
+    bucket->key = key;
+    create_list( &bucket->entries );
+    insert_hash_entry( index, &bucket->key, bucket );
+  }
+  else if ( bucket->entries != NULL && bucket->entries->data == entry ) {
+    return; // e.g. outputs to the same port twice
+  }
+
+  insert_in_front( &bucket->entries, entry );
+}
+
+
+static void
+delete_from_flow_index( hash_table *index, const uint64_t key, flow_entry *entry ) {
+  assert( index != NULL );
+  assert( entry != NULL );
+
+  flow_index_bucket *bucket = lookup_hash_entry( index, &key );
+  if ( bucket == NULL ) {
+    return;
+  }
+
+  delete_element( &bucket->entries, entry );
+  if ( bucket->entries == NULL ) {
+    delete_hash_entry( index, &bucket->key );
+    xfree( bucket );
+  }
+}
+
+
+static list_element *
+lookup_flow_index( hash_table *index, const uint64_t key ) {
+  assert( index != NULL );
+
+  flow_index_bucket *bucket = lookup_hash_entry( index, &key );
+  if ( bucket == NULL ) {
+    return NULL;
+  }
+
+  return bucket->entries;
+}
+
+
+static void
+delete_flow_index( hash_table *index ) {
+  if ( index == NULL ) {
+    return;
+  }
+
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( index, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    flow_index_bucket *bucket = e->value;
+    delete_list( bucket->entries );
+    xfree( bucket );
+  }
+  delete_hash( index );
+}
+
+
+static void
+update_output_indexes( flow_table *table, flow_entry *entry, const instruction *instruction, const bool add ) {
+  assert( table != NULL );
+  assert( entry != NULL );
+
+  if ( instruction == NULL || instruction->actions == NULL ) {
+    return;
+  }
+
+  for ( dlist_element *e = get_first_element( instruction->actions ); e != NULL; e = e->next ) {
+    action *action = e->data;
+    if ( action == NULL ) {
+      continue;
+    }
+    hash_table *index = NULL;
+    uint64_t key = 0;
+    if ( action->type == OFPAT_OUTPUT ) {
+      index = table->out_port_index;
+      key = action->port;
+    }
+    else if ( action->type == OFPAT_GROUP ) {
+      index = table->out_group_index;
+      key = action->group_id;
+    }
+    else {
+      continue;
+    }
+    if ( add ) {
+      add_to_flow_index( index, key, entry );
+    }
+    else {
+      delete_from_flow_index( index, key, entry );
+    }
+  }
+}
+
+
+static void
+index_instructions( flow_table *table, flow_entry *entry, const bool add ) {
+  assert( entry != NULL );
+
+  if ( entry->instructions == NULL ) {
+    return;
+  }
+  update_output_indexes( table, entry, entry->instructions->write_actions, add );
+  update_output_indexes( table, entry, entry->instructions->apply_actions, add );
+}
+
+
+static void
+index_flow_entry( flow_table *table, flow_entry *entry ) {
+  assert( table != NULL );
+  assert( entry != NULL );
+
+  add_to_flow_index( table->cookie_index, entry->cookie, entry );
+  index_instructions( table, entry, true );
+}
+
+
+static void
+unindex_flow_entry( flow_table *table, flow_entry *entry ) {
+  assert( table != NULL );
+  assert( entry != NULL );
+
+  delete_from_flow_index( table->cookie_index, entry->cookie, entry );
+  index_instructions( table, entry, false );
+}
+
+
 static void
 delete_flow_entry_from_table( flow_table *table, flow_entry *entry, uint8_t reason, bool notify ) {
   assert( table != NULL );
   assert( entry != NULL );
 
+  move_flow_stats_cursors( entry );
   bool ret = delete_element( &table->entries, entry );
   if ( ret ) {
+    cancel_flow_entry_expiry( entry );
+    unindex_flow_entry( table, entry );
     decrement_active_count( table->features.table_id );
     if ( notify ) {
       flow_deleted( entry, reason );
@@ -232,59 +516,44 @@ delete_flow_entry_from_table( flow_table *table, flow_entry *entry, uint8_t reas
 
 
 static void
-foreach_flow_entry( const uint8_t table_id, flow_entry_handler callback, void *user_data ) {
-  assert( valid_table_id( table_id ) );
-  assert( callback != NULL );
+expire_flow_entry( flow_entry *entry, const struct timespec *now ) {
+  assert( entry != NULL );
+  assert( now != NULL );
 
-  flow_table *table = get_flow_table( table_id );
+  flow_table *table = get_flow_table( entry->table_id );
   assert( table != NULL );
 
-  list_element *e = table->entries;
-  while ( e != NULL ) {
-    list_element *next = e->next; // Current element may be deleted inside the callback function.
-    flow_entry *entry = e->data;
-    assert( entry != NULL );
-    callback( entry, user_data );
-    e = next;
-  }
-}
-
-
-static void
-age_flow_entries_walker( flow_entry *entry, void *user_data ) {
-  assert( entry != NULL );
-  assert( user_data != NULL );
-
-  struct timespec *now = user_data;
   struct timespec diff = { 0, 0 };
-
-  timespec_diff( entry->created_at, *now, &diff );
-  entry->duration_sec = ( uint32_t ) diff.tv_sec;
-  entry->duration_nsec = ( uint32_t ) diff.tv_nsec;
-
   if ( entry->hard_timeout > 0 ) {
+    timespec_diff( entry->created_at, *now, &diff );
     if ( diff.tv_sec >= entry->hard_timeout ) {
-      flow_table *table = get_flow_table( entry->table_id );
       delete_flow_entry_from_table( table, entry, OFPRR_HARD_TIMEOUT, true );
+      return;
     }
   }
 
   if ( entry->idle_timeout > 0 ) {
     timespec_diff( entry->last_seen, *now, &diff );
     if ( diff.tv_sec >= entry->idle_timeout ) {
-      flow_table *table = get_flow_table( entry->table_id );
       delete_flow_entry_from_table( table, entry, OFPRR_IDLE_TIMEOUT, true );
+      return;
     }
   }
 
+  // Not expired yet ( e.g. the entry has been hit since it was scheduled ).
+  cancel_flow_entry_expiry( entry );
+  schedule_flow_entry_expiry( entry );
 }
 
 
+/*
+ * Processes the timing wheel slots for every second elapsed since the
+ * previous run. Only flow entries whose deadline has come are examined, so
+ * the cost does not depend on the number of flow entries without timeouts.
+ */
 static void
-age_flow_entries( void *user_data ) {
-  const uint8_t table_id = *( uint8_t * ) user_data;
-
-  assert( valid_table_id( table_id ) );
+expire_flow_entries( void *user_data ) {
+  UNUSED( user_data );
 
   if ( !lock_pipeline() ) {
     return;
@@ -293,7 +562,27 @@ age_flow_entries( void *user_data ) {
   struct timespec now = { 0, 0 };
   time_now( &now );
 
-  foreach_flow_entry( table_id, age_flow_entries_walker, &now );
+  time_t from = expiry_clock + 1;
+  if ( now.tv_sec - from >= N_EXPIRY_SLOTS ) {
+    from = now.tv_sec - N_EXPIRY_SLOTS + 1;
+  }
+
+  for ( time_t t = from; t <= now.tv_sec; t++ ) {
+    expiry_clock = t;
+    list_element *e = expiry_slots[ t % N_EXPIRY_SLOTS ];
+    while ( e != NULL ) {
+      list_element *next = e->next; // Current element may be deleted or moved below.
+      flow_entry *entry = e->data;
+      assert( entry != NULL );
+      if ( entry->expires_at <= now.tv_sec ) {
+        expire_flow_entry( entry, &now );
+      }
+      e = next;
+    }
+  }
+  if ( expiry_clock < now.tv_sec ) {
+    expiry_clock = now.tv_sec;
+  }
 
   if ( !unlock_pipeline() ) {
     return;
@@ -320,14 +609,15 @@ init_flow_table( const uint8_t table_id, const uint32_t max_flow_entries ) {
   table->counters.lookup_count = 0;
   table->counters.matched_count = 0;
   create_list( &table->entries );
+  table->cookie_index = create_hash( compare_datapath_id, hash_datapath_id );
+  table->out_port_index = create_hash( compare_datapath_id, hash_datapath_id );
+  table->out_group_index = create_hash( compare_datapath_id, hash_datapath_id );
   table->initialized = true;
 
   set_default_flow_table_features( table_id, &table->features );
 
   table->features.max_entries = max_flow_entries;
 
-  add_periodic_event_callback_safe( AGING_INTERVAL, age_flow_entries, ( void * ) &table->features.table_id );
-
   return OFDPE_SUCCESS;
 }
 
@@ -344,15 +634,19 @@ finalize_flow_table( const uint8_t table_id ) {
     return OFDPE_FAILED;
   }
 
-  delete_timer_event_safe( age_flow_entries, &table->features.table_id );
+  skip_flow_stats_cursors( table_id );
 
   for ( list_element *e = table->entries; e != NULL; e = e->next ) {
     flow_entry *entry = e->data;
     if ( entry != NULL ) {
+      cancel_flow_entry_expiry( entry );
       free_flow_entry( entry );
     }
   }
   delete_list( table->entries );
+  delete_flow_index( table->cookie_index );
+  delete_flow_index( table->out_port_index );
+  delete_flow_index( table->out_group_index );
 
   memset( table, 0, sizeof( flow_table ) );
   table->initialized = false;
@@ -533,94 +827,643 @@ lookup_flow_entry_strict( const uint8_t table_id, const match *match, const uint
     return NULL;
   }
 
-  return entry;
+  return entry;
+}
+
+
+// Inserts an entry after the run of entries that have the same or a higher
+// priority. The scan starts after *position ( or from the head if NULL ) and
+// *position is advanced to the last entry that has a higher priority, so
+// that a batch sorted in descending priority order is merged in one pass.
+// If new_element is not NULL, it is linked instead of allocating a new one.
+static OFDPE
+insert_flow_entry_from( flow_table *table, flow_entry *entry, const uint16_t flags, list_element **position,
+                        list_element *new_element ) {
+  assert( table != NULL );
+  assert( entry != NULL );
+  assert( position != NULL );
+
+  list_element *element = *position != NULL ? ( *position )->next : table->entries;
+  while ( element != NULL && ( ( flow_entry * ) element->data )->priority > entry->priority ) {
+    *position = element;
+    element = element->next;
+  }
+
+  list_element *last = *position;
+  while( element != NULL ) {
+    list_element *next = element->next;
+    flow_entry *e = element->data;
+    assert( e != NULL );
+    if ( e->priority < entry->priority ) {
+      break;
+    }
+    if ( ( flags & OFPFF_CHECK_OVERLAP ) != 0 && compare_match( e->match, entry->match ) ) {
+      return ERROR_OFDPE_FLOW_MOD_FAILED_OVERLAP;
+    }
+    if ( compare_match_strict( e->match, entry->match ) ) {
+      if ( ( flags & OFPFF_RESET_COUNTS ) != 0 ) {
+        entry->byte_count = e->byte_count;
+        entry->packet_count = e->packet_count;
+      }
+      delete_flow_entry_from_table( table, e, 0, false );
+    }
+    else {
+      last = element;
+    }
+    element = next;
+  }
+
+  if ( new_element == NULL ) {
+    new_element = xmalloc( sizeof( list_element ) );
+  }
+  new_element->data = entry;
+  if ( last == NULL ) {
+    new_element->next = table->entries;
+    table->entries = new_element;
+  }
+  else {
+    new_element->next = last->next;
+    last->next = new_element;
+  }
+
+  entry->table_id = table->features.table_id;
+  increment_active_count( table->features.table_id );
+  index_flow_entry( table, entry );
+  schedule_flow_entry_expiry( entry );
+
+  return OFDPE_SUCCESS;
+}
+
+
+static OFDPE
+insert_flow_entry( flow_table *table, flow_entry *entry, const uint16_t flags ) {
+  list_element *position = NULL;
+  return insert_flow_entry_from( table, entry, flags, &position, NULL );
+}
+
+
+OFDPE
+add_flow_entry( const uint8_t table_id, flow_entry *entry, const uint16_t flags ) {
+  if ( !valid_table_id( table_id ) ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+  }
+  if ( entry == NULL ) {
+    return ERROR_INVALID_PARAMETER;
+  }
+
+  if ( !lock_pipeline() ) {
+    return ERROR_LOCK;
+  }
+
+  flow_table *table = get_flow_table( table_id );
+  if ( table == NULL ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+  }
+
+  if ( table->features.max_entries <= get_active_count( table_id ) ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_TABLE_FULL;
+  }
+
+  OFDPE ret = validate_instruction_set( entry->instructions, table->features.metadata_write );
+  if ( ret == OFDPE_SUCCESS ) {
+    ret = insert_flow_entry( table, entry, flags );
+    if ( ret == OFDPE_SUCCESS ) {
+      increment_reference_counters_in_groups( entry->instructions );
+    }
+  }
+
+  if ( !unlock_pipeline() ) {
+    return ERROR_UNLOCK;
+  }
+
+  return ret;
+}
+
+
+static int
+compare_flow_entry_additions( const void *x, const void *y ) {
+  const flow_entry_addition *a = *( const flow_entry_addition * const * ) x;
+  const flow_entry_addition *b = *( const flow_entry_addition * const * ) y;
+
+  if ( a->table_id != b->table_id ) {
+    return a->table_id < b->table_id ? -1 : 1;
+  }
+  uint16_t a_priority = a->entry != NULL ? a->entry->priority : 0;
+  uint16_t b_priority = b->entry != NULL ? b->entry->priority : 0;
+  if ( a_priority != b_priority ) {
+    return a_priority > b_priority ? -1 : 1;
+  }
+  // keep arrival order among entries with the same priority
+  return a < b ? -1 : ( a > b ? 1 : 0 );
+}
+
+
+static OFDPE
+add_flow_entry_in_batch( flow_entry_addition *addition, flow_table **table, list_element **position ) {
+  if ( !valid_table_id( addition->table_id ) ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+  }
+  if ( addition->entry == NULL ) {
+    return ERROR_INVALID_PARAMETER;
+  }
+
+  flow_table *current = get_flow_table( addition->table_id );
+  if ( current == NULL ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+  }
+  if ( current != *table ) {
+    *table = current;
+    *position = NULL;
+  }
+
+  if ( current->features.max_entries <= get_active_count( addition->table_id ) ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_TABLE_FULL;
+  }
+
+  OFDPE ret = validate_instruction_set( addition->entry->instructions, current->features.metadata_write );
+  if ( ret != OFDPE_SUCCESS ) {
+    return ret;
+  }
+
+  ret = insert_flow_entry_from( current, addition->entry, addition->flags, position, NULL );
+  if ( ret == OFDPE_SUCCESS ) {
+    increment_reference_counters_in_groups( addition->entry->instructions );
+  }
+
+  return ret;
+}
+
+
+// Adds a batch of flow entries in a single pipeline critical section.
+// The batch is merged into each table in descending priority order so
+// that every table is walked only once. The result of each addition is
+// stored in its result field and entries that are not added are left
+// to the caller, as add_flow_entry() does.
+OFDPE
+add_flow_entries( flow_entry_addition *additions, const uint32_t n_additions ) {
+  if ( additions == NULL && n_additions > 0 ) {
+    return ERROR_INVALID_PARAMETER;
+  }
+  if ( n_additions == 0 ) {
+    return OFDPE_SUCCESS;
+  }
+
+  flow_entry_addition **sorted = xmalloc( sizeof( flow_entry_addition * ) * n_additions );
+  for ( uint32_t i = 0; i < n_additions; i++ ) {
+    sorted[ i ] = &additions[ i ];
+  }
+  qsort( sorted, n_additions, sizeof( flow_entry_addition * ), compare_flow_entry_additions );
+
+  if ( !lock_pipeline() ) {
+    xfree( sorted );
+    return ERROR_LOCK;
+  }
+
+  flow_table *table = NULL;
+  list_element *position = NULL;
+  for ( uint32_t i = 0; i < n_additions; i++ ) {
+    sorted[ i ]->result = add_flow_entry_in_batch( sorted[ i ], &table, &position );
+  }
+
+  if ( !unlock_pipeline() ) {
+    xfree( sorted );
+    return ERROR_UNLOCK;
+  }
+
+  xfree( sorted );
+
+  return OFDPE_SUCCESS;
+}
+
+
+flow_entry_bundle *
+create_flow_entry_bundle( void ) {
+  flow_entry_bundle *bundle = xmalloc( sizeof( flow_entry_bundle ) );
+  bundle->additions = NULL;
+  bundle->n_additions = 0;
+
+  return bundle;
+}
+
+
+static void
+delete_staged_flow_entries( flow_entry_bundle *bundle, const bool free_entries ) {
+  for ( list_element *e = bundle->additions; e != NULL; e = e->next ) {
+    flow_entry_addition *addition = e->data;
+    if ( free_entries && addition->entry != NULL ) {
+      free_flow_entry( addition->entry );
+    }
+    xfree( addition );
+  }
+  if ( bundle->additions != NULL ) {
+    delete_list( bundle->additions );
+    bundle->additions = NULL;
+  }
+  bundle->n_additions = 0;
+}
+
+
+// Frees the bundle and the flow entries that are staged but not committed.
+void
+delete_flow_entry_bundle( flow_entry_bundle *bundle ) {
+  if ( bundle == NULL ) {
+    return;
+  }
+
+  delete_staged_flow_entries( bundle, true );
+  xfree( bundle );
+}
+
+
+// Validates a flow entry and stages it in the bundle. Flow tables are not
+// changed until the bundle is committed. The entry is owned by the bundle
+// on success.
+OFDPE
+stage_flow_entry( flow_entry_bundle *bundle, const uint8_t table_id, flow_entry *entry, const uint16_t flags ) {
+  if ( bundle == NULL || entry == NULL ) {
+    return ERROR_INVALID_PARAMETER;
+  }
+  if ( !valid_table_id( table_id ) ) {
+    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+  }
+
+  if ( !lock_pipeline() ) {
+    return ERROR_LOCK;
+  }
+
+  OFDPE ret = ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+  flow_table *table = get_flow_table( table_id );
+  if ( table != NULL ) {
+    ret = validate_instruction_set( entry->instructions, table->features.metadata_write );
+  }
+
+  if ( !unlock_pipeline() ) {
+    return ERROR_UNLOCK;
+  }
+  if ( ret != OFDPE_SUCCESS ) {
+    return ret;
+  }
+
+  for ( list_element *e = bundle->additions; e != NULL; e = e->next ) {
+    flow_entry_addition *staged = e->data;
+    if ( staged->table_id != table_id || staged->entry->priority != entry->priority ) {
+      continue;
+    }
+    if ( ( flags & OFPFF_CHECK_OVERLAP ) != 0 && compare_match( staged->entry->match, entry->match ) ) {
+      return ERROR_OFDPE_FLOW_MOD_FAILED_OVERLAP;
+    }
+    if ( compare_match_strict( staged->entry->match, entry->match ) ) {
+      free_flow_entry( staged->entry );
+      staged->entry = entry;
+      staged->flags = flags;
+      return OFDPE_SUCCESS;
+    }
+  }
+
+  flow_entry_addition *addition = xmalloc( sizeof( flow_entry_addition ) );
+  addition->table_id = table_id;
+  addition->flags = flags;
+  addition->entry = entry;
+  addition->result = OFDPE_SUCCESS;
+  append_to_tail( &bundle->additions, addition );
+  bundle->n_additions++;
+
+  return OFDPE_SUCCESS;
+}
+
+
+// Looks at the entries that have the same priority as the staged entry.
+// *position is advanced as insert_flow_entry_from() does.
+static void
+scan_same_priority_flow_entries( flow_table *table, const flow_entry *entry, list_element **position,
+                                 bool *overlaps, bool *replaces ) {
+  *overlaps = false;
+  *replaces = false;
+
+  list_element *element = *position != NULL ? ( *position )->next : table->entries;
+  while ( element != NULL && ( ( flow_entry * ) element->data )->priority > entry->priority ) {
+    *position = element;
+    element = element->next;
+  }
+  for ( ; element != NULL; element = element->next ) {
+    flow_entry *e = element->data;
+    if ( e->priority < entry->priority ) {
+      break;
+    }
+    if ( compare_match( e->match, entry->match ) ) {
+      *overlaps = true;
+    }
+    if ( compare_match_strict( e->match, entry->match ) ) {
+      *replaces = true;
+    }
+  }
+}
+
+
+static bool
+actions_refer_to_existing_groups( const instruction *instruction ) {
+  if ( instruction == NULL || instruction->actions == NULL ) {
+    return true;
+  }
+
+  for ( dlist_element *e = get_first_element( instruction->actions ); e != NULL; e = e->next ) {
+    action *action = e->data;
+    if ( action != NULL && action->type == OFPAT_GROUP && !group_exists( action->group_id ) ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// Groups may be deleted while the entries are staged, so the instructions
+// are validated again under the pipeline lock.
+static OFDPE
+revalidate_staged_flow_entry( flow_table *table, const flow_entry *entry ) {
+  OFDPE ret = validate_instruction_set( entry->instructions, table->features.metadata_write );
+  if ( ret != OFDPE_SUCCESS ) {
+    return ret;
+  }
+  if ( !actions_refer_to_existing_groups( entry->instructions->write_actions ) ||
+       !actions_refer_to_existing_groups( entry->instructions->apply_actions ) ) {
+    return ERROR_OFDPE_BAD_ACTION_BAD_OUT_GROUP;
+  }
+
+  return OFDPE_SUCCESS;
+}
+
+
+static OFDPE
+check_staged_flow_entries( flow_entry_addition **sorted, const uint32_t n_additions ) {
+  flow_table *table = NULL;
+  list_element *position = NULL;
+  uint32_t n_added = 0;
+  for ( uint32_t i = 0; i < n_additions; i++ ) {
+    flow_table *current = get_flow_table( sorted[ i ]->table_id );
+    if ( current == NULL ) {
+      return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
+    }
+    if ( current != table ) {
+      table = current;
+      position = NULL;
+      n_added = 0;
+    }
+    OFDPE ret = revalidate_staged_flow_entry( table, sorted[ i ]->entry );
+    if ( ret != OFDPE_SUCCESS ) {
+      return ret;
+    }
+    bool overlaps = false;
+    bool replaces = false;
+    scan_same_priority_flow_entries( table, sorted[ i ]->entry, &position, &overlaps, &replaces );
+    if ( ( sorted[ i ]->flags & OFPFF_CHECK_OVERLAP ) != 0 && overlaps ) {
+      return ERROR_OFDPE_FLOW_MOD_FAILED_OVERLAP;
+    }
+    // entries that replace an existing one do not take up a new slot
+    if ( !replaces ) {
+      n_added++;
+      if ( table->features.max_entries < get_active_count( sorted[ i ]->table_id ) + n_added ) {
+        return ERROR_OFDPE_FLOW_MOD_FAILED_TABLE_FULL;
+      }
+    }
+  }
+
+  return OFDPE_SUCCESS;
+}
+
+
+// Adds all flow entries staged in the bundle, or none of them. Sorting and
+// allocation are done before taking the pipeline lock, so the critical
+// section only checks the staged entries against the flow tables and links
+// them in. Since the pipeline looks up flow tables under the same lock,
+// packets see either none or all of the staged entries.
+OFDPE
+commit_flow_entry_bundle( flow_entry_bundle *bundle ) {
+  if ( bundle == NULL ) {
+    return ERROR_INVALID_PARAMETER;
+  }
+  if ( bundle->n_additions == 0 ) {
+    return OFDPE_SUCCESS;
+  }
+
+  uint32_t n_additions = bundle->n_additions;
+  flow_entry_addition **sorted = xmalloc( sizeof( flow_entry_addition * ) * n_additions );
+  list_element **elements = xmalloc( sizeof( list_element * ) * n_additions );
+  uint32_t i = 0;
+  for ( list_element *e = bundle->additions; e != NULL; e = e->next ) {
+    sorted[ i ] = e->data;
+    elements[ i ] = xmalloc( sizeof( list_element ) );
+    i++;
+  }
+  qsort( sorted, n_additions, sizeof( flow_entry_addition * ), compare_flow_entry_additions );
+
+  if ( !lock_pipeline() ) {
+    for ( i = 0; i < n_additions; i++ ) {
+      xfree( elements[ i ] );
+    }
+    xfree( elements );
+    xfree( sorted );
+    return ERROR_LOCK;
+  }
+
+  OFDPE ret = check_staged_flow_entries( sorted, n_additions );
+  if ( ret == OFDPE_SUCCESS ) {
+    flow_table *table = NULL;
+    list_element *position = NULL;
+    for ( i = 0; i < n_additions; i++ ) {
+      flow_table *current = get_flow_table( sorted[ i ]->table_id );
+      if ( current != table ) {
+        table = current;
+        position = NULL;
+      }
+      // overlaps are already checked
+      uint16_t flags = ( uint16_t ) ( sorted[ i ]->flags & ~OFPFF_CHECK_OVERLAP );
+      sorted[ i ]->result = insert_flow_entry_from( table, sorted[ i ]->entry, flags, &position, elements[ i ] );
+      assert( sorted[ i ]->result == OFDPE_SUCCESS );
+      increment_reference_counters_in_groups( sorted[ i ]->entry->instructions );
+    }
+  }
+
+  bool committed = ret == OFDPE_SUCCESS;
+  if ( !unlock_pipeline() ) {
+    ret = ERROR_UNLOCK;
+  }
+
+  if ( committed ) {
+    // the entries are owned by the flow tables now
+    delete_staged_flow_entries( bundle, false );
+  }
+  else {
+    for ( i = 0; i < n_additions; i++ ) {
+      xfree( elements[ i ] );
+    }
+  }
+  xfree( elements );
+  xfree( sorted );
+
+  return ret;
+}
+
+
+static bool
+instruction_has_output_port( const instruction *instruction, const uint32_t out_port ) {
+  assert( instruction != NULL );
+
+  if ( instruction->actions == NULL ) {
+    return false;
+  }
+
+  bool found = false;
+  for ( dlist_element *e = get_first_element( instruction->actions ); e != NULL; e = e->next ) {
+    action *action = e->data;
+    if ( action == NULL ) {
+      continue;
+    }
+    if ( action->type == OFPAT_OUTPUT && out_port == action->port ) {
+      found = true;
+      break;
+    }
+  }
+
+  return found;
+}
+
+
+static bool
+instructions_have_output_port( instruction_set *instructions, const uint32_t out_port ) {
+  assert( out_port <= OFPP_MAX );
+
+  bool found = false;
+  if ( instructions->write_actions != NULL ) {
+    found = instruction_has_output_port( instructions->write_actions, out_port );
+  }
+  if ( !found && instructions->apply_actions != NULL ) {
+    found = instruction_has_output_port( instructions->apply_actions, out_port );
+  }
+
+  return found;
+}
+
+
+static bool
+instruction_has_output_group( const instruction *instruction, const uint32_t out_group ) {
+  assert( instruction != NULL );
+
+  if ( instruction->actions == NULL ) {
+    return false;
+  }
+
+  bool found = false;
+  for ( dlist_element *e = get_first_element( instruction->actions ); e != NULL; e = e->next ) {
+    action *action = e->data;
+    if ( action == NULL ) {
+      continue;
+    }
+    if ( action->type == OFPAT_GROUP && out_group == action->group_id ) {
+      found = true;
+      break;
+    }
+  }
+
+  return found;
+}
+
+
+static bool
+instructions_have_output_group( instruction_set *instructions, const uint32_t out_group ) {
+  assert( out_group <= OFPG_MAX );
+
+  bool found = false;
+  if ( instructions->write_actions != NULL ) {
+    found = instruction_has_output_group( instructions->write_actions, out_group );
+  }
+  if ( !found && instructions->apply_actions != NULL ) {
+    found = instruction_has_output_group( instructions->apply_actions, out_group );
+  }
+
+  return found;
 }
 
 
-static OFDPE
-insert_flow_entry( flow_table *table, flow_entry *entry, const uint16_t flags ) {
-  assert( table != NULL );
+static bool
+flow_entry_matches_filter( const flow_entry *entry, const uint64_t cookie, const uint64_t cookie_mask,
+                           const uint32_t out_port, const uint32_t out_group ) {
   assert( entry != NULL );
 
-  list_element *element = table->entries;
-  while( element != NULL ) {
-    list_element *next = element->next;
-    flow_entry *e = element->data;
-    assert( e != NULL );
-    if ( e->priority < entry->priority ) {
-      break;
-    }
-    if ( e->priority == entry->priority ) {
-      if ( ( flags & OFPFF_CHECK_OVERLAP ) != 0 && compare_match( e->match, entry->match ) ) {
-        return ERROR_OFDPE_FLOW_MOD_FAILED_OVERLAP;
-      }
-      if ( compare_match_strict( e->match, entry->match ) ) {
-        if ( ( flags & OFPFF_RESET_COUNTS ) != 0 ) {
-          entry->byte_count = e->byte_count;
-          entry->packet_count = e->packet_count;
-        }
-        flow_table *table = get_flow_table( e->table_id );
-        assert( table != NULL );
-        delete_flow_entry_from_table( table, e, 0, false );
-      }
+  if ( out_port != OFPP_ANY ) {
+    if ( !instructions_have_output_port( entry->instructions, out_port ) ) {
+      return false;
     }
-    element = next;
   }
-
-  if ( element == NULL ) {
-    // tail
-    append_to_tail( &table->entries, entry );
-  }
-  else if ( element == table->entries ) {
-    // head
-    insert_in_front( &table->entries, entry );
+  if ( out_group != OFPG_ANY ) {
+    if ( !instructions_have_output_group( entry->instructions, out_group ) ) {
+      return false;
+    }
   }
-  else {
-    // insert before
-    insert_before( &table->entries, element->data, entry );
+  if ( cookie_mask != 0 ) {
+    if ( ( entry->cookie & cookie_mask ) != ( cookie & cookie_mask ) ) {
+      return false;
+    }
   }
 
-  increment_active_count( table->features.table_id );
-
-  return OFDPE_SUCCESS;
+  return true;
 }
 
 
-OFDPE
-add_flow_entry( const uint8_t table_id, flow_entry *entry, const uint16_t flags ) {
-  if ( !valid_table_id( table_id ) ) {
-    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
-  }
-  if ( entry == NULL ) {
-    return ERROR_INVALID_PARAMETER;
-  }
+/*
+ * Looks up flow entries that match all the given conditions through the most
+ * selective index available. Returns false without looking up anything if no
+ * index applies, in which case the flow tables have to be walked.
+ */
+static bool
+lookup_flow_entries_with_index( const uint8_t table_id, const match *match, const uint64_t cookie, const uint64_t cookie_mask,
+                                const uint32_t out_port, const uint32_t out_group, list_element **entries ) {
+  assert( valid_table_id( table_id ) || table_id == FLOW_TABLE_ALL );
+  assert( entries != NULL );
 
-  if ( !lock_pipeline() ) {
-    return ERROR_LOCK;
+  bool exact_cookie = ( cookie_mask == UINT64_MAX );
+  if ( !exact_cookie && out_port == OFPP_ANY && out_group == OFPG_ANY ) {
+    return false;
   }
 
-  flow_table *table = get_flow_table( table_id );
-  if ( table == NULL ) {
-    return ERROR_OFDPE_FLOW_MOD_FAILED_BAD_TABLE_ID;
-  }
+  create_list( entries );
 
-  if ( table->features.max_entries <= get_active_count( table_id ) ) {
-    return ERROR_OFDPE_FLOW_MOD_FAILED_TABLE_FULL;
+  uint8_t first = table_id;
+  uint8_t last = table_id;
+  if ( table_id == FLOW_TABLE_ALL ) {
+    first = 0;
+    last = FLOW_TABLE_ID_MAX;
   }
+  for ( unsigned int id = first; id <= last; id++ ) {
+    flow_table *table = get_flow_table( ( uint8_t ) id );
+    if ( table == NULL ) {
+      continue;
+    }
 
-  OFDPE ret = validate_instruction_set( entry->instructions, table->features.metadata_write );
-  if ( ret == OFDPE_SUCCESS ) {
-    ret = insert_flow_entry( table, entry, flags );
-    if ( ret == OFDPE_SUCCESS ) {
-      increment_reference_counters_in_groups( entry->instructions );
+    list_element *candidates = NULL;
+    if ( exact_cookie ) {
+      candidates = lookup_flow_index( table->cookie_index, cookie );
+    }
+    else if ( out_group != OFPG_ANY ) {
+      candidates = lookup_flow_index( table->out_group_index, out_group );
+    }
+    else {
+      candidates = lookup_flow_index( table->out_port_index, out_port );
     }
-  }
 
-  if ( !unlock_pipeline() ) {
-    return ERROR_UNLOCK;
+    for ( list_element *e = candidates; e != NULL; e = e->next ) {
+      flow_entry *entry = e->data;
+      assert( entry != NULL );
+      if ( match != NULL && !compare_match( match, entry->match ) ) {
+        continue;
+      }
+      if ( flow_entry_matches_filter( entry, cookie, cookie_mask, out_port, out_group ) ) {
+        insert_in_front( entries, entry );
+      }
+    }
   }
 
-  return ret;
+  return true;
 }
 
 
@@ -628,12 +1471,17 @@ static void
 update_instructions( flow_entry *entry, instruction_set *instructions ) {
   assert( entry != NULL );
 
+  flow_table *table = get_flow_table( entry->table_id );
+  assert( table != NULL );
+
+  index_instructions( table, entry, false );
   decrement_reference_counters_in_groups( entry->instructions );
   if ( entry->instructions != instructions ) {
     delete_instruction_set( entry->instructions );
   }
   entry->instructions = duplicate_instruction_set( instructions );
   increment_reference_counters_in_groups( entry->instructions );
+  index_instructions( table, entry, true );
 }
 
 
@@ -703,15 +1551,19 @@ update_flow_entries( const uint8_t table_id, const match *match, const uint64_t
   }
 
   list_element *list = NULL;
-  if ( table_id != FLOW_TABLE_ALL ) {
-    list = lookup_flow_entries_with_table_id( table_id, match, 0, false, false );
+  if ( lookup_flow_entries_with_index( table_id, match, cookie, cookie_mask, OFPP_ANY, OFPG_ANY, &list ) ) {
+    update_flow_entries_in_list( list, 0, 0, flags, instructions );
   }
   else {
-    list = lookup_flow_entries_from_all_tables( match, 0, false, false );
+    if ( table_id != FLOW_TABLE_ALL ) {
+      list = lookup_flow_entries_with_table_id( table_id, match, 0, false, false );
+    }
+    else {
+      list = lookup_flow_entries_from_all_tables( match, 0, false, false );
+    }
+    update_flow_entries_in_list( list, cookie, cookie_mask, flags, instructions );
   }
 
-  update_flow_entries_in_list( list, cookie, cookie_mask, flags, instructions );
-
   if ( list != NULL ) {
     delete_list( list );
   }
@@ -842,86 +1694,6 @@ update_or_add_flow_entry( const uint8_t table_id, const match *key,
 }
 
 
-static bool
-instruction_has_output_port( const instruction *instruction, const uint32_t out_port ) {
-  assert( instruction != NULL );
-
-  if ( instruction->actions == NULL ) {
-    return false;
-  }
-
-  bool found = false;
-  for ( dlist_element *e = get_first_element( instruction->actions ); e != NULL; e = e->next ) {
-    action *action = e->data;
-    if ( action == NULL ) {
-      continue;
-    }
-    if ( action->type == OFPAT_OUTPUT && out_port == action->port ) {
-      found = true;
-      break;
-    }
-  }
-
-  return found;
-}
-
-
-static bool
-instructions_have_output_port( instruction_set *instructions, const uint32_t out_port ) {
-  assert( out_port <= OFPP_MAX );
-
-  bool found = false;
-  if ( instructions->write_actions != NULL ) {
-    found = instruction_has_output_port( instructions->write_actions, out_port );
-  }
-  if ( instructions->apply_actions != NULL ) {
-    found = instruction_has_output_port( instructions->apply_actions, out_port );
-  }
-
-  return found;
-}
-
-
-static bool
-instruction_has_output_group( const instruction *instruction, const uint32_t out_group ) {
-  assert( instruction != NULL );
-
-  if ( instruction->actions == NULL ) {
-    return false;
-  }
-
-  bool found = false;
-  for ( dlist_element *e = get_first_element( instruction->actions ); e != NULL; e = e->next ) {
-    action *action = e->data;
-    if ( action == NULL ) {
-      continue;
-    }
-    if ( action->type == OFPAT_GROUP && out_group == action->group_id ) {
-      found = true;
-      break;
-    }
-  }
-
-  return found;
-}
-
-
-static bool
-instructions_have_output_group( instruction_set *instructions, const uint32_t out_group ) {
-  assert( out_group <= OFPG_MAX );
-
-  bool found = false;
-  if ( instructions->write_actions != NULL ) {
-    found = instruction_has_output_group( instructions->write_actions, out_group );
-  }
-  if ( instructions->apply_actions != NULL ) {
-    found = instruction_has_output_group( instructions->apply_actions, out_group );
-  }
-
-  return found;
-}
-
-
 static void
 delete_flow_entries_in_list( list_element *entries, const uint64_t cookie, const uint64_t cookie_mask,
                              const uint32_t out_port, const uint32_t out_group, const uint8_t reason ) {
@@ -970,15 +1742,19 @@ delete_flow_entries( const uint8_t table_id, const match *match, const uint64_t
   }
 
   list_element *delete_us = NULL;
-  if ( table_id != FLOW_TABLE_ALL ) {
-    delete_us = lookup_flow_entries_with_table_id( table_id, match, 0, false, false );
+  if ( lookup_flow_entries_with_index( table_id, match, cookie, cookie_mask, out_port, out_group, &delete_us ) ) {
+    delete_flow_entries_in_list( delete_us, 0, 0, OFPP_ANY, OFPG_ANY, OFPRR_DELETE );
   }
   else {
-    delete_us = lookup_flow_entries_from_all_tables( match, 0, false, false );
+    if ( table_id != FLOW_TABLE_ALL ) {
+      delete_us = lookup_flow_entries_with_table_id( table_id, match, 0, false, false );
+    }
+    else {
+      delete_us = lookup_flow_entries_from_all_tables( match, 0, false, false );
+    }
+    delete_flow_entries_in_list( delete_us, cookie, cookie_mask, out_port, out_group, OFPRR_DELETE );
   }
 
-  delete_flow_entries_in_list( delete_us, cookie, cookie_mask, out_port, out_group, OFPRR_DELETE );
-
   if ( delete_us != NULL ) {
     delete_list( delete_us );
   }
@@ -1033,19 +1809,7 @@ delete_flow_entries_by_group_id( const uint32_t group_id ) {
   }
 
   list_element *delete_us = NULL;
-  create_list( &delete_us );
-
-  for ( uint8_t table_id = 0; table_id <= FLOW_TABLE_ID_MAX; table_id++ ) {
-    flow_table *table = get_flow_table( table_id );
-    assert( table != NULL );
-    for ( list_element *e = table->entries; e != NULL; e = e->next ) {
-      assert( e->data != NULL );
-      flow_entry *entry = e->data;
-      if ( instructions_have_output_group( entry->instructions, group_id ) ) {
-        append_to_tail( &delete_us, e->data );
-      }
-    }
-  }
+  lookup_flow_entries_with_index( FLOW_TABLE_ALL, NULL, 0, 0, OFPP_ANY, group_id, &delete_us );
 
   delete_flow_entries_in_list( delete_us, 0, 0, OFPP_ANY, OFPG_ANY, OFPRR_GROUP_DELETE );
 
@@ -1091,6 +1855,29 @@ get_table_stats( table_stats **stats, uint8_t *n_tables ) {
 }
 
 
+static void
+assign_flow_stats( flow_stats *stat, const flow_entry *entry, const struct timespec *now ) {
+  assert( stat != NULL );
+  assert( entry != NULL );
+  assert( now != NULL );
+
+  struct timespec diff = { 0, 0 };
+
+  stat->table_id = entry->table_id;
+  timespec_diff( entry->created_at, *now, &diff );
+  stat->duration_sec = ( uint32_t ) diff.tv_sec;
+  stat->duration_nsec = ( uint32_t ) diff.tv_nsec;
+  stat->priority = entry->priority;
+  stat->idle_timeout = entry->idle_timeout;
+  stat->hard_timeout = entry->hard_timeout;
+  stat->flags = entry->flags;
+  stat->cookie = entry->cookie;
+  stat->packet_count = entry->packet_count;
+  stat->byte_count = entry->byte_count;
+  stat->match = *entry->match;
+}
+
+
 OFDPE
 get_flow_stats( const uint8_t table_id, const match *match, const uint64_t cookie, const uint64_t cookie_mask,
                 const uint32_t out_port, const uint32_t out_group, flow_stats **stats, uint32_t *n_entries ) {
@@ -1118,26 +1905,7 @@ get_flow_stats( const uint8_t table_id, const match *match, const uint64_t cooki
     flow_entry *entry = e->data;
     assert( entry != NULL );
 
-    bool matched = true;
-
-    if ( out_port != OFPP_ANY ) {
-      if ( !instructions_have_output_port( entry->instructions, out_port ) ) {
-        matched = false;
-      }
-    }
-    if ( out_group != OFPG_ANY ) {
-      if ( !instructions_have_output_group( entry->instructions, out_group ) ) {
-        matched = false;
-      }
-    }
-
-    if ( matched && cookie_mask != 0 ) {
-      if ( ( entry->cookie & cookie_mask ) != ( cookie & cookie_mask ) ) {
-        matched = false;
-      }
-    }
-
-    if ( matched ) {
+    if ( flow_entry_matches_filter( entry, cookie, cookie_mask, out_port, out_group ) ) {
       ( *n_entries )++;
       append_to_tail( &entries, entry );
     }
@@ -1155,23 +1923,10 @@ get_flow_stats( const uint8_t table_id, const match *match, const uint64_t cooki
 
   struct timespec now = { 0, 0 };
   time_now( &now );
-  struct timespec diff = { 0, 0 };
   flow_stats *stat = *stats;
 
   for ( list_element *e = entries; e != NULL; e = e->next ) {
-    flow_entry *entry = e->data;
-    stat->table_id = entry->table_id;
-    timespec_diff( entry->created_at, now, &diff );
-    stat->duration_sec = ( uint32_t ) diff.tv_sec;
-    stat->duration_nsec = ( uint32_t ) diff.tv_nsec;
-    stat->priority = entry->priority;
-    stat->idle_timeout = entry->idle_timeout;
-    stat->hard_timeout = entry->hard_timeout;
-    stat->flags = entry->flags;
-    stat->cookie = entry->cookie;
-    stat->packet_count = entry->packet_count;
-    stat->byte_count = entry->byte_count;
-    stat->match = *entry->match;
+    assign_flow_stats( stat, e->data, &now );
     stat++;
   }
 
@@ -1187,6 +1942,118 @@ get_flow_stats( const uint8_t table_id, const match *match, const uint64_t cooki
 }
 
 
+/*
+ * Creates a cursor for walking flow entries that match a flow stats request
+ * chunk by chunk. Entries added while the walk is in progress may or may not
+ * be reported, and entries deleted before being reached are never reported.
+ */
+flow_stats_cursor *
+create_flow_stats_cursor( const uint8_t table_id, const match *match,
+                          const uint64_t cookie, const uint64_t cookie_mask,
+                          const uint32_t out_port, const uint32_t out_group ) {
+  assert( valid_table_id( table_id ) || table_id == FLOW_TABLE_ALL );
+
+  flow_stats_cursor *cursor = xmalloc( sizeof( flow_stats_cursor ) );
+  memset( cursor, 0, sizeof( flow_stats_cursor ) );
+  cursor->table_id = table_id;
+  cursor->match = match != NULL ? duplicate_match( match ) : NULL;
+  cursor->cookie = cookie;
+  cursor->cookie_mask = cookie_mask;
+  cursor->out_port = out_port;
+  cursor->out_group = out_group;
+  cursor->current_table_id = table_id != FLOW_TABLE_ALL ? table_id : 0;
+
+  if ( !lock_pipeline() ) {
+    if ( cursor->match != NULL ) {
+      delete_match( cursor->match );
+    }
+    xfree( cursor );
+    return NULL;
+  }
+
+  list_element *head = NULL;
+  if ( flow_tables[ cursor->current_table_id ].initialized ) {
+    head = flow_tables[ cursor->current_table_id ].entries;
+  }
+  seek_flow_stats_cursor( cursor, head );
+  if ( !cursor->done ) {
+    insert_in_front( &flow_stats_cursors, cursor );
+  }
+
+  unlock_pipeline();
+
+  return cursor;
+}
+
+
+void
+delete_flow_stats_cursor( flow_stats_cursor *cursor ) {
+  assert( cursor != NULL );
+
+  // The cursor must be unlinked even if locking fails, since it is freed below.
+  bool locked = lock_pipeline();
+  if ( flow_stats_cursors != NULL ) {
+    delete_element( &flow_stats_cursors, cursor );
+  }
+  if ( locked ) {
+    unlock_pipeline();
+  }
+
+  if ( cursor->match != NULL ) {
+    delete_match( cursor->match );
+  }
+  xfree( cursor );
+}
+
+
+/*
+ * Fills up to max_entries flow stats and advances the cursor. The pipeline
+ * lock is held only while a single chunk is retrieved, so that forwarding
+ * can proceed between chunks. The walk is complete when cursor->done is true.
+ */
+OFDPE
+get_next_flow_stats( flow_stats_cursor *cursor, flow_stats *stats, const uint32_t max_entries, uint32_t *n_entries ) {
+  assert( cursor != NULL );
+  assert( stats != NULL );
+  assert( n_entries != NULL );
+
+  *n_entries = 0;
+  if ( cursor->done ) {
+    return OFDPE_SUCCESS;
+  }
+
+  if ( !lock_pipeline() ) {
+    return ERROR_LOCK;
+  }
+
+  struct timespec now = { 0, 0 };
+  time_now( &now );
+
+  uint32_t n_scanned = 0;
+  while ( cursor->next != NULL && *n_entries < max_entries && n_scanned < FLOW_STATS_SCAN_MAX ) {
+    flow_entry *entry = cursor->next->data;
+    assert( entry != NULL );
+    n_scanned++;
+    if ( ( cursor->match == NULL || compare_match( cursor->match, entry->match ) ) &&
+         flow_entry_matches_filter( entry, cursor->cookie, cursor->cookie_mask, cursor->out_port, cursor->out_group ) ) {
+      assign_flow_stats( &stats[ *n_entries ], entry, &now );
+      ( *n_entries )++;
+    }
+    seek_flow_stats_cursor( cursor, cursor->next->next );
+  }
+
+  if ( cursor->done && flow_stats_cursors != NULL ) {
+    delete_element( &flow_stats_cursors, cursor );
+  }
+
+  if ( !unlock_pipeline() ) {
+    return ERROR_UNLOCK;
+  }
+
+  return OFDPE_SUCCESS;
+}
+
+
 OFDPE
 set_flow_table_features( const uint8_t table_id, const flow_table_features *features ) {
   warn( "Chaning flow table features is not supported ( table_id = %#x ).", table_id );
@@ -1291,9 +2158,12 @@ dump_flow_table( const uint8_t table_id, void dump_function( const char *format,
 
   ( *dump_function )( "[Entries]" );
 
+  struct timespec now = { 0, 0 };
+  time_now( &now );
   for ( list_element *e = table->entries; e != NULL; e = e->next ) {
     flow_entry *entry = e->data;
     assert( entry != NULL );
+    update_flow_entry_duration( entry, &now );
     dump_flow_entry( entry, dump_function );
   }
 
@@ -66,6 +66,9 @@ typedef struct {
 typedef struct {
   bool initialized;
   list_element *entries;
+  hash_table *cookie_index;
+  hash_table *out_port_index;
+  hash_table *out_group_index;
   flow_table_stats counters;
   flow_table_features features;
 } flow_table;
@@ -86,6 +89,30 @@ typedef struct {
   match match;
 } flow_stats;
 
+typedef struct {
+  uint8_t table_id;
+  match *match;
+  uint64_t cookie;
+  uint64_t cookie_mask;
+  uint32_t out_port;
+  uint32_t out_group;
+  uint8_t current_table_id;
+  list_element *next;
+  bool done;
+} flow_stats_cursor;
+
+typedef struct {
+  uint8_t table_id;
+  uint16_t flags;
+  flow_entry *entry;
+  OFDPE result;
+} flow_entry_addition;
+
+typedef struct {
+  list_element *additions;
+  uint32_t n_additions;
+} flow_entry_bundle;
+
 
 void init_flow_tables( const uint32_t max_flow_entries );
 void finalize_flow_tables( void );
@@ -95,6 +122,11 @@ list_element *lookup_flow_entries( const uint8_t table_id, const match *match );
 flow_entry *lookup_flow_entry( const uint8_t table_id, const match *match );
 flow_entry *lookup_flow_entry_strict( const uint8_t table_id, const match *match, const uint16_t priority );
 OFDPE add_flow_entry( const uint8_t table_id, flow_entry *entry, const uint16_t flags );
+OFDPE add_flow_entries( flow_entry_addition *additions, const uint32_t n_additions );
+flow_entry_bundle *create_flow_entry_bundle( void );
+void delete_flow_entry_bundle( flow_entry_bundle *bundle );
+OFDPE stage_flow_entry( flow_entry_bundle *bundle, const uint8_t table_id, flow_entry *entry, const uint16_t flags );
+OFDPE commit_flow_entry_bundle( flow_entry_bundle *bundle );
 OFDPE update_flow_entries( const uint8_t table_id, const match *match, const uint64_t cookie, const uint64_t cookie_mask,
                            const uint16_t flags, instruction_set *instructions );
 OFDPE update_flow_entry_strict( const uint8_t table_id, const match *match,
@@ -112,6 +144,11 @@ OFDPE delete_flow_entries_by_group_id( const uint32_t group_id );
 OFDPE get_table_stats( table_stats **stats, uint8_t *n_tables );
 OFDPE get_flow_stats( const uint8_t table_id, const match *match, const uint64_t cookie, const uint64_t cookie_mask,
                       const uint32_t out_port, const uint32_t out_group, flow_stats **stats, uint32_t *n_entries );
+flow_stats_cursor *create_flow_stats_cursor( const uint8_t table_id, const match *match,
+                                             const uint64_t cookie, const uint64_t cookie_mask,
+                                             const uint32_t out_port, const uint32_t out_group );
+void delete_flow_stats_cursor( flow_stats_cursor *cursor );
+OFDPE get_next_flow_stats( flow_stats_cursor *cursor, flow_stats *stats, const uint32_t max_entries, uint32_t *n_entries );
 OFDPE set_flow_table_features( const uint8_t table_id, const flow_table_features *features );
 OFDPE get_flow_table_features( const uint8_t table_id, flow_table_features *stats );
 OFDPE set_flow_table_config( const uint8_t table_id, const uint32_t config );
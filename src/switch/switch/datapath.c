@@ -31,35 +31,66 @@
 #include "switch.h"
 
 
+/*
+ * Moves buffers that did not fit into the ring while the protocol thread
+ * was lagging behind, keeping their order.
+ */
+static void
+flush_backlog( struct datapath *datapath ) {
+  buffer *packet;
+  while ( ( packet = peek_message( datapath->backlog ) ) != NULL ) {
+    if ( !push_handoff_ring( datapath->peer_ring, packet ) ) {
+      break;
+    }
+    dequeue_message( datapath->backlog );
+  }
+}
+
+
+/*
+ * Runs once per event loop iteration after at least one buffer has been
+ * pushed, so a whole batch costs a single eventfd write. No write is
+ * needed at all while the protocol thread has not yet drained the ring
+ * since the previous notification.
+ */
 void
 notify_protocol( int fd, void *user_data ) {
   assert( fd >= 0 );
   struct datapath *datapath = user_data;
   assert( datapath != NULL );
 
-  ssize_t ret = write( datapath->peer_efd, &datapath->send_count, sizeof( datapath->send_count ) );
-  if ( ret < 0 ) {
-    if ( ret == EAGAIN || errno == EINTR ) {
+  flush_backlog( datapath );
+  if ( request_handoff_ring_notification( datapath->peer_ring ) ) {
+    uint64_t count = 1;
+    ssize_t ret = write( datapath->peer_efd, &count, sizeof( count ) );
+    if ( ret != sizeof( count ) ) {
+      reset_handoff_ring_notification( datapath->peer_ring );
+      if ( ret < 0 && ( errno == EAGAIN || errno == EINTR ) ) {
+        return;
+      }
+      char buf[ 256 ];
+      memset( buf, '\0', sizeof( buf ) );
+      char *error_string = strerror_r( errno, buf, sizeof( buf ) - 1 );
+      error( "Failed to notify protocol ret = %d errno %s [%d]", ret, error_string, errno );
       return;
     }
-    char buf[ 256 ];
-    memset( buf, '\0', sizeof( buf ) );
-    char *error_string = strerror_r( errno, buf, sizeof( buf ) - 1 );    
-    error( "Failed to notify protocol count= " PRIu64 ", ret = %d errno %s [%d]", datapath->send_count, ret, error_string, errno );
-    return;
-  } else if ( ret != sizeof( datapath->send_count ) ) {
-    error( "Failed to notify protocol count= " PRIu64 ",ret = %d", datapath->send_count, ret );
   }
-  datapath->send_count = 0;
-  set_writable_safe( fd, false );
+  if ( peek_message( datapath->backlog ) == NULL ) {
+    datapath->notify_pending = false;
+    set_writable_safe( fd, false );
+  }
 }
 
 
 static void
 push_datapath_message_to_peer( buffer *packet, struct datapath *datapath ) {
-  enqueue_message( datapath->peer_queue, packet );
-  datapath->send_count++;
-  set_writable_safe( datapath->peer_efd, true );
+  if ( peek_message( datapath->backlog ) != NULL || !push_handoff_ring( datapath->peer_ring, packet ) ) {
+    enqueue_message( datapath->backlog, packet );
+  }
+  if ( !datapath->notify_pending ) {
+    datapath->notify_pending = true;
+    set_writable_safe( datapath->peer_efd, true );
+  }
 }
 
 
@@ -209,6 +240,11 @@ void set_event_handlers( void *user_data ) {
 static void
 dump_flows_actually() {
   dump_flow_table( 0, info );
+
+  uint64_t rate_limited = 0;
+  uint64_t coalesced = 0;
+  get_suppressed_packet_in_counts( &rate_limited, &coalesced );
+  info( "Suppressed packet-ins: rate limited = %" PRIu64 ", coalesced = %" PRIu64 ".", rate_limited, coalesced );
 }
 
 
@@ -248,10 +284,22 @@ serve_datapath( void *data ) {
   }
   datapath->running = OFDPE_SUCCESS;
 
+  packet_in_limits limits = {
+    args->packet_in_port_rate, args->packet_in_port_burst,
+    args->packet_in_reason_rate, args->packet_in_reason_burst,
+    args->packet_in_coalesce_count, args->packet_in_coalesce_window
+  };
+  ret = set_packet_in_limits( &limits );
+  if ( ret != OFDPE_SUCCESS ) {
+    error( "Failed to set packet-in limits ( ret = %d ).", ret );
+    return -1;
+  }
+
   datapath->own_efd = args->efd[ 1 ];
   datapath->peer_efd = args->efd[ 0 ];
-  datapath->peer_queue = args->to_protocol_queue;
-  datapath->send_count = 0;
+  datapath->peer_ring = args->to_protocol_ring;
+  datapath->backlog = create_message_queue();
+  datapath->notify_pending = false;
   
   set_fd_handler_safe( datapath->peer_efd, NULL, NULL, notify_protocol, datapath );
   set_writable_safe( datapath->peer_efd, false );
@@ -279,6 +327,7 @@ serve_datapath( void *data ) {
   }
 
   ret = finalize_datapath();
+  delete_message_queue( datapath->backlog );
   if ( ret != OFDPE_SUCCESS ) {
     error( "Failed to finalize datapath ( ret = %d ).", ret );
     return -1;
@@ -21,6 +21,7 @@
 
 
 #include "trema.h"
+#include "handoff-ring.h"
 
 
 #ifdef __cplusplus
@@ -37,8 +38,9 @@ extern "C" {
 struct datapath {
   struct async thread;
   const struct switch_arguments *args; 
-  message_queue *peer_queue;
-  uint64_t send_count;
+  handoff_ring *peer_ring;
+  message_queue *backlog;
+  bool notify_pending;
   void *data;
   int own_efd;
   int peer_efd;
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "trema.h"
+#include "ofdp.h"
+#include "action-helper.h"
+#include "decode-helper.h"
+#include "oxm-helper.h"
+
+
+/*
+ * Each OXM TLV and action is converted to host byte order on the stack and
+ * handed to the existing assign_match() / assign_actions(), so no message
+ * part is copied to the heap or queued on a list before it is assigned.
+ */
+#define OXM_MAX_LENGTH ( sizeof( oxm_match_header ) + UINT8_MAX )
+#define ACTION_MAX_LENGTH ( offsetof( struct ofp_action_set_field, field ) + OXM_MAX_LENGTH + 8 )
+
+
+static match *
+_decode_match( const struct ofp_match *ofp_match ) {
+  assert( ofp_match != NULL );
+
+  match *match = create_match();
+  uint64_t oxm[ ( OXM_MAX_LENGTH + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ) ];
+  uint16_t length = ntohs( ofp_match->length );
+  size_t offset = offsetof( struct ofp_match, oxm_fields );
+  while ( offset + sizeof( oxm_match_header ) <= length ) {
+    const oxm_match_header *src = ( const oxm_match_header * ) ( ( const char * ) ofp_match + offset );
+    ntoh_oxm_match( ( oxm_match_header * ) oxm, src );
+    assign_match( match, ( const oxm_match_header * ) oxm );
+    offset += sizeof( oxm_match_header ) + OXM_LENGTH( ntohl( *src ) );
+  }
+
+  return match;
+}
+match * ( *decode_match )( const struct ofp_match *ofp_match ) = _decode_match;
+
+
+static action_list *
+_decode_actions( const struct ofp_action_header *actions, const uint16_t length ) {
+  action_list *ac_list = create_action_list();
+  uint64_t action[ ( ACTION_MAX_LENGTH + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ) ];
+  size_t offset = 0;
+  while ( offset + sizeof( struct ofp_action_header ) <= length ) {
+    const struct ofp_action_header *src = ( const struct ofp_action_header * ) ( ( const char * ) actions + offset );
+    uint16_t action_length = ntohs( src->len );
+    if ( action_length < sizeof( struct ofp_action_header ) ) {
+      break;
+    }
+    if ( action_length <= sizeof( action ) ) {
+      struct ofp_action_header *dst = ( struct ofp_action_header * ) action;
+      ntoh_action( dst, src );
+      ac_list = assign_actions( ac_list, dst, dst->len );
+    }
+    else {
+      warn( "Unsupported action ( type = %#x, length = %u ).", ntohs( src->type ), action_length );
+    }
+    offset += action_length;
+  }
+
+  return ac_list;
+}
+action_list * ( *decode_actions )( const struct ofp_action_header *actions, const uint16_t length ) = _decode_actions;
+
+
+static instruction *
+decode_instruction( const struct ofp_instruction *src, OFDPE *ret ) {
+  *ret = OFDPE_SUCCESS;
+
+  switch ( ntohs( src->type ) ) {
+    case OFPIT_GOTO_TABLE: {
+      const struct ofp_instruction_goto_table *goto_table = ( const struct ofp_instruction_goto_table * ) src;
+      if ( !valid_table_id( goto_table->table_id ) ) {
+        *ret = ERROR_OFDPE_BAD_INSTRUCTION_BAD_TABLE_ID;
+        return NULL;
+      }
+      return alloc_instruction_goto_table( goto_table->table_id );
+    }
+    case OFPIT_WRITE_METADATA: {
+      const struct ofp_instruction_write_metadata *metadata = ( const struct ofp_instruction_write_metadata * ) src;
+      return alloc_instruction_write_metadata( ntohll( metadata->metadata ), ntohll( metadata->metadata_mask ) );
+    }
+    case OFPIT_WRITE_ACTIONS:
+    case OFPIT_APPLY_ACTIONS: {
+      const struct ofp_instruction_actions *actions = ( const struct ofp_instruction_actions * ) src;
+      uint16_t actions_length = ( uint16_t ) ( ntohs( src->len ) - offsetof( struct ofp_instruction_actions, actions ) );
+      action_list *ac_list = decode_actions( actions->actions, actions_length );
+      if ( ntohs( src->type ) == OFPIT_WRITE_ACTIONS ) {
+        return alloc_instruction_write_actions( ac_list );
+      }
+      return alloc_instruction_apply_actions( ac_list );
+    }
+    case OFPIT_CLEAR_ACTIONS:
+      return alloc_instruction_clear_actions();
+    case OFPIT_METER: {
+      const struct ofp_instruction_meter *meter = ( const struct ofp_instruction_meter * ) src;
+      return alloc_instruction_meter( ntohl( meter->meter_id ) );
+    }
+    default:
+      break;
+  }
+
+  *ret = ERROR_OFDPE_BAD_INSTRUCTION_UNSUP_INST;
+  return NULL;
+}
+
+
+static OFDPE
+_decode_instructions( const struct ofp_instruction *instructions, const uint16_t length, instruction_set **ins_set ) {
+  assert( ins_set != NULL );
+
+  *ins_set = create_instruction_set();
+  size_t offset = 0;
+  while ( offset + sizeof( struct ofp_instruction ) <= length ) {
+    const struct ofp_instruction *src = ( const struct ofp_instruction * ) ( ( const char * ) instructions + offset );
+    uint16_t instruction_length = ntohs( src->len );
+    if ( instruction_length < sizeof( struct ofp_instruction ) ) {
+      break;
+    }
+
+    OFDPE ret = OFDPE_SUCCESS;
+    instruction *instruction = decode_instruction( src, &ret );
+    if ( instruction != NULL ) {
+      ret = add_instruction( *ins_set, instruction );
+      if ( ret != OFDPE_SUCCESS ) {
+        free_instruction( instruction );
+      }
+    }
+    if ( ret != OFDPE_SUCCESS ) {
+      delete_instruction_set( *ins_set );
+      *ins_set = NULL;
+      return ret;
+    }
+    offset += instruction_length;
+  }
+
+  return OFDPE_SUCCESS;
+}
+OFDPE ( *decode_instructions )( const struct ofp_instruction *instructions, const uint16_t length, instruction_set **ins_set ) = _decode_instructions;
+
+
+static bucket_list *
+_decode_buckets( const struct ofp_bucket *buckets, const uint16_t length ) {
+  bucket_list *bkt_list = create_action_bucket_list();
+  size_t offset = 0;
+  while ( offset + sizeof( struct ofp_bucket ) <= length ) {
+    const struct ofp_bucket *src = ( const struct ofp_bucket * ) ( ( const char * ) buckets + offset );
+    uint16_t bucket_length = ntohs( src->len );
+    if ( bucket_length < sizeof( struct ofp_bucket ) ) {
+      break;
+    }
+    uint16_t actions_length = ( uint16_t ) ( bucket_length - offsetof( struct ofp_bucket, actions ) );
+    if ( actions_length > 0 ) {
+      action_list *ac_list = decode_actions( src->actions, actions_length );
+      bucket *bucket = create_action_bucket( ntohs( src->weight ), ntohl( src->watch_port ), ntohl( src->watch_group ), ac_list );
+      append_action_bucket( bkt_list, bucket );
+    }
+    offset += bucket_length;
+  }
+
+  return bkt_list;
+}
+bucket_list * ( *decode_buckets )( const struct ofp_bucket *buckets, const uint16_t length ) = _decode_buckets;
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef DECODE_HELPER_H
+#define DECODE_HELPER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "ofdp.h"
+
+
+/*
+ * Decode validated OpenFlow structures in network byte order straight into
+ * datapath structures.
+ */
+match * ( *decode_match )( const struct ofp_match *ofp_match );
+action_list * ( *decode_actions )( const struct ofp_action_header *actions, const uint16_t length );
+OFDPE ( *decode_instructions )( const struct ofp_instruction *instructions, const uint16_t length, instruction_set **ins_set );
+bucket_list * ( *decode_buckets )( const struct ofp_bucket *buckets, const uint16_t length );
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // DECODE_HELPER_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -56,8 +56,7 @@ construct_bucket_list( const list_element *buckets ) {
 
 
 static void
-_handle_group_add( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) {
-  bucket_list *bkt_list = construct_bucket_list( buckets );
+_handle_group_add_buckets( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, bucket_list *bkt_list ) {
   group_entry *entry = alloc_group_entry( type, group_id, bkt_list );
   if ( entry == NULL ) {
     send_error_message( transaction_id, OFPET_GROUP_MOD_FAILED, OFPGMFC_EPERM );
@@ -74,13 +73,18 @@ _handle_group_add( const uint32_t transaction_id, const uint8_t type, const uint
     free_group_entry( entry );
   }
 }
-void ( *handle_group_add )( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) = _handle_group_add;
+void ( *handle_group_add_buckets )( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, bucket_list *bkt_list ) = _handle_group_add_buckets;
 
 
 static void
-_handle_group_mod_mod( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) {
-  bucket_list *bkt_list = construct_bucket_list( buckets );
+_handle_group_add( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) {
+  handle_group_add_buckets( transaction_id, type, group_id, construct_bucket_list( buckets ) );
+}
+void ( *handle_group_add )( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) = _handle_group_add;
+
 
+static void
+_handle_group_mod_mod_buckets( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, bucket_list *bkt_list ) {
   OFDPE ret = update_group_entry( group_id, type, bkt_list );
   if ( ret != OFDPE_SUCCESS ) {
     uint16_t type = OFPET_GROUP_MOD_FAILED;
@@ -90,6 +94,13 @@ _handle_group_mod_mod( const uint32_t transaction_id, const uint8_t type, const
     delete_action_bucket_list( bkt_list );
   }
 }
+void ( *handle_group_mod_mod_buckets )( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, bucket_list *bkt_list ) = _handle_group_mod_mod_buckets;
+
+
+static void
+_handle_group_mod_mod( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) {
+  handle_group_mod_mod_buckets( transaction_id, type, group_id, construct_bucket_list( buckets ) );
+}
 void ( *handle_group_mod_mod )( const uint32_t transaction_id, const uint8_t type, const uint32_t group_id, const list_element *buckets ) = _handle_group_mod_mod;
 
 
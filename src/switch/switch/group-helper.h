@@ -33,6 +33,15 @@ void ( *handle_group_mod_mod )( const uint32_t transaction_id,
         const uint8_t type,
         const uint32_t group_id,
         const list_element *buckets );
+// takes the ownership of bkt_list
+void ( *handle_group_add_buckets )( const uint32_t transaction_id,
+        const uint8_t type,
+        const uint32_t group_id,
+        bucket_list *bkt_list );
+void ( *handle_group_mod_mod_buckets )( const uint32_t transaction_id,
+        const uint8_t type,
+        const uint32_t group_id,
+        bucket_list *bkt_list );
 void ( *handle_group_mod_delete )( const uint32_t transaction_id,
         const uint32_t group_id );
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include "handoff-ring.h"
+
+
+handoff_ring *
+create_handoff_ring( uint32_t size ) {
+  if ( size == 0 || ( size & ( size - 1 ) ) != 0 ) {
+    die( "size must be a power of two ( size = %u ).", size );
+  }
+
+  handoff_ring *ring = xmalloc( sizeof( handoff_ring ) );
+  memset( ring, 0, sizeof( handoff_ring ) );
+  ring->mask = size - 1;
+  ring->slots = xcalloc( size, sizeof( buffer * ) );
+
+  return ring;
+}
+
+
+void
+delete_handoff_ring( handoff_ring *ring ) {
+  if ( ring == NULL ) {
+    die( "ring must not be NULL" );
+  }
+
+  buffer *message;
+  while ( ( message = pop_handoff_ring( ring ) ) != NULL ) {
+    free_buffer( message );
+  }
+  xfree( ring->slots );
+  xfree( ring );
+}
+
+
+bool
+push_handoff_ring( handoff_ring *ring, buffer *message ) {
+  assert( ring != NULL );
+  assert( message != NULL );
+
+  uint32_t tail = ring->tail;
+  uint32_t head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+  if ( tail - head > ring->mask ) {
+    return false;
+  }
+  ring->slots[ tail & ring->mask ] = message;
+  __atomic_store_n( &ring->tail, tail + 1, __ATOMIC_SEQ_CST );
+
+  return true;
+}
+
+
+buffer *
+pop_handoff_ring( handoff_ring *ring ) {
+  assert( ring != NULL );
+
+  uint32_t head = ring->head;
+  if ( head == __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE ) ) {
+    return NULL;
+  }
+  buffer *message = ring->slots[ head & ring->mask ];
+  __atomic_store_n( &ring->head, head + 1, __ATOMIC_RELEASE );
+
+  return message;
+}
+
+
+bool
+handoff_ring_is_empty( handoff_ring *ring ) {
+  assert( ring != NULL );
+
+  return __atomic_load_n( &ring->head, __ATOMIC_SEQ_CST ) == __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST );
+}
+
+
+/*
+ * Called by the producer after pushing. Returns true only to the first
+ * caller since the consumer last reset the flag, which then has to wake
+ * the consumer up.
+ */
+bool
+request_handoff_ring_notification( handoff_ring *ring ) {
+  assert( ring != NULL );
+
+  return __atomic_exchange_n( &ring->notified, 1, __ATOMIC_SEQ_CST ) == 0;
+}
+
+
+/*
+ * Called by the consumer once it has drained the ring. The consumer must
+ * check handoff_ring_is_empty() afterwards, since a buffer pushed before the
+ * reset did not produce a notification.
+ */
+void
+reset_handoff_ring_notification( handoff_ring *ring ) {
+  assert( ring != NULL );
+
+  __atomic_store_n( &ring->notified, 0, __ATOMIC_SEQ_CST );
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef HANDOFF_RING_H
+#define HANDOFF_RING_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "trema.h"
+
+
+#define HANDOFF_RING_SIZE  4096
+#define HANDOFF_RING_CACHE_LINE  64
+
+
+/*
+ * Lock-free ring that hands buffers from exactly one producer thread to
+ * exactly one consumer thread. The notified flag lets the producer signal
+ * the consumer once per batch instead of once per buffer.
+ */
+typedef struct {
+  uint32_t head; // owned by the consumer
+  char head_pad[ HANDOFF_RING_CACHE_LINE - sizeof( uint32_t ) ];
+  uint32_t tail; // owned by the producer
+  char tail_pad[ HANDOFF_RING_CACHE_LINE - sizeof( uint32_t ) ];
+  uint32_t notified;
+  uint32_t mask;
+  buffer **slots;
+} handoff_ring;
+
+
+handoff_ring *create_handoff_ring( uint32_t size );
+void delete_handoff_ring( handoff_ring *ring );
+bool push_handoff_ring( handoff_ring *ring, buffer *message );
+buffer *pop_handoff_ring( handoff_ring *ring );
+bool handoff_ring_is_empty( handoff_ring *ring );
+bool request_handoff_ring_notification( handoff_ring *ring );
+void reset_handoff_ring_notification( handoff_ring *ring );
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // HANDOFF_RING_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -52,7 +52,7 @@ static uint16_t
 in_phy_port_length( const match *match ) {
   uint16_t length = 0;
   
-  if ( match->in_port.valid ) {
+  if ( match->in_phy_port.valid ) {
     length = oxm_in_phy_port.length;
   }
   return length;
@@ -25,6 +25,7 @@ extern "C" {
 #endif
 
 
+uint64_t match_fields( const match *match );
 uint16_t match_length( const match *match );
 uint16_t oxm_length( const uint16_t type );
 uint32_t oxm_attr_field( const bool attr, const enum oxm_ofb_match_fields oxm_type );
@@ -16,6 +16,7 @@
  */
 
 
+#include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include "trema.h"
@@ -64,19 +65,23 @@
 
 
 /*
- * We could have created an array of oxm structures with a match field is the 
- * index. But we chose not because not wanted to restrict ourselves on the 
- * match type value. This introduces a sligtly overhead on searching.
+ * Registered oxm modules are indexed by the OXM field code of the
+ * OFPXMC_OPENFLOW_BASIC class so that a module is found without searching.
  */
-static struct oxm **oxm_arr;
-static uint32_t nr_oxm;
-static uint32_t oxm_alloc;
+#define OXM_OFB_FIELDS ( OFPXMT_OFB_IPV6_EXTHDR + 1 )
+#define OXM_OFB_FIELD_BIT( field ) ( UINT64_C( 1 ) << ( field ) )
+
+
+static struct oxm *oxm_table[ OXM_OFB_FIELDS ];
+static uint64_t registered_fields;
 
 
 void
 register_oxm( struct oxm *oxm ) {
-  ALLOC_GROW( oxm_arr, nr_oxm + 1, oxm_alloc );
-  oxm_arr[ nr_oxm++ ] = oxm;
+  assert( oxm->type < OXM_OFB_FIELDS );
+
+  oxm_table[ oxm->type ] = oxm;
+  registered_fields |= OXM_OFB_FIELD_BIT( oxm->type );
 }
 
 
@@ -126,23 +131,72 @@ init_oxm( void ) {
 
 uint32_t
 oxm_attr_field( const bool attr, const enum oxm_ofb_match_fields oxm_type ) {
-  uint32_t field = 0;
-
-  for ( uint32_t i = 0; i < nr_oxm && !field; i++ ) {
-    field = oxm_arr[ i ]->oxm_attr_field( attr, oxm_type );
+  if ( oxm_type >= OXM_OFB_FIELDS || oxm_table[ oxm_type ] == NULL ) {
+    return 0;
   }
-  return field;
+  return oxm_table[ oxm_type ]->oxm_attr_field( attr, oxm_type );
 }
 
 
 uint16_t
 oxm_length( const uint16_t type ) {
-  for ( uint32_t i = 0; i < nr_oxm; i++ ) {
-    if ( oxm_arr[ i ]->type == type ) {
-      return oxm_arr[ i ]->length;
-    }
+  if ( type >= OXM_OFB_FIELDS || oxm_table[ type ] == NULL ) {
+    return 0;
   }
-  return 0;
+  return oxm_table[ type ]->length;
+}
+
+
+#define MATCH_FIELD( attr, field ) ( match->attr.valid ? OXM_OFB_FIELD_BIT( field ) : 0 )
+#define MATCH_ARRAY_FIELD( attr, field ) ( match->attr[ 0 ].valid ? OXM_OFB_FIELD_BIT( field ) : 0 )
+
+
+uint64_t
+match_fields( const match *match ) {
+  assert( match );
+
+  uint64_t fields = MATCH_FIELD( in_port, OFPXMT_OFB_IN_PORT ) |
+                    MATCH_FIELD( in_phy_port, OFPXMT_OFB_IN_PHY_PORT ) |
+                    MATCH_FIELD( metadata, OFPXMT_OFB_METADATA ) |
+                    MATCH_ARRAY_FIELD( eth_dst, OFPXMT_OFB_ETH_DST ) |
+                    MATCH_ARRAY_FIELD( eth_src, OFPXMT_OFB_ETH_SRC ) |
+                    MATCH_FIELD( eth_type, OFPXMT_OFB_ETH_TYPE ) |
+                    MATCH_FIELD( vlan_vid, OFPXMT_OFB_VLAN_VID ) |
+                    MATCH_FIELD( vlan_pcp, OFPXMT_OFB_VLAN_PCP ) |
+                    MATCH_FIELD( ip_dscp, OFPXMT_OFB_IP_DSCP ) |
+                    MATCH_FIELD( ip_ecn, OFPXMT_OFB_IP_ECN ) |
+                    MATCH_FIELD( ip_proto, OFPXMT_OFB_IP_PROTO ) |
+                    MATCH_FIELD( ipv4_src, OFPXMT_OFB_IPV4_SRC ) |
+                    MATCH_FIELD( ipv4_dst, OFPXMT_OFB_IPV4_DST ) |
+                    MATCH_FIELD( tcp_src, OFPXMT_OFB_TCP_SRC ) |
+                    MATCH_FIELD( tcp_dst, OFPXMT_OFB_TCP_DST ) |
+                    MATCH_FIELD( udp_src, OFPXMT_OFB_UDP_SRC ) |
+                    MATCH_FIELD( udp_dst, OFPXMT_OFB_UDP_DST ) |
+                    MATCH_FIELD( sctp_src, OFPXMT_OFB_SCTP_SRC ) |
+                    MATCH_FIELD( sctp_dst, OFPXMT_OFB_SCTP_DST ) |
+                    MATCH_FIELD( icmpv4_type, OFPXMT_OFB_ICMPV4_TYPE ) |
+                    MATCH_FIELD( icmpv4_code, OFPXMT_OFB_ICMPV4_CODE ) |
+                    MATCH_FIELD( arp_op, OFPXMT_OFB_ARP_OP ) |
+                    MATCH_FIELD( arp_spa, OFPXMT_OFB_ARP_SPA ) |
+                    MATCH_FIELD( arp_tpa, OFPXMT_OFB_ARP_TPA ) |
+                    MATCH_ARRAY_FIELD( arp_sha, OFPXMT_OFB_ARP_SHA ) |
+                    MATCH_ARRAY_FIELD( arp_tha, OFPXMT_OFB_ARP_THA ) |
+                    MATCH_ARRAY_FIELD( ipv6_src, OFPXMT_OFB_IPV6_SRC ) |
+                    MATCH_ARRAY_FIELD( ipv6_dst, OFPXMT_OFB_IPV6_DST ) |
+                    MATCH_FIELD( ipv6_flabel, OFPXMT_OFB_IPV6_FLABEL ) |
+                    MATCH_FIELD( icmpv6_type, OFPXMT_OFB_ICMPV6_TYPE ) |
+                    MATCH_FIELD( icmpv6_code, OFPXMT_OFB_ICMPV6_CODE ) |
+                    MATCH_ARRAY_FIELD( ipv6_nd_target, OFPXMT_OFB_IPV6_ND_TARGET ) |
+                    MATCH_ARRAY_FIELD( ipv6_nd_sll, OFPXMT_OFB_IPV6_ND_SLL ) |
+                    MATCH_ARRAY_FIELD( ipv6_nd_tll, OFPXMT_OFB_IPV6_ND_TLL ) |
+                    MATCH_FIELD( mpls_label, OFPXMT_OFB_MPLS_LABEL ) |
+                    MATCH_FIELD( mpls_tc, OFPXMT_OFB_MPLS_TC ) |
+                    MATCH_FIELD( mpls_bos, OFPXMT_OFB_MPLS_BOS ) |
+                    MATCH_FIELD( pbb_isid, OFPXMT_OFB_PBB_ISID ) |
+                    MATCH_FIELD( tunnel_id, OFPXMT_OFB_TUNNEL_ID ) |
+                    MATCH_FIELD( ipv6_exthdr, OFPXMT_OFB_IPV6_EXTHDR );
+
+  return fields & registered_fields;
 }
 
 
@@ -150,9 +204,10 @@ uint16_t
 match_length( const match *match ) {
   assert( match );
   uint16_t length = 0;
-  
-  for ( uint32_t i  = 0; i < nr_oxm; i++ ) {
-    length = ( uint16_t )( length + oxm_arr[ i ]->match_length( match ) );
+
+  for ( uint64_t fields = match_fields( match ); fields != 0; fields &= fields - 1 ) {
+    struct oxm *oxm = oxm_table[ __builtin_ctzll( fields ) ];
+    length = ( uint16_t )( length + oxm->match_length( match ) );
   }
   return length;
 }
@@ -160,8 +215,9 @@ match_length( const match *match ) {
 
 static void
 _pack_oxm( struct ofp_match *ofp_match, const match *match ) {
-  for ( uint32_t i = 0; i < nr_oxm; i++ ) {
-    oxm_arr[ i ]->pack( ofp_match, match );
+  for ( uint64_t fields = match_fields( match ); fields != 0; fields &= fields - 1 ) {
+    struct oxm *oxm = oxm_table[ __builtin_ctzll( fields ) ];
+    oxm->pack( ofp_match, match );
   }
 }
 void ( *pack_oxm )( struct ofp_match *ofp_match, const match *match ) = _pack_oxm;
@@ -33,11 +33,23 @@ static char const * const switch_usage[] = {
   "  -c --server_ip=ipv4_addr                   set server's ipv4 address to connect to",
   "  -p --server_port=port                      set server's port to connect to",
   "  -e --switch_ports=<interface/logical port> one or more comma separated list of switch ports",
+  "     --packet_in_port_rate=rate[:burst]      limit packet-ins per second from each port",
+  "     --packet_in_reason_rate=rate[:burst]    limit packet-ins per second for each reason",
+  "     --packet_in_coalesce=count[:msec]       send only the first count packet-ins per microflow within msec (default 1000)",
+  "     --busy_poll=usec                        keep polling the datapath for usec after a large batch",
   "  -h --help                                  display usage and exit",
   NULL
 };
 
 
+enum {
+  OPT_PACKET_IN_PORT_RATE = 0x100,
+  OPT_PACKET_IN_REASON_RATE,
+  OPT_PACKET_IN_COALESCE,
+  OPT_BUSY_POLL,
+};
+
+
 static void
 print_usage( const struct switch_arguments *args, int exit_code ) {
   fprintf( stderr, "Usage: %s [options] \n", args->progname );
@@ -59,11 +71,28 @@ set_default_opts( struct switch_arguments *args, const struct option long_option
   args->server_ip = 0x7f000001,
   args->server_port = 6633,
   args->max_flow_entries = UINT8_MAX;
+  args->packet_in_port_rate = 0;
+  args->packet_in_port_burst = 0;
+  args->packet_in_reason_rate = 0;
+  args->packet_in_reason_burst = 0;
+  args->packet_in_coalesce_count = 0;
+  args->packet_in_coalesce_window = 1000;
+  args->busy_poll = 0;
   args->run_as_daemon = false,
   args->options = long_options;
 }
 
 
+static void
+parse_pair( const char *arg, uint32_t *first, uint32_t *second ) {
+  char *end = NULL;
+  *first = ( uint32_t ) strtoul( arg, &end, 0 );
+  if ( end != NULL && *end == ':' ) {
+    *second = ( uint32_t ) strtoul( end + 1, NULL, 0 );
+  }
+}
+
+
 void 
 _parse_options( struct switch_arguments *args, int argc, char **argv ) {
   static struct option long_options[] = {
@@ -74,6 +103,10 @@ _parse_options( struct switch_arguments *args, int argc, char **argv ) {
     { "server_ip", required_argument, 0, 'c' },
     { "server_port", required_argument, 0, 'p' },
     { "switch_ports", required_argument, 0, 'e' },
+    { "packet_in_port_rate", required_argument, 0, OPT_PACKET_IN_PORT_RATE },
+    { "packet_in_reason_rate", required_argument, 0, OPT_PACKET_IN_REASON_RATE },
+    { "packet_in_coalesce", required_argument, 0, OPT_PACKET_IN_COALESCE },
+    { "busy_poll", required_argument, 0, OPT_BUSY_POLL },
     { "help", no_argument, 0, 'h' },
     { 0, 0, 0, 0 },
   };
@@ -134,6 +167,26 @@ _parse_options( struct switch_arguments *args, int argc, char **argv ) {
           args->datapath_ports = optarg;
         }
         break;
+      case OPT_PACKET_IN_PORT_RATE:
+        if ( optarg ) {
+          parse_pair( optarg, &args->packet_in_port_rate, &args->packet_in_port_burst );
+        }
+        break;
+      case OPT_PACKET_IN_REASON_RATE:
+        if ( optarg ) {
+          parse_pair( optarg, &args->packet_in_reason_rate, &args->packet_in_reason_burst );
+        }
+        break;
+      case OPT_PACKET_IN_COALESCE:
+        if ( optarg ) {
+          parse_pair( optarg, &args->packet_in_coalesce_count, &args->packet_in_coalesce_window );
+        }
+        break;
+      case OPT_BUSY_POLL:
+        if ( optarg ) {
+          args->busy_poll = ( uint32_t ) strtoul( optarg, NULL, 0 );
+        }
+        break;
       default:
         break;
     }
@@ -26,6 +26,7 @@ extern "C" {
 
 
 #include "trema.h"
+#include "handoff-ring.h"
 
 
 struct switch_arguments {
@@ -35,12 +36,19 @@ struct switch_arguments {
 
   const char *datapath_ports;
   uint64_t datapath_id;
-  int efd[ 2 ]; // event descriptors associated with the to_protocol_queue
-  message_queue *to_protocol_queue;
+  int efd[ 2 ]; // event descriptors associated with the to_protocol_ring
+  handoff_ring *to_protocol_ring;
   uint32_t server_ip;
   bool run_as_daemon;
   uint16_t server_port;
   uint16_t max_flow_entries;
+  uint32_t packet_in_port_rate;
+  uint32_t packet_in_port_burst;
+  uint32_t packet_in_reason_rate;
+  uint32_t packet_in_reason_burst;
+  uint32_t packet_in_coalesce_count;
+  uint32_t packet_in_coalesce_window;
+  uint32_t busy_poll;
 }; 
 
 
@@ -24,6 +24,7 @@
 #include "trema.h"
 #include "ofdp.h"
 #include "action-helper.h"
+#include "decode-helper.h"
 #include "group-helper.h"
 #include "instruction-helper.h"
 #include "oxm-helper.h"
@@ -131,6 +132,51 @@ _handle_get_config_request( const uint32_t transaction_id, void * user_data ) {
 void ( *handle_get_config_request )( const uint32_t transaction_id, void *user_data ) = _handle_get_config_request;
 
 
+static void
+_handle_set_async( const uint32_t transaction_id, uint32_t packet_in_mask[ 2 ], uint32_t port_status_mask[ 2 ],
+                   uint32_t flow_removed_mask[ 2 ], void *user_data ) {
+  UNUSED( user_data );
+
+  async_config config;
+  memcpy( config.packet_in_mask, packet_in_mask, sizeof( config.packet_in_mask ) );
+  memcpy( config.port_status_mask, port_status_mask, sizeof( config.port_status_mask ) );
+  memcpy( config.flow_removed_mask, flow_removed_mask, sizeof( config.flow_removed_mask ) );
+  OFDPE ret = set_async_config( &config );
+  if ( ret != OFDPE_SUCCESS ) {
+    uint16_t type = OFPET_BAD_REQUEST;
+    uint16_t code = OFPBRC_EPERM;
+    get_ofp_error( ret, &type, &code );
+    send_error_message( transaction_id, type, code );
+  }
+}
+void ( *handle_set_async )( const uint32_t transaction_id, uint32_t packet_in_mask[ 2 ], uint32_t port_status_mask[ 2 ],
+                            uint32_t flow_removed_mask[ 2 ], void *user_data ) = _handle_set_async;
+
+
+static void
+_handle_get_async_request( const uint32_t transaction_id, void *user_data ) {
+  UNUSED( user_data );
+
+  async_config config;
+  memset( &config, 0, sizeof( async_config ) );
+
+  OFDPE ret = get_async_config( &config );
+  if ( ret != OFDPE_SUCCESS ) {
+    uint16_t type = OFPET_BAD_REQUEST;
+    uint16_t code = OFPBRC_EPERM;
+    get_ofp_error( ret, &type, &code );
+    send_error_message( transaction_id, type, code );
+    return;
+  }
+
+  buffer *get_async_reply = create_get_async_reply( transaction_id, config.packet_in_mask, config.port_status_mask,
+                                                    config.flow_removed_mask );
+  switch_send_openflow_message( get_async_reply );
+  free_buffer( get_async_reply );
+}
+void ( *handle_get_async_request )( const uint32_t transaction_id, void *user_data ) = _handle_get_async_request;
+
+
 static void
 _handle_echo_request( const uint32_t transaction_id, const buffer *body, void *user_data ) {
   UNUSED( user_data );
@@ -148,32 +194,165 @@ create_assign_instruction_set( list_element *list, uint8_t table_id ) {
   if ( ret == OFDPE_SUCCESS ) {
     return ins_set;
   }
+  delete_instruction_set( ins_set );
   return NULL;
 }
 
 
+static match *
+create_assign_match( const oxm_matches *oxm ) {
+  match *match = create_match();
+  if ( oxm != NULL && oxm->n_matches > 0 ) {
+    for ( list_element *e = oxm->list; e != NULL; e = e->next ) {
+      oxm_match_header *hdr = e->data;
+      assign_match( match, hdr );
+    }
+  }
+  return match;
+}
+
+
+/*
+ * Consecutive OFPFC_ADD flow mods are queued and added to the flow tables
+ * in one pipeline critical section. The queue is flushed when it is full,
+ * once all messages received in an event loop iteration are handled, and
+ * before any message that may observe the flow tables is handled.
+ */
+#define FLOW_MOD_BATCH_SIZE 256
+
+
+typedef struct {
+  uint32_t transaction_id;
+  uint32_t buffer_id;
+} pending_flow_mod;
+
+
+static flow_entry_addition flow_mod_additions[ FLOW_MOD_BATCH_SIZE ];
+static pending_flow_mod pending_flow_mods[ FLOW_MOD_BATCH_SIZE ];
+static uint32_t n_pending_flow_mods = 0;
+static struct protocol *flow_mod_protocol = NULL;
+static bool flow_mod_flush_scheduled = false;
+
+
 static void
-handle_flow_mod_add( const uint32_t transaction_id, const uint64_t cookie, 
-                     const uint64_t cookie_mask, const uint8_t table_id,
-                     const uint16_t idle_timeout, const uint16_t hard_timeout,
-                     const uint16_t priority, const uint32_t buffer_id,
-                     const uint16_t flags, const oxm_matches *oxm,
-                     const openflow_instructions *instructions,
-                     struct protocol *protocol ) {
-  UNUSED( cookie_mask );
+execute_buffered_packet( const uint32_t transaction_id, const uint32_t buffer_id ) {
+  action_list *actions = create_action_list();
+  action *action = create_action_output( OFPP_TABLE, UINT16_MAX );
+  append_action( actions, action );
+  OFDPE ret = execute_packet_out( buffer_id, 0, actions, NULL );
+  delete_action_list( actions );
+  if ( ret != OFDPE_SUCCESS ) {
+    uint16_t type = OFPET_FLOW_MOD_FAILED;
+    uint16_t code = OFPFMFC_UNKNOWN;
+    get_ofp_error( ret, &type, &code );
+    send_error_message( transaction_id, type, code );
+  }
+}
+
+
+static void
+flush_flow_mods( void ) {
+  if ( n_pending_flow_mods == 0 ) {
+    return;
+  }
+
+  uint32_t n_flow_mods = n_pending_flow_mods;
+  n_pending_flow_mods = 0;
+
+  OFDPE ret = add_flow_entries( flow_mod_additions, n_flow_mods );
+
+  bool packet_out = false;
+  for ( uint32_t i = 0; i < n_flow_mods; i++ ) {
+    OFDPE result = ret == OFDPE_SUCCESS ? flow_mod_additions[ i ].result : ret;
+    uint32_t transaction_id = pending_flow_mods[ i ].transaction_id;
+    if ( result != OFDPE_SUCCESS ) {
+      error( "Failed to add a flow entry ( ret = %d ).", result );
+      free_flow_entry( flow_mod_additions[ i ].entry );
+
+      uint16_t type = OFPET_FLOW_MOD_FAILED;
+      uint16_t code = OFPFMFC_UNKNOWN;
+      get_ofp_error( result, &type, &code );
+      send_error_message( transaction_id, type, code );
+      continue;
+    }
+
+    if ( pending_flow_mods[ i ].buffer_id != OFP_NO_BUFFER ) {
+      execute_buffered_packet( transaction_id, pending_flow_mods[ i ].buffer_id );
+      packet_out = true;
+    }
+  }
+
+  if ( packet_out && flow_mod_protocol != NULL ) {
+    wakeup_datapath( flow_mod_protocol );
+  }
+}
+
+
+static void
+flush_flow_mods_in_event_loop( void *user_data ) {
+  UNUSED( user_data );
+
+  flow_mod_flush_scheduled = false;
+  flush_flow_mods();
+}
+
+
+// A one-shot timer that expires right away runs in the next event loop
+// iteration, after the messages received in this one are handled. The
+// external callback is not used since it has a single slot per thread
+// that other requests share.
+static bool
+schedule_flow_mod_flush( void ) {
+  struct itimerspec interval = { { 0, 0 }, { 0, 1 } };
+  return add_timer_event_callback_safe( &interval, flush_flow_mods_in_event_loop, NULL );
+}
+
+
+static void
+queue_flow_mod_add( const uint32_t transaction_id, const uint8_t table_id, const uint32_t buffer_id,
+                    const uint16_t flags, flow_entry *entry, struct protocol *protocol ) {
+  flow_entry_addition *addition = &flow_mod_additions[ n_pending_flow_mods ];
+  addition->table_id = table_id;
+  addition->flags = flags;
+  addition->entry = entry;
+  addition->result = OFDPE_SUCCESS;
+  pending_flow_mods[ n_pending_flow_mods ].transaction_id = transaction_id;
+  pending_flow_mods[ n_pending_flow_mods ].buffer_id = buffer_id;
+  n_pending_flow_mods++;
+  flow_mod_protocol = protocol;
+
+  if ( !flow_mod_flush_scheduled ) {
+    flow_mod_flush_scheduled = schedule_flow_mod_flush();
+  }
+  if ( n_pending_flow_mods == FLOW_MOD_BATCH_SIZE || !flow_mod_flush_scheduled ) {
+    flush_flow_mods();
+  }
+}
+
+
+/*
+ * Returns NULL if an error is sent back. Takes the ownership of match and
+ * instruction_set either way.
+ */
+static flow_entry *
+create_flow_mod_entry( const uint32_t transaction_id, const uint64_t cookie,
+                       const uint8_t table_id, const uint16_t idle_timeout,
+                       const uint16_t hard_timeout, const uint16_t priority,
+                       const uint16_t flags, match *match,
+                       instruction_set *instruction_set ) {
   /*
    * currently if flags set OFPFF_SEND_FLOW_REM and OFPFF_RESET_COUNTS are the only allowed value.
    */
   if ( ( flags & ~( OFPFF_SEND_FLOW_REM | OFPFF_RESET_COUNTS ) ) != 0 ) {
     send_error_message( transaction_id, OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_FLAGS );
-    return;
+    goto error;
   }
   /*
    * The use of OFPTT_ALL is only valid for delete requests.
    */
   if ( table_id == OFPTT_ALL ) {
     send_error_message( transaction_id, OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID );
-    return;
+    goto error;
   }
   /*
    * If no buffered packet is associated with a flow mod it must be set
@@ -181,26 +360,8 @@ handle_flow_mod_add( const uint32_t transaction_id, const uint64_t cookie,
    * controller by a packet-in message.
    */
 
-  match *match = create_match();
-  if ( oxm != NULL && oxm->n_matches > 0 ) {
-    
-#ifdef DEBUG    
-    char oxm_str[ 2048 ];
-    match_to_string( oxm, oxm_str, sizeof( oxm_str ) );
-    printf( "%s\n", oxm_str );
-#endif
-    
-    for ( list_element *e = oxm->list; e != NULL; e = e->next ) {
-      oxm_match_header *hdr = e->data;
-      assign_match( match, hdr );
-    }
-  }
-
-  instruction_set *instruction_set = create_assign_instruction_set( instructions->list, table_id );
   if ( instruction_set == NULL ) {
-    send_error_message( transaction_id, OFPET_FLOW_MOD_FAILED, OFPBIC_UNSUP_INST );
-    xfree( match );
-    return;
+    instruction_set = create_instruction_set();
   }
 
   /*
@@ -218,39 +379,133 @@ handle_flow_mod_add( const uint32_t transaction_id, const uint64_t cookie,
      * TODO we should send a more appropriate error once we worked out the
      * datapath errors.
      */
-    delete_instruction_set( instruction_set );
-    xfree( match );
     send_error_message( transaction_id, OFPET_FLOW_MOD_FAILED, OFPFMFC_UNKNOWN );
+    goto error;
+  }
+
+  return new_entry;
+
+error:
+  if ( instruction_set != NULL ) {
+    delete_instruction_set( instruction_set );
+  }
+  delete_match( match );
+  return NULL;
+}
+
+
+static void
+handle_flow_mod_add( const uint32_t transaction_id, const uint64_t cookie, 
+                     const uint64_t cookie_mask, const uint8_t table_id,
+                     const uint16_t idle_timeout, const uint16_t hard_timeout,
+                     const uint16_t priority, const uint32_t buffer_id,
+                     const uint16_t flags, match *match,
+                     instruction_set *ins_set, struct protocol *protocol ) {
+  UNUSED( cookie_mask );
+
+  flow_entry *new_entry = create_flow_mod_entry( transaction_id, cookie, table_id, idle_timeout, hard_timeout,
+                                                 priority, flags, match, ins_set );
+  if ( new_entry != NULL ) {
+    queue_flow_mod_add( transaction_id, table_id, buffer_id, flags, new_entry, protocol );
+  }
+}
+
+
+/*
+ * Bundles ( ONF extension 230 ) of OFPFC_ADD flow mods. Flow entries added
+ * to a bundle are validated and staged in the datapath, and are added to
+ * the flow tables all at once when the bundle is committed.
+ */
+#define MAX_BUNDLES 16
+
+
+typedef struct {
+  uint32_t bundle_id;
+  uint16_t flags;
+  bool closed;
+  flow_entry_bundle *entries;
+} flow_mod_bundle;
+
+
+static list_element *bundles = NULL;
+static uint32_t n_bundles = 0;
+// the bundle that the flow mod being handled is added to
+static flow_mod_bundle *staging_bundle = NULL;
+
+
+static void
+send_bundle_error( const uint32_t transaction_id, const uint16_t code ) {
+  buffer *error = create_error_experimenter( transaction_id, OFPET_EXPERIMENTER, code, ONF_EXPERIMENTER_ID, NULL );
+  switch_send_openflow_message( error );
+  free_buffer( error );
+}
+
+
+static flow_mod_bundle *
+lookup_bundle( const uint32_t bundle_id ) {
+  for ( list_element *e = bundles; e != NULL; e = e->next ) {
+    flow_mod_bundle *bundle = e->data;
+    if ( bundle->bundle_id == bundle_id ) {
+      return bundle;
+    }
+  }
+
+  return NULL;
+}
+
+
+static void
+delete_bundle( flow_mod_bundle *bundle ) {
+  delete_element( &bundles, bundle );
+  n_bundles--;
+  delete_flow_entry_bundle( bundle->entries );
+  xfree( bundle );
+}
+
+
+// Bundles belong to the controller connection that opened them.
+void
+discard_bundles( void ) {
+  while ( bundles != NULL ) {
+    delete_bundle( bundles->data );
+  }
+  staging_bundle = NULL;
+}
+
+
+static void
+stage_flow_mod_add( const uint32_t transaction_id, const uint64_t cookie, const uint8_t table_id,
+                    const uint16_t idle_timeout, const uint16_t hard_timeout,
+                    const uint16_t priority, const uint32_t buffer_id,
+                    const uint16_t flags, match *match,
+                    instruction_set *ins_set ) {
+  assert( staging_bundle != NULL );
+
+  // buffered packets cannot be held until the bundle is committed
+  if ( buffer_id != OFP_NO_BUFFER ) {
+    send_bundle_error( transaction_id, ONFERR_ET_MSG_UNSUP );
+    if ( ins_set != NULL ) {
+      delete_instruction_set( ins_set );
+    }
+    delete_match( match );
     return;
   }
 
-  OFDPE ret = add_flow_entry( table_id, new_entry, flags );
+  flow_entry *new_entry = create_flow_mod_entry( transaction_id, cookie, table_id, idle_timeout, hard_timeout,
+                                                 priority, flags, match, ins_set );
+  if ( new_entry == NULL ) {
+    return;
+  }
+
+  OFDPE ret = stage_flow_entry( staging_bundle->entries, table_id, new_entry, flags );
   if ( ret != OFDPE_SUCCESS ) {
-    error( "Failed to add a flow entry ( ret = %d ).", ret );
-    delete_instruction_set( instruction_set );
-    xfree( match );
+    error( "Failed to stage a flow entry ( ret = %d ).", ret );
+    free_flow_entry( new_entry );
 
     uint16_t type = OFPET_FLOW_MOD_FAILED;
     uint16_t code = OFPFMFC_UNKNOWN;
     get_ofp_error( ret, &type, &code );
     send_error_message( transaction_id, type, code );
-    return;
-  }
-
-  if ( buffer_id != OFP_NO_BUFFER ) {
-    action_list *actions = create_action_list();
-    action *action = create_action_output( OFPP_TABLE, UINT16_MAX );
-    append_action( actions, action );
-    ret = execute_packet_out( buffer_id, 0, actions, NULL );
-    delete_action_list( actions );
-    if ( ret != OFDPE_SUCCESS ) {
-      uint16_t type = OFPET_FLOW_MOD_FAILED;
-      uint16_t code = OFPFMFC_UNKNOWN;
-      get_ofp_error( ret, &type, &code );
-      send_error_message( transaction_id, type, code );
-      return;
-    }
-    wakeup_datapath( protocol );
   }
 }
 
@@ -258,29 +513,9 @@ handle_flow_mod_add( const uint32_t transaction_id, const uint64_t cookie,
 static void
 handle_flow_mod_delete( const uint32_t transaction_id, const uint64_t cookie,
                         const uint64_t cookie_mask, const uint8_t table_id,
-                        const uint16_t idle_timeout, const uint16_t hard_timeout,
-                        const uint16_t priority, const uint32_t buffer_id,
-                        const uint32_t out_port, const uint32_t out_group,
-                        const uint16_t flags, const oxm_matches *oxm_match,
-                        const openflow_instructions *instructions,
+                        const uint16_t priority, const uint32_t out_port,
+                        const uint32_t out_group, match *match,
                         const bool strict ) {
-
-  UNUSED( transaction_id );
-  UNUSED( idle_timeout );
-  UNUSED( hard_timeout );
-  UNUSED( priority );
-  UNUSED( buffer_id );
-  UNUSED( flags );
-  UNUSED( instructions );
-  
-  match *match = create_match();
-  if ( oxm_match != NULL && oxm_match->n_matches > 0 ) {
-    for ( list_element *e = oxm_match->list; e != NULL; e = e->next ) {
-      oxm_match_header *hdr = e->data;
-      assign_match( match, hdr );
-    }
-  }
-
   OFDPE ret = OFDPE_FAILED;
   if ( strict ) {
     ret = delete_flow_entry_strict( table_id, match, cookie, cookie_mask, priority, out_port, out_group );
@@ -305,27 +540,14 @@ handle_flow_mod_mod( const uint32_t transaction_id, const uint64_t cookie,
                      const uint64_t cookie_mask, const uint8_t table_id,
                      const uint16_t idle_timeout, const uint16_t hard_timeout,
                      const uint16_t priority, const uint32_t buffer_id,
-                     const uint16_t flags, const oxm_matches *oxm,
-                     const openflow_instructions *instructions,
-                     const bool strict, struct protocol *protocol ) {
-  UNUSED( transaction_id );
-
-  match *match = create_match( );
-  if ( oxm != NULL && oxm->n_matches > 0 ) {
-    for ( list_element *e = oxm->list; e != NULL; e = e->next ) {
-      oxm_match_header *hdr = e->data;
-      assign_match( match, hdr );
-    }
-  }
-  instruction_set *ins_set = NULL;
-  if ( instructions != NULL ) {
-    ins_set = create_instruction_set();
-    assign_instructions( ins_set, instructions->list, table_id );
-  }
-
+                     const uint16_t flags, match *match,
+                     instruction_set *ins_set, const bool strict,
+                     struct protocol *protocol ) {
   OFDPE ret = update_or_add_flow_entry( table_id, match, cookie, cookie_mask, priority, idle_timeout, hard_timeout,
                                         flags, strict, ins_set );
-  delete_instruction_set( ins_set );
+  if ( ins_set != NULL ) {
+    delete_instruction_set( ins_set );
+  }
   delete_match( match );
   if ( ret != OFDPE_SUCCESS ) {
     uint16_t type = OFPET_FLOW_MOD_FAILED;
@@ -353,27 +575,47 @@ handle_flow_mod_mod( const uint32_t transaction_id, const uint64_t cookie,
 }
 
 
+/*
+ * Dispatches a decoded flow mod. Takes the ownership of match and ins_set.
+ * ins_set is NULL if the flow mod carries no instructions.
+ */
 static void
-_handle_flow_mod( const uint32_t transaction_id,
-                  const uint64_t cookie,
-                  const uint64_t cookie_mask,
-                  const uint8_t table_id,
-                  const uint8_t command,
-                  const uint16_t idle_timeout,
-                  const uint16_t hard_timeout,
-                  const uint16_t priority,
-                  const uint32_t buffer_id,
-                  const uint32_t out_port,
-                  const uint32_t out_group,
-                  const uint16_t flags,
-                  const oxm_matches *oxm,
-                  const openflow_instructions *instructions,
-                  void *user_data
-  ) {
-  assert( user_data );
-  struct protocol *protocol = user_data;
+dispatch_flow_mod( const uint32_t transaction_id,
+                   const uint64_t cookie,
+                   const uint64_t cookie_mask,
+                   const uint8_t table_id,
+                   const uint8_t command,
+                   const uint16_t idle_timeout,
+                   const uint16_t hard_timeout,
+                   const uint16_t priority,
+                   const uint32_t buffer_id,
+                   const uint32_t out_port,
+                   const uint32_t out_group,
+                   const uint16_t flags,
+                   match *match,
+                   instruction_set *ins_set,
+                   struct protocol *protocol ) {
   bool strict = false;
 
+  if ( staging_bundle != NULL ) {
+    if ( command == OFPFC_ADD ) {
+      stage_flow_mod_add( transaction_id, cookie, table_id, idle_timeout, hard_timeout,
+                          priority, buffer_id, flags, match, ins_set );
+    }
+    else {
+      send_bundle_error( transaction_id, ONFERR_ET_MSG_UNSUP );
+      if ( ins_set != NULL ) {
+        delete_instruction_set( ins_set );
+      }
+      delete_match( match );
+    }
+    return;
+  }
+
+  if ( command != OFPFC_ADD ) {
+    flush_flow_mods();
+  }
+
   switch ( command ) {
     case OFPFC_ADD:
       /*
@@ -383,8 +625,8 @@ _handle_flow_mod( const uint32_t transaction_id,
        */
       handle_flow_mod_add( transaction_id, cookie, cookie_mask,
                            table_id, idle_timeout, hard_timeout,
-                           priority, buffer_id, flags, oxm,
-                           instructions, protocol );
+                           priority, buffer_id, flags, match,
+                           ins_set, protocol );
       break;
     case OFPFC_MODIFY:
       /*
@@ -395,38 +637,84 @@ _handle_flow_mod( const uint32_t transaction_id,
        */
       handle_flow_mod_mod( transaction_id, cookie, cookie_mask, table_id,
                            idle_timeout, hard_timeout, priority, buffer_id,
-                           flags, oxm, instructions, strict, protocol );
+                           flags, match, ins_set, strict, protocol );
       break;
     case OFPFC_MODIFY_STRICT:
       strict = true;
       handle_flow_mod_mod( transaction_id, cookie, cookie_mask, table_id,
                            idle_timeout, hard_timeout, priority, buffer_id,
-                           flags, oxm, instructions, strict, protocol );
+                           flags, match, ins_set, strict, protocol );
       break;
     case OFPFC_DELETE:
       /*
        * The out_port and out_group introduce a constraint when matching
        * flow entries.
        */
-      handle_flow_mod_delete( transaction_id, cookie, cookie_mask,
-                              table_id, idle_timeout, hard_timeout,
-                              priority, buffer_id, out_port,
-                              out_group, flags, oxm,
-                              instructions, strict );
+      if ( ins_set != NULL ) {
+        delete_instruction_set( ins_set );
+      }
+      handle_flow_mod_delete( transaction_id, cookie, cookie_mask, table_id,
+                              priority, out_port, out_group, match, strict );
       break;
     case OFPFC_DELETE_STRICT:
       strict = true;
+      if ( ins_set != NULL ) {
+        delete_instruction_set( ins_set );
+      }
       handle_flow_mod_delete( transaction_id, cookie, cookie_mask, table_id,
-                              idle_timeout, hard_timeout, priority, buffer_id,
-                              out_port, out_group, flags, oxm,
-                              instructions, strict );
+                              priority, out_port, out_group, match, strict );
       break;
     default:
       warn( "Undefined flow mod command type %d", command );
       send_error_message( transaction_id, OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_COMMAND );
+      if ( ins_set != NULL ) {
+        delete_instruction_set( ins_set );
+      }
+      delete_match( match );
       break;
   }
 }
+
+
+static void
+_handle_flow_mod( const uint32_t transaction_id,
+                  const uint64_t cookie,
+                  const uint64_t cookie_mask,
+                  const uint8_t table_id,
+                  const uint8_t command,
+                  const uint16_t idle_timeout,
+                  const uint16_t hard_timeout,
+                  const uint16_t priority,
+                  const uint32_t buffer_id,
+                  const uint32_t out_port,
+                  const uint32_t out_group,
+                  const uint16_t flags,
+                  const oxm_matches *oxm,
+                  const openflow_instructions *instructions,
+                  void *user_data
+  ) {
+  assert( user_data );
+
+#ifdef DEBUG
+  if ( oxm != NULL && oxm->n_matches > 0 ) {
+    char oxm_str[ 2048 ];
+    match_to_string( oxm, oxm_str, sizeof( oxm_str ) );
+    printf( "%s\n", oxm_str );
+  }
+#endif
+
+  instruction_set *ins_set = NULL;
+  if ( instructions != NULL && ( command == OFPFC_ADD || command == OFPFC_MODIFY || command == OFPFC_MODIFY_STRICT ) ) {
+    ins_set = create_assign_instruction_set( instructions->list, table_id );
+    if ( ins_set == NULL ) {
+      send_error_message( transaction_id, OFPET_BAD_INSTRUCTION, OFPBIC_UNSUP_INST );
+      return;
+    }
+  }
+
+  dispatch_flow_mod( transaction_id, cookie, cookie_mask, table_id, command, idle_timeout, hard_timeout,
+                     priority, buffer_id, out_port, out_group, flags, create_assign_match( oxm ), ins_set, user_data );
+}
 void ( *handle_flow_mod )( const uint32_t transaction_id,
         const uint64_t cookie,
         const uint64_t cookie_mask,
@@ -444,6 +732,40 @@ void ( *handle_flow_mod )( const uint32_t transaction_id,
         void *user_data) = _handle_flow_mod;
 
 
+static void
+_handle_flow_mod_message( const buffer *message, void *user_data ) {
+  assert( message != NULL );
+  assert( user_data != NULL );
+
+  const struct ofp_flow_mod *flow_mod = message->data;
+  uint32_t transaction_id = ntohl( flow_mod->header.xid );
+  uint8_t table_id = flow_mod->table_id;
+  uint8_t command = flow_mod->command;
+  uint16_t match_len = ntohs( flow_mod->match.length );
+  uint16_t offset = ( uint16_t ) ( offsetof( struct ofp_flow_mod, match ) + match_len + PADLEN_TO_64( match_len ) );
+  uint16_t instructions_length = ( uint16_t ) ( ntohs( flow_mod->header.length ) - offset );
+
+  instruction_set *ins_set = NULL;
+  if ( instructions_length > 0 && ( command == OFPFC_ADD || command == OFPFC_MODIFY || command == OFPFC_MODIFY_STRICT ) ) {
+    const struct ofp_instruction *instructions = ( const struct ofp_instruction * ) ( ( const char * ) flow_mod + offset );
+    OFDPE ret = decode_instructions( instructions, instructions_length, &ins_set );
+    if ( ret != OFDPE_SUCCESS ) {
+      uint16_t type = OFPET_BAD_INSTRUCTION;
+      uint16_t code = OFPBIC_UNSUP_INST;
+      get_ofp_error( ret, &type, &code );
+      send_error_message( transaction_id, type, code );
+      return;
+    }
+  }
+
+  dispatch_flow_mod( transaction_id, ntohll( flow_mod->cookie ), ntohll( flow_mod->cookie_mask ), table_id, command,
+                     ntohs( flow_mod->idle_timeout ), ntohs( flow_mod->hard_timeout ), ntohs( flow_mod->priority ),
+                     ntohl( flow_mod->buffer_id ), ntohl( flow_mod->out_port ), ntohl( flow_mod->out_group ),
+                     ntohs( flow_mod->flags ), decode_match( &flow_mod->match ), ins_set, user_data );
+}
+void ( *handle_flow_mod_message )( const buffer *message, void *user_data ) = _handle_flow_mod_message;
+
+
 static void
 _handle_packet_out( const uint32_t transaction_id, uint32_t buffer_id, 
                     uint32_t in_port, const openflow_actions *actions,
@@ -453,6 +775,8 @@ _handle_packet_out( const uint32_t transaction_id, uint32_t buffer_id,
 
   struct protocol *protocol = user_data;
 
+  flush_flow_mods();
+
   action_list *ac_list = create_action_list();
   for ( list_element *e = actions->list; e != NULL; e = e->next ) {
     struct ofp_action_header *ac_hdr = e->data;
@@ -474,13 +798,46 @@ void ( *handle_packet_out )( uint32_t transaction_id, uint32_t buffer_id,
                            const buffer *frame, void *user_data ) = _handle_packet_out;
 
 
+static void
+_handle_packet_out_message( const buffer *message, void *user_data ) {
+  assert( message != NULL );
+  assert( user_data != NULL );
+
+  const struct ofp_packet_out *packet_out = message->data;
+  struct protocol *protocol = user_data;
+
+  flush_flow_mods();
+
+  uint16_t actions_length = ntohs( packet_out->actions_len );
+  action_list *ac_list = decode_actions( packet_out->actions, actions_length );
+
+  buffer *frame = NULL;
+  size_t offset = offsetof( struct ofp_packet_out, actions ) + actions_length;
+  size_t frame_length = ntohs( packet_out->header.length ) - offset;
+  if ( frame_length > 0 ) {
+    frame = alloc_buffer_with_length( frame_length );
+    memcpy( append_back_buffer( frame, frame_length ), ( const char * ) packet_out + offset, frame_length );
+  }
+
+  execute_packet_out( ntohl( packet_out->buffer_id ), ntohl( packet_out->in_port ), ac_list, frame );
+  wakeup_datapath( protocol );
+  delete_action_list( ac_list );
+  if ( frame != NULL ) {
+    free_buffer( frame );
+  }
+}
+void ( *handle_packet_out_message )( const buffer *message, void *user_data ) = _handle_packet_out_message;
+
+
 static void
 _handle_port_mod( uint32_t transaction_id, uint32_t port_no, uint8_t hw_addr[],
                   uint32_t config, uint32_t mask, uint32_t advertise, void *user_data ) {
   UNUSED( hw_addr );
   UNUSED( advertise );
   UNUSED( user_data );
-  
+
+  flush_flow_mods();
+
   /*
    * the update_port_config() performs a port lookup.
    */
@@ -500,7 +857,9 @@ static void
 _handle_table_mod( uint32_t transaction_id, uint8_t table_id, uint32_t config,
   void *user_data ) {
   UNUSED( user_data );
-  
+
+  flush_flow_mods();
+
   if ( set_flow_table_config( table_id, config ) != OFDPE_SUCCESS ) {
     send_error_message( transaction_id, OFPET_TABLE_MOD_FAILED, OFPTMFC_EPERM );    
   }
@@ -517,6 +876,9 @@ _handle_group_mod( const uint32_t transaction_id,
         const list_element *buckets,
         void *user_data ) {
   UNUSED( user_data );
+
+  flush_flow_mods();
+
   switch( command ) {
     case OFPGC_ADD:
       handle_group_add( transaction_id, type, group_id, buckets );
@@ -535,6 +897,38 @@ _handle_group_mod( const uint32_t transaction_id,
 void ( *handle_group_mod )( const uint32_t transaction_id, const uint16_t command, const uint8_t type, const uint32_t group_id, const list_element *buckets, void *user_data ) = _handle_group_mod;
 
 
+static void
+_handle_group_mod_message( const buffer *message, void *user_data ) {
+  assert( message != NULL );
+  UNUSED( user_data );
+
+  const struct ofp_group_mod *group_mod = message->data;
+  uint32_t transaction_id = ntohl( group_mod->header.xid );
+  uint32_t group_id = ntohl( group_mod->group_id );
+  uint16_t buckets_length = ( uint16_t ) ( ntohs( group_mod->header.length ) - offsetof( struct ofp_group_mod, buckets ) );
+
+  flush_flow_mods();
+
+  switch( ntohs( group_mod->command ) ) {
+    case OFPGC_ADD:
+      handle_group_add_buckets( transaction_id, group_mod->type, group_id,
+                                decode_buckets( group_mod->buckets, buckets_length ) );
+      break;
+    case OFPGC_MODIFY:
+      handle_group_mod_mod_buckets( transaction_id, group_mod->type, group_id,
+                                    decode_buckets( group_mod->buckets, buckets_length ) );
+      break;
+    case OFPGC_DELETE:
+      handle_group_mod_delete( transaction_id, group_id );
+      break;
+    default:
+      send_error_message( transaction_id, OFPET_GROUP_MOD_FAILED, OFPGMFC_BAD_COMMAND );
+      break;
+  }
+}
+void ( *handle_group_mod_message )( const buffer *message, void *user_data ) = _handle_group_mod_message;
+
+
 static void
 shrink_array( struct outstanding_request outstanding_requests[], int pos ) {
   memset( &outstanding_requests[ pos ], 0, sizeof( struct outstanding_request ) );
@@ -595,6 +989,9 @@ _handle_multipart_request( uint32_t transaction_id, uint16_t type, uint16_t flag
 
   struct protocol *protocol = user_data;
   assert( protocol );
+
+  flush_flow_mods();
+
   if ( save_outstanding_request( &protocol->ctrl, transaction_id, type, flags ) == -1 ) {
     send_error_message( transaction_id, OFPET_BAD_REQUEST, OFPBRC_MULTIPART_BUFFER_OVERFLOW );
     return;
@@ -731,6 +1128,197 @@ _handle_multipart_request( uint32_t transaction_id, uint16_t type, uint16_t flag
 void ( *handle_multipart_request )( uint32_t transaction_id, uint16_t type, uint16_t flags, const buffer *body, void *user_data ) = _handle_multipart_request;
 
 
+static void
+_handle_barrier_request( uint32_t transaction_id, void *user_data ) {
+  UNUSED( user_data );
+
+  /*
+   * All flow mods received before the barrier request must be processed
+   * before the barrier reply is sent.
+   */
+  flush_flow_mods();
+
+  buffer *barrier_reply = create_barrier_reply( transaction_id );
+  switch_send_openflow_message( barrier_reply );
+  free_buffer( barrier_reply );
+}
+void ( *handle_barrier_request )( uint32_t transaction_id, void *user_data ) = _handle_barrier_request;
+
+
+static void
+send_bundle_reply( const uint32_t transaction_id, const flow_mod_bundle *bundle, const uint16_t type ) {
+  buffer *reply = create_bundle_control( transaction_id, bundle->bundle_id, type, bundle->flags );
+  switch_send_openflow_message( reply );
+  free_buffer( reply );
+}
+
+
+static void
+open_bundle( const uint32_t transaction_id, const uint32_t bundle_id, const uint16_t flags ) {
+  if ( lookup_bundle( bundle_id ) != NULL ) {
+    send_bundle_error( transaction_id, ONFERR_ET_BUNDLE_EXIST );
+    return;
+  }
+  if ( n_bundles >= MAX_BUNDLES ) {
+    send_bundle_error( transaction_id, ONFERR_ET_OUT_OF_BUNDLES );
+    return;
+  }
+  // bundles are always committed atomically and in order
+  if ( ( flags & ~( ONF_BF_ATOMIC | ONF_BF_ORDERED ) ) != 0 ) {
+    send_bundle_error( transaction_id, ONFERR_ET_BAD_FLAGS );
+    return;
+  }
+
+  flow_mod_bundle *bundle = xmalloc( sizeof( flow_mod_bundle ) );
+  bundle->bundle_id = bundle_id;
+  bundle->flags = flags;
+  bundle->closed = false;
+  bundle->entries = create_flow_entry_bundle();
+  append_to_tail( &bundles, bundle );
+  n_bundles++;
+
+  send_bundle_reply( transaction_id, bundle, ONF_BCT_OPEN_REPLY );
+}
+
+
+static void
+commit_bundle( const uint32_t transaction_id, flow_mod_bundle *bundle ) {
+  // flow mods received before the commit request are applied first
+  flush_flow_mods();
+
+  OFDPE ret = commit_flow_entry_bundle( bundle->entries );
+  if ( ret == OFDPE_SUCCESS ) {
+    send_bundle_reply( transaction_id, bundle, ONF_BCT_COMMIT_REPLY );
+  }
+  else {
+    error( "Failed to commit a bundle ( bundle_id = %#x, ret = %d ).", bundle->bundle_id, ret );
+    uint16_t type = OFPET_FLOW_MOD_FAILED;
+    uint16_t code = OFPFMFC_UNKNOWN;
+    get_ofp_error( ret, &type, &code );
+    send_error_message( transaction_id, type, code );
+    send_bundle_error( transaction_id, ONFERR_ET_MSG_FAILED );
+  }
+  // the bundle is discarded whether the commit succeeds or not
+  delete_bundle( bundle );
+}
+
+
+static void
+handle_bundle_control( const uint32_t transaction_id, const buffer *body ) {
+  struct onf_bundle_ctrl_msg ctrl;
+  size_t body_length = sizeof( ctrl ) - offsetof( struct onf_bundle_ctrl_msg, bundle_id );
+  if ( body == NULL || body->length != body_length ) {
+    send_error_message( transaction_id, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN );
+    return;
+  }
+  memcpy( &ctrl.bundle_id, body->data, body_length );
+  uint32_t bundle_id = ntohl( ctrl.bundle_id );
+  uint16_t type = ntohs( ctrl.type );
+  uint16_t flags = ntohs( ctrl.flags );
+
+  if ( type == ONF_BCT_OPEN_REQUEST ) {
+    open_bundle( transaction_id, bundle_id, flags );
+    return;
+  }
+
+  flow_mod_bundle *bundle = lookup_bundle( bundle_id );
+  if ( bundle == NULL ) {
+    send_bundle_error( transaction_id, ONFERR_ET_BAD_ID );
+    return;
+  }
+  switch ( type ) {
+    case ONF_BCT_CLOSE_REQUEST:
+      if ( bundle->closed ) {
+        send_bundle_error( transaction_id, ONFERR_ET_BUNDLE_CLOSED );
+        break;
+      }
+      bundle->closed = true;
+      send_bundle_reply( transaction_id, bundle, ONF_BCT_CLOSE_REPLY );
+      break;
+    case ONF_BCT_COMMIT_REQUEST:
+      commit_bundle( transaction_id, bundle );
+      break;
+    case ONF_BCT_DISCARD_REQUEST:
+      send_bundle_reply( transaction_id, bundle, ONF_BCT_DISCARD_REPLY );
+      delete_bundle( bundle );
+      break;
+    default:
+      send_bundle_error( transaction_id, ONFERR_ET_BAD_TYPE );
+      break;
+  }
+}
+
+
+static void
+handle_bundle_add_message( const uint32_t transaction_id, const buffer *body ) {
+  size_t header_length = offsetof( struct onf_bundle_add_msg, message ) - offsetof( struct onf_bundle_add_msg, bundle_id );
+  if ( body == NULL || body->length < header_length + sizeof( struct ofp_header ) ) {
+    send_error_message( transaction_id, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN );
+    return;
+  }
+  struct onf_bundle_add_msg add;
+  memcpy( &add.bundle_id, body->data, header_length + sizeof( struct ofp_header ) );
+  if ( ntohs( add.message.length ) != body->length - header_length ) {
+    send_bundle_error( transaction_id, ONFERR_ET_MSG_BAD_LEN );
+    return;
+  }
+
+  flow_mod_bundle *bundle = lookup_bundle( ntohl( add.bundle_id ) );
+  if ( bundle == NULL ) {
+    send_bundle_error( transaction_id, ONFERR_ET_BAD_ID );
+    return;
+  }
+  if ( bundle->closed ) {
+    send_bundle_error( transaction_id, ONFERR_ET_BUNDLE_CLOSED );
+    return;
+  }
+  if ( ntohl( add.message.xid ) != transaction_id ) {
+    send_bundle_error( transaction_id, ONFERR_ET_MSG_BAD_XID );
+    return;
+  }
+  if ( add.message.type != OFPT_FLOW_MOD ) {
+    send_bundle_error( transaction_id, ONFERR_ET_MSG_UNSUP );
+    return;
+  }
+
+  // the message is handled as usual except that flow mods are staged
+  buffer *message = alloc_buffer_with_length( body->length - header_length );
+  void *p = append_back_buffer( message, body->length - header_length );
+  memcpy( p, ( const char * ) body->data + header_length, body->length - header_length );
+  staging_bundle = bundle;
+  if ( !handle_secure_channel_message( message ) ) {
+    send_bundle_error( transaction_id, ONFERR_ET_MSG_FAILED );
+  }
+  staging_bundle = NULL;
+  free_buffer( message );
+}
+
+
+static void
+_handle_experimenter( uint32_t transaction_id, uint32_t experimenter, uint32_t exp_type,
+                      const buffer *data, void *user_data ) {
+  UNUSED( user_data );
+
+  if ( experimenter != ONF_EXPERIMENTER_ID ) {
+    send_error_message( transaction_id, OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER );
+    return;
+  }
+  switch ( exp_type ) {
+    case ONFT_BUNDLE_CONTROL:
+      handle_bundle_control( transaction_id, data );
+      break;
+    case ONFT_BUNDLE_ADD_MESSAGE:
+      handle_bundle_add_message( transaction_id, data );
+      break;
+    default:
+      send_error_message( transaction_id, OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE );
+      break;
+  }
+}
+void ( *handle_experimenter )( uint32_t transaction_id, uint32_t experimenter, uint32_t exp_type,
+                               const buffer *data, void *user_data ) = _handle_experimenter;
+
+
 /*
  * Local variables:
  * c-basic-offset: 2
@@ -37,6 +37,13 @@ void ( *handle_set_config )( const uint32_t transaction_id,
         void *user_data );
 void ( *handle_get_config_request )( const uint32_t transaction_id,
         void *user_data );
+void ( *handle_set_async )( const uint32_t transaction_id,
+        uint32_t packet_in_mask[ 2 ],
+        uint32_t port_status_mask[ 2 ],
+        uint32_t flow_removed_mask[ 2 ],
+        void *user_data );
+void ( *handle_get_async_request )( const uint32_t transaction_id,
+        void *user_data );
 void ( *handle_echo_request )( const uint32_t transaction_id, 
         const buffer *body, 
         void *user_data );
@@ -55,12 +62,16 @@ void ( *handle_flow_mod )( const uint32_t transaction_id,
         const oxm_matches *match,
         const openflow_instructions *instructions,
         void *user_data);
+void ( *handle_flow_mod_message )( const buffer *message,
+        void *user_data );
 void ( *handle_packet_out )( const uint32_t transaction_id,
         uint32_t buffer_id,
         uint32_t in_port,
         const openflow_actions *actions,
         const buffer *frame, 
         void *user_data );
+void ( *handle_packet_out_message )( const buffer *message,
+        void *user_data );
 void ( *handle_port_mod )( uint32_t transaction_id,
         uint32_t port_no,
         uint8_t hw_addr[],
@@ -78,11 +89,21 @@ void ( *handle_group_mod )( const uint32_t transaction_id,
         const uint32_t group_id,
         const list_element *buckets,
         void *user_data );
+void ( *handle_group_mod_message )( const buffer *message,
+        void *user_data );
 void ( *handle_multipart_request)( uint32_t transaction_id,
         uint16_t type,
         uint16_t flags,
         const buffer *body,
         void *user_data );
+void ( *handle_barrier_request )( uint32_t transaction_id,
+        void *user_data );
+void ( *handle_experimenter )( uint32_t transaction_id,
+        uint32_t experimenter,
+        uint32_t exp_type,
+        const buffer *data,
+        void *user_data );
+void discard_bundles( void );
 
 
 #ifdef __cplusplus
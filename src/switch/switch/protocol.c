@@ -20,8 +20,10 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include "trema.h"
 #include "ofdp.h"
@@ -138,16 +140,31 @@ handle_datapath_opf_packet( buffer *packet, struct protocol *protocol ) {
 
 static void
 handle_controller_connected( void *user_data ) {
+  // async masks set by a previous controller do not carry over
+  reset_async_config();
+
   set_hello_handler( handle_hello, user_data );
   set_features_request_handler( handle_features_request, user_data );
   set_set_config_handler( handle_set_config, user_data );
+  set_set_async_handler( handle_set_async, user_data );
+  set_get_async_request_handler( handle_get_async_request, user_data );
   set_echo_request_handler( handle_echo_request, user_data );
-  set_flow_mod_handler( handle_flow_mod, user_data );
-  set_packet_out_handler( handle_packet_out, user_data );
+  set_flow_mod_message_handler( handle_flow_mod_message, user_data );
+  set_packet_out_message_handler( handle_packet_out_message, user_data );
   set_port_mod_handler( handle_port_mod, user_data );
   set_table_mod_handler( handle_table_mod, user_data );
-  set_group_mod_handler( handle_group_mod, user_data );
+  set_group_mod_message_handler( handle_group_mod_message, user_data );
   set_multipart_request_handler( handle_multipart_request, user_data );
+  set_barrier_request_handler( handle_barrier_request, user_data );
+  switch_set_experimenter_handler( handle_experimenter, user_data );
+}
+
+
+static void
+handle_controller_disconnected( void *user_data ) {
+  UNUSED( user_data );
+
+  discard_bundles();
 }
 
 
@@ -167,6 +184,7 @@ handle_datapath_ctrl_packet( buffer *packet, struct protocol *protocol ) {
     finish_async( &protocol->thread );
   }
   set_controller_connected_handler( handle_controller_connected, protocol );
+  set_controller_disconnected_handler( handle_controller_disconnected, protocol );
 }
 
 
@@ -184,6 +202,62 @@ handle_datapath_packet( buffer *packet, struct protocol *protocol ) {
 }
 
 
+static uint64_t
+drain_datapath_packets( struct protocol *protocol, uint64_t budget ) {
+  uint64_t count = 0;
+  buffer *packet;
+  while ( count < budget && ( packet = pop_handoff_ring( protocol->input_ring ) ) != NULL ) {
+    handle_datapath_packet( packet, protocol );
+    count++;
+  }
+
+  return count;
+}
+
+
+/*
+ * After a large batch keeps polling the ring with the notification still
+ * set, so that the datapath pushes without any eventfd write. The deadline
+ * is fixed when polling starts, so the event loop gets back control after
+ * busy_poll microseconds however busy the datapath is.
+ */
+static void
+busy_poll_datapath( struct protocol *protocol ) {
+  const struct switch_arguments *args = protocol->args;
+  struct timespec interval = { args->busy_poll / 1000000, ( long ) ( args->busy_poll % 1000000 ) * 1000 };
+  struct timespec now;
+  struct timespec deadline;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  ADD_TIMESPEC( &now, &interval, &deadline );
+  while ( TIMESPEC_LESS_THEN( &now, &deadline ) ) {
+    if ( drain_datapath_packets( protocol, MAX_DATAPATH_PACKETS_PER_WAKEUP ) == 0 ) {
+      sched_yield();
+    }
+    clock_gettime( CLOCK_MONOTONIC, &now );
+  }
+}
+
+
+static void
+rearm_retrieve_packet( int fd ) {
+  uint64_t count = 1;
+  ssize_t ret = write( fd, &count, sizeof( count ) );
+  if ( ret != sizeof( count ) ) {
+    char buf[ 256 ];
+    memset( buf, '\0', sizeof( buf ) );
+    char *error_string = strerror_r( errno, buf, sizeof( buf ) - 1 );
+    error( "Failed to rearm retrieving packets from datapath ret = %d errno %s [%d]", ret, error_string, errno );
+  }
+}
+
+
+/*
+ * Handles at most MAX_DATAPATH_PACKETS_PER_WAKEUP packets per call so that
+ * the secure channel is serviced under a steady packet-in load. Packets
+ * left in the ring make the eventfd readable again, and the notification
+ * stays set so that the datapath does not write it as well.
+ */
 void
 retrieve_packet_from_datapath( int fd, void *user_data ) {
   assert( fd >= 0 );
@@ -193,21 +267,28 @@ retrieve_packet_from_datapath( int fd, void *user_data ) {
   uint64_t count = 0;
 
   ssize_t ret = read( fd, &count, sizeof( uint64_t ) );
-  if ( ret < 0 ) {
-    if ( ret != EAGAIN || errno == EINTR ) {
-      return;
-    }
+  if ( ret < 0 && errno != EAGAIN && errno != EINTR ) {
     char buf[ 256 ];
     memset( buf, '\0', sizeof( buf ) );
     char *error_string = strerror_r( errno, buf, sizeof( buf ) - 1 );    
     error( "Failed to retrieve packet from datapath errno %s [%d]", error_string, errno );
-    count = 0;
   }
-  for ( uint64_t i = 0; i < count; i++ ) {
-    buffer *packet = dequeue_message( protocol->input_queue );
-    assert( packet != NULL );
-    handle_datapath_packet( packet, protocol );
+
+  count = drain_datapath_packets( protocol, MAX_DATAPATH_PACKETS_PER_WAKEUP );
+  if ( protocol->args->busy_poll > 0 && count >= BUSY_POLL_THRESHOLD ) {
+    busy_poll_datapath( protocol );
+  }
+  if ( handoff_ring_is_empty( protocol->input_ring ) ) {
+    reset_handoff_ring_notification( protocol->input_ring );
+    if ( handoff_ring_is_empty( protocol->input_ring ) ) {
+      return;
+    }
+    // a packet pushed before the reset went without notification
+    if ( !request_handoff_ring_notification( protocol->input_ring ) ) {
+      return;
+    }
   }
+  rearm_retrieve_packet( fd );
 }
 
 
@@ -224,7 +305,7 @@ serve_protocol( void *data ) {
   const struct switch_arguments *args = protocol->args;
   protocol->own_efd = args->efd[ 0 ];
   protocol->peer_efd = args->efd[ 1 ];
-  protocol->input_queue = args->to_protocol_queue;
+  protocol->input_ring = args->to_protocol_ring;
   protocol->send_count = 0;
 
   set_fd_handler_safe( protocol->own_efd, retrieve_packet_from_datapath, protocol, NULL, NULL );
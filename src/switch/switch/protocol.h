@@ -26,6 +26,8 @@ extern "C" {
 
 
 #define MAX_OUTSTANDING_REQUESTS  16
+#define BUSY_POLL_THRESHOLD  64
+#define MAX_DATAPATH_PACKETS_PER_WAKEUP  1024
 
 
 /*
@@ -48,7 +50,7 @@ struct protocol_ctrl {
 struct protocol {
   struct async thread;
   const struct switch_arguments *args;
-  message_queue *input_queue;
+  handoff_ring *input_ring;
   uint64_t send_count;
   void *data;
   int own_efd;
@@ -38,6 +38,9 @@
 #endif // UNIT_TESTING
 
 
+#define FLOW_STATS_CHUNK_SIZE 64
+
+
 static list_element *
 new_list( void ) {
   list_element *list;
@@ -77,9 +80,9 @@ sum_ofp_aggregate_stats( struct ofp_aggregate_stats_reply *as_reply, const flow_
 }
 
 
-static flow_stats *
-retrieve_flow_stats( uint32_t *nr_stats, const uint8_t table_id, const uint32_t out_port, const uint32_t out_group,
-                     const uint64_t cookie, const uint64_t cookie_mask, const struct ofp_match *ofp_match ) {
+static flow_stats_cursor *
+open_flow_stats_cursor( const uint8_t table_id, const uint32_t out_port, const uint32_t out_group,
+                        const uint64_t cookie, const uint64_t cookie_mask, const struct ofp_match *ofp_match ) {
   match *flow_match = create_match();
   size_t match_len = 0;
   if ( ofp_match != NULL ) {
@@ -95,14 +98,13 @@ retrieve_flow_stats( uint32_t *nr_stats, const uint8_t table_id, const uint32_t
     }
   }
 
-  flow_stats *stats = NULL;
-  OFDPE ret = get_flow_stats( table_id, flow_match, cookie, cookie_mask, out_port, out_group, &stats, nr_stats );
-  if ( ret != OFDPE_SUCCESS ) {
-    error( "Failed to retrieve flow stats from datapath ( ret = %d ).", ret );
+  flow_stats_cursor *cursor = create_flow_stats_cursor( table_id, flow_match, cookie, cookie_mask, out_port, out_group );
+  if ( cursor == NULL ) {
+    error( "Failed to create a flow stats cursor." );
   }
   delete_match( flow_match );
 
-  return stats;
+  return cursor;
 }
 
 
@@ -625,70 +627,100 @@ assign_table_features( flow_table_features *table_feature ) {
 }
 
 
-/*
- * Set up information to request flow statistics from datapath. The function
- * returns a linked list of ofp_flow_stats objects. If no statistics found an
- * empty list is returned.
- */
 static void
-_request_send_flow_stats( const struct ofp_flow_stats_request *req, const uint32_t transaction_id ) {
-  uint32_t nr_stats = 0;
-
-  flow_stats *stats = retrieve_flow_stats( &nr_stats, req->table_id, req->out_port, req->out_group,
-                                           req->cookie, req->cookie_mask, &req->match );
-
+send_flow_stats_reply( flow_stats *stats, const uint32_t n_stats, const uint32_t transaction_id, const uint16_t flags ) {
   list_element *list = new_list();
 
-  if ( stats != NULL && nr_stats > 0 ) {
+  for ( uint32_t i = 0; i < n_stats; i++ ) {
     oxm_matches *oxm_matches = create_oxm_matches();
-    uint16_t flags = OFPMPF_REPLY_MORE;
+    construct_oxm( oxm_matches, &stats[ i ].match );
+    uint16_t oxm_matches_len = get_oxm_matches_length( oxm_matches );
+    struct ofp_flow_stats *fs = xmalloc( sizeof( *fs ) + oxm_matches_len );
+    assign_ofp_flow_stats( fs, &stats[ i ] );
+
+    // TODO this performs htons and the create_flow_multipart_reply does also htons.
+    pack_ofp_match( &fs->match, oxm_matches );
+    delete_oxm_matches( oxm_matches );
 
-    for ( uint32_t i = 0; i < nr_stats; i++ ) {
-      construct_oxm( oxm_matches, &stats[ i ].match );
-      uint16_t oxm_matches_len = get_oxm_matches_length( oxm_matches );
-      struct ofp_flow_stats *fs = xmalloc( sizeof( *fs ) + oxm_matches_len );
-      assign_ofp_flow_stats( fs, &stats[ i ] );
+    // finally update the length construct_ofp_match performs htons on the length and type
+    fs->length = ( uint16_t ) ( sizeof( *fs ) +  ( uint16_t ) ( fs->match.length  - 4 ) );
+    append_to_tail( &list, ( void * ) fs );
+  }
 
-      // TODO this performs htons and the create_flow_multipart_reply does also htons.
-      // We also don't have enough storage preallocated from the match.
-      pack_ofp_match( &fs->match, oxm_matches );
+  SEND_STATS( flow, transaction_id, flags, list )
 
-      // finally update the length construct_ofp_match performs htons on the length and type
-      fs->length = ( uint16_t ) ( sizeof( *fs ) +  ( uint16_t ) ( fs->match.length  - 4 ) );
-      append_to_tail( &list, ( void * ) fs );
-      if ( i == nr_stats - 1 ) {
-        flags &= ( uint16_t ) ~OFPMPF_REPLY_MORE;
-      }
-      SEND_STATS( flow, transaction_id, flags, list )
-      delete_element( &list, ( void * ) fs );
-      xfree( fs );
+  for ( list_element *e = list; e != NULL; e = e->next ) {
+    xfree( e->data );
+  }
+  delete_list( list );
+}
+
+
+/*
+ * Walks the flow tables with a cursor and sends each chunk of flow statistics
+ * as a multipart reply, so that the pipeline is never locked for the whole
+ * walk. All replies but the last one have OFPMPF_REPLY_MORE set.
+ */
+static void
+_request_send_flow_stats( const struct ofp_flow_stats_request *req, const uint32_t transaction_id ) {
+  flow_stats_cursor *cursor = open_flow_stats_cursor( req->table_id, req->out_port, req->out_group,
+                                                      req->cookie, req->cookie_mask, &req->match );
+  if ( cursor == NULL ) {
+    return;
+  }
+
+  flow_stats *stats = xmalloc( sizeof( flow_stats ) * FLOW_STATS_CHUNK_SIZE );
+  bool more = true;
+  while ( more ) {
+    uint32_t n_stats = 0;
+    OFDPE ret = get_next_flow_stats( cursor, stats, FLOW_STATS_CHUNK_SIZE, &n_stats );
+    if ( ret != OFDPE_SUCCESS ) {
+      error( "Failed to retrieve flow stats from datapath ( ret = %d ).", ret );
+      break;
+    }
+    more = !cursor->done;
+    if ( n_stats > 0 || !more ) {
+      send_flow_stats_reply( stats, n_stats, transaction_id, more ? OFPMPF_REPLY_MORE : 0 );
     }
-    xfree( stats );
-    delete_oxm_matches( oxm_matches );
-    delete_list( list );
   }
+  xfree( stats );
+  delete_flow_stats_cursor( cursor );
 }
 void ( *request_send_flow_stats)( const struct ofp_flow_stats_request *req, uint32_t transaction_id ) = _request_send_flow_stats;
 
 
 static struct ofp_aggregate_stats_reply *
 _request_aggregate_stats( const struct ofp_aggregate_stats_request *req ) {
-  uint32_t nr_stats = 0;
-
-  flow_stats *stats = retrieve_flow_stats( &nr_stats, req->table_id, req->out_port, req->out_group, req->cookie,
-                                           req->cookie_mask, &req->match );
-  if ( stats && nr_stats > 0 ) {
-    struct ofp_aggregate_stats_reply *as_reply = xmalloc( sizeof( *as_reply ) );
-
-    memset( as_reply, 0, sizeof( *as_reply ) );
-    for( uint32_t i = 0; i < nr_stats; i++ ) {
+  flow_stats_cursor *cursor = open_flow_stats_cursor( req->table_id, req->out_port, req->out_group,
+                                                      req->cookie, req->cookie_mask, &req->match );
+  if ( cursor == NULL ) {
+    return NULL;
+  }
+
+  struct ofp_aggregate_stats_reply *as_reply = xmalloc( sizeof( *as_reply ) );
+  memset( as_reply, 0, sizeof( *as_reply ) );
+
+  flow_stats *stats = xmalloc( sizeof( flow_stats ) * FLOW_STATS_CHUNK_SIZE );
+  while ( !cursor->done ) {
+    uint32_t n_stats = 0;
+    OFDPE ret = get_next_flow_stats( cursor, stats, FLOW_STATS_CHUNK_SIZE, &n_stats );
+    if ( ret != OFDPE_SUCCESS ) {
+      error( "Failed to retrieve flow stats from datapath ( ret = %d ).", ret );
+      break;
+    }
+    for ( uint32_t i = 0; i < n_stats; i++ ) {
       sum_ofp_aggregate_stats( as_reply, &stats[ i ] );
     }
-    as_reply->flow_count = nr_stats;
-    xfree( stats );
-    return as_reply;
+    as_reply->flow_count += n_stats;
   }
-  return NULL;
+  xfree( stats );
+  delete_flow_stats_cursor( cursor );
+
+  if ( as_reply->flow_count == 0 ) {
+    xfree( as_reply );
+    return NULL;
+  }
+  return as_reply;
 }
 struct ofp_aggregate_stats_reply * (* request_aggregate_stats)( const struct ofp_aggregate_stats_request *req ) = _request_aggregate_stats;
 
@@ -86,8 +86,7 @@ init_parse_args( int argc, char **argv ) {
     }
   }
   memcpy( args->efd, &efd, sizeof( efd ) );
-  args->to_protocol_queue = create_message_queue();
-  assert( args->to_protocol_queue != NULL );
+  args->to_protocol_ring = create_handoff_ring( HANDOFF_RING_SIZE );
   char *switch_log = get_switch_log();
   logging_type log_output_type = LOGGING_TYPE_FILE;
   if ( args->run_as_daemon == false ) {
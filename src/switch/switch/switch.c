@@ -57,8 +57,8 @@ run_switch( struct switch_arguments *args ) {
 static void
 stop_switch( struct switch_arguments *args ) {
   finalize_openflow_switch_interface();
-  if ( args->to_protocol_queue != NULL ) {
-    delete_message_queue( args->to_protocol_queue );
+  if ( args->to_protocol_ring != NULL ) {
+    delete_handoff_ring( args->to_protocol_ring );
   }
 }
 
@@ -18,6 +18,7 @@
  */
 
 
+#include <assert.h>
 #include <inttypes.h>
 #include <openflow.h>
 #include <string.h>
@@ -25,11 +26,13 @@
 #include "trema.h"
 
 
-static cookie_table_t cookie_table;
+static cookie_table_t default_cookie_table;
+static cookie_table_t *cookie_table = &default_cookie_table;
 static uint64_t cookie_dough = 0;
 static uint64_t INVALID_COOKIE = UINT64_MAX;
 static const time_t COOKIE_ENTRY_LIFETIME = 86400 * 30;
 static const unsigned int BUCKETS_SIZE = 131063;
+static const unsigned int SHARD_BUCKETS_SIZE = 4093;
 
 
 static uint64_t
@@ -129,20 +132,63 @@ free_cookie_table_walker( void *key, void *value, void *user_data ) {
 }
 
 
+static void
+create_cookie_table_hashes( cookie_table_t *table, unsigned int buckets_size ) {
+  table->global = create_hash_with_size( compare_cookie, hash_cookie_entry, buckets_size );
+  table->application = create_hash_with_size( compare_application, hash_application, buckets_size );
+}
+
+
+static void
+delete_cookie_table_hashes( cookie_table_t *table ) {
+  foreach_hash( table->global, free_cookie_table_walker, NULL );
+  delete_hash( table->global );
+  delete_hash( table->application );
+  table->global = NULL;
+  table->application = NULL;
+}
+
+
 void
 init_cookie_table( void ) {
-  cookie_table.global = create_hash_with_size( compare_cookie, hash_cookie_entry, BUCKETS_SIZE );
-  cookie_table.application = create_hash_with_size( compare_application, hash_application, BUCKETS_SIZE );
+  create_cookie_table_hashes( &default_cookie_table, BUCKETS_SIZE );
+  cookie_table = &default_cookie_table;
 }
 
 
 void
 finalize_cookie_table( void ) {
-  foreach_hash( cookie_table.global, free_cookie_table_walker, NULL );
-  delete_hash( cookie_table.global );
-  delete_hash( cookie_table.application );
-  cookie_table.global = NULL;
-  cookie_table.application = NULL;
+  delete_cookie_table_hashes( &default_cookie_table );
+  cookie_table = &default_cookie_table;
+}
+
+
+// A table for a single switch handled by a worker process. It has far
+// fewer buckets than the default table since a worker holds one per switch.
+cookie_table_t *
+create_cookie_table( void ) {
+  cookie_table_t *table = xmalloc( sizeof( cookie_table_t ) );
+  create_cookie_table_hashes( table, SHARD_BUCKETS_SIZE );
+
+  return table;
+}
+
+
+void
+delete_cookie_table( cookie_table_t *table ) {
+  assert( table != NULL );
+
+  delete_cookie_table_hashes( table );
+  if ( cookie_table == table ) {
+    cookie_table = &default_cookie_table;
+  }
+  xfree( table );
+}
+
+
+void
+select_cookie_table( cookie_table_t *table ) {
+  cookie_table = table != NULL ? table : &default_cookie_table;
 }
 
 
@@ -168,8 +214,8 @@ insert_cookie_entry( uint64_t *original_cookie, char *service_name, uint16_t fla
     warn( "Conflicted cookie ( cookie = %#" PRIx64 " ).", new_entry->cookie );
     delete_cookie_entry( conflict_entry );
   }
-  insert_hash_entry( cookie_table.global, &new_entry->cookie, new_entry );
-  insert_hash_entry( cookie_table.application, &new_entry->application, new_entry );
+  insert_hash_entry( cookie_table->global, &new_entry->cookie, new_entry );
+  insert_hash_entry( cookie_table->application, &new_entry->application, new_entry );
 
   return &new_entry->cookie;
 }
@@ -188,11 +234,11 @@ delete_cookie_entry( cookie_entry_t *entry ) {
     return;
   }
 
-  cookie_entry_t *delete_entry_global = delete_hash_entry( cookie_table.global, &entry->cookie );
+  cookie_entry_t *delete_entry_global = delete_hash_entry( cookie_table->global, &entry->cookie );
   if ( delete_entry_global == NULL ) {
     error( "No cookie entry found ( cookie = %#" PRIx64 " ).", entry->cookie );
   }
-  cookie_entry_t *delete_entry_application = delete_hash_entry( cookie_table.application, &entry->application );
+  cookie_entry_t *delete_entry_application = delete_hash_entry( cookie_table->application, &entry->application );
   if ( delete_entry_application == NULL ) {
     error( "No cookie entry found ( cookie = %#" PRIx64 ", service_name = %s ).",
            entry->application.cookie, entry->application.service_name );
@@ -204,7 +250,7 @@ delete_cookie_entry( cookie_entry_t *entry ) {
 
 cookie_entry_t *
 lookup_cookie_entry_by_cookie( uint64_t *cookie ) {
-  return lookup_hash_entry( cookie_table.global, cookie );
+  return lookup_hash_entry( cookie_table->global, cookie );
 }
 
 
@@ -218,7 +264,7 @@ lookup_cookie_entry_by_application( uint64_t *cookie, char *service_name ) {
   strncpy( key.service_name, service_name, MESSENGER_SERVICE_NAME_LENGTH );
   key.service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
 
-  entry = lookup_hash_entry( cookie_table.application, &key );
+  entry = lookup_hash_entry( cookie_table->application, &key );
 
   return entry;
 }
@@ -233,8 +279,8 @@ age_cookie_entry( cookie_entry_t *entry ) {
           entry->cookie, entry->application.cookie, entry->application.service_name,
           entry->application.flags, entry->reference_count, entry->expire_at );
 
-    delete_hash_entry( cookie_table.global, &entry->cookie );
-    delete_hash_entry( cookie_table.application, &entry->application );
+    delete_hash_entry( cookie_table->global, &entry->cookie );
+    delete_hash_entry( cookie_table->application, &entry->application );
     free_cookie_entry( entry );
   }
 }
@@ -247,7 +293,7 @@ age_cookie_table( void *user_data ) {
   hash_iterator iter;
   hash_entry *e;
 
-  init_hash_iterator( cookie_table.global, &iter );
+  init_hash_iterator( cookie_table->global, &iter );
   while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
     age_cookie_entry( e->value );
   }
@@ -270,13 +316,13 @@ dump_cookie_table( void ) {
 
   info( "#### COOKIE TABLE ####" );
   info( "[global]" );
-  init_hash_iterator( cookie_table.global, &iter );
+  init_hash_iterator( cookie_table->global, &iter );
   while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
     dump_cookie_entry( e->value );
   }
 
   info( "[application]" );
-  init_hash_iterator( cookie_table.application, &iter );
+  init_hash_iterator( cookie_table->application, &iter );
   while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
     dump_cookie_entry( e->value );
   }
@@ -53,6 +53,9 @@ typedef struct cookie_table {
 
 void init_cookie_table( void );
 void finalize_cookie_table( void );
+cookie_table_t *create_cookie_table( void );
+void delete_cookie_table( cookie_table_t *table );
+void select_cookie_table( cookie_table_t *table );
 uint64_t *insert_cookie_entry( uint64_t *original_cookie, char *service_name, uint16_t flags );
 void delete_cookie_entry( cookie_entry_t *entry );
 cookie_entry_t *lookup_cookie_entry_by_cookie( uint64_t *cookie );
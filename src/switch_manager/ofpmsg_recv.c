@@ -25,6 +25,7 @@
 #include "cookie_table.h"
 #include "ofpmsg_recv.h"
 #include "ofpmsg_send.h"
+#include "packetin_dispatcher.h"
 #include "service_interface.h"
 #include "switch.h"
 #include "xid_table.h"
@@ -257,6 +258,12 @@ int
 ofpmsg_recv_packetin( struct switch_info *sw_info, buffer *buf ) {
   ofpmsg_debug( "Receive 'packet in' from a switch." );
 
+  if ( sw_info->packetin_filter ) {
+    dispatch_packetin( sw_info->datapath_id, buf );
+    free_buffer( buf );
+    return 0;
+  }
+
   service_send_to_application( sw_info->packetin_service_name_list,
                                MESSENGER_OPENFLOW_MESSAGE,
                                &sw_info->datapath_id, buf );
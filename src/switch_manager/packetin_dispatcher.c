@@ -0,0 +1,201 @@
+/*
+ * OpenFlow Switch Manager
+ *
+ * Copyright (C) 2008-2012 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/*
+ * Packet-in filter rules evaluated inside the switch daemon. Rules are
+ * kept and managed by the same code as in the packetin_filter process
+ * ( see packetin_filter_table.h ), and each packet-in is sent directly
+ * to the services of the matched rule instead of passing through the
+ * packetin_filter process.
+ */
+
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+#include "trema.h"
+#include "packetin_dispatcher.h"
+#include "service_interface.h"
+
+
+// built-in packetin-filter-rule
+static const char LLDP_PACKET_IN[] = "lldp::";
+static const char ANY_PACKET_IN[] = "packet_in::";
+
+static list_element *dispatch_rules = NULL; // rules given on the command line
+
+
+void
+init_packetin_dispatcher( void ) {
+  init_packetin_filter_table();
+  create_list( &dispatch_rules );
+}
+
+
+void
+finalize_packetin_dispatcher( void ) {
+  for ( list_element *e = dispatch_rules; e != NULL; e = e->next ) {
+    xfree( e->data );
+  }
+  delete_list( dispatch_rules );
+  dispatch_rules = NULL;
+  finalize_packetin_filter_table();
+}
+
+
+static bool
+apply_packetin_dispatch_rule( const char *rule ) {
+  assert( rule != NULL );
+
+  oxm_matches *match = create_oxm_matches();
+  const char *service_name;
+  uint16_t priority;
+  if ( strncmp( rule, LLDP_PACKET_IN, strlen( LLDP_PACKET_IN ) ) == 0 ) {
+    service_name = rule + strlen( LLDP_PACKET_IN );
+    priority = OFP_DEFAULT_PRIORITY;
+    append_oxm_match_eth_type( match, ETH_ETHTYPE_LLDP );
+  }
+  else if ( strncmp( rule, ANY_PACKET_IN, strlen( ANY_PACKET_IN ) ) == 0 ) {
+    service_name = rule + strlen( ANY_PACKET_IN );
+    priority = 0;
+  }
+  else {
+    delete_oxm_matches( match );
+    return false;
+  }
+
+  bool ret = add_packetin_filter_entry( match, priority, service_name );
+  delete_oxm_matches( match );
+
+  return ret;
+}
+
+
+bool
+add_packetin_dispatch_rule( const char *rule ) {
+  if ( !apply_packetin_dispatch_rule( rule ) ) {
+    return false;
+  }
+  append_to_tail( &dispatch_rules, xstrdup( rule ) );
+
+  return true;
+}
+
+
+// Rules for one of the switches in a worker. They start with the rules given
+// on the command line.
+struct match_table *
+create_packetin_dispatch_table( void ) {
+  struct match_table *table = create_packetin_filter_table();
+  select_packetin_filter_table( table );
+  for ( list_element *e = dispatch_rules; e != NULL; e = e->next ) {
+    apply_packetin_dispatch_rule( e->data );
+  }
+  select_packetin_filter_table( NULL );
+
+  return table;
+}
+
+
+// Walks the raw ( network byte order ) match of a packet-in to avoid
+// building a full oxm_matches list just for the ingress port.
+static uint32_t
+get_in_port( const struct ofp_match *match, size_t match_len ) {
+  const char *oxm = ( const char * ) match + offsetof( struct ofp_match, oxm_fields );
+  const char *end = ( const char * ) match + match_len;
+
+  while ( oxm + sizeof( oxm_match_header ) <= end ) {
+    oxm_match_header header;
+    memcpy( &header, oxm, sizeof( oxm_match_header ) );
+    header = ntohl( header );
+    oxm += sizeof( oxm_match_header );
+    if ( header == OXM_OF_IN_PORT && oxm + sizeof( uint32_t ) <= end ) {
+      uint32_t in_port;
+      memcpy( &in_port, oxm, sizeof( uint32_t ) );
+      return ntohl( in_port );
+    }
+    oxm += OXM_LENGTH( header );
+  }
+
+  return 0;
+}
+
+
+void
+dispatch_packetin( uint64_t datapath_id, buffer *buf ) {
+  assert( buf != NULL );
+
+  struct ofp_packet_in *packet_in = buf->data;
+  uint16_t match_len = ntohs( packet_in->match.length );
+  size_t body_offset = offsetof( struct ofp_packet_in, match ) + match_len + PADLEN_TO_64( match_len ) + 2;
+  if ( buf->length < body_offset ) {
+    error( "Too short packet-in message ( length = %u ).", buf->length );
+    return;
+  }
+
+  uint32_t in_port = get_in_port( &packet_in->match, match_len );
+  if ( in_port == 0 ) {
+    return;
+  }
+
+  oxm_matches *match = create_oxm_matches();
+  size_t body_length = buf->length - body_offset;
+  if ( body_length > 0 ) {
+    // The frame is parsed in place in the packet-in message.
+    buffer *body = alloc_buffer_with_data( ( char * ) buf->data + body_offset, body_length );
+    if ( !parse_packet( body ) ) {
+      debug( "Failed to parse a packet-in frame ( datapath_id = %#" PRIx64 " ).", datapath_id );
+      free_buffer( body );
+      delete_oxm_matches( match );
+      return;
+    }
+    buffer *inner = NULL;
+    if ( packet_type_ipv4_etherip( body ) ) {
+      inner = parse_etherip_frame( body );
+    }
+    set_match_from_packet( match, in_port, NULL, inner != NULL ? inner : body );
+    if ( inner != NULL ) {
+      free_buffer( inner );
+    }
+    free_buffer( body );
+  }
+  else {
+    append_oxm_match_in_port( match, in_port );
+  }
+
+  list_element *services = lookup_match_entry( match );
+  delete_oxm_matches( match );
+  if ( services == NULL ) {
+    debug( "No packetin filter entry found ( datapath_id = %#" PRIx64 ", in_port = %u ).", datapath_id, in_port );
+    return;
+  }
+
+  service_send_to_application( services, MESSENGER_OPENFLOW_MESSAGE, &datapath_id, buf );
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
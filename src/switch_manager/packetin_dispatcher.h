@@ -0,0 +1,43 @@
+/*
+ * OpenFlow Switch Manager
+ *
+ * Copyright (C) 2008-2012 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef PACKETIN_DISPATCHER_H
+#define PACKETIN_DISPATCHER_H
+
+
+#include "trema.h"
+
+
+void init_packetin_dispatcher( void );
+void finalize_packetin_dispatcher( void );
+bool add_packetin_dispatch_rule( const char *rule );
+struct match_table *create_packetin_dispatch_table( void );
+void dispatch_packetin( uint64_t datapath_id, buffer *buf );
+
+
+#endif // PACKETIN_DISPATCHER_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
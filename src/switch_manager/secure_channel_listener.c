@@ -19,6 +19,7 @@
 
 
 #include <arpa/inet.h>
+#include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
@@ -207,6 +208,45 @@ free_switch_daemon_args( char **argv ) {
 }
 
 
+static char **
+make_switch_worker_args( struct listener_info *listener_info, int index ) {
+  int argc = SWITCH_MANAGER_DEFAULT_ARGC + listener_info->switch_daemon_argc + 1;
+  char **argv = xcalloc( ( size_t ) argc, sizeof( char * ) );
+
+  int i = 0;
+  argv[ i++ ] = xasprintf( "%s%d", SWITCH_MANAGER_WORKER_PREFIX, index );
+  argv[ i++ ] = xasprintf( "%s%s%d", SWITCH_MANAGER_NAME_OPTION, SWITCH_MANAGER_WORKER_PREFIX, index );
+  argv[ i++ ] = xasprintf( "%s%d", SWITCH_MANAGER_LISTEN_SOCKET_OPTION, listener_info->listen_fd );
+  argv[ i++ ] = xasprintf( "%s%s", SWITCH_MANAGER_STATE_PREFIX, get_trema_name() );
+  int j;
+  for ( j = 0; j < listener_info->switch_daemon_argc; i++, j++ ) {
+    argv[ i ] = xstrdup( listener_info->switch_daemon_argv[ j ] );
+  }
+
+  return argv;
+}
+
+
+static void
+redirect_stdio_to_devnull( void ) {
+  int in_fd = open( "/dev/null", O_RDONLY );
+  if ( in_fd != 0 ) {
+    dup2( in_fd, 0 );
+    close( in_fd );
+  }
+  int out_fd = open( "/dev/null", O_WRONLY );
+  if ( out_fd != 1 ) {
+    dup2( out_fd, 1 );
+    close( out_fd );
+  }
+  int err_fd = open( "/dev/null", O_WRONLY );
+  if ( err_fd != 2 ) {
+    dup2( err_fd, 2 );
+    close( err_fd );
+  }
+}
+
+
 static const int ACCEPT_FD = 3;
 
 
@@ -241,21 +281,7 @@ secure_channel_accept( int fd, void *data ) {
 
     char **argv = make_switch_daemon_args( listener_info, &addr, accept_fd );
 
-    int in_fd = open( "/dev/null", O_RDONLY );
-    if ( in_fd != 0 ) {
-      dup2( in_fd, 0 );
-      close( in_fd );
-    }
-    int out_fd = open( "/dev/null", O_WRONLY );
-    if ( out_fd != 1 ) {
-      dup2( out_fd, 1 );
-      close( out_fd );
-    }
-    int err_fd = open( "/dev/null", O_WRONLY );
-    if ( err_fd != 2 ) {
-      dup2( err_fd, 2 );
-      close( err_fd );
-    }
+    redirect_stdio_to_devnull();
 
     execvp( listener_info->switch_daemon, argv );
     error( "Failed to execvp: %s(%s) %s %s. %s.",
@@ -273,6 +299,66 @@ secure_channel_accept( int fd, void *data ) {
 }
 
 
+static pid_t
+spawn_switch_worker( struct listener_info *listener_info, int index ) {
+  pid_t pid = fork();
+  if ( pid < 0 ) {
+    error( "Failed to fork. %s.", strerror( errno ) );
+    return -1;
+  }
+  if ( pid == 0 ) {
+    // the listen socket is inherited and shared among workers.
+    char **argv = make_switch_worker_args( listener_info, index );
+
+    redirect_stdio_to_devnull();
+
+    execvp( listener_info->switch_daemon, argv );
+    error( "Failed to execvp: %s(%s) %s %s. %s.",
+      argv[ 0 ], listener_info->switch_daemon,
+      argv[ 1 ], argv[ 2 ], strerror( errno ) );
+
+    free_switch_daemon_args( argv );
+
+    exit( EXIT_FAILURE );
+  }
+
+  debug( "Switch worker %d is started ( pid = %d ).", index, pid );
+
+  return pid;
+}
+
+
+bool
+secure_channel_start_workers( struct listener_info *listener_info ) {
+  assert( listener_info->n_workers > 0 );
+  assert( listener_info->listen_fd >= 0 );
+
+  listener_info->worker_pids = xcalloc( ( size_t ) listener_info->n_workers, sizeof( pid_t ) );
+  for ( int i = 0; i < listener_info->n_workers; i++ ) {
+    listener_info->worker_pids[ i ] = spawn_switch_worker( listener_info, i );
+    if ( listener_info->worker_pids[ i ] < 0 ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool
+secure_channel_restart_worker( struct listener_info *listener_info, pid_t pid ) {
+  for ( int i = 0; i < listener_info->n_workers; i++ ) {
+    if ( listener_info->worker_pids[ i ] == pid ) {
+      warn( "Switch worker %d ( pid = %d ) is exited. Restarting.", i, pid );
+      listener_info->worker_pids[ i ] = spawn_switch_worker( listener_info, i );
+      return listener_info->worker_pids[ i ] > 0;
+    }
+  }
+
+  return false;
+}
+
+
 /*
  * Local variables:
  * c-basic-offset: 2
@@ -29,6 +29,8 @@
 
 bool secure_channel_listen_start( struct listener_info *listener_info );
 void secure_channel_accept( int fd, void *data );
+bool secure_channel_start_workers( struct listener_info *listener_info );
+bool secure_channel_restart_worker( struct listener_info *listener_info, pid_t pid );
 
 
 #endif // SECURE_CANNEL_LISTENER_H
@@ -106,7 +106,9 @@ handle_messages_from_secure_channel( struct switch_info *sw_info ) {
   int errors = 0;
   buffer *message;
 
-  while ( ( message = dequeue_message( sw_info->recv_queue ) ) != NULL ) {
+  // the switch may be disconnected while handling a message.
+  while ( sw_info->recv_queue != NULL &&
+          ( message = dequeue_message( sw_info->recv_queue ) ) != NULL ) {
     ret = ofpmsg_recv( sw_info, message );
     if ( ret < 0 ) {
       error( "Failed to handle message to application." );
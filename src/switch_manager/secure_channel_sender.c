@@ -20,8 +20,13 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <openflow.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "event_handler.h"
 #include "message_queue.h"
@@ -30,6 +35,60 @@
 #include "trema.h"
 
 
+#ifdef IOV_MAX
+#define FLUSH_IOVCNT_MAX IOV_MAX
+#else
+#define FLUSH_IOVCNT_MAX 1024
+#endif
+
+
+// reused by every flush. switch daemons have a single event loop.
+static struct iovec flush_iov[ FLUSH_IOVCNT_MAX ];
+
+
+static void
+flush_timeout( void *user_data ) {
+  struct switch_info *sw_info = user_data;
+
+  sw_info->flush_scheduled = false;
+  if ( sw_info->send_queue != NULL && sw_info->send_queue->length > 0 ) {
+    set_writable( sw_info->secure_channel_fd, true );
+  }
+}
+
+
+static void
+schedule_flush( struct switch_info *sw_info ) {
+  if ( sw_info->send_coalesce_usec == 0 || sw_info->send_queue->length >= FLUSH_IOVCNT_MAX ) {
+    set_writable( sw_info->secure_channel_fd, true );
+    return;
+  }
+  if ( sw_info->flush_scheduled ) {
+    return;
+  }
+
+  // hold messages for a while to send a burst of them in a few segments.
+  struct itimerspec interval;
+  interval.it_value.tv_sec = sw_info->send_coalesce_usec / 1000000;
+  interval.it_value.tv_nsec = ( sw_info->send_coalesce_usec % 1000000 ) * 1000;
+  interval.it_interval.tv_sec = 0;
+  interval.it_interval.tv_nsec = 0;
+  add_timer_event_callback( &interval, flush_timeout, sw_info );
+  sw_info->flush_scheduled = true;
+}
+
+
+void
+cancel_flush_secure_channel( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( sw_info->flush_scheduled ) {
+    delete_timer_event( flush_timeout, sw_info );
+    sw_info->flush_scheduled = false;
+  }
+}
+
+
 int
 send_to_secure_channel( struct switch_info *sw_info, buffer *buf ) {
   assert( sw_info != NULL );
@@ -42,79 +101,117 @@ send_to_secure_channel( struct switch_info *sw_info, buffer *buf ) {
 
   bool res = enqueue_message( sw_info->send_queue, buf );
   if ( res ) {
-    set_writable( sw_info->secure_channel_fd, true );
+    schedule_flush( sw_info );
   }
   return res ? 0 : -1;
 }
 
 
-typedef struct {
-  struct iovec *iov;
-  int iovcnt;
-} writev_args;
+static bool
+set_cork( int fd, bool cork ) {
+#ifdef TCP_CORK
+  int flag = cork ? 1 : 0;
+  if ( setsockopt( fd, IPPROTO_TCP, TCP_CORK, &flag, sizeof( flag ) ) < 0 ) {
+    // not a TCP socket.
+    return false;
+  }
+  return true;
+#else
+  UNUSED( fd );
+  UNUSED( cork );
+  return false;
+#endif
+}
+
+
+static int
+fill_flush_iov( message_queue *queue, size_t *total_length ) {
+  int iovcnt = 0;
+  *total_length = 0;
+
+  for ( message_queue_element *element = queue->divider->next;
+        element != NULL && iovcnt < FLUSH_IOVCNT_MAX; element = element->next ) {
+    buffer *message = element->data;
+    flush_iov[ iovcnt ].iov_base = message->data;
+    flush_iov[ iovcnt ].iov_len = message->length;
+    *total_length += message->length;
+    iovcnt++;
+  }
+
+  return iovcnt;
+}
 
 
 static void
-append_to_writev_args( buffer *message, void *user_data ) {
-  writev_args *args = user_data;
+discard_written_messages( message_queue *queue, size_t write_length ) {
+  buffer *buf;
 
-  args->iov[ args->iovcnt ].iov_base = message->data;
-  args->iov[ args->iovcnt ].iov_len = message->length;
-  args->iovcnt++;
+  while ( write_length > 0 && ( buf = peek_message( queue ) ) != NULL ) {
+    if ( write_length < buf->length ) {
+      remove_front_buffer( buf, write_length );
+      return;
+    }
+    write_length -= buf->length;
+    buf = dequeue_message( queue );
+    free_buffer( buf );
+  }
 }
 
 
+/*
+ * Writes queued messages with writev() in batches of up to IOV_MAX messages
+ * until the queue gets empty or the socket buffer gets full. A backlog of
+ * more than one batch is sent with TCP_CORK set so that it leaves in full
+ * segments. The socket has TCP_NODELAY set, so the last segment is pushed
+ * out on uncorking.
+ */
 int
 flush_secure_channel( struct switch_info *sw_info ) {
   assert( sw_info != NULL );
   assert( sw_info->send_queue != NULL );
   assert( sw_info->secure_channel_fd >= 0 );
 
-  buffer *buf;
-  ssize_t write_length;
-
   if ( sw_info->send_queue->length == 0 ) {
     return 0;
   }
   set_writable( sw_info->secure_channel_fd, false );
-  writev_args args;
-  args.iov = xmalloc( sizeof( struct iovec ) * ( size_t ) sw_info->send_queue->length );
-  args.iovcnt = 0;
-  foreach_message_queue( sw_info->send_queue, append_to_writev_args, &args );
-  if ( args.iovcnt == 0 ) {
-    xfree( args.iov );
-    return 0;
-  }
-  write_length = writev( sw_info->secure_channel_fd, args.iov, args.iovcnt );
-  xfree( args.iov );
-  if ( write_length < 0 ) {
-    if ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) {
-      set_writable( sw_info->secure_channel_fd, true );
-      return 0;
-    }
-    error( "Failed to send a message to secure channel ( errno = %s [%d] ).",
-           strerror( errno ), errno );
-    return -1;
-  }
-  if ( write_length == 0 ) {
-    return 0;
+
+  bool corked = false;
+  if ( sw_info->send_queue->length > FLUSH_IOVCNT_MAX ) {
+    corked = set_cork( sw_info->secure_channel_fd, true );
   }
-  while ( ( buf = peek_message( sw_info->send_queue ) ) != NULL ) {
-    if ( write_length == 0 ) {
-      set_writable( sw_info->secure_channel_fd, true );
-      return 0;
+
+  int ret = 0;
+  while ( sw_info->send_queue->length > 0 ) {
+    size_t total_length;
+    int iovcnt = fill_flush_iov( sw_info->send_queue, &total_length );
+    ssize_t write_length = writev( sw_info->secure_channel_fd, flush_iov, iovcnt );
+    if ( write_length < 0 ) {
+      if ( errno == EINTR ) {
+        continue;
+      }
+      if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+        set_writable( sw_info->secure_channel_fd, true );
+        break;
+      }
+      error( "Failed to send a message to secure channel ( errno = %s [%d] ).",
+             strerror( errno ), errno );
+      ret = -1;
+      break;
     }
-    if ( ( size_t ) write_length < buf->length ) {
-      remove_front_buffer( buf, ( size_t ) write_length );
+    discard_written_messages( sw_info->send_queue, ( size_t ) write_length );
+    if ( ( size_t ) write_length < total_length ) {
+      // socket buffer is full. wait for the socket to be writable.
       set_writable( sw_info->secure_channel_fd, true );
-      return 0;
+      break;
     }
-    write_length -= ( ssize_t ) buf->length;
-    buf = dequeue_message( sw_info->send_queue );
-    free_buffer( buf );
   }
 
-  return 0;
+  if ( corked ) {
+    set_cork( sw_info->secure_channel_fd, false );
+  }
+
+  return ret;
 }
 
 
@@ -30,6 +30,7 @@
 
 int send_to_secure_channel( struct switch_info *sw_info, buffer *buf );
 int flush_secure_channel( struct switch_info *sw_info );
+void cancel_flush_secure_channel( struct switch_info *sw_info );
 
 
 #endif // SECURE_CHANNEL_SENDER_H
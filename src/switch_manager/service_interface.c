@@ -132,7 +132,12 @@ service_recv_from_application( uint16_t message_type, buffer *buf ) {
    uint16_t service_name_length;
    char *service_name;
 
-  if ( buf->length < sizeof( openflow_service_header_t ) + sizeof( struct ofp_header ) ) {
+  // a disconnect request has no openflow message.
+  size_t min_length = sizeof( openflow_service_header_t );
+  if ( message_type != MESSENGER_OPENFLOW_DISCONNECT_REQUEST ) {
+    min_length += sizeof( struct ofp_header );
+  }
+  if ( buf->length < min_length ) {
     error( "Too short openflow application message(%u).", buf->length );
     free_buffer( buf );
 
@@ -143,7 +148,7 @@ service_recv_from_application( uint16_t message_type, buffer *buf ) {
   datapath_id = ntohll( message->datapath_id );
   service_name_length = ntohs( message->service_name_length );
   service_name = remove_front_buffer( buf, sizeof( openflow_service_header_t ) );
-  if ( service_name_length < 1 ) {
+  if ( service_name_length < 1 || service_name_length > buf->length ) {
     error( "Invalid service name length %u.", service_name_length );
     free_buffer( buf );
 
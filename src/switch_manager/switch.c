@@ -18,6 +18,8 @@
  */
 
 
+#include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
@@ -28,6 +30,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include "trema.h"
 #include "cookie_table.h"
 #include "management_interface.h"
@@ -35,6 +39,7 @@
 #include "messenger.h"
 #include "ofpmsg_send.h"
 #include "openflow_service_interface.h"
+#include "packetin_dispatcher.h"
 #include "secure_channel_receiver.h"
 #include "secure_channel_sender.h"
 #include "service_interface.h"
@@ -58,6 +63,9 @@ enum long_options_val {
   NO_FLOW_CLEANUP_LONG_OPTION_VALUE = 1,
   NO_COOKIE_TRANSLATION_LONG_OPTION_VALUE = 2,
   NO_PACKET_IN_LONG_OPTION_VALUE = 3,
+  PACKET_IN_FILTER_LONG_OPTION_VALUE = 4,
+  LISTEN_SOCKET_LONG_OPTION_VALUE = 5,
+  SEND_COALESCE_LONG_OPTION_VALUE = 6,
 };
 
 static struct option long_options[] = {
@@ -65,6 +73,9 @@ static struct option long_options[] = {
   { "no-flow-cleanup", 0, NULL, NO_FLOW_CLEANUP_LONG_OPTION_VALUE },
   { "no-cookie-translation", 0, NULL, NO_COOKIE_TRANSLATION_LONG_OPTION_VALUE },
   { "no-packet_in", 0, NULL, NO_PACKET_IN_LONG_OPTION_VALUE },
+  { "packet_in-filter", 0, NULL, PACKET_IN_FILTER_LONG_OPTION_VALUE },
+  { "listen-socket", 1, NULL, LISTEN_SOCKET_LONG_OPTION_VALUE },
+  { "send-coalesce", 1, NULL, SEND_COALESCE_LONG_OPTION_VALUE },
   { NULL, 0, NULL, 0  },
 };
 
@@ -73,6 +84,14 @@ static char short_options[] = "s:";
 
 struct switch_info switch_info;
 
+// A worker process accepts connections from the listen socket shared with
+// other workers and handles many switches. switch_info above is used as the
+// template of per-switch settings in that case.
+static int listen_fd = -1;
+static list_element *worker_switches = NULL;
+static hash_table *switch_table = NULL; // datapath_id -> struct switch_info *
+static list_element *unregistering_service_names = NULL;
+
 static const time_t COOKIE_TABLE_AGING_INTERVAL = 3600;
 static const time_t ECHO_REQUEST_INTERVAL = 60;
 static const time_t ECHO_REPLY_TIMEOUT = 2;
@@ -97,6 +116,9 @@ usage() {
     "      --no-flow-cleanup       do not cleanup flows on startup\n"
     "      --no-cookie-translation do not translate cookie values\n"
     "      --no-packet_in          do not allow packet-ins on startup\n"
+    "      --packet_in-filter      dispatch packet-ins with in-daemon filter rules\n"
+    "      --listen-socket=fd      accept and handle many switches on a listen socket\n"
+    "      --send-coalesce=USEC    delay sending to the switch to coalesce messages\n"
     "  -h, --help                  display this help and exit\n"
     "\n"
     "DESTINATION-RULE:\n"
@@ -104,6 +126,9 @@ usage() {
     "\n"
     "openflow-message-type:\n"
     "  packet_in                   packet-in openflow message type\n"
+    "                              ( any packet and priority is zero with --packet_in-filter )\n"
+    "  lldp                        LLDP ethernet frame type and priority is 0x8000\n"
+    "                              ( only with --packet_in-filter )\n"
     "  port_status                 port-status openflow message type\n"
     "  vendor                      vendor openflow message type\n"
     "  state_notify                connection status\n"
@@ -128,6 +153,20 @@ strtofd( const char *str ) {
 }
 
 
+static long
+strtousec( const char *str ) {
+  char *ep;
+  long l;
+
+  l = strtol( str, &ep, 0 );
+  if ( l < 0 || l >= 1000000 || *ep != '\0' ) {
+    die( "Invalid delay (%s).", str );
+    return 0;
+  }
+  return l;
+}
+
+
 static void
 option_parser( int argc, char *argv[] ) {
   int c;
@@ -136,6 +175,7 @@ option_parser( int argc, char *argv[] ) {
   switch_info.flow_cleanup = true;
   switch_info.cookie_translation = true;
   switch_info.deny_packet_in_on_startup = false;
+  switch_info.packetin_filter = false;
   while ( ( c = getopt_long( argc, argv, short_options, long_options, NULL ) ) != -1 ) {
     switch ( c ) {
       case 's':
@@ -154,6 +194,18 @@ option_parser( int argc, char *argv[] ) {
         switch_info.deny_packet_in_on_startup = true;
         break;
 
+      case PACKET_IN_FILTER_LONG_OPTION_VALUE:
+        switch_info.packetin_filter = true;
+        break;
+
+      case LISTEN_SOCKET_LONG_OPTION_VALUE:
+        listen_fd = strtofd( optarg );
+        break;
+
+      case SEND_COALESCE_LONG_OPTION_VALUE:
+        switch_info.send_coalesce_usec = strtousec( optarg );
+        break;
+
       default:
         usage();
         exit( EXIT_SUCCESS );
@@ -183,87 +235,173 @@ service_send_state( struct switch_info *sw_info, uint64_t *dpid, uint16_t tag )
 }
 
 
+static bool
+worker_mode( void ) {
+  return listen_fd >= 0;
+}
+
+
+static void
+select_switch( struct switch_info *sw_info ) {
+  select_xid_table( sw_info->xid_table );
+  select_cookie_table( sw_info->cookie_table );
+  if ( sw_info->packetin_filter ) {
+    select_packetin_filter_table( sw_info->packetin_filter_table );
+  }
+}
+
+
+static struct switch_info *
+lookup_switch( uint64_t datapath_id ) {
+  if ( !worker_mode() ) {
+    return datapath_id == switch_info.datapath_id ? &switch_info : NULL;
+  }
+
+  return lookup_hash_entry( switch_table, &datapath_id );
+}
+
+
+static void
+foreach_switch( void ( *callback )( struct switch_info *sw_info ) ) {
+  if ( !worker_mode() ) {
+    callback( &switch_info );
+    return;
+  }
+
+  for ( list_element *e = worker_switches; e != NULL; e = e->next ) {
+    callback( e->data );
+  }
+  select_switch( &switch_info );
+}
+
+
+static void
+free_switch( struct switch_info *sw_info ) {
+  assert( sw_info != &switch_info );
+
+  delete_element( &worker_switches, sw_info );
+  if ( sw_info->xid_table != NULL ) {
+    delete_xid_table( sw_info->xid_table );
+  }
+  if ( sw_info->cookie_table != NULL ) {
+    delete_cookie_table( sw_info->cookie_table );
+  }
+  if ( sw_info->packetin_filter_table != NULL ) {
+    delete_packetin_filter_table( sw_info->packetin_filter_table );
+  }
+  if ( sw_info->dpid_service_name != NULL ) {
+    xfree( sw_info->dpid_service_name );
+  }
+  xfree( sw_info );
+}
+
+
+// Switches are released only when the outermost event handler for them
+// returns, since a disconnection may happen deep in message handling.
+static void
+release_switch_if_disconnected( struct switch_info *sw_info ) {
+  if ( worker_mode() && sw_info->state == SWITCH_STATE_DISCONNECTED ) {
+    free_switch( sw_info );
+  }
+}
+
+
 static void
 secure_channel_read( int fd, void* data ) {
   UNUSED( fd );
-  UNUSED( data );
+  struct switch_info *sw_info = data;
 
-  if ( recv_from_secure_channel( &switch_info ) < 0 ) {
-    switch_event_disconnected( &switch_info );
+  select_switch( sw_info );
+  if ( recv_from_secure_channel( sw_info ) < 0 ) {
+    switch_event_disconnected( sw_info );
+    release_switch_if_disconnected( sw_info );
     return;
   }
 
-  if ( switch_info.recv_queue->length > 0 ) {
-    int ret = handle_messages_from_secure_channel( &switch_info );
+  if ( sw_info->recv_queue->length > 0 ) {
+    int ret = handle_messages_from_secure_channel( sw_info );
     if ( ret < 0 ) {
-      stop_event_handler();
-      stop_messenger();
+      if ( worker_mode() ) {
+        switch_event_disconnected( sw_info );
+      }
+      else {
+        stop_event_handler();
+        stop_messenger();
+      }
     }
   }
+  release_switch_if_disconnected( sw_info );
 }
 
 
 static void
 secure_channel_write( int fd, void* data ) {
   UNUSED( fd );
-  UNUSED( data );
+  struct switch_info *sw_info = data;
 
-  if ( flush_secure_channel( &switch_info ) < 0 ) {
-    switch_event_disconnected( &switch_info );
+  if ( sw_info->state == SWITCH_STATE_DISCONNECTED ) {
+    return;
+  }
+  select_switch( sw_info );
+  if ( flush_secure_channel( sw_info ) < 0 ) {
+    switch_event_disconnected( sw_info );
+    release_switch_if_disconnected( sw_info );
     return;
   }
 }
 
 
 static void
-switch_set_timeout( long sec, timer_callback callback, void *user_data ) {
+switch_set_timeout( struct switch_info *sw_info, long sec, timer_callback callback ) {
   struct itimerspec interval;
 
   interval.it_value.tv_sec = sec;
   interval.it_value.tv_nsec = 0;
   interval.it_interval.tv_sec = 0;
   interval.it_interval.tv_nsec = 0;
-  add_timer_event_callback( &interval, callback, user_data );
-  switch_info.running_timer = true;
+  add_timer_event_callback( &interval, callback, sw_info );
+  sw_info->running_timer = true;
 }
 
 
 static void
-switch_unset_timeout( timer_callback callback, void *user_data ) {
-  if ( switch_info.running_timer ) {
-    switch_info.running_timer = false;
-    delete_timer_event( callback, user_data );
+switch_unset_timeout( struct switch_info *sw_info, timer_callback callback ) {
+  if ( sw_info->running_timer ) {
+    sw_info->running_timer = false;
+    delete_timer_event( callback, sw_info );
   }
 }
 
 
 static void
 switch_event_timeout_hello( void *user_data ) {
-  UNUSED( user_data );
+  struct switch_info *sw_info = user_data;
 
-  if ( switch_info.state != SWITCH_STATE_WAIT_HELLO ) {
+  if ( sw_info->state != SWITCH_STATE_WAIT_HELLO ) {
     return;
   }
-  switch_info.running_timer = false;
+  sw_info->running_timer = false;
 
   error( "Hello timeout. state:%d, dpid:%#" PRIx64 ", fd:%d.",
-         switch_info.state, switch_info.datapath_id, switch_info.secure_channel_fd );
-  switch_event_disconnected( &switch_info );
+         sw_info->state, sw_info->datapath_id, sw_info->secure_channel_fd );
+  switch_event_disconnected( sw_info );
+  release_switch_if_disconnected( sw_info );
 }
 
 
 static void
 switch_event_timeout_features_reply( void *user_data ) {
-  UNUSED( user_data );
+  struct switch_info *sw_info = user_data;
 
-  if ( switch_info.state != SWITCH_STATE_WAIT_FEATURES_REPLY ) {
+  if ( sw_info->state != SWITCH_STATE_WAIT_FEATURES_REPLY ) {
     return;
   }
-  switch_info.running_timer = false;
+  sw_info->running_timer = false;
 
   error( "Features Reply timeout. state:%d, dpid:%#" PRIx64 ", fd:%d.",
-         switch_info.state, switch_info.datapath_id, switch_info.secure_channel_fd );
-  switch_event_disconnected( &switch_info );
+         sw_info->state, sw_info->datapath_id, sw_info->secure_channel_fd );
+  switch_event_disconnected( sw_info );
+  release_switch_if_disconnected( sw_info );
 }
 
 
@@ -280,7 +418,7 @@ switch_event_connected( struct switch_info *sw_info ) {
   }
   sw_info->state = SWITCH_STATE_WAIT_HELLO;
 
-  switch_set_timeout( SWITCH_STATE_TIMEOUT_HELLO, switch_event_timeout_hello, NULL );
+  switch_set_timeout( sw_info, SWITCH_STATE_TIMEOUT_HELLO, switch_event_timeout_hello );
 
   return 0;
 }
@@ -292,7 +430,7 @@ switch_event_recv_hello( struct switch_info *sw_info ) {
 
   if ( sw_info->state == SWITCH_STATE_WAIT_HELLO ) {
     // cancel to hello_wait-timeout timer
-    switch_unset_timeout( switch_event_timeout_hello, NULL );
+    switch_unset_timeout( sw_info, switch_event_timeout_hello );
 
     if ( sw_info->deny_packet_in_on_startup ) {
       ret = ofpmsg_send_deny_all( sw_info );
@@ -307,8 +445,8 @@ switch_event_recv_hello( struct switch_info *sw_info ) {
     }
     sw_info->state = SWITCH_STATE_WAIT_FEATURES_REPLY;
 
-    switch_set_timeout( SWITCH_STATE_TIMEOUT_FEATURES_REPLY,
-                        switch_event_timeout_features_reply, NULL );
+    switch_set_timeout( sw_info, SWITCH_STATE_TIMEOUT_FEATURES_REPLY,
+                        switch_event_timeout_features_reply );
   }
 
   return 0;
@@ -317,10 +455,12 @@ switch_event_recv_hello( struct switch_info *sw_info ) {
 
 static void
 echo_reply_timeout( void *user_data ) {
-  UNUSED( user_data );
+  struct switch_info *sw_info = user_data;
+  sw_info->running_timer = false;
 
-  error( "Echo request timeout ( datapath id %#" PRIx64 ").", switch_info.datapath_id );
-  switch_event_disconnected( &switch_info );
+  error( "Echo request timeout ( datapath id %#" PRIx64 ").", sw_info->datapath_id );
+  switch_event_disconnected( sw_info );
+  release_switch_if_disconnected( sw_info );
 }
 
 
@@ -338,7 +478,7 @@ switch_event_recv_echoreply( struct switch_info *sw_info, buffer *buf ) {
   if ( ntohll( body->datapath_id ) != sw_info->datapath_id ) {
     return 0;
   }
-  switch_unset_timeout( echo_reply_timeout, NULL );
+  switch_unset_timeout( sw_info, echo_reply_timeout );
   struct timespec now, tim;
   clock_gettime( CLOCK_MONOTONIC, &now );
   tim.tv_sec = ( time_t ) ntohl( body->sec );
@@ -358,20 +498,145 @@ echo_request_interval( void *user_data ) {
 
   buffer *buf = alloc_buffer();
   echo_body *body = append_back_buffer( buf, sizeof( echo_body ) );
-  body->datapath_id = htonll( switch_info.datapath_id );
+  body->datapath_id = htonll( sw_info->datapath_id );
   struct timespec now;
   clock_gettime( CLOCK_MONOTONIC, &now );
   body->sec = htonl( ( uint32_t ) now.tv_sec );
   body->nsec = htonl( ( uint32_t ) now.tv_nsec );
+  select_switch( sw_info );
   sw_info->echo_request_xid = generate_xid();
 
   int err = ofpmsg_send_echorequest( sw_info, sw_info->echo_request_xid, buf );
   if ( err < 0 ) {
-    switch_event_disconnected( &switch_info );
+    switch_event_disconnected( sw_info );
+    release_switch_if_disconnected( sw_info );
     return;
   }
 
-  switch_set_timeout( ECHO_REPLY_TIMEOUT, echo_reply_timeout, NULL );
+  switch_set_timeout( sw_info, ECHO_REPLY_TIMEOUT, echo_reply_timeout );
+}
+
+
+static void
+request_disconnect( const char *service_name, uint64_t datapath_id ) {
+  size_t name_length = strlen( get_trema_name() ) + 1;
+  buffer *buf = alloc_buffer_with_length( sizeof( openflow_service_header_t ) + name_length );
+  openflow_service_header_t *header = append_back_buffer( buf, sizeof( openflow_service_header_t ) );
+  header->datapath_id = htonll( datapath_id );
+  header->service_name_length = htons( ( uint16_t ) name_length );
+  memcpy( append_back_buffer( buf, name_length ), get_trema_name(), name_length );
+
+  if ( !send_message( service_name, MESSENGER_OPENFLOW_DISCONNECT_REQUEST, buf->data, buf->length ) ) {
+    error( "Failed to send a disconnect request ( service_name = %s ).", service_name );
+  }
+  free_buffer( buf );
+}
+
+
+// In worker mode, packetin filter requests are accepted on the service name
+// of each switch and apply to the rules of that switch.
+static void
+handle_switch_packetin_filter_request( const messenger_context_handle *handle, uint16_t tag, void *data, size_t length ) {
+  const char *service_name = get_requested_service_name();
+  assert( service_name != NULL );
+
+  for ( list_element *e = worker_switches; e != NULL; e = e->next ) {
+    struct switch_info *sw_info = e->data;
+    if ( sw_info->dpid_service_name != NULL && sw_info->state != SWITCH_STATE_DISCONNECTED &&
+         strcmp( sw_info->dpid_service_name, service_name ) == 0 ) {
+      select_switch( sw_info );
+      handle_packetin_filter_request( handle, tag, data, length );
+      return;
+    }
+  }
+
+  error( "No switch found for a packetin filter request ( service_name = %s ).", service_name );
+}
+
+
+static void
+unregister_service( void *user_data ) {
+  char *service_name = user_data;
+
+  delete_message_received_callback( service_name, service_recv );
+  if ( switch_info.packetin_filter ) {
+    delete_message_requested_callback( service_name, handle_switch_packetin_filter_request );
+  }
+  delete_element( &unregistering_service_names, service_name );
+  xfree( service_name );
+}
+
+
+static bool
+cancel_unregistering_service( const char *service_name ) {
+  for ( list_element *e = unregistering_service_names; e != NULL; e = e->next ) {
+    if ( strcmp( e->data, service_name ) == 0 ) {
+      char *name = e->data;
+      delete_timer_event( unregister_service, name );
+      delete_element( &unregistering_service_names, name );
+      xfree( name );
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+static int
+register_switch( struct switch_info *sw_info, const char *service_name ) {
+  struct switch_info *old = lookup_hash_entry( switch_table, &sw_info->datapath_id );
+  if ( old != NULL ) {
+    // reconnected to this worker
+    switch_event_disconnected( old );
+    free_switch( old );
+  }
+  else {
+    pid_t pid = get_trema_process_from_name( service_name );
+    if ( pid > 0 && pid != getpid() ) {
+      // Another process still handles the switch. Ask it to release the
+      // switch and let the switch connect again.
+      notice( "Switch ( datapath_id = %#" PRIx64 " ) is handled by another process ( pid = %d ).",
+              sw_info->datapath_id, pid );
+      request_disconnect( service_name, sw_info->datapath_id );
+      return -1;
+    }
+  }
+
+  sw_info->dpid_service_name = xstrdup( service_name );
+  if ( !cancel_unregistering_service( service_name ) ) {
+    add_message_received_callback( service_name, service_recv );
+    if ( sw_info->packetin_filter ) {
+      add_message_requested_callback( service_name, handle_switch_packetin_filter_request );
+    }
+  }
+  add_trema_process_alias( service_name );
+  insert_hash_entry( switch_table, &sw_info->datapath_id, sw_info );
+
+  return 0;
+}
+
+
+static void
+unregister_switch( struct switch_info *sw_info ) {
+  if ( sw_info->dpid_service_name == NULL ) {
+    return;
+  }
+
+  if ( lookup_hash_entry( switch_table, &sw_info->datapath_id ) == sw_info ) {
+    delete_hash_entry( switch_table, &sw_info->datapath_id );
+  }
+  if ( get_trema_process_from_name( sw_info->dpid_service_name ) == getpid() ) {
+    delete_trema_process_alias( sw_info->dpid_service_name );
+  }
+
+  // We may be called back from the receive queue of the service name itself
+  // ( e.g., disconnect request ). Delete the callback after returning to the
+  // event loop.
+  char *service_name = xstrdup( sw_info->dpid_service_name );
+  struct itimerspec interval = { { 0, 0 }, { 0, 1 } };
+  add_timer_event_callback( &interval, unregister_service, service_name );
+  append_to_tail( &unregistering_service_names, service_name );
 }
 
 
@@ -388,28 +653,37 @@ switch_event_recv_featuresreply( struct switch_info *sw_info, uint64_t *dpid ) {
     sw_info->state = SWITCH_STATE_COMPLETED;
 
     // cancel to features_reply_wait-timeout timer
-    switch_unset_timeout( switch_event_timeout_features_reply, NULL );
+    switch_unset_timeout( sw_info, switch_event_timeout_features_reply );
 
     // TODO: set keepalive-timeout
     snprintf( new_service_name, new_service_name_len, "%s%#" PRIx64, SWITCH_MANAGER_PREFIX, sw_info->datapath_id );
 
-    // checking duplicate service
-    pid_t pid = get_trema_process_from_name( new_service_name );
-    if ( pid > 0 ) {
-      // duplicated
-      if ( !terminate_trema_process( pid ) ) {
-        return -1;
+    if ( worker_mode() ) {
+      ret = register_switch( sw_info, new_service_name );
+      if ( ret < 0 ) {
+        sw_info->state = SWITCH_STATE_WAIT_FEATURES_REPLY;
+        return ret;
       }
     }
-    // rename service_name of messenger
-    rename_message_received_callback( get_trema_name(), new_service_name );
+    else {
+      // checking duplicate service
+      pid_t pid = get_trema_process_from_name( new_service_name );
+      if ( pid > 0 ) {
+        // duplicated
+        if ( !terminate_trema_process( pid ) ) {
+          return -1;
+        }
+      }
+      // rename service_name of messenger
+      rename_message_received_callback( get_trema_name(), new_service_name );
 
-    debug( "Rename service name from %s to %s.", get_trema_name(), new_service_name );
-    if ( messenger_dump_enabled() ) {
-      stop_messenger_dump();
-      start_messenger_dump( new_service_name, DEFAULT_DUMP_SERVICE_NAME );
+      debug( "Rename service name from %s to %s.", get_trema_name(), new_service_name );
+      if ( messenger_dump_enabled() ) {
+        stop_messenger_dump();
+        start_messenger_dump( new_service_name, DEFAULT_DUMP_SERVICE_NAME );
+      }
+      set_trema_name( new_service_name );
     }
-    set_trema_name( new_service_name );
 
     // notify state and datapath_id
     service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_READY );
@@ -419,7 +693,7 @@ switch_event_recv_featuresreply( struct switch_info *sw_info, uint64_t *dpid ) {
     if ( ret < 0 ) {
       return ret;
     }
-    if ( switch_info.flow_cleanup ) {
+    if ( sw_info->flow_cleanup ) {
       ret = ofpmsg_send_delete_all_flows( sw_info );
       if ( ret < 0 ) {
         return ret;
@@ -447,12 +721,24 @@ int
 switch_event_disconnected( struct switch_info *sw_info ) {
   int old_state = sw_info->state;
 
+  if ( old_state == SWITCH_STATE_DISCONNECTED ) {
+    return 0;
+  }
   sw_info->state = SWITCH_STATE_DISCONNECTED;
 
-  if ( old_state == SWITCH_STATE_COMPLETED ) {
+  if ( old_state == SWITCH_STATE_WAIT_HELLO ) {
+    switch_unset_timeout( sw_info, switch_event_timeout_hello );
+  }
+  else if ( old_state == SWITCH_STATE_WAIT_FEATURES_REPLY ) {
+    switch_unset_timeout( sw_info, switch_event_timeout_features_reply );
+  }
+  else if ( old_state == SWITCH_STATE_COMPLETED ) {
+    switch_unset_timeout( sw_info, echo_reply_timeout );
     delete_timer_event( echo_request_interval, sw_info );
   }
 
+  cancel_flush_secure_channel( sw_info );
+
   if ( sw_info->fragment_buf != NULL ) {
     free_buffer( sw_info->fragment_buf );
     sw_info->fragment_buf = NULL;
@@ -469,9 +755,9 @@ switch_event_disconnected( struct switch_info *sw_info ) {
   }
 
   if ( sw_info->secure_channel_fd >= 0 ) {
-    set_readable( switch_info.secure_channel_fd, false );
-    set_writable( switch_info.secure_channel_fd, false );
-    delete_fd_handler( switch_info.secure_channel_fd );
+    set_readable( sw_info->secure_channel_fd, false );
+    set_writable( sw_info->secure_channel_fd, false );
+    delete_fd_handler( sw_info->secure_channel_fd );
 
     close( sw_info->secure_channel_fd );
     sw_info->secure_channel_fd = -1;
@@ -484,6 +770,12 @@ switch_event_disconnected( struct switch_info *sw_info ) {
     // send secure channle disconnect state to application
     service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_DISCONNECTED );
   }
+
+  if ( worker_mode() ) {
+    unregister_switch( sw_info );
+    return 0;
+  }
+
   flush_messenger();
 
   stop_trema();
@@ -494,26 +786,32 @@ switch_event_disconnected( struct switch_info *sw_info ) {
 
 int
 switch_event_recv_from_application( uint64_t *datapath_id, char *application_service_name, buffer *buf ) {
+  struct switch_info *sw_info = lookup_switch( *datapath_id );
 
-  if ( *datapath_id != switch_info.datapath_id ) {
+  if ( sw_info == NULL ) {
     error( "Invalid datapath id %#" PRIx64 ".", *datapath_id );
     free_buffer( buf );
 
     return -1;
   }
 
-  return ofpmsg_send( &switch_info, buf, application_service_name );
+  select_switch( sw_info );
+  return ofpmsg_send( sw_info, buf, application_service_name );
 }
 
 
 int
 switch_event_disconnect_request( uint64_t *datapath_id ) {
+  struct switch_info *sw_info = lookup_switch( *datapath_id );
 
-  if ( *datapath_id != switch_info.datapath_id ) {
+  if ( sw_info == NULL ) {
     error( "Invalid datapath id %#" PRIx64 ".", *datapath_id );
     return -1;
   }
-  return switch_event_disconnected( &switch_info );
+  int ret = switch_event_disconnected( sw_info );
+  release_switch_if_disconnected( sw_info );
+
+  return ret;
 }
 
 
@@ -527,6 +825,35 @@ switch_event_recv_error( struct switch_info *sw_info ) {
 }
 
 
+static void
+dump_switch_xid_table( struct switch_info *sw_info ) {
+  select_switch( sw_info );
+  dump_xid_table();
+}
+
+
+static void
+dump_switch_cookie_table( struct switch_info *sw_info ) {
+  select_switch( sw_info );
+  dump_cookie_table();
+}
+
+
+static void
+age_switch_cookie_table( struct switch_info *sw_info ) {
+  select_switch( sw_info );
+  age_cookie_table( NULL );
+}
+
+
+static void
+age_cookie_tables( void *user_data ) {
+  UNUSED( user_data );
+
+  foreach_switch( age_switch_cookie_table );
+}
+
+
 static void
 management_recv( uint16_t tag, void *data, size_t data_len ) {
   UNUSED( data );
@@ -534,14 +861,14 @@ management_recv( uint16_t tag, void *data, size_t data_len ) {
 
   switch ( tag ) {
   case DUMP_XID_TABLE:
-    dump_xid_table();
+    foreach_switch( dump_switch_xid_table );
     break;
 
   case DUMP_COOKIE_TABLE:
     if ( !switch_info.cookie_translation ) {
       break;
     }
-    dump_cookie_table();
+    foreach_switch( dump_switch_cookie_table );
     break;
 
   case TOGGLE_COOKIE_AGING:
@@ -549,11 +876,11 @@ management_recv( uint16_t tag, void *data, size_t data_len ) {
       break;
     }
     if ( age_cookie_table_enabled ) {
-      delete_timer_event( age_cookie_table, NULL );
+      delete_timer_event( age_cookie_tables, NULL );
       age_cookie_table_enabled = false;
     }
     else {
-      add_periodic_event_callback( COOKIE_TABLE_AGING_INTERVAL, age_cookie_table, NULL );
+      add_periodic_event_callback( COOKIE_TABLE_AGING_INTERVAL, age_cookie_tables, NULL );
       age_cookie_table_enabled = true;
     }
     break;
@@ -566,7 +893,105 @@ management_recv( uint16_t tag, void *data, size_t data_len ) {
 
 static void
 stop_switch_daemon( void ) {
-  switch_event_disconnected( &switch_info );
+  if ( !worker_mode() ) {
+    switch_event_disconnected( &switch_info );
+    return;
+  }
+
+  while ( worker_switches != NULL ) {
+    struct switch_info *sw_info = worker_switches->data;
+    switch_event_disconnected( sw_info );
+    free_switch( sw_info );
+  }
+  flush_messenger();
+  stop_trema();
+}
+
+
+static void
+start_switch( struct switch_info *sw_info ) {
+  fcntl( sw_info->secure_channel_fd, F_SETFL, O_NONBLOCK );
+
+  set_fd_handler( sw_info->secure_channel_fd, secure_channel_read, sw_info, secure_channel_write, sw_info );
+  set_readable( sw_info->secure_channel_fd, true );
+  set_writable( sw_info->secure_channel_fd, false );
+
+  // default switch configuration
+  sw_info->config_flags = OFPC_FRAG_NORMAL;
+  sw_info->miss_send_len = OFPCML_MAX;
+
+  sw_info->fragment_buf = NULL;
+  sw_info->send_queue = create_message_queue();
+  sw_info->recv_queue = create_message_queue();
+  sw_info->flush_scheduled = false;
+  sw_info->running_timer = false;
+  sw_info->echo_request_xid = 0;
+}
+
+
+static void
+accept_switch( int fd, void *data ) {
+  UNUSED( data );
+
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof( struct sockaddr_in );
+  int accept_fd = accept( fd, ( struct sockaddr * ) &addr, &addr_len );
+  if ( accept_fd < 0 ) {
+    // other workers may take the connection first.
+    if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ) {
+      error( "Failed to accept from switch ( %s [%d] ).", strerror( errno ), errno );
+    }
+    return;
+  }
+
+  struct switch_info *sw_info = xmalloc( sizeof( struct switch_info ) );
+  memcpy( sw_info, &switch_info, sizeof( struct switch_info ) );
+  sw_info->secure_channel_fd = accept_fd;
+  sw_info->dpid_service_name = NULL;
+  sw_info->datapath_id = 0;
+  sw_info->xid_table = create_xid_table();
+  sw_info->cookie_table = switch_info.cookie_translation ? create_cookie_table() : NULL;
+  sw_info->packetin_filter_table = switch_info.packetin_filter ? create_packetin_dispatch_table() : NULL;
+  append_to_tail( &worker_switches, sw_info );
+
+  start_switch( sw_info );
+  select_switch( sw_info );
+  if ( switch_event_connected( sw_info ) < 0 ) {
+    error( "Failed to set connected state." );
+    switch_event_disconnected( sw_info );
+    free_switch( sw_info );
+    return;
+  }
+  flush_secure_channel( sw_info );
+}
+
+
+static void
+start_worker( void ) {
+  create_list( &worker_switches );
+  create_list( &unregistering_service_names );
+  switch_table = create_hash( compare_datapath_id, hash_datapath_id );
+
+  fcntl( listen_fd, F_SETFL, O_NONBLOCK );
+  set_fd_handler( listen_fd, accept_switch, NULL, NULL, NULL );
+  set_readable( listen_fd, true );
+}
+
+
+static void
+stop_worker( void ) {
+  set_readable( listen_fd, false );
+  delete_fd_handler( listen_fd );
+  close( listen_fd );
+
+  while ( worker_switches != NULL ) {
+    free_switch( worker_switches->data );
+  }
+  while ( unregistering_service_names != NULL ) {
+    unregister_service( unregistering_service_names->data );
+  }
+  delete_hash( switch_table );
+  switch_table = NULL;
 }
 
 
@@ -594,14 +1019,23 @@ main( int argc, char *argv[] ) {
   create_list( &switch_info.packetin_service_name_list );
   create_list( &switch_info.portstatus_service_name_list );
   create_list( &switch_info.state_service_name_list );
+  if ( switch_info.packetin_filter ) {
+    init_packetin_dispatcher();
+  }
 
   // FIXME
 #define VENDER_PREFIX "vendor::"
 #define PACKET_IN_PREFIX "packet_in::"
 #define PORTSTATUS_PREFIX "port_status::"
 #define STATE_PREFIX "state_notify::"
+#define LLDP_PREFIX "lldp::"
   for ( i = optind; i < argc; i++ ) {
-    if ( strncmp( argv[i], VENDER_PREFIX, strlen( VENDER_PREFIX ) ) == 0 ) {
+    if ( switch_info.packetin_filter &&
+         ( strncmp( argv[i], PACKET_IN_PREFIX, strlen( PACKET_IN_PREFIX ) ) == 0 ||
+           strncmp( argv[i], LLDP_PREFIX, strlen( LLDP_PREFIX ) ) == 0 ) ) {
+      add_packetin_dispatch_rule( argv[i] );
+    }
+    else if ( strncmp( argv[i], VENDER_PREFIX, strlen( VENDER_PREFIX ) ) == 0 ) {
       service_name = xstrdup( argv[i] + strlen( VENDER_PREFIX ) );
       insert_in_front( &switch_info.vendor_service_name_list, service_name );
     }
@@ -625,49 +1059,51 @@ main( int argc, char *argv[] ) {
   sigaction( SIGINT, &signal_exit, NULL );
   sigaction( SIGTERM, &signal_exit, NULL );
 
-  fcntl( switch_info.secure_channel_fd, F_SETFL, O_NONBLOCK );
-
-  set_fd_handler( switch_info.secure_channel_fd, secure_channel_read, NULL, secure_channel_write, NULL );
-  set_readable( switch_info.secure_channel_fd, true );
-  set_writable( switch_info.secure_channel_fd, false );
-
-  // default switch configuration
-  switch_info.config_flags = OFPC_FRAG_NORMAL;
-  switch_info.miss_send_len = OFPCML_MAX;
-
-  switch_info.fragment_buf = NULL;
-  switch_info.send_queue = create_message_queue();
-  switch_info.recv_queue = create_message_queue();
-  switch_info.running_timer = false;
-  switch_info.echo_request_xid = 0;
-
   init_xid_table();
   if ( switch_info.cookie_translation ) {
     init_cookie_table();
   }
 
   add_message_received_callback( get_trema_name(), service_recv );
+  if ( switch_info.packetin_filter && !worker_mode() ) {
+    // packetin filter rules are managed through the service name of the switch daemon.
+    // Workers accept them on the service name of each switch ( see register_switch() ).
+    add_message_requested_callback( get_trema_name(), handle_packetin_filter_request );
+  }
 
   snprintf( management_service_name , MESSENGER_SERVICE_NAME_LENGTH,
             "%s.m", get_trema_name() );
   management_service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
   add_message_received_callback( management_service_name, management_recv );
 
-  ret = switch_event_connected( &switch_info );
-  if ( ret < 0 ) {
-    error( "Failed to set connected state." );
-    return -1;
+  if ( worker_mode() ) {
+    start_worker();
+  }
+  else {
+    start_switch( &switch_info );
+    ret = switch_event_connected( &switch_info );
+    if ( ret < 0 ) {
+      error( "Failed to set connected state." );
+      return -1;
+    }
+    flush_secure_channel( &switch_info );
   }
-  flush_secure_channel( &switch_info );
 
   start_trema();
 
+  if ( worker_mode() ) {
+    stop_worker();
+  }
+
   finalize_xid_table();
   if ( switch_info.cookie_translation ) {
     finalize_cookie_table();
   }
+  if ( switch_info.packetin_filter ) {
+    finalize_packetin_dispatcher();
+  }
 
-  if ( switch_info.secure_channel_fd >= 0 ) {
+  if ( !worker_mode() && switch_info.secure_channel_fd >= 0 ) {
     delete_fd_handler( switch_info.secure_channel_fd );
   }
 
@@ -141,10 +141,11 @@ struct listener_info listener_info;
 static struct option long_options[] = {
   { "port", 1, NULL, 'p' },
   { "switch", 1, NULL, 's' },
+  { "workers", 1, NULL, 'w' },
   { NULL, 0, NULL, 0  },
 };
 
-static char short_options[] = "p:s:";
+static char short_options[] = "p:s:w:";
 
 
 void
@@ -156,6 +157,7 @@ usage() {
 	 "  -s, --switch=PATH           the command path of switch\n"
 	 "  -n, --name=SERVICE_NAME     service name\n"
          "  -p, --port=PORT             server listen port (default %u)\n"
+         "  -w, --workers=N             handle switches in N switch daemons (default 0: one per switch)\n"
 	 "  -d, --daemonize             run in the background\n"
 	 "  -l, --logging_level=LEVEL   set logging level\n"
 	 "  -h, --help                  display this help and exit\n"
@@ -184,6 +186,11 @@ wait_child( void ) {
       else {
         debug( "Child process is terminated. pid:%d, signal:%d", pid, WTERMSIG( status ) );
       }
+      // restart crashed workers. the ones stopped on purpose are not.
+      int signum = WTERMSIG( status );
+      if ( listener_info.n_workers > 0 && signum != SIGTERM && signum != SIGINT && signum != SIGKILL ) {
+        secure_channel_restart_worker( &listener_info, pid );
+      }
     }
   }
 }
@@ -257,12 +264,32 @@ finalize_listener_info(  struct listener_info *listener_info ) {
     listener_info->switch_daemon = NULL;
   }
   if ( listener_info->listen_fd >= 0 ) {
-    set_readable( listener_info->listen_fd, false );
-    delete_fd_handler( listener_info->listen_fd );
+    if ( listener_info->n_workers == 0 ) {
+      set_readable( listener_info->listen_fd, false );
+      delete_fd_handler( listener_info->listen_fd );
+    }
 
     close( listener_info->listen_fd );
     listener_info->listen_fd = -1;
   }
+  if ( listener_info->worker_pids != NULL ) {
+    xfree( listener_info->worker_pids );
+    listener_info->worker_pids = NULL;
+  }
+}
+
+
+static int
+strtoworkers( const char *str ) {
+  char *ep;
+  long l;
+
+  l = strtol( str, &ep, 0 );
+  if ( l < 0 || l > SHRT_MAX || *ep != '\0' ) {
+    die( "Invalid number of workers. %s", str );
+    return -1;
+  }
+  return ( int ) l;
 }
 
 
@@ -296,6 +323,12 @@ parse_argument( struct listener_info *listener_info, int argc, char *argv[] ) {
         xfree( (void *)( uintptr_t )listener_info->switch_daemon );
         listener_info->switch_daemon = xstrdup( optarg );
         break;
+      case 'w':
+        listener_info->n_workers = strtoworkers( optarg );
+        if ( listener_info->n_workers < 0 ) {
+          return false;
+        }
+        break;
       default:
         usage();
         exit( EXIT_SUCCESS );
@@ -420,8 +453,18 @@ main( int argc, char *argv[] ) {
     exit( EXIT_FAILURE );
   }
 
-  set_fd_handler( listener_info.listen_fd, secure_channel_accept, &listener_info, NULL, NULL );
-  set_readable( listener_info.listen_fd, true );
+  if ( listener_info.n_workers > 0 ) {
+    // workers accept switches from the listen socket by themselves.
+    ret = secure_channel_start_workers( &listener_info );
+    if ( !ret ) {
+      finalize_listener_info( &listener_info );
+      exit( EXIT_FAILURE );
+    }
+  }
+  else {
+    set_fd_handler( listener_info.listen_fd, secure_channel_accept, &listener_info, NULL, NULL );
+    set_readable( listener_info.listen_fd, true );
+  }
 
   start_trema();
 
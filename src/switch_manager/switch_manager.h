@@ -41,6 +41,8 @@ static const uint SWITCH_MANAGER_ADDR_STR_LEN = sizeof( "255.255.255.255:65535"
 
 static const char SWITCH_MANAGER_PATH[] = "objects/switch_manager/switch_daemon";
 static const char SWITCH_MANAGER_STATE_PREFIX[] = "state_notify::";
+static const char SWITCH_MANAGER_WORKER_PREFIX[] = "switch_worker.";
+static const char SWITCH_MANAGER_LISTEN_SOCKET_OPTION[] = "--listen-socket=";
 
 
 struct listener_info {
@@ -49,6 +51,8 @@ struct listener_info {
   char **switch_daemon_argv;
   uint16_t listen_port;
   int listen_fd;
+  int n_workers;        // switch daemons sharing the listen socket, or zero
+  pid_t *worker_pids;
 };
 
 
@@ -46,6 +46,7 @@ struct switch_info {
   bool flow_cleanup;
   bool cookie_translation;
   bool deny_packet_in_on_startup;
+  bool packetin_filter;         // dispatch packet-ins with in-daemon filter rules
 
   int state;                    // state of switch secure channel
   uint64_t datapath_id;
@@ -59,9 +60,15 @@ struct switch_info {
 
   message_queue *send_queue;
   message_queue *recv_queue;
+  long send_coalesce_usec;      // delay to coalesce messages to the switch
+  bool flush_scheduled;
 
   bool running_timer;
 
+  struct xid_table *xid_table;  // per-switch tables in worker mode
+  struct cookie_table *cookie_table;
+  struct match_table *packetin_filter_table;
+
   uint32_t echo_request_xid;
 };
 
@@ -28,14 +28,16 @@
 static uint32_t transaction_id = 0U;
 
 #define XID_MAX_ENTRIES 4096
+#define XID_HASH_SIZE 4099
 
-typedef struct xid_table {
+struct xid_table {
   xid_entry_t *entries[ XID_MAX_ENTRIES ];
   hash_table *hash;
   int next_index;
-} xid_table_t;
+};
 
-static xid_table_t xid_table;
+static xid_table_t *default_xid_table = NULL;
+static xid_table_t *xid_table = NULL;
 
 
 uint32_t
@@ -81,25 +83,56 @@ free_xid_entry( xid_entry_t *free_entry ) {
 }
 
 
-void
-init_xid_table( void ) {
-  memset( &xid_table, 0, sizeof( xid_table_t ) );
-  xid_table.hash = create_hash( compare_uint32, hash_uint32 );
-  xid_table.next_index = 0;
+xid_table_t *
+create_xid_table( void ) {
+  xid_table_t *table = xmalloc( sizeof( xid_table_t ) );
+  memset( table, 0, sizeof( xid_table_t ) );
+  table->hash = create_hash_with_size( compare_uint32, hash_uint32, XID_HASH_SIZE );
+  table->next_index = 0;
+
+  return table;
 }
 
 
 void
-finalize_xid_table( void ) {
+delete_xid_table( xid_table_t *table ) {
+  assert( table != NULL );
+
   for( int i = 0; i < XID_MAX_ENTRIES; i++ ) {
-    if ( xid_table.entries[ i ] != NULL ) {
-      free_xid_entry( xid_table.entries[ i ] );
-      xid_table.entries[ i ] = NULL;
+    if ( table->entries[ i ] != NULL ) {
+      free_xid_entry( table->entries[ i ] );
+      table->entries[ i ] = NULL;
     }
   }
-  delete_hash( xid_table.hash );
-  xid_table.hash = NULL;
-  xid_table.next_index = 0;
+  delete_hash( table->hash );
+  if ( xid_table == table ) {
+    xid_table = default_xid_table;
+  }
+  xfree( table );
+}
+
+
+// Switches the table used by the functions below. Each switch handled
+// by a worker process has its own table.
+void
+select_xid_table( xid_table_t *table ) {
+  xid_table = table != NULL ? table : default_xid_table;
+}
+
+
+void
+init_xid_table( void ) {
+  default_xid_table = create_xid_table();
+  xid_table = default_xid_table;
+}
+
+
+void
+finalize_xid_table( void ) {
+  xid_table_t *table = default_xid_table;
+  default_xid_table = NULL;
+  delete_xid_table( table );
+  xid_table = NULL;
 }
 
 
@@ -110,22 +143,22 @@ insert_xid_entry( uint32_t original_xid, char *service_name ) {
   debug( "Inserting xid entry ( original_xid = %#lx, service_name = %s ).",
          original_xid, service_name );
 
-  if ( xid_table.next_index >= XID_MAX_ENTRIES ) {
-    xid_table.next_index = 0;
+  if ( xid_table->next_index >= XID_MAX_ENTRIES ) {
+    xid_table->next_index = 0;
   }
 
-  if ( xid_table.entries[ xid_table.next_index ] != NULL ) {
-    delete_xid_entry( xid_table.entries[ xid_table.next_index ] );
+  if ( xid_table->entries[ xid_table->next_index ] != NULL ) {
+    delete_xid_entry( xid_table->entries[ xid_table->next_index ] );
   }
 
-  new_entry = allocate_xid_entry( original_xid, service_name, xid_table.next_index );
-  xid_entry_t *old = insert_hash_entry( xid_table.hash, &new_entry->xid, new_entry );
+  new_entry = allocate_xid_entry( original_xid, service_name, xid_table->next_index );
+  xid_entry_t *old = insert_hash_entry( xid_table->hash, &new_entry->xid, new_entry );
   if ( old != NULL ) {
-    xid_table.entries[ old->index ] = NULL;
+    xid_table->entries[ old->index ] = NULL;
     free_xid_entry( old );
   }
-  xid_table.entries[ xid_table.next_index ] = new_entry;
-  xid_table.next_index++;
+  xid_table->entries[ xid_table->next_index ] = new_entry;
+  xid_table->next_index++;
 
   return new_entry->xid;
 }
@@ -136,7 +169,7 @@ delete_xid_entry( xid_entry_t *delete_entry ) {
   debug( "Deleting xid entry ( xid = %#lx, original_xid = %#lx, service_name = %s, index = %d ).",
          delete_entry->xid, delete_entry->original_xid, delete_entry->service_name, delete_entry->index );
 
-  xid_entry_t *deleted = delete_hash_entry( xid_table.hash, &delete_entry->xid );
+  xid_entry_t *deleted = delete_hash_entry( xid_table->hash, &delete_entry->xid );
 
   if ( deleted == NULL ) {
     error( "Failed to delete xid entry ( xid = %#lx ).", delete_entry->xid );
@@ -144,14 +177,14 @@ delete_xid_entry( xid_entry_t *delete_entry ) {
     return;
   }
 
-  xid_table.entries[ deleted->index ] = NULL;
+  xid_table->entries[ deleted->index ] = NULL;
   free_xid_entry( deleted );
 }
 
 
 xid_entry_t *
 lookup_xid_entry( uint32_t xid ) {
-  return lookup_hash_entry( xid_table.hash, &xid );
+  return lookup_hash_entry( xid_table->hash, &xid );
 }
 
 
@@ -168,7 +201,7 @@ dump_xid_table( void ) {
   hash_entry *e;
 
   info( "#### XID TABLE ####" );
-  init_hash_iterator( xid_table.hash, &iter );
+  init_hash_iterator( xid_table->hash, &iter );
   while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
     dump_xid_entry( e->value );
   }
@@ -34,8 +34,13 @@ typedef struct xid_entry {
   int index;
 } xid_entry_t;
 
+typedef struct xid_table xid_table_t;
+
 
 uint32_t generate_xid( void );
+xid_table_t *create_xid_table( void );
+void delete_xid_table( xid_table_t *table );
+void select_xid_table( xid_table_t *table );
 void init_xid_table( void );
 void finalize_xid_table( void );
 uint32_t insert_xid_entry( uint32_t original_xid, char *service_name );
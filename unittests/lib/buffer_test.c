@@ -69,6 +69,65 @@ test_alloc_buffer_with_length_succeeds() {
 }
 
 
+static void
+test_alloc_buffer_with_data_refers_to_data() {
+  tea teas[ 2 ] = { CEYLON, DARJEELING };
+
+  buffer *buf = alloc_buffer_with_data( teas, sizeof( teas ) );
+  assert_true( buf != NULL );
+  assert_true( buf->data == teas );
+  assert_true( buf->length == sizeof( teas ) );
+
+  tea *tea_data = remove_front_buffer( buf, sizeof( tea ) );
+  assert_true( tea_data == &teas[ 1 ] );
+
+  buffer *duplicate = duplicate_buffer( buf );
+  assert_true( duplicate->data != buf->data );
+  assert_memory_equal( duplicate->data, &DARJEELING, sizeof( tea ) );
+
+  free_buffer( duplicate );
+  free_buffer( buf );
+  assert_true( 0 == strcmp( teas[ 0 ].name, CEYLON.name ) );
+}
+
+
+static void
+test_append_back_buffer_with_data_copies_data() {
+  tea teas[ 1 ] = { CEYLON };
+
+  buffer *buf = alloc_buffer_with_data( teas, sizeof( teas ) );
+  tea *tea_data = append_back_buffer( buf, sizeof( tea ) );
+  memcpy( tea_data, &DARJEELING, sizeof( tea ) );
+  assert_true( buf->data != teas );
+  assert_true( buf->length == sizeof( tea ) * 2 );
+  assert_memory_equal( buf->data, &CEYLON, sizeof( tea ) );
+
+  free_buffer( buf );
+}
+
+
+static void
+test_append_front_buffer_uses_headroom() {
+  buffer *buf = alloc_buffer_with_headroom( sizeof( tea ), sizeof( tea ) );
+  assert_true( buf != NULL );
+  assert_true( buf->length == 0 );
+
+  tea *body = append_back_buffer( buf, sizeof( tea ) );
+  memcpy( body, &DARJEELING, sizeof( tea ) );
+
+  tea *tea_data = append_front_buffer( buf, sizeof( tea ) );
+  assert_true( tea_data + 1 == body );
+  assert_true( buf->length == sizeof( tea ) * 2 );
+  memcpy( tea_data, &CEYLON, sizeof( tea ) );
+  assert_memory_equal( body, &DARJEELING, sizeof( tea ) );
+
+  tea_data = remove_front_buffer( buf, sizeof( tea ) );
+  assert_true( tea_data == body );
+
+  free_buffer( buf );
+}
+
+
 static void
 test_free_buffer_succeeds() {
   buffer *buf = alloc_buffer();
@@ -335,6 +394,8 @@ main() {
   const UnitTest tests[] = {
     unit_test( test_alloc_buffer_succeeds ),
     unit_test( test_alloc_buffer_with_length_succeeds ),
+    unit_test( test_alloc_buffer_with_data_refers_to_data ),
+    unit_test( test_append_back_buffer_with_data_copies_data ),
 
     unit_test( test_free_buffer_succeeds ),
 
@@ -342,6 +403,7 @@ main() {
     unit_test( test_append_front_buffer_succeeds ),
     unit_test( test_append_front_buffer_resize_succeeds ),
     unit_test( test_append_front_buffer_new_alloc_succeeds ),
+    unit_test( test_append_front_buffer_uses_headroom ),
 
     unit_test( test_remove_front_buffer_succeeds ),
     unit_test( test_remove_front_buffer_text_insert_succeeds ),
@@ -34,10 +34,10 @@
 #include "wrapper.h"
 
 
-typedef struct match_table {
+struct match_table {
   list_element *wildcards_table;
   pthread_mutex_t *mutex;
-} match_table;
+};
 
 
 extern match_table *_match_table_head;
@@ -176,6 +176,36 @@ test_init_and_finalize_match_table_succeeds() {
 }
 
 
+static void
+test_select_match_table_switches_tables() {
+  init_match_table();
+  match_table *default_table = _match_table_head;
+  match_table *table = create_match_table();
+  assert_true( table != NULL );
+  assert_true( _match_table_head == default_table );
+
+  oxm_matches *alice = create_oxm_matches();
+  set_alice_match_entry( alice );
+  select_match_table( table );
+  assert_true( _match_table_head == table );
+  assert_true( insert_match_entry( alice, DEFAULT_PRIORITY, ( void * ) ( uintptr_t ) ALICE_MATCH_SERVICE_NAME ) );
+  assert_string_equal( lookup_match_entry( alice ), ALICE_MATCH_SERVICE_NAME );
+
+  select_match_table( NULL );
+  assert_true( _match_table_head == default_table );
+  assert_true( lookup_match_entry( alice ) == NULL );
+
+  select_match_table( table );
+  assert_true( delete_match_strict_entry( alice, DEFAULT_PRIORITY ) != NULL );
+  delete_match_table( table );
+  assert_true( _match_table_head == default_table );
+
+  delete_oxm_matches( alice );
+  finalize_match_table();
+  assert_true( _match_table_head == NULL );
+}
+
+
 static void
 test_init_match_table_dies_if_already_initialized() {
   init_match_table();
@@ -634,6 +664,61 @@ test_reinsert_of_deleted_lowhest_priority_wildcards_entry_succeeds() {
 }
 
 
+static void
+test_lookup_prefers_higher_priority_prefix_entry_over_exact_entry() {
+  oxm_matches *alice = create_oxm_matches();
+  set_alice_match_entry( alice );
+  oxm_matches *alice_prefix = create_oxm_matches();
+  append_oxm_match_eth_type( alice_prefix, ETHERTYPE_IP );
+  append_oxm_match_ipv4_src( alice_prefix, 0x0a000100, 0xffffff00 );
+  assert_true( insert_match_entry( alice, LOW_PRIORITY, xstrdup( ALICE_MATCH_SERVICE_NAME ) ) );
+  assert_true( insert_match_entry( alice_prefix, HIGH_PRIORITY, xstrdup( ANY_MATCH_SERVICE_NAME ) ) );
+
+  void *data = lookup_match_entry( alice );
+  assert_true( data != NULL );
+  assert_string_equal( ( char * ) data, ANY_MATCH_SERVICE_NAME );
+
+  XFREE( delete_match_strict_entry( alice_prefix, HIGH_PRIORITY ) );
+  data = lookup_match_entry( alice );
+  assert_true( data != NULL );
+  assert_string_equal( ( char * ) data, ALICE_MATCH_SERVICE_NAME );
+  XFREE( delete_match_strict_entry( alice, LOW_PRIORITY ) );
+
+  delete_oxm_matches( alice );
+  delete_oxm_matches( alice_prefix );
+}
+
+
+static void
+test_lookup_same_priority_entries_in_insertion_order() {
+  oxm_matches *alice = create_oxm_matches();
+  set_alice_match_entry( alice );
+  oxm_matches *alice_wildcards = create_oxm_matches();
+  set_alice_wildcards_entry( alice_wildcards );
+  oxm_matches *any_wildcards = create_oxm_matches();
+  set_any_wildcards_entry( any_wildcards );
+  assert_true( insert_match_entry( any_wildcards, DEFAULT_PRIORITY, xstrdup( ANY_MATCH_SERVICE_NAME ) ) );
+  assert_true( insert_match_entry( alice_wildcards, DEFAULT_PRIORITY, xstrdup( ALICE_MATCH_SERVICE_NAME ) ) );
+
+  void *data = lookup_match_entry( alice );
+  assert_true( data != NULL );
+  assert_string_equal( ( char * ) data, ANY_MATCH_SERVICE_NAME );
+
+  XFREE( delete_match_strict_entry( any_wildcards, DEFAULT_PRIORITY ) );
+  assert_true( insert_match_entry( any_wildcards, DEFAULT_PRIORITY, xstrdup( ANY_MATCH_SERVICE_NAME ) ) );
+  data = lookup_match_entry( alice );
+  assert_true( data != NULL );
+  assert_string_equal( ( char * ) data, ALICE_MATCH_SERVICE_NAME );
+
+  XFREE( delete_match_strict_entry( alice_wildcards, DEFAULT_PRIORITY ) );
+  XFREE( delete_match_strict_entry( any_wildcards, DEFAULT_PRIORITY ) );
+
+  delete_oxm_matches( alice );
+  delete_oxm_matches( alice_wildcards );
+  delete_oxm_matches( any_wildcards );
+}
+
+
 /*************************************************************************
  * update, lookup and delete entry tests.
  *************************************************************************/
@@ -1238,6 +1323,7 @@ main() {
   const UnitTest tests[] = {
     // init and finalize tests.
     unit_test_setup_teardown( test_init_and_finalize_match_table_succeeds, setup, teardown ),
+    unit_test_setup_teardown( test_select_match_table_switches_tables, setup, teardown ),
     unit_test_setup_teardown( test_init_match_table_dies_if_already_initialized, setup, teardown ),
     unit_test_setup_teardown( test_finalize_match_table_dies_if_not_initialized, setup, teardown ),
     unit_test_setup_teardown( test_insert_match_entry_dies_if_not_initialized, setup, teardown ),
@@ -1259,6 +1345,10 @@ main() {
     unit_test_setup_teardown( test_reinsert_of_deleted_highest_priority_wildcards_entry_succeeds, setup_and_init, finalize_and_teardown ),
     unit_test_setup_teardown( test_reinsert_of_deleted_lowhest_priority_wildcards_entry_succeeds, setup_and_init, finalize_and_teardown ),
 
+    // lookup tests.
+    unit_test_setup_teardown( test_lookup_prefers_higher_priority_prefix_entry_over_exact_entry, setup_and_init, finalize_and_teardown ),
+    unit_test_setup_teardown( test_lookup_same_priority_entries_in_insertion_order, setup_and_init, finalize_and_teardown ),
+
     // update tests.
     unit_test_setup_teardown( test_update_exact_wildcards_succeeds, setup_and_init, finalize_and_teardown ),
     unit_test_setup_teardown( test_update_nonexistent_wildcards_entry_fails, setup_and_init, finalize_and_teardown ),
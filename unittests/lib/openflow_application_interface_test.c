@@ -74,6 +74,9 @@ extern void handle_openflow_message( void *data, size_t length );
 extern void handle_message( uint16_t type, void *data, size_t length );
 extern void insert_dpid( list_element **head, uint64_t *dpid );
 extern void handle_list_switches_reply( uint16_t message_type, void *data, size_t length, void *user_data );
+extern void add_switch_route( uint64_t datapath_id );
+extern void *lookup_switch_route( uint64_t datapath_id );
+extern void delete_switch_routes();
 
 
 #define SWITCH_READY_HANDLER ( ( void * ) 0x00020001 )
@@ -153,7 +156,7 @@ static openflow_event_handlers_t EVENT_HANDLERS = {
   LIST_SWITCHES_REPLY_HANDLER
 };
 static uint64_t DATAPATH_ID = 0x0102030405060708ULL;
-static char REMOTE_SERVICE_NAME[] = "switch.0x102030405060708";
+static char REMOTE_SERVICE_NAME[] = "switch_daemon.0x102030405060708";
 static const uint32_t TRANSACTION_ID = 0x04030201;
 static const uint32_t VENDOR_ID = 0xccddeeff;
 static const uint8_t MAC_ADDR_X[ OFP_ETH_ALEN ] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
@@ -271,13 +274,6 @@ mock_clear_send_queue( const char *service_name ) {
 }
 
 
-bool
-mock_parse_packet( buffer *buf ) {
-  calloc_packet_info( buf );
-  return ( bool ) mock();
-}
-
-
 static void
 mock_switch_disconnected_handler( uint64_t datapath_id, void *user_data ) {
   check_expected( &datapath_id );
@@ -464,6 +460,19 @@ mock_simple_packet_in_handler( uint64_t dpid, packet_in event ) {
 }
 
 
+static void
+mock_deferred_packet_in_handler( uint64_t dpid, packet_in event ) {
+  UNUSED( dpid );
+
+  assert_true( event.data->user_data == NULL );
+  packet_info *info = get_parsed_packet_info( event.data );
+  assert_true( info != NULL );
+  assert_true( info->l2_header == event.data->data );
+
+  packet_in_handler_called = true;
+}
+
+
 static void
 mock_flow_removed_handler( uint64_t datapath_id, uint32_t transaction_id, uint64_t cookie, uint16_t priority,
                            uint8_t reason, uint8_t table_id, uint32_t duration_sec, uint32_t duration_nsec,
@@ -891,6 +900,7 @@ cleanup() {
   memset( service_name, 0, sizeof( service_name ) );
   memset( &event_handlers, 0, sizeof( event_handlers ) );
   memset( USER_DATA, 'Z', sizeof( USER_DATA ) );
+  delete_switch_routes();
   if ( stats != NULL ) {
     delete_hash( stats );
     stats = NULL;
@@ -1113,6 +1123,7 @@ test_handle_switch_ready() {
   stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_ready_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
+  delete_switch_routes();
   free_buffer( data );
   xfree( delete_hash_entry( stats, "openflow_application_interface.switch_ready_receive_succeeded" ) );
 }
@@ -1134,6 +1145,7 @@ test_handle_switch_ready_with_simple_handler() {
   stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_ready_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
+  delete_switch_routes();
   free_buffer( data );
   xfree( delete_hash_entry( stats, "openflow_application_interface.switch_ready_receive_succeeded" ) );
 }
@@ -1512,15 +1524,43 @@ test_send_openflow_message() {
   ret = send_openflow_message( DATAPATH_ID, buffer );
   
   assert_true( ret );
+  assert_int_equal( ( int ) buffer->length, sizeof( struct ofp_header ) );
   stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.hello_send_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
+  assert_true( lookup_switch_route( DATAPATH_ID ) == NULL );
 
+  delete_switch_routes();
   free_buffer( buffer );
   xfree( expected_data );
   xfree( delete_hash_entry( stats, "openflow_application_interface.hello_send_succeeded" ) );
 }
 
 
+static void
+test_send_openflow_message_to_connected_switch() {
+  buffer *buffer = create_hello( TRANSACTION_ID, NULL );
+  size_t header_length = ( size_t ) ( sizeof( openflow_service_header_t ) +
+                                      strlen( SERVICE_NAME ) + 1 );
+
+  add_switch_route( DATAPATH_ID );
+  void *route = lookup_switch_route( DATAPATH_ID );
+  assert_true( route != NULL );
+
+  expect_string( mock_send_message, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message, tag32, MESSENGER_OPENFLOW_MESSAGE );
+  expect_value( mock_send_message, len, header_length + sizeof( struct ofp_header ) );
+  expect_any( mock_send_message, data );
+  will_return( mock_send_message, true );
+
+  assert_true( send_openflow_message( DATAPATH_ID, buffer ) );
+  assert_true( lookup_switch_route( DATAPATH_ID ) == route );
+
+  delete_switch_routes();
+  free_buffer( buffer );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.hello_send_succeeded" ) );
+}
+
+
 static void
 test_send_openflow_message_if_message_is_NULL() {
   expect_assert_failure( send_openflow_message( DATAPATH_ID, NULL ) );
@@ -2046,7 +2086,6 @@ test_handle_packet_in() {
 
   buffer *buffer = create_packet_in( TRANSACTION_ID, buffer_id, total_len, reason, table_id, cookie, match, data );
   
-  will_return( mock_parse_packet, true );
   expect_memory( mock_packet_in_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
   expect_value( mock_packet_in_handler, transaction_id, TRANSACTION_ID );
   expect_value( mock_packet_in_handler, buffer_id, buffer_id );
@@ -2105,7 +2144,6 @@ test_handle_packet_in_with_simple_handler() {
 
   buffer *buffer = create_packet_in( TRANSACTION_ID, buffer_id, total_len, reason, table_id, cookie, match, data );
   
-  will_return( mock_parse_packet, true );
   expect_memory( mock_simple_packet_in_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
   expect_value( mock_simple_packet_in_handler, transaction_id, TRANSACTION_ID );
   expect_value( mock_simple_packet_in_handler, buffer_id, buffer_id );
@@ -2128,7 +2166,7 @@ test_handle_packet_in_with_simple_handler() {
 
 
 static void
-test_handle_packet_in_with_malformed_packet() {
+test_handle_packet_in_defers_parse_packet() {
   uint32_t buffer_id = 0x01020304;
   uint8_t reason = OFPR_NO_MATCH;
   uint8_t table_id = 0x01;
@@ -2163,13 +2201,11 @@ test_handle_packet_in_with_malformed_packet() {
 
   buffer *buffer = create_packet_in( TRANSACTION_ID, buffer_id, total_len, reason, table_id, cookie, match, data );
 
-  will_return( mock_parse_packet, false );
-
-  set_packet_in_handler( mock_packet_in_handler, USER_DATA );
+  set_packet_in_handler( mock_deferred_packet_in_handler, USER_DATA );
 
   handle_packet_in( DATAPATH_ID, buffer );
 
-  assert_false( packet_in_handler_called );
+  assert_true( packet_in_handler_called );
 
   delete_oxm_matches(match);
   free_buffer( buffer );
@@ -3994,6 +4030,12 @@ test_handle_list_switches_reply() {
 
   set_list_switches_reply_handler( mock_handle_list_switches_reply );
   handle_list_switches_reply( message_type, dpid, length, user_data );
+
+  assert_true( lookup_switch_route( alice ) != NULL );
+  assert_true( lookup_switch_route( bob ) != NULL );
+  assert_true( lookup_switch_route( carol ) != NULL );
+
+  delete_switch_routes();
 }
 
 
@@ -4028,13 +4070,17 @@ test_handle_list_switches_reply_if_length_is_zero() {
 static void
 test_handle_switch_events_if_type_is_MESSENGER_OPENFLOW_CONNECTED() {
   buffer *data = alloc_buffer_with_length( sizeof( openflow_service_header_t ) );
-  append_back_buffer( data, sizeof( openflow_service_header_t ) );
+  uint64_t *datapath_id = append_back_buffer( data, sizeof( openflow_service_header_t ) );
+
+  *datapath_id = htonll( DATAPATH_ID );
 
   handle_switch_events( MESSENGER_OPENFLOW_CONNECTED, data->data, data->length );
 
   stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_connected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
+  assert_true( lookup_switch_route( DATAPATH_ID ) != NULL );
 
+  delete_switch_routes();
   free_buffer( data );
   xfree( delete_hash_entry( stats, "openflow_application_interface.switch_connected_receive_succeeded" ) );
 }
@@ -4056,12 +4102,15 @@ test_handle_switch_events_if_type_is_MESSENGER_OPENFLOW_DISCONNECTED() {
   expect_string( mock_clear_send_queue, service_name, REMOTE_SERVICE_NAME );
   will_return( mock_clear_send_queue, true );
 
+  add_switch_route( DATAPATH_ID );
   set_switch_disconnected_handler( mock_switch_disconnected_handler, SWITCH_DISCONNECTED_USER_DATA );
   handle_switch_events( MESSENGER_OPENFLOW_DISCONNECTED, data->data, data->length );
 
   stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_disconnected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
+  assert_true( lookup_switch_route( DATAPATH_ID ) == NULL );
 
+  delete_switch_routes();
   free_buffer( data );
   xfree( delete_hash_entry( stats, "openflow_application_interface.switch_disconnected_receive_succeeded" ) );
 }
@@ -4345,7 +4394,6 @@ test_handle_openflow_message() {
     buffer *buffer = create_packet_in( TRANSACTION_ID, buffer_id, total_len, reason, table_id, cookie, match, data );
     append_front_buffer( buffer, sizeof( openflow_service_header_t ) );
     memcpy( buffer->data, &messenger_header, sizeof( openflow_service_header_t ) );
-    will_return( mock_parse_packet, true );
     expect_memory( mock_packet_in_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
     expect_value( mock_packet_in_handler, transaction_id, TRANSACTION_ID );
     expect_value( mock_packet_in_handler, buffer_id, buffer_id );
@@ -5676,6 +5724,7 @@ test_handle_message_if_type_is_MESSENGER_OPENFLOW_CONNECTED() {
   stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_connected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
+  delete_switch_routes();
   free_buffer( data );
   xfree( delete_hash_entry( stats, "openflow_application_interface.switch_connected_receive_succeeded" ) );
 }
@@ -5931,7 +5980,7 @@ main() {
     unit_test_setup_teardown( test_set_packet_in_handler_should_die_if_handler_is_NULL, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_with_simple_handler, init, cleanup ),
-    unit_test_setup_teardown( test_handle_packet_in_with_malformed_packet, init, cleanup ),
+    unit_test_setup_teardown( test_handle_packet_in_defers_parse_packet, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_without_data, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_without_handler, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_should_die_if_message_is_NULL, init, cleanup ),
@@ -5964,6 +6013,7 @@ main() {
 
     // send_openflow_message() tests.
     unit_test_setup_teardown( test_send_openflow_message, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_message_to_connected_switch, init, cleanup ),
     unit_test_setup_teardown( test_send_openflow_message_if_message_is_NULL, init, cleanup ),
     unit_test_setup_teardown( test_send_openflow_message_if_message_length_is_zero, init, cleanup ),
 
@@ -912,6 +912,59 @@ test_create_experimenter_without_data() {
 }
 
 
+/********************************************************************************
+ * Tests of functions for bundle experimenter messages.
+ ********************************************************************************/
+
+static void
+test_create_bundle_control() {
+  buffer *buffer = create_bundle_control( MY_TRANSACTION_ID, 0x12345678, ONF_BCT_COMMIT_REQUEST, ONF_BF_ATOMIC );
+  assert_true( buffer != NULL );
+
+  assert_int_equal( ( int ) buffer->length, sizeof( struct onf_bundle_ctrl_msg ) );
+
+  struct onf_bundle_ctrl_msg *bundle_ctrl = buffer->data;
+
+  assert_int_equal( bundle_ctrl->header.header.version, OFP_VERSION );
+  assert_int_equal( bundle_ctrl->header.header.type, OFPT_EXPERIMENTER );
+  assert_int_equal( ntohs( bundle_ctrl->header.header.length ), sizeof( struct onf_bundle_ctrl_msg ) );
+  assert_int_equal( ( int ) ntohl( bundle_ctrl->header.header.xid ), ( int ) MY_TRANSACTION_ID );
+  assert_int_equal( ( int ) ntohl( bundle_ctrl->header.experimenter ), ONF_EXPERIMENTER_ID );
+  assert_int_equal( ( int ) ntohl( bundle_ctrl->header.exp_type ), ONFT_BUNDLE_CONTROL );
+  assert_int_equal( ( int ) ntohl( bundle_ctrl->bundle_id ), 0x12345678 );
+  assert_int_equal( ntohs( bundle_ctrl->type ), ONF_BCT_COMMIT_REQUEST );
+  assert_int_equal( ntohs( bundle_ctrl->flags ), ONF_BF_ATOMIC );
+
+  free_buffer( buffer );
+}
+
+
+static void
+test_create_bundle_add_message() {
+  buffer *message = create_barrier_request( MY_TRANSACTION_ID );
+  buffer *buffer = create_bundle_add_message( MY_TRANSACTION_ID, 0x12345678, ONF_BF_ORDERED, message );
+  assert_true( buffer != NULL );
+
+  uint16_t length = ( uint16_t ) ( offsetof( struct onf_bundle_add_msg, message ) + message->length );
+  assert_int_equal( ( int ) buffer->length, length );
+
+  struct onf_bundle_add_msg *bundle_add = buffer->data;
+
+  assert_int_equal( bundle_add->header.header.version, OFP_VERSION );
+  assert_int_equal( bundle_add->header.header.type, OFPT_EXPERIMENTER );
+  assert_int_equal( ntohs( bundle_add->header.header.length ), length );
+  assert_int_equal( ( int ) ntohl( bundle_add->header.header.xid ), ( int ) MY_TRANSACTION_ID );
+  assert_int_equal( ( int ) ntohl( bundle_add->header.experimenter ), ONF_EXPERIMENTER_ID );
+  assert_int_equal( ( int ) ntohl( bundle_add->header.exp_type ), ONFT_BUNDLE_ADD_MESSAGE );
+  assert_int_equal( ( int ) ntohl( bundle_add->bundle_id ), 0x12345678 );
+  assert_int_equal( ntohs( bundle_add->flags ), ONF_BF_ORDERED );
+  assert_memory_equal( &bundle_add->message, message->data, message->length );
+
+  free_buffer( message );
+  free_buffer( buffer );
+}
+
+
 /********************************************************************************
  * Tests of functions for OFPT_FEATURES_REQUEST.
  ********************************************************************************/
@@ -45894,6 +45947,8 @@ main() {
 
     unit_test_setup_teardown( test_create_experimenter, init, teardown ),
     unit_test_setup_teardown( test_create_experimenter_without_data, init, teardown ),
+    unit_test_setup_teardown( test_create_bundle_control, init, teardown ),
+    unit_test_setup_teardown( test_create_bundle_add_message, init, teardown ),
     unit_test_setup_teardown( test_create_features_request, init, teardown ),
     unit_test_setup_teardown( test_create_features_reply, init, teardown ),
     unit_test_setup_teardown( test_create_get_config_request, init, teardown ),
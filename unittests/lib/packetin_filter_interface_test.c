@@ -366,6 +366,38 @@ test_add_packetin_filter_fails_if_service_name_is_zero_length() {
 }
 
 
+static void
+test_add_packetin_filter_succeeds_with_management_service() {
+  uint16_t match_len = ( uint16_t ) ( offsetof( struct ofp_match, oxm_fields ) + get_oxm_matches_length( MATCH ) );
+  uint16_t match_pad_len = ( uint16_t ) ( match_len + PADLEN_TO_64( match_len ) );
+  uint16_t entry_len = ( uint16_t ) ( offsetof( packetin_filter_entry, match ) + match_pad_len );
+  uint16_t req_len = ( uint16_t ) ( offsetof( add_packetin_filter_request, entry ) + entry_len );
+  add_packetin_filter_request *expected_data = xcalloc( 1, req_len );
+  memset( expected_data, 0, req_len );
+  expected_data->length = htons( req_len );
+  expected_data->entry.length = htons( entry_len );
+  expected_data->entry.priority = htons( PRIORITY );
+  strncpy( expected_data->entry.service_name, SERVICE_NAME, sizeof( expected_data->entry.service_name ) );
+  construct_ofp_match( &expected_data->entry.match, MATCH );
+
+  assert_true( set_packetin_filter_management_service( "switch_daemon.0x1" ) );
+
+  expect_string( mock_send_request_message, to_service_name, "switch_daemon.0x1" );
+  expect_string( mock_send_request_message, from_service_name, CLIENT_SERVICE_NAME );
+  expect_value( mock_send_request_message, tag32, MESSENGER_ADD_PACKETIN_FILTER_REQUEST );
+  expect_memory( mock_send_request_message, data, expected_data, req_len );
+  expect_value( mock_send_request_message, len, req_len );
+  expect_value( mock_send_request_message, hd->callback, HANDLER );
+  expect_value( mock_send_request_message, hd->user_data, USER_DATA );
+  will_return( mock_send_request_message, true );
+
+  assert_true( add_packetin_filter( MATCH, PRIORITY, SERVICE_NAME, HANDLER, USER_DATA ) );
+
+  assert_true( set_packetin_filter_management_service( NULL ) );
+  xfree( expected_data );
+}
+
+
 
 /********************************************************************************
  * delete_packetin_filter() tests.
@@ -787,6 +819,7 @@ main() {
     unit_test_setup_teardown( test_add_packetin_filter_succeeds_if_not_initialized, setup, finalize_and_teardown ),
     unit_test_setup_teardown( test_add_packetin_filter_fails_if_service_name_is_NULL, setup_and_init, finalize_and_teardown ),
     unit_test_setup_teardown( test_add_packetin_filter_fails_if_service_name_is_zero_length, setup_and_init, finalize_and_teardown ),
+    unit_test_setup_teardown( test_add_packetin_filter_succeeds_with_management_service, setup_and_init, finalize_and_teardown ),
 
     // delete_packetin_filter() tests.
     unit_test_setup_teardown( test_delete_packetin_filter_succeeds_with_PACKETIN_FILTER_FLAG_MATCH_STRICT, setup_and_init, finalize_and_teardown ),
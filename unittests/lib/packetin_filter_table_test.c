@@ -0,0 +1,444 @@
+/*
+ * Unit tests for packetin_filter_table.
+ *
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <arpa/inet.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trema.h"
+#include "cmockery_trema.h"
+
+
+/********************************************************************************
+ * Mock functions.
+ ********************************************************************************/
+
+static void ( *original_warn )( const char *format, ... );
+static void ( *original_error )( const char *format, ... );
+static bool ( *original_send_reply_message )( const messenger_context_handle *handle, const uint16_t tag,
+                                              const void *data, size_t len );
+
+static messenger_context_handle *HANDLE = ( messenger_context_handle * ) 0x12345678;
+static uint16_t PRIORITY = OFP_HIGH_PRIORITY / 2;
+static char SERVICE_NAME[] = "send_message_to_here";
+static char ANOTHER_SERVICE_NAME[] = "and_here";
+static oxm_matches *MATCH = NULL;
+
+static uint16_t reply_tag = 0;
+static char reply_data[ 2048 ];
+static size_t reply_length = 0;
+
+
+static void
+mock_warn( const char *format, ... ) {
+  va_list args;
+  va_start( args, format );
+  char message[ 1000 ];
+  vsprintf( message, format, args );
+  va_end( args );
+
+  check_expected( message );
+}
+
+
+static void
+mock_error( const char *format, ... ) {
+  va_list args;
+  va_start( args, format );
+  char message[ 1000 ];
+  vsprintf( message, format, args );
+  va_end( args );
+
+  check_expected( message );
+}
+
+
+static bool
+mock_send_reply_message( const messenger_context_handle *handle, const uint16_t tag,
+                         const void *data, size_t len ) {
+  assert_true( handle == HANDLE );
+  assert_true( len <= sizeof( reply_data ) );
+
+  reply_tag = tag;
+  memcpy( reply_data, data, len );
+  reply_length = len;
+
+  return true;
+}
+
+
+/********************************************************************************
+ * Helper functions.
+ ********************************************************************************/
+
+// add, delete and dump requests share the layout of the delete request.
+static buffer *
+create_request( uint8_t flags, oxm_matches *match, uint16_t priority, const char *service_name ) {
+  uint16_t match_len = ( uint16_t ) ( offsetof( struct ofp_match, oxm_fields ) + get_oxm_matches_length( match ) );
+  match_len = ( uint16_t ) ( match_len + PADLEN_TO_64( match_len ) );
+  size_t length = offsetof( delete_packetin_filter_request, criteria.match ) + match_len;
+
+  buffer *buf = alloc_buffer_with_length( length );
+  delete_packetin_filter_request *request = append_back_buffer( buf, length );
+  memset( request, 0, length );
+  request->length = htons( ( uint16_t ) length );
+  request->flags = flags;
+  request->criteria.length = htons( ( uint16_t ) ( offsetof( packetin_filter_entry, match ) + match_len ) );
+  request->criteria.priority = htons( priority );
+  strncpy( request->criteria.service_name, service_name, sizeof( request->criteria.service_name ) - 1 );
+  construct_ofp_match( &request->criteria.match, match );
+
+  return buf;
+}
+
+
+static void
+handle_request( uint16_t tag, uint8_t flags, oxm_matches *match, uint16_t priority, const char *service_name ) {
+  buffer *request = create_request( flags, match, priority, service_name );
+  reply_tag = 0;
+  reply_length = 0;
+  handle_packetin_filter_request( HANDLE, tag, request->data, request->length );
+  free_buffer( request );
+}
+
+
+static void
+add_filter( oxm_matches *match, uint16_t priority, const char *service_name ) {
+  handle_request( MESSENGER_ADD_PACKETIN_FILTER_REQUEST, 0, match, priority, service_name );
+  assert_int_equal( reply_tag, MESSENGER_ADD_PACKETIN_FILTER_REPLY );
+  assert_int_equal( ( ( add_packetin_filter_reply * ) reply_data )->status, PACKETIN_FILTER_OPERATION_SUCCEEDED );
+}
+
+
+static int
+count_services( oxm_matches *match, uint16_t priority ) {
+  int n_services = 0;
+  for ( list_element *e = lookup_match_strict_entry( match, priority ); e != NULL; e = e->next ) {
+    n_services++;
+  }
+
+  return n_services;
+}
+
+
+/********************************************************************************
+ * Setup and teardown functions.
+ ********************************************************************************/
+
+static void
+setup() {
+  original_warn = warn;
+  warn = mock_warn;
+  original_error = error;
+  error = mock_error;
+  original_send_reply_message = send_reply_message;
+  send_reply_message = mock_send_reply_message;
+
+  MATCH = create_oxm_matches();
+  append_oxm_match_eth_type( MATCH, 0x0800 );
+  append_oxm_match_ip_proto( MATCH, 0x6 );
+}
+
+
+static void
+teardown() {
+  delete_oxm_matches( MATCH );
+
+  warn = original_warn;
+  error = original_error;
+  send_reply_message = original_send_reply_message;
+}
+
+
+/********************************************************************************
+ * add_packetin_filter_entry() and delete_packetin_filter_entry() tests.
+ ********************************************************************************/
+
+static void
+test_add_packetin_filter_entry_appends_services() {
+  init_packetin_filter_table();
+
+  assert_true( add_packetin_filter_entry( MATCH, PRIORITY, SERVICE_NAME ) );
+  assert_true( add_packetin_filter_entry( MATCH, PRIORITY, ANOTHER_SERVICE_NAME ) );
+
+  list_element *services = lookup_match_entry( MATCH );
+  assert_true( services != NULL );
+  assert_string_equal( services->data, SERVICE_NAME );
+  assert_string_equal( services->next->data, ANOTHER_SERVICE_NAME );
+  assert_true( services->next->next == NULL );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_add_packetin_filter_entry_fails_if_service_exists() {
+  init_packetin_filter_table();
+
+  assert_true( add_packetin_filter_entry( MATCH, PRIORITY, SERVICE_NAME ) );
+
+  expect_string( mock_warn, message, "match entry already exists ( match = [eth_type = 0x0800, ip_proto = 0x06], service_name = [send_message_to_here] )" );
+  assert_false( add_packetin_filter_entry( MATCH, PRIORITY, SERVICE_NAME ) );
+  assert_int_equal( count_services( MATCH, PRIORITY ), 1 );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_delete_packetin_filter_entry_keeps_other_services() {
+  init_packetin_filter_table();
+
+  add_packetin_filter_entry( MATCH, PRIORITY, SERVICE_NAME );
+  add_packetin_filter_entry( MATCH, PRIORITY, ANOTHER_SERVICE_NAME );
+
+  assert_int_equal( delete_packetin_filter_entry( MATCH, PRIORITY, SERVICE_NAME ), 1 );
+  list_element *services = lookup_match_strict_entry( MATCH, PRIORITY );
+  assert_true( services != NULL );
+  assert_string_equal( services->data, ANOTHER_SERVICE_NAME );
+  assert_true( services->next == NULL );
+
+  assert_int_equal( delete_packetin_filter_entry( MATCH, PRIORITY, ANOTHER_SERVICE_NAME ), 1 );
+  assert_true( lookup_match_strict_entry( MATCH, PRIORITY ) == NULL );
+
+  finalize_packetin_filter_table();
+}
+
+
+/********************************************************************************
+ * create_packetin_filter_table() and delete_packetin_filter_table() tests.
+ ********************************************************************************/
+
+static void
+test_packetin_filter_tables_keep_entries_apart() {
+  init_packetin_filter_table();
+
+  match_table *table = create_packetin_filter_table();
+  select_packetin_filter_table( table );
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+  assert_int_equal( count_services( MATCH, PRIORITY ), 1 );
+
+  select_packetin_filter_table( NULL );
+  assert_int_equal( count_services( MATCH, PRIORITY ), 0 );
+  add_filter( MATCH, PRIORITY, ANOTHER_SERVICE_NAME );
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+  assert_int_equal( count_services( MATCH, PRIORITY ), 2 );
+
+  select_packetin_filter_table( table );
+  list_element *services = lookup_match_strict_entry( MATCH, PRIORITY );
+  assert_string_equal( services->data, SERVICE_NAME );
+  assert_true( services->next == NULL );
+
+  // frees the remaining entries and selects the default table again
+  delete_packetin_filter_table( table );
+  assert_int_equal( count_services( MATCH, PRIORITY ), 2 );
+
+  finalize_packetin_filter_table();
+}
+
+
+/********************************************************************************
+ * handle_packetin_filter_request() tests.
+ ********************************************************************************/
+
+static void
+test_handle_add_request_succeeds() {
+  init_packetin_filter_table();
+
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+
+  list_element *services = lookup_match_strict_entry( MATCH, PRIORITY );
+  assert_true( services != NULL );
+  assert_string_equal( services->data, SERVICE_NAME );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_add_request_fails_if_service_exists() {
+  init_packetin_filter_table();
+
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+
+  expect_string( mock_warn, message, "match entry already exists ( match = [eth_type = 0x0800, ip_proto = 0x06], service_name = [send_message_to_here] )" );
+  handle_request( MESSENGER_ADD_PACKETIN_FILTER_REQUEST, 0, MATCH, PRIORITY, SERVICE_NAME );
+  assert_int_equal( reply_tag, MESSENGER_ADD_PACKETIN_FILTER_REPLY );
+  assert_int_equal( ( ( add_packetin_filter_reply * ) reply_data )->status, PACKETIN_FILTER_OPERATION_FAILED );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_add_request_fails_without_service_name() {
+  init_packetin_filter_table();
+
+  expect_string( mock_error, message, "Service name must be specified." );
+  handle_request( MESSENGER_ADD_PACKETIN_FILTER_REQUEST, 0, MATCH, PRIORITY, "" );
+  assert_int_equal( reply_length, 0 );
+  assert_true( lookup_match_strict_entry( MATCH, PRIORITY ) == NULL );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_delete_request_with_PACKETIN_FILTER_FLAG_MATCH_STRICT() {
+  init_packetin_filter_table();
+
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+  add_filter( MATCH, PRIORITY, ANOTHER_SERVICE_NAME );
+
+  handle_request( MESSENGER_DELETE_PACKETIN_FILTER_REQUEST, PACKETIN_FILTER_FLAG_MATCH_STRICT, MATCH, PRIORITY, SERVICE_NAME );
+  assert_int_equal( reply_tag, MESSENGER_DELETE_PACKETIN_FILTER_REPLY );
+  delete_packetin_filter_reply *reply = ( delete_packetin_filter_reply * ) reply_data;
+  assert_int_equal( reply->status, PACKETIN_FILTER_OPERATION_SUCCEEDED );
+  assert_int_equal( ntohl( reply->n_deleted ), 1 );
+  assert_int_equal( count_services( MATCH, PRIORITY ), 1 );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_delete_request_with_PACKETIN_FILTER_FLAG_MATCH_LOOSE() {
+  init_packetin_filter_table();
+
+  oxm_matches *any = create_oxm_matches();
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+  add_filter( MATCH, PRIORITY, ANOTHER_SERVICE_NAME );
+  add_filter( any, 0, SERVICE_NAME );
+
+  handle_request( MESSENGER_DELETE_PACKETIN_FILTER_REQUEST, PACKETIN_FILTER_FLAG_MATCH_LOOSE, any, 0, "" );
+  assert_int_equal( reply_tag, MESSENGER_DELETE_PACKETIN_FILTER_REPLY );
+  delete_packetin_filter_reply *reply = ( delete_packetin_filter_reply * ) reply_data;
+  assert_int_equal( reply->status, PACKETIN_FILTER_OPERATION_SUCCEEDED );
+  assert_int_equal( ntohl( reply->n_deleted ), 3 );
+  assert_true( lookup_match_entry( MATCH ) == NULL );
+
+  delete_oxm_matches( any );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_dump_request_with_PACKETIN_FILTER_FLAG_MATCH_STRICT() {
+  init_packetin_filter_table();
+
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+  add_filter( MATCH, PRIORITY, ANOTHER_SERVICE_NAME );
+
+  handle_request( MESSENGER_DUMP_PACKETIN_FILTER_REQUEST, PACKETIN_FILTER_FLAG_MATCH_STRICT, MATCH, PRIORITY, ANOTHER_SERVICE_NAME );
+  assert_int_equal( reply_tag, MESSENGER_DUMP_PACKETIN_FILTER_REPLY );
+  dump_packetin_filter_reply *reply = ( dump_packetin_filter_reply * ) reply_data;
+  assert_int_equal( reply->status, PACKETIN_FILTER_OPERATION_SUCCEEDED );
+  assert_int_equal( ntohs( reply->length ), reply_length );
+  assert_int_equal( ntohl( reply->n_entries ), 1 );
+  assert_int_equal( ntohs( reply->entries[ 0 ].priority ), PRIORITY );
+  assert_string_equal( reply->entries[ 0 ].service_name, ANOTHER_SERVICE_NAME );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_dump_request_with_PACKETIN_FILTER_FLAG_MATCH_LOOSE() {
+  init_packetin_filter_table();
+
+  oxm_matches *any = create_oxm_matches();
+  add_filter( MATCH, PRIORITY, SERVICE_NAME );
+  add_filter( any, 0, ANOTHER_SERVICE_NAME );
+
+  handle_request( MESSENGER_DUMP_PACKETIN_FILTER_REQUEST, PACKETIN_FILTER_FLAG_MATCH_LOOSE, any, 0, "" );
+  assert_int_equal( reply_tag, MESSENGER_DUMP_PACKETIN_FILTER_REPLY );
+  dump_packetin_filter_reply *reply = ( dump_packetin_filter_reply * ) reply_data;
+  assert_int_equal( reply->status, PACKETIN_FILTER_OPERATION_SUCCEEDED );
+  assert_int_equal( ntohs( reply->length ), reply_length );
+  assert_int_equal( ntohl( reply->n_entries ), 2 );
+
+  delete_oxm_matches( any );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_request_fails_with_too_short_request() {
+  init_packetin_filter_table();
+
+  char request[ 1 ] = { 0 };
+  expect_string( mock_error, message, "Invalid add packetin filter request ( length = 1 )." );
+  handle_packetin_filter_request( HANDLE, MESSENGER_ADD_PACKETIN_FILTER_REQUEST, request, sizeof( request ) );
+
+  finalize_packetin_filter_table();
+}
+
+
+static void
+test_handle_request_fails_with_undefined_tag() {
+  init_packetin_filter_table();
+
+  char request[ 1 ] = { 0 };
+  expect_string( mock_warn, message, "Undefined request tag ( tag = 0xffff )." );
+  handle_packetin_filter_request( HANDLE, 0xffff, request, sizeof( request ) );
+
+  finalize_packetin_filter_table();
+}
+
+
+/********************************************************************************
+ * Run tests.
+ ********************************************************************************/
+
+int
+main() {
+  const UnitTest tests[] = {
+    // add_packetin_filter_entry() and delete_packetin_filter_entry() tests.
+    unit_test_setup_teardown( test_add_packetin_filter_entry_appends_services, setup, teardown ),
+    unit_test_setup_teardown( test_add_packetin_filter_entry_fails_if_service_exists, setup, teardown ),
+    unit_test_setup_teardown( test_delete_packetin_filter_entry_keeps_other_services, setup, teardown ),
+
+    // handle_packetin_filter_request() tests.
+    unit_test_setup_teardown( test_packetin_filter_tables_keep_entries_apart, setup, teardown ),
+    unit_test_setup_teardown( test_handle_add_request_succeeds, setup, teardown ),
+    unit_test_setup_teardown( test_handle_add_request_fails_if_service_exists, setup, teardown ),
+    unit_test_setup_teardown( test_handle_add_request_fails_without_service_name, setup, teardown ),
+    unit_test_setup_teardown( test_handle_delete_request_with_PACKETIN_FILTER_FLAG_MATCH_STRICT, setup, teardown ),
+    unit_test_setup_teardown( test_handle_delete_request_with_PACKETIN_FILTER_FLAG_MATCH_LOOSE, setup, teardown ),
+    unit_test_setup_teardown( test_handle_dump_request_with_PACKETIN_FILTER_FLAG_MATCH_STRICT, setup, teardown ),
+    unit_test_setup_teardown( test_handle_dump_request_with_PACKETIN_FILTER_FLAG_MATCH_LOOSE, setup, teardown ),
+    unit_test_setup_teardown( test_handle_request_fails_with_too_short_request, setup, teardown ),
+    unit_test_setup_teardown( test_handle_request_fails_with_undefined_tag, setup, teardown ),
+  };
+  setup_leak_detector();
+  return run_tests( tests );
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmockery_trema.h"
+#include "async_event_notifier.h"
+
+
+#define TABLE_ID 0
+#define COOKIE 0x1122334455667788ULL
+#define MAX_LEN 128
+#define TCP_SRC 1024
+
+
+/*************************************************************************
+ * Helper.
+ *************************************************************************/
+
+static int n_packet_ins = 0;
+
+
+static void
+count_packet_in( void *data, void *user_data ) {
+  UNUSED( data );
+  UNUSED( user_data );
+
+  n_packet_ins++;
+}
+
+
+static void
+send_packet_in( const uint8_t reason, const uint32_t in_port, const uint16_t tcp_dst ) {
+  match *match = create_match();
+  match->in_port.value = in_port;
+  match->in_port.valid = true;
+  match->tcp_src.value = TCP_SRC;
+  match->tcp_src.valid = true;
+  match->tcp_dst.value = tcp_dst;
+  match->tcp_dst.valid = true;
+  buffer *packet = alloc_buffer_with_length( 64 );
+  append_back_buffer( packet, 64 );
+
+  notify_packet_in( reason, TABLE_ID, COOKIE, match, packet, MAX_LEN );
+
+  free_buffer( packet );
+  delete_match( match );
+}
+
+
+static void
+assert_suppressed_packet_ins( const uint64_t expected_rate_limited, const uint64_t expected_coalesced ) {
+  uint64_t rate_limited = 0;
+  uint64_t coalesced = 0;
+  get_suppressed_packet_in_counts( &rate_limited, &coalesced );
+  assert_true( rate_limited == expected_rate_limited );
+  assert_true( coalesced == expected_coalesced );
+}
+
+
+static void
+setup() {
+  n_packet_ins = 0;
+  init_async_event_notifier( 0 );
+  set_async_event_handler( ASYNC_EVENT_TYPE_PACKET_IN, count_packet_in, NULL );
+}
+
+
+static void
+teardown() {
+  finalize_async_event_notifier();
+}
+
+
+/*************************************************************************
+ * Async config tests.
+ *************************************************************************/
+
+static void
+test_packet_in_is_not_notified_if_reason_is_masked() {
+  async_config config;
+  get_async_config( &config );
+  config.packet_in_mask[ 0 ] = 1U << OFPR_ACTION;
+  set_async_config( &config );
+
+  assert_false( packet_in_enabled( OFPR_NO_MATCH ) );
+  assert_true( packet_in_enabled( OFPR_ACTION ) );
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  assert_int_equal( n_packet_ins, 0 );
+  send_packet_in( OFPR_ACTION, 1, 80 );
+  assert_int_equal( n_packet_ins, 1 );
+  // masked packet-ins are not counted as suppressed
+  assert_suppressed_packet_ins( 0, 0 );
+}
+
+
+static void
+test_flow_removed_is_enabled_by_mask() {
+  set_async_event_handler( ASYNC_EVENT_TYPE_FLOW_REMOVED, count_packet_in, NULL );
+  async_config config;
+  get_async_config( &config );
+  config.flow_removed_mask[ 0 ] = 1U << OFPRR_DELETE;
+  set_async_config( &config );
+
+  assert_false( flow_removed_enabled( OFPRR_IDLE_TIMEOUT ) );
+  assert_true( flow_removed_enabled( OFPRR_DELETE ) );
+}
+
+
+static void
+test_async_events_are_not_enabled_without_handler() {
+  set_async_event_handler( ASYNC_EVENT_TYPE_PACKET_IN, NULL, NULL );
+
+  assert_false( packet_in_enabled( OFPR_NO_MATCH ) );
+  assert_false( flow_removed_enabled( OFPRR_DELETE ) );
+}
+
+
+static void
+test_reset_async_config_restores_defaults() {
+  async_config defaults;
+  get_async_config( &defaults );
+  async_config config;
+  memset( &config, 0, sizeof( async_config ) );
+  set_async_config( &config );
+  assert_false( packet_in_enabled( OFPR_NO_MATCH ) );
+
+  assert_int_equal( reset_async_config(), OFDPE_SUCCESS );
+
+  get_async_config( &config );
+  assert_memory_equal( &config, &defaults, sizeof( async_config ) );
+  assert_true( packet_in_enabled( OFPR_NO_MATCH ) );
+}
+
+
+/*************************************************************************
+ * Rate limiter tests.
+ *************************************************************************/
+
+static void
+test_packet_ins_are_not_limited_by_default() {
+  for ( int i = 0; i < 100; i++ ) {
+    send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  }
+
+  assert_int_equal( n_packet_ins, 100 );
+  assert_suppressed_packet_ins( 0, 0 );
+}
+
+
+static void
+test_packet_ins_are_limited_per_port() {
+  packet_in_limits limits = { .port_rate = 1, .port_burst = 2 };
+  assert_int_equal( set_packet_in_limits( &limits ), OFDPE_SUCCESS );
+
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  send_packet_in( OFPR_NO_MATCH, 1, 81 );
+  send_packet_in( OFPR_NO_MATCH, 1, 82 );
+  assert_int_equal( n_packet_ins, 2 );
+  assert_suppressed_packet_ins( 1, 0 );
+
+  // other ports have buckets of their own
+  send_packet_in( OFPR_NO_MATCH, 2, 80 );
+  assert_int_equal( n_packet_ins, 3 );
+}
+
+
+static void
+test_packet_ins_are_limited_per_reason() {
+  packet_in_limits limits = { .reason_rate = 1, .reason_burst = 2 };
+  assert_int_equal( set_packet_in_limits( &limits ), OFDPE_SUCCESS );
+
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  send_packet_in( OFPR_NO_MATCH, 2, 80 );
+  send_packet_in( OFPR_NO_MATCH, 3, 80 );
+  assert_int_equal( n_packet_ins, 2 );
+  assert_suppressed_packet_ins( 1, 0 );
+
+  send_packet_in( OFPR_ACTION, 1, 80 );
+  assert_int_equal( n_packet_ins, 3 );
+}
+
+
+static void
+test_packet_in_dropped_by_port_limit_does_not_take_reason_token() {
+  packet_in_limits limits = { .port_rate = 1, .port_burst = 1, .reason_rate = 1, .reason_burst = 2 };
+  assert_int_equal( set_packet_in_limits( &limits ), OFDPE_SUCCESS );
+
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  send_packet_in( OFPR_NO_MATCH, 1, 81 );
+  send_packet_in( OFPR_NO_MATCH, 2, 80 );
+  assert_int_equal( n_packet_ins, 2 );
+  send_packet_in( OFPR_NO_MATCH, 3, 80 );
+  assert_int_equal( n_packet_ins, 2 );
+  assert_suppressed_packet_ins( 2, 0 );
+}
+
+
+/*************************************************************************
+ * Coalescing tests.
+ *************************************************************************/
+
+static void
+test_packet_ins_of_same_microflow_are_coalesced() {
+  packet_in_limits limits = { .coalesce_count = 2 };
+  assert_int_equal( set_packet_in_limits( &limits ), OFDPE_SUCCESS );
+
+  for ( int i = 0; i < 5; i++ ) {
+    send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  }
+  assert_int_equal( n_packet_ins, 2 );
+  assert_suppressed_packet_ins( 0, 3 );
+
+  // another microflow
+  send_packet_in( OFPR_NO_MATCH, 1, 81 );
+  assert_int_equal( n_packet_ins, 3 );
+}
+
+
+static void
+test_packet_ins_are_sent_again_in_next_coalesce_window() {
+  packet_in_limits limits = { .coalesce_count = 1, .coalesce_window_msec = 10 };
+  assert_int_equal( set_packet_in_limits( &limits ), OFDPE_SUCCESS );
+
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  assert_int_equal( n_packet_ins, 1 );
+
+  struct timespec wait = { 0, 20 * 1000 * 1000 };
+  nanosleep( &wait, NULL );
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  assert_int_equal( n_packet_ins, 2 );
+  assert_suppressed_packet_ins( 0, 1 );
+}
+
+
+static void
+test_coalesced_packet_ins_do_not_take_tokens() {
+  packet_in_limits limits = { .reason_rate = 1, .reason_burst = 2, .coalesce_count = 1 };
+  assert_int_equal( set_packet_in_limits( &limits ), OFDPE_SUCCESS );
+
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  send_packet_in( OFPR_NO_MATCH, 1, 80 );
+  send_packet_in( OFPR_NO_MATCH, 1, 81 );
+  assert_int_equal( n_packet_ins, 2 );
+  assert_suppressed_packet_ins( 0, 1 );
+}
+
+
+/*************************************************************************
+ * Run tests.
+ *************************************************************************/
+
+int
+main() {
+  const UnitTest tests[] = {
+    unit_test_setup_teardown( test_packet_in_is_not_notified_if_reason_is_masked, setup, teardown ),
+    unit_test_setup_teardown( test_flow_removed_is_enabled_by_mask, setup, teardown ),
+    unit_test_setup_teardown( test_async_events_are_not_enabled_without_handler, setup, teardown ),
+    unit_test_setup_teardown( test_reset_async_config_restores_defaults, setup, teardown ),
+    unit_test_setup_teardown( test_packet_ins_are_not_limited_by_default, setup, teardown ),
+    unit_test_setup_teardown( test_packet_ins_are_limited_per_port, setup, teardown ),
+    unit_test_setup_teardown( test_packet_ins_are_limited_per_reason, setup, teardown ),
+    unit_test_setup_teardown( test_packet_in_dropped_by_port_limit_does_not_take_reason_token, setup, teardown ),
+    unit_test_setup_teardown( test_packet_ins_of_same_microflow_are_coalesced, setup, teardown ),
+    unit_test_setup_teardown( test_packet_ins_are_sent_again_in_next_coalesce_window, setup, teardown ),
+    unit_test_setup_teardown( test_coalesced_packet_ins_do_not_take_tokens, setup, teardown ),
+  };
+
+  return run_tests( tests );
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmockery_trema.h"
+#include "flow_table.h"
+#include "group_table.h"
+#include "table_manager.h"
+
+
+#define MAX_FLOW_ENTRIES 2
+#define TABLE_ID 0
+#define PRIORITY 100
+#define GROUP_ID 1
+
+
+/*************************************************************************
+ * Helper.
+ *************************************************************************/
+
+static flow_entry *
+create_flow_entry( const uint32_t in_port, action *action ) {
+  match *match = create_match();
+  match->in_port.value = in_port;
+  match->in_port.mask = UINT32_MAX;
+  match->in_port.valid = true;
+
+  action_list *actions = create_action_list();
+  append_action( actions, action );
+  instruction_set *instructions = create_instruction_set();
+  add_instruction( instructions, alloc_instruction_apply_actions( actions ) );
+
+  return alloc_flow_entry( match, instructions, PRIORITY, 0, 0, 0, 0 );
+}
+
+
+static flow_entry *
+create_flow_entry_to_controller( const uint32_t in_port ) {
+  return create_flow_entry( in_port, create_action_output( OFPP_CONTROLLER, OFPCML_NO_BUFFER ) );
+}
+
+
+static flow_entry *
+lookup_flow_entry_by_in_port( const uint32_t in_port ) {
+  match *match = create_match();
+  match->in_port.value = in_port;
+  match->in_port.mask = UINT32_MAX;
+  match->in_port.valid = true;
+  flow_entry *entry = lookup_flow_entry_strict( TABLE_ID, match, PRIORITY );
+  delete_match( match );
+
+  return entry;
+}
+
+
+static void
+setup() {
+  init_timer_safe();
+  init_table_manager( MAX_FLOW_ENTRIES );
+}
+
+
+static void
+teardown() {
+  finalize_table_manager();
+  finalize_timer_safe();
+}
+
+
+/*************************************************************************
+ * stage_flow_entry() tests.
+ *************************************************************************/
+
+static void
+test_stage_flow_entry_does_not_change_flow_table() {
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+
+  assert_int_equal( stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 1 ), 0 ), OFDPE_SUCCESS );
+  assert_int_equal( bundle->n_additions, 1 );
+  assert_true( lookup_flow_entry_by_in_port( 1 ) == NULL );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+static void
+test_stage_flow_entry_replaces_staged_entry_with_same_match() {
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+
+  assert_int_equal( stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 1 ), 0 ), OFDPE_SUCCESS );
+  assert_int_equal( stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 1 ), 0 ), OFDPE_SUCCESS );
+  assert_int_equal( bundle->n_additions, 1 );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+static void
+test_stage_flow_entry_fails_if_group_does_not_exist() {
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  flow_entry *entry = create_flow_entry( 1, create_action_group( GROUP_ID ) );
+
+  assert_int_equal( stage_flow_entry( bundle, TABLE_ID, entry, 0 ), ERROR_OFDPE_BAD_ACTION_BAD_OUT_GROUP );
+  assert_int_equal( bundle->n_additions, 0 );
+
+  free_flow_entry( entry );
+  delete_flow_entry_bundle( bundle );
+}
+
+
+/*************************************************************************
+ * commit_flow_entry_bundle() tests.
+ *************************************************************************/
+
+static void
+test_commit_flow_entry_bundle_adds_all_entries() {
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  flow_entry *first = create_flow_entry_to_controller( 1 );
+  flow_entry *second = create_flow_entry_to_controller( 2 );
+  stage_flow_entry( bundle, TABLE_ID, first, 0 );
+  stage_flow_entry( bundle, TABLE_ID, second, 0 );
+
+  assert_int_equal( commit_flow_entry_bundle( bundle ), OFDPE_SUCCESS );
+  assert_int_equal( bundle->n_additions, 0 );
+  assert_true( lookup_flow_entry_by_in_port( 1 ) == first );
+  assert_true( lookup_flow_entry_by_in_port( 2 ) == second );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+static void
+test_commit_flow_entry_bundle_fails_if_table_is_full() {
+  assert_int_equal( add_flow_entry( TABLE_ID, create_flow_entry_to_controller( 1 ), 0 ), OFDPE_SUCCESS );
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 2 ), 0 );
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 3 ), 0 );
+
+  assert_int_equal( commit_flow_entry_bundle( bundle ), ERROR_OFDPE_FLOW_MOD_FAILED_TABLE_FULL );
+  assert_int_equal( bundle->n_additions, 2 );
+  assert_true( lookup_flow_entry_by_in_port( 2 ) == NULL );
+  assert_true( lookup_flow_entry_by_in_port( 3 ) == NULL );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+static void
+test_commit_flow_entry_bundle_does_not_count_replaced_entries() {
+  assert_int_equal( add_flow_entry( TABLE_ID, create_flow_entry_to_controller( 1 ), 0 ), OFDPE_SUCCESS );
+  assert_int_equal( add_flow_entry( TABLE_ID, create_flow_entry_to_controller( 2 ), 0 ), OFDPE_SUCCESS );
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  flow_entry *first = create_flow_entry_to_controller( 1 );
+  flow_entry *second = create_flow_entry_to_controller( 2 );
+  stage_flow_entry( bundle, TABLE_ID, first, 0 );
+  stage_flow_entry( bundle, TABLE_ID, second, 0 );
+
+  assert_int_equal( commit_flow_entry_bundle( bundle ), OFDPE_SUCCESS );
+  assert_true( lookup_flow_entry_by_in_port( 1 ) == first );
+  assert_true( lookup_flow_entry_by_in_port( 2 ) == second );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+static void
+test_commit_flow_entry_bundle_fails_if_overlapping() {
+  assert_int_equal( add_flow_entry( TABLE_ID, create_flow_entry_to_controller( 1 ), 0 ), OFDPE_SUCCESS );
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 2 ), 0 );
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 1 ), OFPFF_CHECK_OVERLAP );
+
+  assert_int_equal( commit_flow_entry_bundle( bundle ), ERROR_OFDPE_FLOW_MOD_FAILED_OVERLAP );
+  assert_true( lookup_flow_entry_by_in_port( 2 ) == NULL );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+static void
+test_commit_flow_entry_bundle_fails_if_group_does_not_exist() {
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 1 ), 0 );
+  flow_entry *entry = create_flow_entry_to_controller( 2 );
+  assert_int_equal( stage_flow_entry( bundle, TABLE_ID, entry, 0 ), OFDPE_SUCCESS );
+  // as if the group were deleted after the entry is staged
+  append_action( entry->instructions->apply_actions->actions, create_action_group( GROUP_ID ) );
+
+  assert_int_equal( commit_flow_entry_bundle( bundle ), ERROR_OFDPE_BAD_ACTION_BAD_OUT_GROUP );
+  assert_true( lookup_flow_entry_by_in_port( 1 ) == NULL );
+  assert_true( lookup_flow_entry_by_in_port( 2 ) == NULL );
+
+  delete_flow_entry_bundle( bundle );
+}
+
+
+/*************************************************************************
+ * delete_flow_entry_bundle() tests.
+ *************************************************************************/
+
+static void
+test_delete_flow_entry_bundle_discards_staged_entries() {
+  flow_entry_bundle *bundle = create_flow_entry_bundle();
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 1 ), 0 );
+  stage_flow_entry( bundle, TABLE_ID, create_flow_entry_to_controller( 2 ), 0 );
+
+  delete_flow_entry_bundle( bundle );
+
+  assert_true( lookup_flow_entry_by_in_port( 1 ) == NULL );
+  assert_true( lookup_flow_entry_by_in_port( 2 ) == NULL );
+}
+
+
+/*************************************************************************
+ * Run tests.
+ *************************************************************************/
+
+int
+main() {
+  const UnitTest tests[] = {
+    unit_test_setup_teardown( test_stage_flow_entry_does_not_change_flow_table, setup, teardown ),
+    unit_test_setup_teardown( test_stage_flow_entry_replaces_staged_entry_with_same_match, setup, teardown ),
+    unit_test_setup_teardown( test_stage_flow_entry_fails_if_group_does_not_exist, setup, teardown ),
+    unit_test_setup_teardown( test_commit_flow_entry_bundle_adds_all_entries, setup, teardown ),
+    unit_test_setup_teardown( test_commit_flow_entry_bundle_fails_if_table_is_full, setup, teardown ),
+    unit_test_setup_teardown( test_commit_flow_entry_bundle_does_not_count_replaced_entries, setup, teardown ),
+    unit_test_setup_teardown( test_commit_flow_entry_bundle_fails_if_overlapping, setup, teardown ),
+    unit_test_setup_teardown( test_commit_flow_entry_bundle_fails_if_group_does_not_exist, setup, teardown ),
+    unit_test_setup_teardown( test_delete_flow_entry_bundle_discards_staged_entries, setup, teardown ),
+  };
+
+  return run_tests( tests );
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
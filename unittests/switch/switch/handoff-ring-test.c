@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2008-2013 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmockery_trema.h"
+#include "wrapper.h"
+#include "checks.h"
+#include "handoff-ring.h"
+
+
+#define RING_SIZE 4
+#define N_THREADED_MESSAGES 100000
+
+
+/*************************************************************************
+ * Helper.
+ *************************************************************************/
+
+static void ( *original_die )( const char *format, ... );
+
+static void
+mock_die( const char *format, ... ) {
+  UNUSED( format );
+  mock_assert( false, "mock_die", __FILE__, __LINE__ ); } // Hoaxes gcov.
+
+
+static void
+setup() {
+  original_die = die;
+  die = mock_die;
+}
+
+
+static void
+teardown() {
+  die = original_die;
+}
+
+
+/*************************************************************************
+ * create and delete tests.
+ *************************************************************************/
+
+static void
+test_create_handoff_ring() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+  assert_true( ring != NULL );
+  assert_int_equal( ring->mask, RING_SIZE - 1 );
+  assert_true( handoff_ring_is_empty( ring ) );
+  assert_true( pop_handoff_ring( ring ) == NULL );
+
+  delete_handoff_ring( ring );
+}
+
+
+static void
+test_create_handoff_ring_if_size_is_not_power_of_two() {
+  expect_assert_failure( create_handoff_ring( 3 ) );
+}
+
+
+static void
+test_delete_handoff_ring_frees_remaining_messages() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+  assert_true( push_handoff_ring( ring, alloc_buffer() ) );
+  assert_true( push_handoff_ring( ring, alloc_buffer() ) );
+
+  delete_handoff_ring( ring );
+}
+
+
+/*************************************************************************
+ * push and pop tests.
+ *************************************************************************/
+
+static void
+test_push_and_pop_handoff_ring() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+  buffer *first = alloc_buffer();
+  buffer *second = alloc_buffer();
+
+  assert_true( push_handoff_ring( ring, first ) );
+  assert_true( push_handoff_ring( ring, second ) );
+  assert_false( handoff_ring_is_empty( ring ) );
+
+  buffer *popped = pop_handoff_ring( ring );
+  assert_true( popped == first );
+  free_buffer( popped );
+  popped = pop_handoff_ring( ring );
+  assert_true( popped == second );
+  free_buffer( popped );
+  assert_true( pop_handoff_ring( ring ) == NULL );
+  assert_true( handoff_ring_is_empty( ring ) );
+
+  delete_handoff_ring( ring );
+}
+
+
+static void
+test_push_handoff_ring_fails_if_ring_is_full() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+  buffer *messages[ RING_SIZE ];
+  for ( int i = 0; i < RING_SIZE; i++ ) {
+    messages[ i ] = alloc_buffer();
+    assert_true( push_handoff_ring( ring, messages[ i ] ) );
+  }
+
+  buffer *overflow = alloc_buffer();
+  assert_false( push_handoff_ring( ring, overflow ) );
+
+  buffer *popped = pop_handoff_ring( ring );
+  assert_true( popped == messages[ 0 ] );
+  free_buffer( popped );
+  assert_true( push_handoff_ring( ring, overflow ) );
+  for ( int i = 1; i < RING_SIZE; i++ ) {
+    popped = pop_handoff_ring( ring );
+    assert_true( popped == messages[ i ] );
+    free_buffer( popped );
+  }
+  popped = pop_handoff_ring( ring );
+  assert_true( popped == overflow );
+  free_buffer( popped );
+
+  delete_handoff_ring( ring );
+}
+
+
+static void
+test_push_and_pop_handoff_ring_wraps_around() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+  // start just below the index overflow so that both slots and indexes wrap
+  ring->head = ring->tail = UINT32_MAX - 1;
+
+  for ( int round = 0; round < RING_SIZE * 3; round++ ) {
+    buffer *first = alloc_buffer();
+    buffer *second = alloc_buffer();
+    buffer *third = alloc_buffer();
+    assert_true( push_handoff_ring( ring, first ) );
+    assert_true( push_handoff_ring( ring, second ) );
+    assert_true( push_handoff_ring( ring, third ) );
+
+    buffer *popped = pop_handoff_ring( ring );
+    assert_true( popped == first );
+    free_buffer( popped );
+    popped = pop_handoff_ring( ring );
+    assert_true( popped == second );
+    free_buffer( popped );
+    popped = pop_handoff_ring( ring );
+    assert_true( popped == third );
+    free_buffer( popped );
+    assert_true( handoff_ring_is_empty( ring ) );
+  }
+
+  delete_handoff_ring( ring );
+}
+
+
+/*************************************************************************
+ * notification tests.
+ *************************************************************************/
+
+static void
+test_request_handoff_ring_notification_only_once_until_reset() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+
+  assert_true( request_handoff_ring_notification( ring ) );
+  assert_false( request_handoff_ring_notification( ring ) );
+  reset_handoff_ring_notification( ring );
+  assert_true( request_handoff_ring_notification( ring ) );
+
+  delete_handoff_ring( ring );
+}
+
+
+/*************************************************************************
+ * producer and consumer threads tests.
+ *************************************************************************/
+
+typedef struct {
+  handoff_ring *ring;
+  buffer **messages;
+} producer_args;
+
+
+static void *
+produce( void *data ) {
+  producer_args *args = data;
+  for ( int i = 0; i < N_THREADED_MESSAGES; i++ ) {
+    while ( !push_handoff_ring( args->ring, args->messages[ i ] ) ) {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+
+static void
+test_handoff_ring_between_producer_and_consumer_threads() {
+  handoff_ring *ring = create_handoff_ring( RING_SIZE );
+  // buffers are allocated here since the leak detector is not thread safe
+  buffer **messages = xmalloc( sizeof( buffer * ) * N_THREADED_MESSAGES );
+  for ( int i = 0; i < N_THREADED_MESSAGES; i++ ) {
+    messages[ i ] = alloc_buffer();
+  }
+
+  producer_args args = { ring, messages };
+  pthread_t producer;
+  assert_int_equal( pthread_create( &producer, NULL, produce, &args ), 0 );
+
+  int received = 0;
+  while ( received < N_THREADED_MESSAGES ) {
+    buffer *popped = pop_handoff_ring( ring );
+    if ( popped == NULL ) {
+      sched_yield();
+      continue;
+    }
+    if ( popped != messages[ received ] ) {
+      fail();
+    }
+    received++;
+  }
+  assert_int_equal( pthread_join( producer, NULL ), 0 );
+  assert_true( handoff_ring_is_empty( ring ) );
+
+  for ( int i = 0; i < N_THREADED_MESSAGES; i++ ) {
+    free_buffer( messages[ i ] );
+  }
+  xfree( messages );
+  delete_handoff_ring( ring );
+}
+
+
+/*************************************************************************
+ * Run tests.
+ *************************************************************************/
+
+int
+main() {
+  const UnitTest tests[] = {
+    unit_test_setup_teardown( test_create_handoff_ring, setup, teardown ),
+    unit_test_setup_teardown( test_create_handoff_ring_if_size_is_not_power_of_two, setup, teardown ),
+    unit_test_setup_teardown( test_delete_handoff_ring_frees_remaining_messages, setup, teardown ),
+    unit_test_setup_teardown( test_push_and_pop_handoff_ring, setup, teardown ),
+    unit_test_setup_teardown( test_push_handoff_ring_fails_if_ring_is_full, setup, teardown ),
+    unit_test_setup_teardown( test_push_and_pop_handoff_ring_wraps_around, setup, teardown ),
+    unit_test_setup_teardown( test_request_handoff_ring_notification_only_once_until_reset, setup, teardown ),
+    unit_test_setup_teardown( test_handoff_ring_between_producer_and_consumer_threads, setup, teardown ),
+  };
+
+  return run_tests( tests );
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -29,6 +29,10 @@ mock_switch_send_openflow_message( buffer *buffer ) {
   if ( header->type == OFPT_GET_CONFIG_REPLY ) {
     check_expected( ( ( struct ofp_switch_config * ) buffer->data )->flags );
   } 
+  else if ( header->type == OFPT_GET_ASYNC_REPLY ) {
+    uint32_t packet_in_mask = ntohl( ( ( struct ofp_async_config * ) buffer->data )->packet_in_mask[ 0 ] );
+    check_expected( packet_in_mask );
+  }
   return true;
 }
 
@@ -100,6 +100,29 @@ test_set_config( void **state ) {
 }
 
 
+static void
+test_set_async_and_get_async_request( void **state ) {
+  UNUSED( state );
+
+  uint32_t packet_in_mask[ 2 ] = { 1U << OFPR_ACTION, 0 };
+  uint32_t port_status_mask[ 2 ] = { 1U << OFPPR_ADD, 1U << OFPPR_ADD };
+  uint32_t flow_removed_mask[ 2 ] = { 1U << OFPRR_DELETE, 0 };
+  handle_set_async( TRANSACTION_ID, packet_in_mask, port_status_mask, flow_removed_mask, NULL );
+
+  async_config config;
+  get_async_config( &config );
+  assert_memory_equal( config.packet_in_mask, packet_in_mask, sizeof( packet_in_mask ) );
+  assert_memory_equal( config.port_status_mask, port_status_mask, sizeof( port_status_mask ) );
+  assert_memory_equal( config.flow_removed_mask, flow_removed_mask, sizeof( flow_removed_mask ) );
+
+  expect_value( mock_switch_send_openflow_message, buffer->length, sizeof( struct ofp_async_config ) );
+  expect_value( mock_switch_send_openflow_message, packet_in_mask, packet_in_mask[ 0 ] );
+  handle_get_async_request( TRANSACTION_ID, NULL );
+
+  reset_async_config();
+}
+
+
 static void
 finalize_datapath_condition( void **state ) {
   UNUSED( state );
@@ -111,6 +134,7 @@ int
 main( void ) {
   const UnitTest tests[] = {
     unit_test_setup_teardown( test_set_config, init_datapath_condition, finalize_datapath_condition ),
+    unit_test_setup_teardown( test_set_async_and_get_async_request, init_datapath_condition, finalize_datapath_condition ),
   };
   return run_tests( tests );
 }
@@ -62,7 +62,7 @@ extern uint16_t count_features( void *feature, size_t feature_size );
 extern uint16_t assign_instruction_ids( struct ofp_instruction *ins, instructions_capabilities *instructions_cap );
 extern uint16_t assign_action_ids( struct ofp_action_header *ac_hdr, actions_capabilities *action_cap );
 extern struct ofp_table_features * assign_table_features( table_features *table_feature );
-extern flow_stats *retrieve_flow_stats( uint32_t *nr_stats, uint8_t table_id, uint32_t out_port, uint32_t out_group, uint64_t cookie, uint64_t cookie_mask, struct ofp_match *match );
+extern flow_stats_cursor *open_flow_stats_cursor( uint8_t table_id, uint32_t out_port, uint32_t out_group, uint64_t cookie, uint64_t cookie_mask, struct ofp_match *match );
 
 static const uint8_t HW_ADDR[ OFP_ETH_ALEN ] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
 static const char *DEV_NAME = "test_veth";
@@ -907,7 +907,7 @@ test_assign_table_features( void **state ) {
 
 
 static void
-test_retrieve_flow_stats( void **state ) {
+test_open_flow_stats_cursor( void **state ) {
   UNUSED( state );
 
   uint16_t total_len = ( uint16_t ) ( sizeof( struct ofp_match ) +
@@ -946,8 +946,13 @@ test_retrieve_flow_stats( void **state ) {
   uint64_t cookie = COOKIE;
   uint64_t cookie_mask = 0xffffffffffffffff;
   init_table_manager();
-  retrieve_flow_stats( &nr_stats, table_id, out_port, out_group, cookie, cookie_mask, ofp_match );
+  flow_stats_cursor *cursor = open_flow_stats_cursor( table_id, out_port, out_group, cookie, cookie_mask, ofp_match );
+  assert_true( cursor != NULL );
+  assert_true( cursor->done );
+  flow_stats stats[ 1 ];
+  assert_int_equal( get_next_flow_stats( cursor, stats, 1, &nr_stats ), OFDPE_SUCCESS );
   assert_int_equal( nr_stats, 0 );
+  delete_flow_stats_cursor( cursor );
 }
 
 
@@ -1062,7 +1067,7 @@ main( void ) {
     unit_test( test_assign_instruction_ids ),
     unit_test( test_assign_action_ids ),
     unit_test( test_assign_table_features ),
-    unit_test( test_retrieve_flow_stats ),
+    unit_test( test_open_flow_stats_cursor ),
     unit_test( test_desc_stats ),
   };
   return run_tests( tests );